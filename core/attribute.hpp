@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <mutex>
+
 #include "absl/container/flat_hash_map.h"
 #include "lgraph.hpp"
 #include "mmap_bimap.hpp"
@@ -9,9 +13,46 @@
 
 template <const char *Name, typename Base, typename Attr_data>
 class Attribute {
-  inline static absl::flat_hash_map<std::string, Attr_data *> lg2attr;
-  inline static const LGraph *           last_lg   = nullptr;
-  inline static Attr_data *              last_attr = nullptr;
+  // Lg_type_id is unique inside a library (lgdb path), the library pointer is stable
+  struct Key {
+    const Graph_library *lib;
+    Lg_type_id::type     lgid;
+
+    bool operator==(const Key &other) const { return lib == other.lib && lgid == other.lgid; }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key &k) {
+      return H::combine(std::move(h), k.lib, k.lgid);
+    };
+  };
+
+  // One slot per (library, lgid). Slots are never freed, so the thread caches can
+  // check them without the lock. The slot generation is bumped each time its
+  // Attr_data is deleted: only the caches of that lgraph are dropped.
+  struct Slot {
+    Attr_data            *attr = nullptr;
+    std::atomic<uint64_t> generation{0};
+  };
+
+  // Never destroyed: Graph_library syncs the open lgraphs from a static destructor
+  inline static absl::flat_hash_map<Key, Slot *> &lg2attr = *new absl::flat_hash_map<Key, Slot *>;
+  inline static std::mutex                         lg2attr_mutex;  // lg2attr is shared across threads
+
+  // Small per thread cache. Hierarchical traversals alternate between a few lgraphs (parent and subs)
+  static constexpr int Cache_entries = 4;
+  struct Cache_entry {
+    Key        key        = {nullptr, 0};
+    Slot      *slot       = nullptr;
+    Attr_data *attr       = nullptr;
+    uint64_t   generation = 0;
+  };
+  struct Cache {
+    int                                    next_victim = 0;
+    std::array<Cache_entry, Cache_entries> entry;
+  };
+  inline static thread_local Cache cache;
+
+  static Key get_key(const LGraph *lg) { return Key{&lg->get_library(), lg->get_lgid().value}; }
 
   static std::string_view get_base() {
     if constexpr (std::is_same<Base, Node>::value) {
@@ -24,62 +65,94 @@ class Attribute {
 
   static std::string get_filename(Lg_type_id lgid) { return absl::StrCat("lg_", std::to_string(lgid), get_base(), Name); };
 
-  static void setup_table(const LGraph *lg) {
-    last_lg  = lg;
+  static Attr_data *setup_table(const LGraph *lg, Cache_entry *e) {
+    const auto key = get_key(lg);
+
+    Slot *slot;
+    {
+      std::lock_guard<std::mutex> guard(lg2attr_mutex);
+
+      auto it = lg2attr.find(key);
+      if (likely(it != lg2attr.end())) {
+        slot = it->second;
+      } else {
+        slot         = new Slot;
+        lg2attr[key] = slot;
+      }
+      if (slot->attr == nullptr)
+        slot->attr = new Attr_data(lg->get_path(), get_filename(lg->get_lgid()));
+
+      if (e == nullptr) {
+        e                 = &cache.entry[cache.next_victim];
+        cache.next_victim = (cache.next_victim + 1) % Cache_entries;
+      }
+      e->key        = key;
+      e->slot       = slot;
+      e->attr       = slot->attr;
+      e->generation = slot->generation.load(std::memory_order_relaxed);  // under the lock
+    }
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    //fmt::print("key:{} attr:{} lg:{}\n", key, Name, (void *)lg);
+    return e->attr;
+  };
 
-    auto it = lg2attr.find(key);
-    if (likely(it != lg2attr.end())) {
-      last_attr = it->second;
-    }else{
-      last_attr  = new Attr_data(lg->get_path(), get_filename(lg->get_lgid()));
-      lg2attr[key] = last_attr;
+  static Attr_data *find(const LGraph *lg) {
+    const auto key = get_key(lg);
+    for (auto &e : cache.entry) {
+      if (e.key == key) {
+        if (likely(e.slot->generation.load(std::memory_order_acquire) == e.generation))
+          return e.attr;
+        return setup_table(lg, &e);  // deleted (sync/clear) since cached
+      }
     }
-  };
+
+    return setup_table(lg, nullptr);
+  }
+
+  static Attr_data *try_erase(const LGraph *lg) {  // nullptr if not open
+    std::lock_guard<std::mutex> guard(lg2attr_mutex);
+
+    auto it = lg2attr.find(get_key(lg));
+    if (it == lg2attr.end() || it->second->attr == nullptr)
+      return nullptr;
+
+    auto *slot = it->second;
+    auto *attr = slot->attr;
+    slot->attr = nullptr;
+    slot->generation.fetch_add(1, std::memory_order_acq_rel);
+
+    return attr;
+  }
 
   static_assert(std::is_same<Base, Node_pin>::value || std::is_same<Base, Node>::value, "Base should be Node or Node_pin");
 
 public:
-  static Attr_data *ref(const Base &obj) {
-    if (unlikely(obj.get_top_lgraph() != last_lg))
-      setup_table(obj.get_top_lgraph());
-    return last_attr;
-  }
-  static Attr_data *ref(const LGraph *lg) {
-    if (unlikely(lg != last_lg))
-      setup_table(lg);
-    return last_attr;
-  }
+  static Attr_data *ref(const Base &obj) { return find(obj.get_top_lgraph()); }
+  static Attr_data *ref(const LGraph *lg) { return find(lg); }
 
   static void clear(const LGraph *lg) {
-    setup_table(lg);
+    find(lg);  // Make sure that it is open (clear the file too)
 
-    I(last_lg == lg); // setup table forces this
+    auto *attr = try_erase(lg);
+    I(attr);
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    I(lg2attr[key] == last_attr);
-    lg2attr.erase(key);
+    attr->clear();
+    delete attr;  // Delete does not clear
+  }
 
-    last_attr->clear();
-    delete last_attr;  // Delete does not clear
+  static void sync(const LGraph *lg) {
+    auto *attr = try_erase(lg);
+    if (attr == nullptr)
+      return;
 
-    last_lg   = nullptr;
-    last_attr = nullptr;
+    delete attr;
   }
 
-  static void sync(const LGraph *lg) {
-    if (last_lg == lg) {
-      last_lg   = nullptr;
-      last_attr = nullptr;
-    }
+  // Release the mmaps, but keep the table open (Attr_data pointers stay valid)
+  static void unmap(const LGraph *lg) {
+    std::lock_guard<std::mutex> guard(lg2attr_mutex);
 
-    const auto key = absl::StrCat(lg->get_unique_name(), Name);
-    auto it = lg2attr.find(key);
-    if (it == lg2attr.end())
-      return;
-    delete it->second;
-    lg2attr.erase(it);
+    auto it = lg2attr.find(get_key(lg));
+    if (it != lg2attr.end() && it->second->attr)
+      it->second->attr->sync();
   }
 };
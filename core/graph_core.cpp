@@ -1,6 +1,414 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
 #include "graph_core.hpp"
 
-Graph_core::Graph_core(std::string_view path, std::string_view name) {
-  // todo
+#include "absl/strings/str_cat.h"
+
+//---------------------------------------------------------------
+// Entry64
+
+void Graph_core::Entry64::fill_inp(std::vector<Index_ID> &ev) const {
+  for (auto i = 0u; i < n_edges; ++i) {
+    if (is_input(edge[i]))
+      ev.emplace_back(get_id(edge[i]));
+  }
+}
+
+void Graph_core::Entry64::fill_out(std::vector<Index_ID> &ev) const {
+  for (auto i = 0u; i < n_edges; ++i) {
+    if (!is_input(edge[i]))
+      ev.emplace_back(get_id(edge[i]));
+  }
+}
+
+bool Graph_core::Entry64::try_add(Index_ID id, bool inp) {
+  if (is_full())
+    return false;
+
+  edge[n_edges++] = encode(id, inp);
+  return true;
+}
+
+bool Graph_core::Entry64::try_del(Index_ID id, bool inp) {
+  const auto e = encode(id, inp);
+  for (auto i = 0u; i < n_edges; ++i) {
+    if (edge[i] != e)
+      continue;
+
+    --n_edges;
+    edge[i]       = edge[n_edges];  // Edge order is not preserved
+    edge[n_edges] = 0;
+    return true;
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------
+// Entry16
+
+void Graph_core::Entry16::fill_inp(Index_ID self_id, std::vector<Index_ID> &ev) const {
+  if (!is_master_root())
+    return;
+
+  for (auto e : sedge) {
+    if (e && is_input(e))
+      ev.emplace_back(get_id(self_id, e));
+  }
+}
+
+void Graph_core::Entry16::fill_out(Index_ID self_id, std::vector<Index_ID> &ev) const {
+  if (!is_master_root())
+    return;
+
+  for (auto e : sedge) {
+    if (e && !is_input(e))
+      ev.emplace_back(get_id(self_id, e));
+  }
+}
+
+bool Graph_core::Entry16::try_add(Index_ID self_id, Index_ID id, bool inp) {
+  if (!is_master_root())
+    return false;  // master uses the space to point to the master_root
+
+  const auto e = encode(self_id, id, inp);
+  if (e == 0)
+    return false;  // too far for a short edge
+
+  for (auto i = 0; i < Num_sedges; ++i) {
+    if (sedge[i] == 0) {
+      sedge[i] = e;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool Graph_core::Entry16::try_del(Index_ID self_id, Index_ID id, bool inp) {
+  if (!is_master_root())
+    return false;
+
+  const auto e = encode(self_id, id, inp);
+  if (e == 0)
+    return false;
+
+  for (auto i = 0; i < Num_sedges; ++i) {
+    if (sedge[i] == e) {
+      sedge[i] = 0;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------
+// Graph_core
+
+Graph_core::Graph_core(std::string_view path, std::string_view name)
+    : table(path, absl::StrCat(name, "_gc16")), overflow(path, absl::StrCat(name, "_gc64")) {
+  setup_tables();
+}
+
+void Graph_core::setup_tables() {
+  if (table.empty()) {
+    table.emplace_back();  // Index_ID zero is invalid
+    table.set(0);
+  }
+  if (overflow.empty()) {
+    overflow.emplace_back();  // overflow zero means no overflow
+    overflow.set(0);
+  }
+}
+
+void Graph_core::clear() {
+  table.clear();
+  overflow.clear();
+
+  setup_tables();
+  next16_free() = 0;
+  next64_free() = 0;
+}
+
+Index_ID Graph_core::alloc16() {
+  if (next16_free()) {
+    Index_ID id  = next16_free();
+    next16_free() = table[id.value].get_next();
+    table.set(id.value);
+    return id;
+  }
+
+  Index_ID id = table.size();
+  I(id < (1ULL << Index_bits));
+  table.emplace_back();
+  table.set(id.value);
+
+  return id;
+}
+
+uint32_t Graph_core::alloc64() {
+  if (next64_free()) {
+    uint32_t id  = next64_free();
+    next64_free() = overflow[id].next;
+    overflow.set(id);
+    return id;
+  }
+
+  uint32_t id = overflow.size();
+  overflow.emplace_back();
+  overflow.set(id);
+
+  return id;
+}
+
+void Graph_core::free16(Index_ID id) {
+  I(id.value && id.value < table.size());
+
+  auto *ent = table.ref(id.value);
+  *ent      = Entry16();
+  ent->next = next16_free();
+
+  next16_free() = id.value;
+}
+
+void Graph_core::free64(uint32_t id) {
+  I(id && id < overflow.size());
+
+  auto *ent = overflow.ref(id);
+  *ent      = Entry64();
+  ent->next = next64_free();
+
+  next64_free() = id;
+}
+
+void Graph_core::add_edge_int(const Index_ID self_id, const Index_ID other_id, bool inp) {
+  auto *ent = table.ref(self_id.value);
+  if (inp)
+    ent->sink_set = 1;
+  else
+    ent->driver_set = 1;
+
+  if (ent->try_add(self_id, other_id, inp))
+    return;
+
+  for (auto ovf_id = ent->overflow; ovf_id; ovf_id = overflow[ovf_id].next) {
+    if (overflow.ref(ovf_id)->try_add(other_id, inp))
+      return;
+  }
+
+  auto new_id = alloc64();  // Only overflow can be remapped, ent is still valid
+  auto *ovf   = overflow.ref(new_id);
+  ovf->next   = ent->overflow;
+  ovf->try_add(other_id, inp);
+
+  ent->overflow = new_id;
+}
+
+bool Graph_core::del_edge_int(const Index_ID self_id, const Index_ID other_id, bool inp) {
+  auto *ent = table.ref(self_id.value);
+  if (ent->try_del(self_id, other_id, inp))
+    return true;
+
+  uint32_t prev_id = 0;
+  for (auto ovf_id = ent->overflow; ovf_id; ovf_id = overflow[ovf_id].next) {
+    auto *ovf = overflow.ref(ovf_id);
+    if (!ovf->try_del(other_id, inp)) {
+      prev_id = ovf_id;
+      continue;
+    }
+
+    if (ovf->n_edges == 0) {  // Recycle empty overflow entries
+      if (prev_id)
+        overflow.ref(prev_id)->next = ovf->next;
+      else
+        ent->overflow = ovf->next;
+      free64(ovf_id);
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void Graph_core::add_edge(const Index_ID sink_id, const Index_ID driver_id) {
+  I(is_valid(sink_id));
+  I(is_valid(driver_id));
+  I(sink_id != driver_id);
+
+  add_edge_int(driver_id, sink_id, false);
+  add_edge_int(sink_id, driver_id, true);
+}
+
+void Graph_core::del_edge(const Index_ID sink_id, const Index_ID driver_id) {
+  I(is_valid(sink_id));
+  I(is_valid(driver_id));
+
+  auto found_out = del_edge_int(driver_id, sink_id, false);
+  auto found_inp = del_edge_int(sink_id, driver_id, true);
+  I(found_out == found_inp);  // Both directions or none
+  (void)found_out;
+  (void)found_inp;
+}
+
+void Graph_core::fill_edges(const Index_ID s, std::vector<Index_ID> &ev, bool inp) const {
+  I(is_valid(s));
+
+  const auto &ent = table[s.value];
+  if (inp)
+    ent.fill_inp(s, ev);
+  else
+    ent.fill_out(s, ev);
+
+  for (auto ovf_id = ent.overflow; ovf_id; ovf_id = overflow[ovf_id].next) {
+    if (inp)
+      overflow[ovf_id].fill_inp(ev);
+    else
+      overflow[ovf_id].fill_out(ev);
+  }
+}
+
+const std::vector<Index_ID> Graph_core::get_setup_drivers(const Index_ID master_root_id) const {
+  I(is_master_root(master_root_id));
+
+  std::vector<Index_ID> v;
+  for (auto id = master_root_id; id; id = table[id.value].get_next()) {
+    if (table[id.value].is_driver_set())
+      v.emplace_back(id);
+  }
+
+  return v;
+}
+
+const std::vector<Index_ID> Graph_core::get_setup_sinks(const Index_ID master_root_id) const {
+  I(is_master_root(master_root_id));
+
+  std::vector<Index_ID> v;
+  for (auto id = master_root_id; id; id = table[id.value].get_next()) {
+    if (table[id.value].is_sink_set())
+      v.emplace_back(id);
+  }
+
+  return v;
+}
+
+Index_ID Graph_core::fast_next(Index_ID start) const {
+  const auto sz = table.size();
+  for (auto id = start.value + 1; id < sz; ++id) {
+    const auto &ent = table[id];
+    if (ent.is_valid() && ent.is_master_root())
+      return id;
+  }
+
+  return 0;
+}
+
+Index_iter Graph_core::out_ids(const Index_ID s) {
+  I(is_valid(s));
+  return Index_iter(this, s, false);
+}
+
+Index_iter Graph_core::inp_ids(const Index_ID s) {
+  I(is_valid(s));
+  return Index_iter(this, s, true);
+}
+
+uint8_t Graph_core::get_type(const Index_ID master_root_id) const {
+  return table[get_master_root(master_root_id).value].get_type();
+}
+
+void Graph_core::set_type(const Index_ID master_root_id, uint8_t type) {
+  auto root_id = get_master_root(master_root_id);
+
+  table.ref(root_id.value)->pid_or_type = type;
+}
+
+Port_ID Graph_core::get_pid(const Index_ID master_root_id) const {
+  I(is_valid(master_root_id));
+  return table[master_root_id.value].get_pid();
+}
+
+Index_ID Graph_core::find_master(const Index_ID master_root_id, const Port_ID pid) const {
+  I(is_master_root(master_root_id));
+  if (pid == 0)
+    return master_root_id;
+
+  for (auto id = table[master_root_id.value].get_next(); id; id = table[id.value].get_next()) {
+    if (table[id.value].get_pid() == pid)
+      return id;
+  }
+
+  return 0;
+}
+
+Index_ID Graph_core::create_master_root(uint8_t type) {
+  auto id = alloc16();
+
+  table.ref(id.value)->set_master_root(type);
+
+  return id;
+}
+
+Index_ID Graph_core::create_master(const Index_ID master_root_id, const Port_ID pid) {
+  I(is_master_root(master_root_id));
+  I(pid);  // pid zero is the master_root
+
+  auto id = alloc16();
+
+  auto *root = table.ref(master_root_id.value);
+  auto *ent  = table.ref(id.value);
+  ent->set_master(master_root_id, pid);
+  ent->next  = root->next;
+  root->next = id.value;
+
+  return id;
+}
+
+void Graph_core::del(const Index_ID s) {
+  I(is_valid(s));
+
+  if (table[s.value].is_master_root()) {
+    auto id = table[s.value].get_next();
+    table.ref(s.value)->next = 0;  // Unlink all the masters at once
+    while (id) {
+      auto next_id = table[id.value].get_next();
+      del(id);
+      id = next_id;
+    }
+  } else {
+    auto root_id = table[s.value].get_master_root(s);
+    auto prev_id = root_id;
+    for (auto id = table[root_id.value].get_next(); id; id = table[id.value].get_next()) {
+      if (id == s) {
+        table.ref(prev_id.value)->next = table[id.value].get_next();
+        break;
+      }
+      prev_id = id;
+    }
+  }
+
+  // Remove the reverse edges
+  std::vector<Index_ID> ev;
+  fill_edges(s, ev, true);
+  for (auto driver_id : ev) {
+    auto found = del_edge_int(driver_id, s, false);
+    I(found);
+    (void)found;
+  }
+  ev.clear();
+  fill_edges(s, ev, false);
+  for (auto sink_id : ev) {
+    auto found = del_edge_int(sink_id, s, true);
+    I(found);
+    (void)found;
+  }
+
+  auto ovf_id = table[s.value].overflow;
+  while (ovf_id) {
+    auto next_id = overflow[ovf_id].next;
+    free64(ovf_id);
+    ovf_id = next_id;
+  }
+
+  free16(s);
 }
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "lgraph_base_core.hpp"
+#include "mmap_vector.hpp"
 
 #include <cassert>
 #include <vector>
@@ -9,29 +10,39 @@
 
 class Graph_core;
 
+// Iterate over the edges (inputs or outputs) of a single pin (master_root or master)
 class Index_iter {
 protected:
   Graph_core     *gc;
+  Index_ID        self_id;
+  bool            input;
 
 public:
   class Fast_iter {
   private:
     Graph_core     *gc;
-    Index_ID        id;
-    // May need to add extra data here
+    Index_ID        id;      // current edge (0 when done)
+    Index_ID        self_id; // pin being iterated
+    uint32_t        ovf_id;  // 0 while in the master entry, current Entry64 otherwise
+    int16_t         pos;     // position in the master entry or in the overflow entry
+    bool            input;
+
+    void advance();
 
   public:
-    constexpr Fast_iter(Graph_core *_gc, const Index_ID _id ) : gc(_gc), id(_id)   {}
-    constexpr Fast_iter(const Fast_iter &it) : gc(it.gc), id(it.id) {}
+    constexpr Fast_iter(Graph_core *_gc, const Index_ID _id ) : gc(_gc), id(_id), self_id(0), ovf_id(0), pos(0), input(false) {}
+    Fast_iter(Graph_core *_gc, const Index_ID _self_id, bool _input) : gc(_gc), id(0), self_id(_self_id), ovf_id(0), pos(-1), input(_input) {
+      advance();
+    }
+    constexpr Fast_iter(const Fast_iter &it) = default;
 
-    constexpr Fast_iter &operator=(const Fast_iter &it) {
-      gc = it.gc;
-      id = it.id;
+    constexpr Fast_iter &operator=(const Fast_iter &it) = default;
+
+    Fast_iter &operator++() {
+      advance();
       return *this;
     }
 
-    Fast_iter &operator++(); // call Graph_core::xx if needed
-
     constexpr bool operator!=(const Fast_iter &other) const { assert(gc==other.gc); return id != other.id; }
     constexpr bool operator==(const Fast_iter &other) const { assert(gc==other.gc); return id == other.id; }
 
@@ -39,83 +50,146 @@ public:
   };
 
   Index_iter() = delete;
-  explicit Index_iter(Graph_core *_gc) : gc(_gc) {}
+  explicit Index_iter(Graph_core *_gc, Index_ID _self_id, bool _input) : gc(_gc), self_id(_self_id), input(_input) {}
 
-  Fast_iter begin() const; // Find first elemnt in Graph_core
-  Fast_iter end() const { return Fast_iter(gc, 0); } // More likely 0 ID for end
+  Fast_iter begin() const { return Fast_iter(gc, self_id, input); }
+  Fast_iter end() const { return Fast_iter(gc, 0); } // Edges never point to ID 0
 };
 
+// Graph_core is the cache-line friendly storage for the LGraph netlist.
+//
+// Each pin (master_root for the node itself/pid 0, master for pid!=0) uses a
+// 16 byte Entry16. Edges that do not fit in the master entry go to a chain of
+// 64 byte Entry64 (overflow). Master_root entries keep up to 2 short (16 bit
+// relative) edges inline. Masters use the space to point to the master_root.
+//
+// Index_ID 0 is reserved (invalid) in both tables. The free lists are kept in
+// the mmap header so that the graph can be reopened.
+//
+// Standalone store, not an LGraph backend (there is no storage selector):
+// LGraph_Base stores node_internal, and lgraph.cpp/lgedge use the
+// Node_internal/Edge_raw layouts directly. graph_core_bench loads the same
+// netlist in both stores and compares them.
 class Graph_core {
 protected:
+  friend class Index_iter::Fast_iter;
+
   class __attribute__((packed)) Entry64 { // AKA Overflow Entry
-    uint8_t  edge_storage[64-1];
-    uint8_t  last_byte;
-  protected:
-    constexpr Entry64() : edge_storage{0,},last_byte(0) {
+  public:
+    static constexpr int Num_edges = 14;
+
+    uint32_t next;               // next Entry64 in the chain (or next free)
+    uint32_t edge[Num_edges];    // long edge: 31 bits Index_ID, upper bit set for inputs
+    uint8_t  n_edges;
+    uint8_t  pad[3];
+
+    constexpr Entry64() : next(0), edge{0,}, n_edges(0), pad{0,} {
     }
-    void set_input()  { last_byte |= 0x80; } // set 8th bit
-    void set_output() { last_byte &= 0x7F; } // clear 8th bit
 
-    constexpr Index_ID get_overflow() const; // returns the next Entry64 if overflow, zero otherwise
+    static constexpr uint32_t encode(Index_ID id, bool inp) { return id.value | (inp ? 0x80000000 : 0); }
+    static constexpr Index_ID get_id(uint32_t e) { return e & 0x7FFFFFFF; }
+    static constexpr bool     is_input(uint32_t e) { return (e >> 31) != 0; }
+
+    constexpr bool is_full() const { return n_edges >= Num_edges; }
 
     void fill_inp(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
     void fill_out(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    bool try_add_driver(Index_ID id); // return false if there was no space
-    bool try_add_sink(Index_ID id); // return false if there was no space
-
+    bool try_add(Index_ID id, bool inp);  // return false if there was no space
+    bool try_del(Index_ID id, bool inp);  // return false if the edge was not found
   };
 
   class __attribute__((packed)) Entry16 { // AKA master or master_root entry
-    uint8_t  edge_storage[16-5];
-    uint16_t edge_storate_or_pid_bits; // edge_store in master_root, 16 pid bits in master
-    uint8_t  pid_bits_or_type:6;       // type in master_root, 6 pid bits in master
+  public:
+    static constexpr int Num_sedges = 2;
+
+    uint32_t overflow;                // first Entry64 (zero if no overflow)
+    uint32_t next;                    // master_next in master_root, next master in master (next free if free)
+    union {
+      int16_t  sedge[Num_sedges];     // short edges in master_root ((delta<<1)|input, zero if unused)
+      uint32_t master_root_id;        // master_root pointer in master
+    };
+    uint16_t pid_or_type;             // type in master_root, pid in master
+    uint8_t  master_root:1;           // for speed good to remember root vs master (pid==0?)
+    uint8_t  valid:1;
     uint8_t  driver_set:1;
-    uint8_t  sink_set:1;               // different from inp_mask!=0 because bidirectional edges
-    uint8_t  ptrs;                     // master_next in master_root (master_prev in master) and overflow_next
-    uint8_t  inp_mask:7;               // 7bits inp_mask (8 or 0b111 means not used)
-    uint8_t  master_root:1;            // for speed good to remember root vs master (pid==0?)
-  protected:
-    constexpr Entry16() : edge_storage{0,}, edge_storate_or_pid_bits(0), pid_bits_or_type(0), driver_set(0), sink_set(0), ptrs(0xFF), inp_mask(0), master_root(0) {
+    uint8_t  sink_set:1;              // different from inp edges!=0 because bidirectional edges
+    uint8_t  unused:4;
+    uint8_t  pad;
+
+    constexpr Entry16() : overflow(0), next(0), sedge{0,}, pid_or_type(0), master_root(0), valid(0), driver_set(0), sink_set(0), unused(0), pad(0) {
     }
 
-    void set_master_root();
-    void set_master();
+    void set_master_root(uint8_t type) {
+      master_root = 1;
+      valid       = 1;
+      pid_or_type = type;
+    }
+    void set_master(Index_ID root_id, Port_ID pid) {
+      master_root    = 0;
+      valid          = 1;
+      master_root_id = root_id.value;
+      pid_or_type    = pid;
+    }
 
-    constexpr Index_ID get_overflow() const; // returns the next Entry64 if overflow, zero otherwise
-    constexpr Index_ID get_next() const;     // returns the next Entry16 that is master, zero if none
+    constexpr Index_ID get_overflow() const { return overflow; } // returns the next Entry64 if overflow, zero otherwise
+    constexpr Index_ID get_next() const { return next; }         // returns the next Entry16 that is master, zero if none
 
+    constexpr bool is_valid()       const { return valid; }
     constexpr bool is_driver_set()  const { return driver_set; }
     constexpr bool is_sink_set()    const { return sink_set; }
     constexpr bool is_master_root() const { return master_root; }
 
-    constexpr uint8_t  get_type()   const { return pid_bits_or_type; }
-    constexpr uint32_t get_pid()    const {
+    constexpr uint8_t  get_type()   const { return pid_or_type; }
+    constexpr Port_ID  get_pid()    const {
       if(is_master_root())
         return 0;
+      return pid_or_type;
+    }
 
-      uint32_t pid = pid_bits_or_type;
-      pid <<=16;
-      pid  |= edge_storate_or_pid_bits;
+    // ptr to master root (self_id if itself is root)
+    constexpr Index_ID get_master_root(Index_ID self_id) const { return is_master_root() ? self_id : Index_ID(master_root_id); }
 
-      return pid; //22 bits PID
+    static constexpr int16_t  encode(Index_ID self_id, Index_ID id, bool inp) {
+      int64_t delta = static_cast<int64_t>(id.value) - static_cast<int64_t>(self_id.value);
+      if (delta >= (1 << 14) || delta < -(1 << 14))
+        return 0;
+      return static_cast<int16_t>(delta * 2 + (inp ? 1 : 0));
     }
+    static constexpr Index_ID get_id(Index_ID self_id, int16_t e) { return self_id.value + (e >> 1); }
+    static constexpr bool     is_input(int16_t e) { return (e & 1) != 0; }
 
-    constexpr Index_ID get_master_root() const; // ptr to master root (zero if itself is root)
+    void fill_inp(Index_ID self_id, std::vector<Index_ID> &ev) const; // fill the inline edges to ev
+    void fill_out(Index_ID self_id, std::vector<Index_ID> &ev) const; // fill the inline edges to ev
+    bool try_add(Index_ID self_id, Index_ID id, bool inp); // return false if there was no space
+    bool try_del(Index_ID self_id, Index_ID id, bool inp); // return false if the edge was not found
+  };
 
-    void fill_inp(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    void fill_out(std::vector<Index_ID> &ev) const; // fill the list of edges to ev (requires expand)
-    bool try_add_driver(Index_ID id); // return false if there was no space
-    bool try_add_sink(Index_ID id); // return false if there was no space
+  static_assert(sizeof(Entry16) == 16);
+  static_assert(sizeof(Entry64) == 64);
 
-  };
+  mmap_lib::vector<Entry16> table;     // master_root and master entries
+  mmap_lib::vector<Entry64> overflow;  // overflow entries
+
+  // Free lists live in the mmap header page. Do not cache the pointer, the mmap can move
+  uint64_t &next16_free() const { return *table.ref_config_data(8); }     // Pointer to free Entry16 chunks
+  uint64_t &next64_free() const { return *overflow.ref_config_data(8); }  // Pointer to free Entry64 chunks
+
+  void     setup_tables();
+  Index_ID alloc16();
+  uint32_t alloc64();
+  void     free16(Index_ID id);
+  void     free64(uint32_t id);
 
-  std::vector<Entry64> table; // to be replaced by mmap_lib::vector once it works
+  void add_edge_int(const Index_ID self_id, const Index_ID other_id, bool inp);
+  bool del_edge_int(const Index_ID self_id, const Index_ID other_id, bool inp);
 
-  Index_ID next12_free;       // Pointer to 12byte free chunks
-  Index_ID next48_free;       // Pointer to 48byte free chunks
+  void fill_edges(const Index_ID s, std::vector<Index_ID> &ev, bool inp) const;
 
 public:
   Graph_core(std::string_view path, std::string_view name);
+
+  void clear();
+
   void add_edge(const Index_ID sink_id, const Index_ID driver_id); // Add edge from s->d and d->s
   void del_edge(const Index_ID sink_id, const Index_ID driver_id); // Remove both s->d and d->s
 
@@ -125,7 +199,8 @@ public:
 
   // unlike the const iterator, it should allow to delete edges/nodes while
   //   // traversing
-  Index_ID fast_next(Index_ID start); // faster iterator returning all the master_root Index_ID (0 if last)
+  Index_ID fast_next(Index_ID start) const; // faster iterator returning all the master_root Index_ID (0 if last)
+  Index_ID fast_first() const { return fast_next(0); }
 
   // Unlike get_setup_drivers, this returns all the drivers/sinks that reach
   // the s index. This can be a large list, so it is not a short vector but an
@@ -133,10 +208,24 @@ public:
   Index_iter out_ids(const Index_ID s);  // Iterate over the out edges of s (*it is Index_ID)
   Index_iter inp_ids(const Index_ID s);  // Iterate over the inp edges of s
 
+  void fill_out_ids(const Index_ID s, std::vector<Index_ID> &ev) const { fill_edges(s, ev, false); }
+  void fill_inp_ids(const Index_ID s, std::vector<Index_ID> &ev) const { fill_edges(s, ev, true); }
+
   uint8_t get_type(const Index_ID master_root_id) const;  // set/get type on the master_root id (s or pointed by s)
-  void    set_type(const Index_ID master_root_id);
+  void    set_type(const Index_ID master_root_id, uint8_t type);
+
+  Port_ID  get_pid(const Index_ID master_root_id) const; // pid for master or 0 for master_root
+  Index_ID get_master_root(const Index_ID s) const {
+    I(is_valid(s));
+    return table[s.value].get_master_root(s);
+  }
+  Index_ID find_master(const Index_ID master_root_id, const Port_ID pid) const; // zero if not created
 
-  Port_ID get_pid(const Index_ID master_root_id) const; // pid for master or 0 for master_root
+  bool is_valid(const Index_ID s) const { return s.value && s.value < table.size() && table[s.value].is_valid(); }
+  bool is_master_root(const Index_ID s) const {
+    I(is_valid(s));
+    return table[s.value].is_master_root();
+  }
 
   // Create a master root node
   Index_ID create_master_root(uint8_t type);
@@ -144,6 +233,40 @@ public:
   Index_ID create_master(const Index_ID master_root_id, const Port_ID pid);
   // Delete node s, all related edges and masters (if master root)
   void del(const Index_ID s);
+
+  size_t size() const { return table.size(); }
+  size_t overflow_size() const { return overflow.size(); }
 };
 
+inline void Index_iter::Fast_iter::advance() {
+  const auto &ent = gc->table[self_id.value];
+
+  if (ovf_id == 0) {
+    if (ent.is_master_root()) {
+      while (++pos < Graph_core::Entry16::Num_sedges) {
+        auto e = ent.sedge[pos];
+        if (e && Graph_core::Entry16::is_input(e) == input) {
+          id = Graph_core::Entry16::get_id(self_id, e);
+          return;
+        }
+      }
+    }
+    ovf_id = ent.overflow;
+    pos    = -1;
+  }
+
+  while (ovf_id) {
+    const auto &ovf = gc->overflow[ovf_id];
+    while (++pos < ovf.n_edges) {
+      auto e = ovf.edge[pos];
+      if (Graph_core::Entry64::is_input(e) == input) {
+        id = Graph_core::Entry64::get_id(e);
+        return;
+      }
+    }
+    ovf_id = ovf.next;
+    pos    = -1;
+  }
 
+  id = 0;
+}
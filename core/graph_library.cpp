@@ -3,22 +3,28 @@
 #include "graph_library.hpp"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #ifdef __APPLE__
 #include <copyfile.h>
 #else
 #include <sys/sendfile.h>
 #endif
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <regex>
 #include <set>
 
 #include "fmt/format.h"
 #include "lgraph.hpp"
+#include "mmap_gc.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/filereadstream.h"
@@ -27,6 +33,11 @@
 
 Graph_library::Global_instances   Graph_library::global_instances;
 Graph_library::Global_name2lgraph Graph_library::global_name2lgraph;
+std::recursive_mutex              Graph_library::global_mutex;
+
+absl::flat_hash_set<LGraph *> Graph_library::open_lgraphs;
+size_t                        Graph_library::open_budget = 256;
+std::atomic<uint64_t>         Graph_library::access_clock{0};
 
 class Cleanup_graph_library {
 public:
@@ -39,7 +50,77 @@ public:
 
 static Cleanup_graph_library private_instance;
 
+namespace {
+
+// graph_library.bin layout (host endian, the magic tells the byte order):
+//
+//   header: magic, format version, 8 bytes reserved
+//   record: size (whole record), lgid, version (0 if deleted/recycled),
+//           source size + source, name size + name, io_pins (Sub_node::to_bin)
+//
+// Records are only appended. The last record of each lgid wins, and the file
+// is compacted (rewritten) when most of it is dead records.
+constexpr uint32_t Lib_magic          = 0x424C474C;  // "LGLB"
+constexpr uint32_t Lib_magic_swapped  = 0x4C474C42;  // written by a host with the other byte order
+constexpr uint32_t Lib_format_version = 1;
+constexpr size_t   Lib_header_size    = 16;
+constexpr size_t   Lib_rec_header     = 16;  // size, lgid, version
+constexpr uint64_t Lib_compact_min    = 64 * 1024;
+
+struct Lib_record {
+  uint32_t         size;
+  uint32_t         lgid;
+  uint64_t         version;
+  std::string_view source;
+  std::string_view name;
+  std::string_view pins;
+};
+
+bool parse_record(const char *base, size_t base_size, uint64_t off, Lib_record &rec) {
+  if (off + Lib_rec_header > base_size)
+    return false;
+
+  memcpy(&rec.size, base + off, 4);
+  memcpy(&rec.lgid, base + off + 4, 4);
+  memcpy(&rec.version, base + off + 8, 8);
+  if (rec.size < Lib_rec_header + 8 || off + rec.size > base_size)
+    return false;
+
+  std::string_view data(base + off + Lib_rec_header, rec.size - Lib_rec_header);
+  size_t           pos = 0;
+  for (auto *field : {&rec.source, &rec.name}) {
+    uint32_t sz;
+    if (pos + 4 > data.size())
+      return false;
+    memcpy(&sz, data.data() + pos, 4);
+    pos += 4;
+    if (pos + sz > data.size())
+      return false;
+    *field = data.substr(pos, sz);
+    pos += sz;
+  }
+  rec.pins = data.substr(pos);
+
+  return true;
+}
+
+uint64_t hash_record(std::string_view rec) { return std::hash<std::string_view>{}(rec) | 1; }  // 0 is no record
+
+bool write_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    auto sz = ::write(fd, data.data(), data.size());
+    if (sz <= 0)
+      return false;
+    data.remove_prefix(sz);
+  }
+  return true;
+}
+
+}  // namespace
+
 void Graph_library::shutdown() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   absl::flat_hash_set<LGraph *> lg_deleted;
 
   for (auto it : global_name2lgraph) {
@@ -52,7 +133,7 @@ void Graph_library::shutdown() {
     }
   }
   global_name2lgraph.clear();
-
+  open_lgraphs.clear();
 
   absl::flat_hash_set<Graph_library *> gl_deleted;
 
@@ -68,7 +149,56 @@ void Graph_library::shutdown() {
   global_instances.clear();
 }
 
+void Graph_library::touch_lgraph(LGraph *lg) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
+  open_lgraphs.insert(lg);
+  lg->touch();
+}
+
+void Graph_library::release_unused() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
+  std::vector<std::pair<uint64_t, LGraph *>> sorted;  // last access, lgraph
+  for (auto *lg : open_lgraphs) {
+    if (lg->is_mapped())  // unmapped ones may be remapped by any access, they stay in the set
+      sorted.emplace_back(lg->get_last_access(), lg);
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  auto n_mapped = sorted.size();
+  for (const auto &[access, lg] : sorted) {
+    (void)access;
+    if (open_budget && n_mapped > open_budget && lg->unmap_tables()) {  // false if locked (being edited)
+      --n_mapped;
+      continue;
+    }
+    // mmap_gc ages are the last (re)map. Restamp the node tables still mapped
+    // in last access order, so the budget evicts the least recently used
+    lg->touch_mmaps();
+  }
+
+  mmap_lib::mmap_gc::collect_budget();  // same safe point
+}
+
+void Graph_library::set_open_budget(size_t n_lgraphs) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+  open_budget = n_lgraphs;
+}
+
+size_t Graph_library::get_open_budget() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+  return open_budget;
+}
+
+size_t Graph_library::get_n_open_mapped() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+  return std::count_if(open_lgraphs.begin(), open_lgraphs.end(), [](const LGraph *lg) { return lg->is_mapped(); });
+}
+
 void Graph_library::sync_all() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   for (auto &it : global_name2lgraph) {
     for (auto &it2 : it.second) {
       it2.second->sync();
@@ -80,12 +210,245 @@ void Graph_library::sync_all() {
 }
 
 void Graph_library::clean_library() {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
+  compact_const_pool();
+  const_pool->sync();
+
 #if 0
   // Possible to call sub_nodes directly and miss this update
   if (graph_library_clean)
     return;
 #endif
 
+  // Append the records that changed since the last sync
+  std::string buf;
+  for (auto i = 1u; i < attributes.size(); ++i) {  // Not position zero
+    if (sub_pending[i]) {
+      if (same_record(i))
+        continue;
+      materialize(i);
+    }
+
+    auto rec = get_record(i);
+    auto h   = hash_record(rec);
+    if (h == rec_hash[i])
+      continue;
+
+    live_bytes += rec.size();
+    live_bytes -= rec_size[i];
+    rec_hash[i] = h;
+    rec_size[i] = rec.size();
+    buf.append(rec);
+  }
+
+  if (file_bytes + buf.size() > 2 * live_bytes + Lib_compact_min) {
+    compact_library();
+    graph_library_clean = true;
+    return;
+  }
+
+  if (!buf.empty() || file_bytes == 0) {
+    int fd = open(library_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+      LGraph::error("graph_library::clean_library could not open graph_library file {}", library_file);
+      return;
+    }
+
+    bool ok = true;
+    if (file_bytes == 0) {
+      uint32_t header[4] = {Lib_magic, Lib_format_version, 0, 0};
+      ok                 = write_all(fd, std::string_view(reinterpret_cast<const char *>(header), Lib_header_size));
+      file_bytes         = Lib_header_size;
+    }
+    ok = ok && write_all(fd, buf);
+    close(fd);
+    if (!ok) {
+      LGraph::error("graph_library::clean_library could not write graph_library file {}", library_file);
+      return;
+    }
+    file_bytes += buf.size();
+  }
+
+  graph_library_clean = true;
+}
+
+// Drop the constants no longer used by any lgraph (open or not). Counting the
+// live handles reads every const_map, so it only happens when the pool grew
+// over twice the live handles of the last check.
+void Graph_library::compact_const_pool() {
+  if (!const_pool->should_compact(const_live))
+    return;
+
+  std::vector<Lconst_pool::Handle> live;
+  auto                             add_live = [&live](Lconst_pool::Handle h) { live.emplace_back(h); };
+  for (auto i = 1u; i < attributes.size(); ++i) {  // Not position zero
+    if (!exists(i))
+      continue;
+    if (attributes[i].lg)
+      attributes[i].lg->each_const_handle(add_live);
+    else
+      LGraph_Node_Type::each_const_handle(path, i, add_live);
+  }
+
+  // One handle per Const node, most designs repeat a few constants (0, 1, masks)
+  std::sort(live.begin(), live.end());
+  live.erase(std::unique(live.begin(), live.end()), live.end());
+  const_live = live.size();
+
+  if (!const_pool->should_compact(const_live))
+    return;
+
+  auto old2new = const_pool->compact(live);
+
+  for (auto i = 1u; i < attributes.size(); ++i) {
+    if (!exists(i))
+      continue;
+    if (attributes[i].lg)
+      attributes[i].lg->relocate_const(old2new);
+    else
+      LGraph_Node_Type::relocate_const(path, i, old2new);
+  }
+}
+
+// Rewrite the library_file with only the last record of each lgid
+void Graph_library::compact_library() {
+  std::string           buf;
+  std::vector<uint64_t> new_pending(sub_pending.size(), 0);
+
+  uint32_t header[4] = {Lib_magic, Lib_format_version, 0, 0};
+  buf.append(reinterpret_cast<const char *>(header), Lib_header_size);
+
+  for (auto i = 1u; i < attributes.size(); ++i) {
+    if (sub_pending[i]) {  // still in the mmap, copy without decoding it
+      Lib_record rec;
+      bool       ok = parse_record(lib_base, lib_size, sub_pending[i], rec);
+      I(ok);
+      new_pending[i] = buf.size();
+      buf.append(lib_base + sub_pending[i], rec.size);
+    } else {
+      auto rec    = get_record(i);
+      rec_hash[i] = hash_record(rec);
+      rec_size[i] = rec.size();
+      buf.append(rec);
+    }
+  }
+
+  auto tmp_file = absl::StrCat(library_file, ".tmp");
+  int  fd       = open(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || !write_all(fd, buf)) {
+    if (fd >= 0)
+      close(fd);
+    LGraph::error("graph_library::compact_library could not write graph_library file {}", tmp_file);
+    return;
+  }
+  close(fd);
+
+  if (rename(tmp_file.c_str(), library_file.c_str()) != 0) {
+    LGraph::error("graph_library::compact_library could not rename {} to {}", tmp_file, library_file);
+    return;
+  }
+
+  file_bytes = buf.size();
+  live_bytes = buf.size() - Lib_header_size;
+
+  // The pending io_pins point to the new file
+  unmap_library();
+  bool any_pending = false;
+  for (auto i = 1u; i < sub_pending.size(); ++i) {
+    sub_pending[i] = new_pending[i];
+    any_pending    = any_pending || new_pending[i];
+  }
+  if (any_pending) {
+    fd       = open(library_file.c_str(), O_RDONLY);
+    auto *b  = fd >= 0 ? mmap(nullptr, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (fd >= 0)
+      close(fd);
+    if (b == MAP_FAILED) {
+      LGraph::error("graph_library::compact_library could not mmap {}", library_file);
+      return;
+    }
+    lib_base = static_cast<const char *>(b);
+    lib_size = file_bytes;
+  }
+}
+
+std::string Graph_library::get_record(Lg_type_id lgid) const {
+  I(!sub_pending[lgid]);
+
+  const auto &sub     = sub_nodes[lgid];
+  bool        valid   = !sub.is_invalid() && attributes[lgid].version != 0;
+  uint64_t    version = valid ? attributes[lgid].version.value : 0;
+
+  std::string rec(Lib_rec_header, '\0');
+  for (auto field : {valid ? std::string_view(attributes[lgid].source) : std::string_view(),
+                     valid ? sub.get_name() : std::string_view()}) {
+    uint32_t sz = field.size();
+    rec.append(reinterpret_cast<const char *>(&sz), 4);
+    rec.append(field);
+  }
+  if (valid)
+    sub.to_bin(rec);
+  else
+    Sub_node().to_bin(rec);
+
+  uint32_t size = rec.size();
+  uint32_t id   = lgid.value;
+  memcpy(rec.data(), &size, 4);
+  memcpy(rec.data() + 4, &id, 4);
+  memcpy(rec.data() + 8, &version, 8);
+
+  return rec;
+}
+
+// Not decoded lgid (the io_pins did not change), check the rest of the record
+bool Graph_library::same_record(Lg_type_id lgid) const {
+  Lib_record rec;
+  bool       ok = parse_record(lib_base, lib_size, sub_pending[lgid], rec);
+  I(ok);
+
+  return rec.version == attributes[lgid].version && rec.source == attributes[lgid].source
+         && rec.name == sub_nodes[lgid].get_name();
+}
+
+void Graph_library::materialize(Lg_type_id lgid) const {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
+  if (sub_pending[lgid] == 0)
+    return;  // another thread was faster
+
+  Lib_record rec;
+  bool       ok = parse_record(lib_base, lib_size, sub_pending[lgid], rec);
+  I(ok);
+  auto used = sub_nodes[lgid].from_bin(rec.pins);
+  I(used == rec.pins.size());
+  (void)used;
+
+  sub_pending[lgid] = 0;
+}
+
+void Graph_library::resize_ids(size_t sz) {
+  attributes.resize(sz);
+  sub_nodes.resize(sz);
+  sub_pending.resize(sz, 0);
+  rec_hash.resize(sz, 0);
+  rec_size.resize(sz, 0);
+}
+
+void Graph_library::unmap_library() {
+  if (lib_base == nullptr)
+    return;
+
+  munmap(const_cast<char *>(lib_base), lib_size);
+  lib_base = nullptr;
+  lib_size = 0;
+}
+
+Graph_library::~Graph_library() { unmap_library(); }
+
+void Graph_library::export_json(std::string_view file) const {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   rapidjson::StringBuffer                          s;
   rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
 
@@ -104,6 +467,8 @@ void Graph_library::clean_library() {
     writer.Key("source");
     writer.String(it.source.c_str());
 
+    if (sub_pending[i])
+      materialize(i);
     sub_nodes[i].to_json(writer);
 
     writer.EndObject();
@@ -150,20 +515,19 @@ void Graph_library::clean_library() {
   {
     std::ofstream fs;
 
-    fs.open(library_file, std::ios::out | std::ios::trunc);
+    fs.open(std::string(file), std::ios::out | std::ios::trunc);
     if (!fs.is_open()) {
-      LGraph::error("graph_library::clean_library could not open graph_library file {}", library_file);
+      LGraph::error("graph_library::export_json could not open file {}", file);
       return;
     }
     fs << s.GetString() << std::endl;
     fs.close();
   }
-
-  graph_library_clean = true;
 }
 
-
 Graph_library *Graph_library::instance(std::string_view path) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   auto it1 = Graph_library::global_instances.find(path);
   if (it1 != Graph_library::global_instances.end()) {
     return it1->second;
@@ -208,6 +572,8 @@ Graph_library *Graph_library::instance(std::string_view path) {
 }
 
 Lg_type_id Graph_library::reset_id(std::string_view name, std::string_view source) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   graph_library_clean = false;
 
   const auto &it = name2id.find(name);
@@ -236,12 +602,16 @@ Lg_type_id Graph_library::reset_id(std::string_view name, std::string_view sourc
 }
 
 bool Graph_library::exists(std::string_view path, std::string_view name) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   const Graph_library *lib = instance(path);
 
   return lib->name2id.find(name) != lib->name2id.end();
 }
 
 LGraph *Graph_library::try_find_lgraph(std::string_view path, std::string_view name) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   const Graph_library *lib = instance(path);  // path must be full path
 
   const auto &glib2 = global_name2lgraph[lib->path];  // WARNING: This inserts name too when needed
@@ -254,6 +624,8 @@ LGraph *Graph_library::try_find_lgraph(std::string_view path, std::string_view n
 }
 
 LGraph *Graph_library::try_find_lgraph(std::string_view name) const {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   I(global_name2lgraph.find(path) != global_name2lgraph.end());
 
   const auto &glib2 = global_name2lgraph[path];
@@ -266,6 +638,8 @@ LGraph *Graph_library::try_find_lgraph(std::string_view name) const {
 }
 
 LGraph *Graph_library::try_find_lgraph(Lg_type_id lgid) const {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   if (lgid >= attributes.size())
     return nullptr;
 
@@ -291,6 +665,8 @@ LGraph *Graph_library::try_find_lgraph(std::string_view path, Lg_type_id lgid) {
 }
 
 Sub_node &Graph_library::reset_sub(std::string_view name, std::string_view source) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   graph_library_clean = false;
 
   Lg_type_id lgid = get_lgid(name);
@@ -299,7 +675,7 @@ Sub_node &Graph_library::reset_sub(std::string_view name, std::string_view sourc
       // LGraph::info("module {} changed source changed from {} to {}\n", name, attributes[lgid].source, source);
       attributes[lgid].source = source;
     }
-    auto &sub = sub_nodes[lgid];
+    auto &sub = *ref_sub(lgid);
     sub.reset_pins();
     return sub;
   }
@@ -310,9 +686,11 @@ Sub_node &Graph_library::reset_sub(std::string_view name, std::string_view sourc
 }
 
 Sub_node &Graph_library::setup_sub(std::string_view name, std::string_view source) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   Lg_type_id lgid = get_lgid(name);
   if (lgid) {
-    return sub_nodes[lgid];
+    return *ref_sub(lgid);
   }
 
   lgid = add_name(name, source);
@@ -321,13 +699,14 @@ Sub_node &Graph_library::setup_sub(std::string_view name, std::string_view sourc
 }
 
 Lg_type_id Graph_library::add_name(std::string_view name, std::string_view source) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   I(source != "");
 
   Lg_type_id id = try_get_recycled_id();
   if (id == 0) {
     id = attributes.size();
-    attributes.emplace_back();
-    sub_nodes.emplace_back();
+    resize_ids(id + 1);
   }
 
   I(id < attributes.size());
@@ -346,6 +725,8 @@ Lg_type_id Graph_library::add_name(std::string_view name, std::string_view sourc
 }
 
 bool Graph_library::rename_name(std::string_view orig, std::string_view dest) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   auto it = name2id.find(orig);
   if (it == name2id.end()) {
     LGraph::error("graph_library: file to rename {} does not exit", orig);
@@ -379,6 +760,8 @@ bool Graph_library::rename_name(std::string_view orig, std::string_view dest) {
 }
 
 void Graph_library::update(Lg_type_id lgid) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   I(lgid < attributes.size());
 
   if (attributes[lgid].version == (max_next_version - 1))
@@ -401,16 +784,113 @@ void Graph_library::reload() {
   spef_list.push_back("fake_bad.spef");    // FIXME
 
   name2id.clear();
-  attributes.resize(1);  // 0 is not a valid ID
-  sub_nodes.resize(1);   // 0 is not a valid ID
+  resize_ids(1);  // 0 is not a valid ID
 
-  if (access(library_file.c_str(), F_OK) == -1) {
+  if (access(library_file.c_str(), F_OK) != -1) {
+    reload_bin();
+  } else if (access(json_file.c_str(), F_OK) != -1) {
+    reload_json();
+  } else {
     mkdir(path.c_str(), 0755);  // At least make sure directory exists for future
-    return;
   }
-  FILE *pFile = fopen(library_file.c_str(), "rb");
-  if (pFile == 0) {
+}
+
+bool Graph_library::reload_bin() {
+  int fd = open(library_file.c_str(), O_RDWR);
+  if (fd < 0) {
     LGraph::error("graph_library::reload could not open graph {} file", library_file);
+    return false;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size < static_cast<off_t>(Lib_header_size)) {
+    close(fd);
+    LGraph::error("graph_library::reload {} is not a graph library file", library_file);
+    return false;
+  }
+
+  auto *b = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (b == MAP_FAILED) {
+    close(fd);
+    LGraph::error("graph_library::reload could not mmap {}", library_file);
+    return false;
+  }
+  lib_base = static_cast<const char *>(b);
+  lib_size = sb.st_size;
+
+  uint32_t header[4];
+  memcpy(header, lib_base, Lib_header_size);
+  if (header[0] != Lib_magic || header[1] != Lib_format_version) {
+    close(fd);
+    unmap_library();
+    if (header[0] == Lib_magic_swapped)
+      LGraph::error("graph_library::reload {} was written by a host with a different byte order", library_file);
+    else if (header[0] == Lib_magic)
+      LGraph::error("graph_library::reload {} format version {} is not supported (version {})", library_file, header[1], Lib_format_version);
+    else
+      LGraph::error("graph_library::reload {} is not a graph library file", library_file);
+    return false;
+  }
+
+  // Only the last record of each lgid matters
+  std::vector<uint64_t> last;
+  uint64_t              off = Lib_header_size;
+  Lib_record            rec;
+  while (parse_record(lib_base, lib_size, off, rec)) {
+    if (rec.lgid >= last.size())
+      last.resize(rec.lgid + 1, 0);
+    last[rec.lgid] = off;
+    off += rec.size;
+  }
+
+  if (off != lib_size) {  // partial record at the end (crash during sync)
+    LGraph::warn("graph_library::reload {} dropping {} bytes of a partial record", library_file, lib_size - off);
+    if (ftruncate(fd, off) != 0)
+      LGraph::warn("graph_library::reload could not truncate {}", library_file);
+  }
+  close(fd);
+  file_bytes = off;
+
+  if (last.size() > attributes.size())
+    resize_ids(last.size());
+
+  for (auto id = 1u; id < last.size(); ++id) {
+    if (last[id] == 0)
+      continue;
+
+    bool ok = parse_record(lib_base, lib_size, last[id], rec);
+    I(ok);
+    (void)ok;
+
+    rec_hash[id] = hash_record(std::string_view(lib_base + last[id], rec.size));
+    rec_size[id] = rec.size;
+    live_bytes += rec.size;
+
+    if (rec.version == 0) {
+      recycled_id.insert(id);
+      continue;
+    }
+
+    if (max_next_version < rec.version)
+      max_next_version = rec.version;
+
+    attributes[id].source  = rec.source;
+    attributes[id].version = rec.version;
+
+    sub_nodes[id].reset(rec.name, id);
+    sub_pending[id] = last[id];  // io_pins decoded on the first get_sub/ref_sub
+
+    name2id[sub_nodes[id].get_name()] = id;
+  }
+
+  return true;
+}
+
+// Old graph_library.json (converted to library_file at the next sync)
+void Graph_library::reload_json() {
+  FILE *pFile = fopen(json_file.c_str(), "rb");
+  if (pFile == 0) {
+    LGraph::error("graph_library::reload could not open graph {} file", json_file);
     return;
   }
   char                      buffer[65536];
@@ -419,8 +899,9 @@ void Graph_library::reload() {
   document.ParseStream<0, rapidjson::UTF8<>, rapidjson::FileReadStream>(is);
 
   if (document.HasParseError()) {
+    fclose(pFile);
     LGraph::error("graph_library::reload {} Error(offset {}): {}",
-                  library_file,
+                  json_file,
                   static_cast<unsigned>(document.GetErrorOffset()),
                   rapidjson::GetParseError_En(document.GetParseError()));
     return;
@@ -438,8 +919,7 @@ void Graph_library::reload() {
     uint64_t id = lg_entry["lgid"].GetUint64();
     ;
     if (id >= attributes.size()) {
-      attributes.resize(id + 1);
-      sub_nodes.resize(id + 1);
+      resize_ids(id + 1);
     }
 
     auto version = lg_entry["version"].GetUint64();
@@ -462,9 +942,26 @@ void Graph_library::reload() {
       recycled_id.insert(id);
     }
   }
+  fclose(pFile);
+
+  for (auto i = 1u; i < attributes.size(); ++i) {
+    if (attributes[i].version != 0)
+      LGraph_Node_Type::upgrade_const(path, i, *const_pool);
+  }
+
+  graph_library_clean = false;  // not in library_file yet
 }
 
-Graph_library::Graph_library(std::string_view _path) : path(_path), library_file(path + "/" + "graph_library.json") {
+Graph_library::Graph_library(std::string_view _path)
+    : path(_path)
+    , library_file(path + "/" + "graph_library.bin")
+    , json_file(path + "/" + "graph_library.json")
+    , lib_base(nullptr)
+    , lib_size(0)
+    , file_bytes(0)
+    , live_bytes(0)
+    , const_pool(std::make_unique<Lconst_pool>(path + "/lconst_pool"))
+    , const_live(0) {
   graph_library_clean = true;
   reload();
 }
@@ -485,6 +982,8 @@ Lg_type_id Graph_library::try_get_recycled_id() {
 void Graph_library::recycle_id(Lg_type_id lgid) { recycled_id.insert(lgid); }
 
 void Graph_library::expunge(std::string_view name) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   auto it2 = name2id.find(name);
   if (it2 == name2id.end()) {
     I(global_name2lgraph[path].find(name) == global_name2lgraph[path].end());
@@ -519,16 +1018,21 @@ void Graph_library::expunge(std::string_view name) {
   }
   closedir(dr);
 
+  sub_pending[id] = 0;
   sub_nodes[id].expunge();  // Nuke IO and contents, but keep around lgid
 }
 
 void Graph_library::clear(Lg_type_id lgid) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   I(lgid < attributes.size());
 
-  sub_nodes[lgid].reset_pins();
+  ref_sub(lgid)->reset_pins();
 }
 
 Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view new_name) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   graph_library_clean = false;
   auto it2            = global_name2lgraph[path].find(name);
   if (it2 != global_name2lgraph[path].end()) {  // orig around, but not open
@@ -542,7 +1046,8 @@ Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view ne
   Lg_type_id id_new = reset_id(new_name, attributes[id_orig].source);
 
   attributes[id_new] = attributes[id_orig];
-  sub_nodes[id_new].copy_from(new_name, id_new, sub_nodes[id_orig]);
+  sub_nodes[id_new].copy_from(new_name, id_new, get_sub(id_orig));
+  sub_pending[id_new] = 0;
 
   DIR *dr = opendir(path.c_str());
   if (dr == NULL) {
@@ -591,6 +1096,8 @@ Lg_type_id Graph_library::copy_lgraph(std::string_view name, std::string_view ne
 }
 
 Lg_type_id Graph_library::register_lgraph(std::string_view name, std::string_view source, LGraph *lg) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   if (global_name2lgraph[path].find(name) != global_name2lgraph[path].end()) {
     I(global_name2lgraph[path][name] == lg);
     I(attributes.size() > lg->get_lgid());
@@ -615,6 +1122,8 @@ Lg_type_id Graph_library::register_lgraph(std::string_view name, std::string_vie
 }
 
 void Graph_library::unregister(std::string_view name, Lg_type_id lgid, LGraph *lg) {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   I(attributes.size() > (size_t)lgid);
   auto it = global_name2lgraph[path].find(name);
   if (lg) {
@@ -622,6 +1131,8 @@ void Graph_library::unregister(std::string_view name, Lg_type_id lgid, LGraph *l
     I(it->second == lg);
     global_name2lgraph[path].erase(it);
     attributes[lgid].lg = 0;
+
+    open_lgraphs.erase(lg);
   } else {
     I(it == global_name2lgraph[path].end());
   }
@@ -631,6 +1142,8 @@ void Graph_library::unregister(std::string_view name, Lg_type_id lgid, LGraph *l
 }
 
 void Graph_library::each_lgraph(std::function<void(Lg_type_id lgid, std::string_view name)> f1) const {
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   for (const auto &[name, id] : name2id) {
     f1(id, name);
   }
@@ -640,6 +1153,8 @@ void Graph_library::each_lgraph(std::string_view match, std::function<void(Lg_ty
   const std::string string_match(match);  // NOTE: regex does not support string_view, c++20 may fix this missing feature
   const std::regex  txt_regex(string_match);
 
+  std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
   for (const auto &[name, id] : name2id) {
     const std::string line(name);
     if (!std::regex_search(line, txt_regex))
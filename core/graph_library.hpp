@@ -1,10 +1,13 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -12,6 +15,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/types/span.h"
+#include "lconst_pool.hpp"
 #include "lgraphbase.hpp"
 #include "sub_node.hpp"
 #include "tech_library.hpp"
@@ -52,25 +56,69 @@ protected:
 
   Lg_type_id        max_next_version;
   const std::string path;
-  const std::string library_file;
+  const std::string library_file;  // binary graph_library.bin
+  const std::string json_file;     // graph_library.json (old format, imported if there is no library_file)
 
   Name2id                       name2id;
   Recycled_id                   recycled_id;
   std::vector<Graph_attributes> attributes;
-  std::vector<Sub_node>         sub_nodes;
+  // deque: add_name from another thread keeps the Sub_node references valid.
+  // Mutable because the io_pins are materialized on the first get_sub.
+  mutable std::deque<Sub_node> sub_nodes;
+
+  // graph_library.bin is an append-only log of records (one per lgraph
+  // update, the last record of an lgid wins). reload only reads the record
+  // headers from the mmap, the io_pins of a Sub_node are decoded on demand.
+  const char *                  lib_base;     // mmap of the library_file at reload (nullptr if none)
+  size_t                        lib_size;
+  mutable std::vector<uint64_t> sub_pending;  // mmap offset of the record with io_pins not decoded yet (0 if done)
+  std::vector<uint64_t>         rec_hash;     // hash of the last record written per lgid (0 if none)
+  std::vector<uint32_t>         rec_size;
+  uint64_t                      file_bytes;  // current library_file size
+  uint64_t                      live_bytes;  // bytes of the last record of each lgid (compact when mostly dead)
+
+  std::unique_ptr<Lconst_pool> const_pool;  // constants shared by all the lgraphs in the path
+  size_t                       const_live;  // live pool handles at the last compaction check
 
   static Global_instances   global_instances;
   static Global_name2lgraph global_name2lgraph;
+  static std::recursive_mutex global_mutex;  // global maps and library updates can be called from several threads
+
+  // Every open lgraph, mapped or not. Over open_budget mapped ones,
+  // release_unused unmaps the least recently accessed (node tables and
+  // attributes). The LGraph objects stay valid and stay here, any access
+  // reloads the mmaps, so the next release_unused sees them mapped again.
+  static absl::flat_hash_set<LGraph *> open_lgraphs;
+  static size_t                        open_budget;  // 0 is no limit
+  static std::atomic<uint64_t>         access_clock;
 
   bool graph_library_clean;
 
-  Graph_library() { max_next_version = 1; }
+  Graph_library()
+      : lib_base(nullptr)
+      , lib_size(0)
+      , file_bytes(0)
+      , live_bytes(0)
+      , const_pool(std::make_unique<Lconst_pool>(""))
+      , const_live(0) {
+    max_next_version = 1;
+  }
 
   explicit Graph_library(std::string_view _path);
 
   void clean_library();
 
-  ~Graph_library() { }
+  ~Graph_library();
+
+  void        materialize(Lg_type_id lgid) const;
+  void        resize_ids(size_t sz);
+  std::string get_record(Lg_type_id lgid) const;
+  bool        same_record(Lg_type_id lgid) const;
+  void        compact_library();
+  void        compact_const_pool();
+  bool        reload_bin();
+  void        reload_json();
+  void        unmap_library();
 
   Lg_type_id reset_id(std::string_view name, std::string_view source);
 
@@ -99,19 +147,25 @@ public:
   Sub_node &setup_sub(std::string_view name) { return setup_sub(name, "-"); }
 
   Sub_node *ref_sub(Lg_type_id lgid) {
+    std::lock_guard<std::recursive_mutex> guard(global_mutex);  // add_name (other thread) may resize sub_pending
     graph_library_clean = false;
     I(lgid > 0);  // 0 is invalid lgid
     I(attributes.size() > lgid);
     I(attributes.size() == sub_nodes.size());
     I(sub_nodes[lgid].get_lgid() == lgid);
+    if (sub_pending[lgid])
+      materialize(lgid);
     return &sub_nodes[lgid];
   }
 
   const Sub_node &get_sub(Lg_type_id lgid) const {
+    std::lock_guard<std::recursive_mutex> guard(global_mutex);  // add_name (other thread) may resize sub_pending
     I(lgid > 0);  // 0 is invalid lgid
     I(attributes.size() > lgid);
     I(attributes.size() == sub_nodes.size());
     I(sub_nodes[lgid].get_lgid() == lgid);
+    if (sub_pending[lgid])
+      materialize(lgid);
     return sub_nodes[lgid];
   }
 
@@ -129,6 +183,8 @@ public:
   }
 
   Lg_type_id get_lgid(std::string_view name) const {
+    std::lock_guard<std::recursive_mutex> guard(global_mutex);
+
     const auto &it = name2id.find(name);
     if (it != name2id.end()) {
       return it->second;
@@ -155,11 +211,20 @@ public:
     return attributes[lgid].version;
   }
 
-  bool has_name(std::string_view name) const { return name2id.find(name) != name2id.end(); }
+  bool has_name(std::string_view name) const {
+    std::lock_guard<std::recursive_mutex> guard(global_mutex);
+    return name2id.find(name) != name2id.end();
+  }
+
+  // Thread safe, Const nodes keep a handle to the pool
+  Lconst_pool &ref_const_pool() const { return *const_pool; }
 
   // TODO: Change to Graph_library &instance...
   static Graph_library *instance(std::string_view path);
 
+  // Lock to make a lookup + create/open sequence atomic (LGraph::open/create)
+  static std::recursive_mutex &get_mutex() { return global_mutex; }
+
   Lg_type_id get_max_version() const {
     assert(max_next_version > 0);
     return max_next_version - 1;
@@ -189,12 +254,33 @@ public:
 
   void sync() { clean_library(); }
 
+  // Debug dump of the library in the old graph_library.json format
+  void export_json(std::string_view file) const;
+
   static void sync_all();  // Called when running out of mmaps
+
+  // LGraph::open/create: track the lgraph for release_unused. Nothing is
+  // released here, other threads may be using any open lgraph.
+  static void     touch_lgraph(LGraph *lg);
+  static uint64_t next_access() { return access_clock.fetch_add(1, std::memory_order_relaxed) + 1; }
+
+  // Safe point only (between commands, no pass running): release the mmaps
+  // of the least recently accessed lgraphs over the budget, and enforce the
+  // mmap_gc memory budget. Lgraphs being edited (locked) are not released.
+  static void   release_unused();
+  static void   set_open_budget(size_t n_lgraphs);
+  static size_t get_open_budget();
+  static size_t get_n_open_mapped();  // open lgraphs with the node table mapped
   static void shutdown();  // Called on program exit to clean pointers (asan)
 
-  absl::Span<const Sub_node> get_sub_nodes() const {
+  void each_sub_node(const std::function<void(const Sub_node &sub)> &f1) const {
+    std::lock_guard<std::recursive_mutex> guard(global_mutex);
     I(sub_nodes.size() >= 1);
-    return absl::MakeSpan(sub_nodes).subspan(1);
+    for (auto i = 1u; i < sub_nodes.size(); ++i) {  // Not position zero
+      if (sub_pending[i])
+        materialize(i);
+      f1(sub_nodes[i]);
+    }
   };
 
   absl::Span<const std::string> get_liberty() const { return absl::MakeSpan(liberty_list); };
@@ -2,95 +2,309 @@
 
 #include "hierarchy.hpp"
 
-#include "annotate.hpp"
+#include <algorithm>
+#include <limits>
+
 #include "lgraph.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
 
-Hierarchy_tree::Hierarchy_tree(LGraph *_top)
-    : mmap_lib::tree<Hierarchy_data>(_top->get_path(), absl::StrCat(_top->get_name(), "_htree")), top(_top) {}
+Hierarchy_tree::Hierarchy_tree(LGraph *_top) : top(_top) {}
+
+void Hierarchy_tree::clear() {
+  classes.clear();
+  lgid2class.clear();
+  class_done.clear();
+  global_version = 0;
+}
+
+Hierarchy_tree::Walk Hierarchy_tree::walk(mmap_lib::Tree_pos pos) const {
+  I(!classes.empty());
+  I(pos >= 0 && static_cast<uint64_t>(pos) < classes[0].n_instances);
+
+  Walk w{0, 0, root_index(), root_index(), 0};  // parent of root is root
+
+  while (w.self.pos != pos) {
+    const auto &children = classes[w.class_id].children;
+    I(!children.empty());
+
+    const uint64_t delta = pos - w.self.pos;
+
+    // Last child that starts before (or at) pos
+    auto it = std::upper_bound(children.begin(), children.end(), delta, [](uint64_t d, const Hierarchy_child &c) {
+      return d < c.offset;
+    });
+    I(it != children.begin());
+    --it;
+
+    w.parent          = w.self;
+    w.parent_class_id = w.class_id;
+    w.tree_pos        = it - children.begin();
+    w.class_id        = it->class_id;
+    w.self            = Hierarchy_index(w.self.level + 1, w.self.pos + it->offset);
+  }
+
+  return w;
+}
+
+Hierarchy_data Hierarchy_tree::get_data(const Hierarchy_index &hidx) const {
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
+
+  const auto *lg = classes[w.class_id].lg;
+  if (hidx.is_root())
+    return Hierarchy_data(lg->get_lgid(), 0);
+
+  return Hierarchy_data(lg->get_lgid(), classes[w.parent_class_id].children[w.tree_pos].up_nid);
+}
 
 LGraph *Hierarchy_tree::ref_lgraph(const Hierarchy_index &hidx) const {
   I(!hidx.is_invalid()); // no hierarchical should not call this
 
-  // NOTE: if this becomes a bottleneck, we can memorize the LGraph *
-  const auto &data = get_data(hidx);
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
 
-  I(data.lgid);
-
-  auto *lg = LGraph::open(get_path(), data.lgid);
+  auto *lg = classes[w.class_id].lg;
   I(lg);
   return lg;
 }
 
 Node Hierarchy_tree::get_instance_up_node(const Hierarchy_index &hidx) const {
-  const auto &data = get_data(hidx);
+  I(!hidx.is_root());
+
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
 
-  auto up_hidx = get_parent(hidx);
+  const auto &up_class = classes[w.parent_class_id];
+  LGraph *    lg       = up_class.lg;
+  GI(!w.parent.is_root(), top != lg);
+  I(lg);
+
+  return Node(top, lg, w.parent, up_class.children[w.tree_pos].up_nid);
+}
 
-  I(data.lgid);
+bool Hierarchy_tree::is_leaf(const Hierarchy_index &hidx) const {
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
 
-  LGraph *lg;
-  if (up_hidx.is_root()) {
-    lg = top;
-  } else {
-    const auto &up_data = get_data(up_hidx);
-    lg                  = LGraph::open(get_path(), up_data.lgid);
-    I(top != lg);
+  return classes[w.class_id].n_instances == 1;  // children may have removed slots
+}
+
+Hierarchy_index Hierarchy_tree::get_parent(const Hierarchy_index &hidx) const {
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
+
+  return w.parent;
+}
+
+Hierarchy_index Hierarchy_tree::get_first_child(const Hierarchy_index &hidx) const {
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
+
+  for (const auto &c : classes[w.class_id].children) {
+    if (c.class_id != Removed_class)
+      return Hierarchy_index(hidx.level + 1, hidx.pos + c.offset);
   }
-  I(lg);
 
-  return Node(top, lg, up_hidx, data.up_nid);
+  I(false);  // is_leaf
+  return invalid_index();
 }
 
-void Hierarchy_tree::regenerate_step(LGraph *lg, const Hierarchy_index &parent) {
-  auto *tree_pos = Ann_node_tree_pos::ref(lg);
+Hierarchy_index Hierarchy_tree::get_child(const Hierarchy_index &hidx, int tree_pos) const {
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
 
-  int conta = 0;
-  for (auto it : lg->get_down_nodes_map()) {
+  const auto &children = classes[w.class_id].children;
+  I(tree_pos >= 0 && tree_pos < static_cast<int>(children.size()));
+  I(children[tree_pos].class_id != Removed_class);
+
+  return Hierarchy_index(hidx.level + 1, hidx.pos + children[tree_pos].offset);
+}
 
-    auto child_lgid = lg->get_type_sub(it.first.get_nid());
+Hierarchy_index Hierarchy_tree::get_depth_preorder_next(const Hierarchy_index &hidx) const {
+  I(!hidx.is_invalid());
 
-    auto node = it.first.get_node(lg);
+  auto next_pos = static_cast<uint64_t>(hidx.pos) + 1;
+  if (next_pos >= size())
+    return invalid_index();
+
+  return walk(static_cast<mmap_lib::Tree_pos>(next_pos)).self;
+}
+
+uint32_t Hierarchy_tree::regenerate_step(LGraph *lg) {
+  auto it = lgid2class.find(lg->get_lgid().value);
+  if (it != lgid2class.end()) {
+    I(class_done[it->second]);  // Otherwise, the lgraph instantiates itself
+    return it->second;
+  }
+
+  const uint32_t class_id = classes.size();
+  lgid2class[lg->get_lgid().value] = class_id;
+  classes.emplace_back();
+  classes[class_id].version = lg->get_hier_version();
+  class_done.emplace_back(false);
+
+  std::vector<Hierarchy_child>                   children;
+  absl::flat_hash_map<Index_ID::type, uint32_t> nid2pos;
+  uint64_t                                       n_instances = 1;
+  for (auto it2 : lg->get_down_nodes_map()) {
+
+    auto child_lgid = lg->get_type_sub(it2.first.get_nid());
+
+    auto node = it2.first.get_node(lg);
 #ifndef NDEBUG
     I(node.is_type_sub());
     I(child_lgid == node.get_type_sub());
 #endif
 
-    auto *child_lg  = lg->get_library().try_find_lgraph(child_lgid);
-    if (child_lg==nullptr) {
+    auto *child_lg = lg->get_library().try_find_lgraph(child_lgid);
+    if (child_lg == nullptr) {
       I(!node.is_type_sub_present());
       continue;
     }
 
-    //Hierarchy_data data(child_lgid, node.get_nid());
-    auto      child = add_child(parent, {child_lgid, node.get_nid()});
+    auto child_class_id = regenerate_step(child_lg);  // classes may be reallocated
 
-    I(child.pos == conta+get_first_child(parent).pos);
-    tree_pos->set(it.first, conta);
+    nid2pos[node.get_nid().value] = children.size();
+    children.emplace_back(Hierarchy_child{node.get_nid(), child_class_id, n_instances});
 
-    regenerate_step(child_lg, child);
-
-    conta++;
+    n_instances += classes[child_class_id].n_instances;
   }
+
+  auto &hclass       = classes[class_id];
+  hclass.lg          = lg;
+  hclass.n_instances = n_instances;
+  hclass.children    = std::move(children);
+  hclass.nid2pos     = std::move(nid2pos);
+
+  class_done[class_id] = true;
+
+  return class_id;
 }
 
 void Hierarchy_tree::regenerate() {
-  Hierarchy_data data(top->get_lgid(), 0);
-  set_root(data);
+  clear();
+
+  global_version = LGraph_Base::get_global_hier_version();  // before the walk, later edits trigger an update
+  regenerate_step(top);
 
-  regenerate_step(top, Hierarchy_tree::root_index());
+  // Hierarchy_index pos is a Tree_pos
+  I(size() < static_cast<uint64_t>(std::numeric_limits<mmap_lib::Tree_pos>::max()), "too many instances in the hierarchy");
+}
+
+void Hierarchy_tree::update_class(uint32_t class_id) {
+  auto *lg                  = classes[class_id].lg;
+  classes[class_id].version = lg->get_hier_version();
+
+  auto live = classes[class_id].nid2pos;  // up_nid to tree_pos, not seen yet
+
+  std::vector<std::pair<Index_ID, LGraph *>> added;
+  for (auto it : lg->get_down_nodes_map()) {
+    auto  nid      = it.first.get_nid();
+    auto *child_lg = lg->get_library().try_find_lgraph(lg->get_type_sub(nid));
+    if (child_lg == nullptr)
+      continue;
+
+    auto it2 = live.find(nid.value);
+    if (it2 != live.end()) {
+      const auto &c = classes[class_id].children[it2->second];
+      if (classes[c.class_id].lg == child_lg) {
+        live.erase(it2);  // Unchanged instance
+        continue;
+      }
+      // Same node, different sub lgraph: remove + add
+    }
+    added.emplace_back(nid, child_lg);
+  }
+
+  // Removed instances leave an empty slot (tree_pos of the others does not change)
+  for (const auto &it : live) {
+    classes[class_id].children[it.second].class_id = Removed_class;
+    classes[class_id].nid2pos.erase(it.first);
+  }
+
+  for (const auto &[nid, child_lg] : added) {
+    auto child_class_id = regenerate_step(child_lg);  // classes may be reallocated
+
+    auto &hclass              = classes[class_id];
+    hclass.nid2pos[nid.value] = hclass.children.size();
+    hclass.children.emplace_back(Hierarchy_child{nid, child_class_id, 0});  // offset set by recount
+  }
+
+  // Too many empty slots: compact (only the tree_pos of this class change)
+  auto &hclass = classes[class_id];
+  if (hclass.children.size() > 2 * hclass.nid2pos.size() + 8) {
+    std::vector<Hierarchy_child> compact;
+    for (const auto &c : hclass.children) {
+      if (c.class_id == Removed_class)
+        continue;
+      hclass.nid2pos[c.up_nid.value] = compact.size();
+      compact.emplace_back(c);
+    }
+    hclass.children = std::move(compact);
+  }
+}
+
+uint64_t Hierarchy_tree::recount_step(uint32_t class_id, std::vector<uint8_t> &state) {
+  if (state[class_id] == 2)
+    return classes[class_id].n_instances;
+
+  I(state[class_id] == 0);  // Otherwise, the lgraph instantiates itself
+  state[class_id] = 1;
+
+  uint64_t n_instances = 1;
+  for (auto &c : classes[class_id].children) {
+    c.offset = n_instances;  // removed slots share the offset with the next instance
+    if (c.class_id == Removed_class)
+      continue;
+    n_instances += recount_step(c.class_id, state);
+  }
+
+  classes[class_id].n_instances = n_instances;
+  state[class_id]               = 2;
+
+  return n_instances;
+}
+
+void Hierarchy_tree::update_int() {
+  if (classes.empty()) {
+    regenerate();
+    return;
+  }
+
+  global_version = LGraph_Base::get_global_hier_version();
+
+  bool changed = false;
+  for (auto i = 0u; i < classes.size(); ++i) {  // update_class may add classes (already up to date)
+    if (classes[i].lg->get_hier_version() == classes[i].version)
+      continue;
+
+    update_class(i);
+    changed = true;
+  }
+  if (!changed)
+    return;
+
+  std::vector<uint8_t> state(classes.size(), 0);
+  recount_step(0, state);
+
+  I(size() < static_cast<uint64_t>(std::numeric_limits<mmap_lib::Tree_pos>::max()), "too many instances in the hierarchy");
 }
 
 Hierarchy_index Hierarchy_tree::go_down(const Node &node) const {
-  auto *tree_pos = Ann_node_tree_pos::ref(node.get_class_lgraph());
-  I(tree_pos);
-  I(tree_pos->has(node.get_compact_class()));
-  auto pos = tree_pos->get(node.get_compact_class());
+  const auto &hidx = node.get_hidx();
+
+  auto w = walk(hidx.pos);
+  I(w.self == hidx);
+
+  const auto &hclass = classes[w.class_id];
+  I(hclass.lg == node.get_class_lgraph());
+
+  auto it = hclass.nid2pos.find(node.get_nid().value);
+  if (it == hclass.nid2pos.end())
+    return invalid_index();  // not an instance (or added after the last update)
 
-  I(!is_leaf(node.get_hidx()));
-  Hierarchy_index child(node.get_hidx().level + 1, pos);
-  return child;
+  return Hierarchy_index(hidx.level + 1, hidx.pos + hclass.children[it->second].offset);
 }
 
 Hierarchy_index Hierarchy_tree::go_up(const Node &node) const { return get_parent(node.get_hidx()); }
@@ -98,9 +312,10 @@ bool            Hierarchy_tree::is_root(const Node &node) const { return node.ge
 
 /* LCOV_EXCL_START */
 void Hierarchy_tree::dump() const {
+  fmt::print("hierarchy instances:{} unique lgraphs:{}\n", size(), get_n_classes());
   for (const auto &index : depth_preorder()) {
     std::string indent(index.level, ' ');
-    const auto &index_data = get_data(index);
+    const auto  index_data = get_data(index);
     fmt::print("{} level:{} pos:{} lgid:{} nid:{}\n", indent, index.level, index.pos, index_data.lgid, index_data.up_nid);
   }
 }
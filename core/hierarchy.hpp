@@ -2,29 +2,148 @@
 
 #pragma once
 
-#include "mmap_tree.hpp"
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "lgraph_base_core.hpp"
+#include "lgraphbase.hpp"
+#include "mmap_tree.hpp"
 
 class Node;
 class LGraph;
 
-class Hierarchy_tree : public mmap_lib::tree<Hierarchy_data> {
+// The instance tree is not unrolled. Each unique LGraph in the hierarchy is
+// stored once (a DAG of classes), and an instance is identified by its depth
+// preorder position in the (virtual) unrolled tree:
+//
+//   Hierarchy_index.level is the depth (0 is top)
+//   Hierarchy_index.pos   is the preorder position (0 is top)
+//
+// The child at tree_pos N of an instance at pos P is at P + children[N].offset,
+// where offset is 1 + the instances of the previous siblings. Regenerate scales
+// with the unique lgraphs, not with the instances. Per instance data (e.g:
+// attributes indexed by Node::Compact) uses the unique pos, so no subtree needs
+// to be expanded.
+//
+// Adding/removing a sub instance (LGraph hier_version) only updates the class
+// of the edited lgraph: new instances are appended (tree_pos) and removed ones
+// leave an empty slot, so the tree_pos of the other instances does not change.
+// Positions before the edited subtree are stable.
+//
+// The tree_pos of a sub node is kept in the class (not in the lgraph): the
+// same lgraph can be in the trees of several tops, each updated at its own
+// time, so their slots can differ.
+class Hierarchy_tree {
 protected:
+  static constexpr uint32_t Removed_class = UINT32_MAX;  // Empty slot (deleted instance) in children
+
+  struct Hierarchy_child {
+    Index_ID up_nid;    // Sub node in the parent lgraph
+    uint32_t class_id;  // Position in classes (or Removed_class)
+    uint64_t offset;    // preorder distance from the parent instance
+  };
+
+  struct Hierarchy_class {
+    LGraph *                                        lg;
+    uint64_t                                        version;      // lg hier_version when children was computed
+    uint64_t                                        n_instances;  // instances in the unrolled subtree (self included)
+    std::vector<Hierarchy_child>                    children;     // tree_pos order
+    absl::flat_hash_map<Index_ID::type, uint32_t> nid2pos;       // up_nid to tree_pos (live children only)
+  };
+
+  struct Walk {  // Result of walking down from the root to a pos
+    uint32_t        class_id;
+    uint32_t        parent_class_id;
+    Hierarchy_index self;
+    Hierarchy_index parent;    // invalid for root
+    int             tree_pos;  // position in the parent children
+  };
+
   LGraph *top;
 
-  void regenerate_step(LGraph *lg, const Hierarchy_index &parent);
+  std::vector<Hierarchy_class>                    classes;  // classes[0] is top
+  absl::flat_hash_map<Lg_type_id::type, uint32_t> lgid2class;
+  std::vector<bool>                               class_done;  // Loop detection during regenerate
+  uint64_t                                        global_version = 0;  // LGraph_Base::get_global_hier_version() seen
+
+  uint32_t regenerate_step(LGraph *lg);
+  void     update_class(uint32_t class_id);
+  uint64_t recount_step(uint32_t class_id, std::vector<uint8_t> &state);
+  void     update_int();
+
+  Walk walk(mmap_lib::Tree_pos pos) const;
 
 public:
+  class Tree_depth_preorder_iterator {
+  public:
+    class CTree_depth_preorder_iterator {
+    public:
+      CTree_depth_preorder_iterator(const Hierarchy_index &_ti, const Hierarchy_tree *_t) : ti(_ti), t(_t) {}
+      CTree_depth_preorder_iterator operator++() {
+        CTree_depth_preorder_iterator i(ti, t);
+
+        ti = t->get_depth_preorder_next(ti);
+
+        return i;
+      };
+      bool operator!=(const CTree_depth_preorder_iterator &other) {
+        I(t == other.t);
+        return ti != other.ti;
+      }
+      const Hierarchy_index &operator*() const { return ti; }
+
+    private:
+      Hierarchy_index       ti;
+      const Hierarchy_tree *t;
+    };
+
+  protected:
+    Hierarchy_index       ti;
+    const Hierarchy_tree *t;
+
+  public:
+    Tree_depth_preorder_iterator() = delete;
+    explicit Tree_depth_preorder_iterator(const Hierarchy_index &_b, const Hierarchy_tree *_t) : ti(_b), t(_t) {}
+
+    CTree_depth_preorder_iterator begin() const { return CTree_depth_preorder_iterator(ti, t); }
+    CTree_depth_preorder_iterator end() const { return CTree_depth_preorder_iterator(invalid_index(), t); }
+  };
+
   Hierarchy_tree(LGraph *top);
 
-  void regenerate();  // Triggered when the hierarchy may have changed
+  void regenerate();  // Full rebuild
+  void clear();
+
+  void update() {  // Catch up with the sub instances added/removed since the last call
+    if (!classes.empty() && global_version == LGraph_Base::get_global_hier_version())
+      return;
+    update_int();
+  }
 
-  // Lg_type_id get_lgid(const Hierarchy_index &hidx) const { return get_data(hidx).lgid; }
-  Node get_instance_up_node(const Hierarchy_index &hidx) const;
+  [[nodiscard]] bool empty() const { return classes.empty(); }
+
+  static constexpr Hierarchy_index invalid_index() { return mmap_lib::Tree_index(-1, -1); }
+  static constexpr Hierarchy_index root_index() { return mmap_lib::Tree_index(0, 0); }
+  constexpr Hierarchy_index        get_root() const { return root_index(); }
+
+  uint64_t size() const { return classes.empty() ? 0 : classes[0].n_instances; }  // instances (unrolled tree size)
+  size_t   get_n_classes() const { return classes.size(); }                       // unique lgraphs
+
+  Hierarchy_data get_data(const Hierarchy_index &hidx) const;
+  Node           get_instance_up_node(const Hierarchy_index &hidx) const;
 
   LGraph *ref_lgraph(const Hierarchy_index &hidx) const;
 
-  Hierarchy_index go_down(const Node &node) const;
+  bool            is_leaf(const Hierarchy_index &hidx) const;
+  Hierarchy_index get_parent(const Hierarchy_index &hidx) const;
+  Hierarchy_index get_first_child(const Hierarchy_index &hidx) const;
+  Hierarchy_index get_child(const Hierarchy_index &hidx, int tree_pos) const;
+  Hierarchy_index get_depth_preorder_next(const Hierarchy_index &hidx) const;
+
+  Tree_depth_preorder_iterator depth_preorder() const { return Tree_depth_preorder_iterator(get_root(), this); }
+
+  Hierarchy_index go_down(const Node &node) const;  // invalid_index() if node is not a sub instance in this tree
 
   Hierarchy_index go_up(const Node &node) const;
   bool            is_root(const Node &node) const;
@@ -34,6 +34,7 @@ void Fast_edge_iterator::Fast_iter::go_next() {
       while (!next_hidx.is_invalid()) {
         hidx      = next_hidx;
         current_g = top_g->ref_htree()->ref_lgraph(hidx);
+        current_g->touch();  // the walk maps the sub tables, keep it recent for release_unused
         nid       = current_g->fast_first();
         if (!nid.is_invalid()) {
           Node node(current_g, current_g, Hierarchy_tree::root_index(), nid);
@@ -275,11 +276,77 @@ void Fwd_edge_iterator::Fwd_iter::fwd_get_from_pending() {
   } while (true);
 }
 
+void Fwd_edge_iterator::Fwd_iter::fwd_get_from_replay() {
+  if (unlikely(order_lg->get_edit_version() != order_version)) {
+    fwd_replay_fallback();  // The graph was edited during the traversal
+    return;
+  }
+
+  if (replay_pos >= replay_order->size()) {
+    current_node.invalidate();
+    return;
+  }
+
+  current_node.update(order_lg, (*replay_order)[replay_pos]);
+  ++replay_pos;
+}
+
+void Fwd_edge_iterator::Fwd_iter::fwd_replay_fallback() {
+  // Continue with the incremental algorithm. Everything not returned yet is unvisited
+  absl::flat_hash_set<Node::Compact> visited;
+  for (auto i = 0u; i < replay_pos; ++i) {
+    visited.insert((*replay_order)[i]);
+  }
+  replay_order = nullptr;
+
+  unvisited.clear();
+  pending_stack.clear();
+  for (auto node : order_lg->fast(visit_sub)) {
+    if (!visited.contains(node.get_compact()))
+      unvisited.insert(node.get_compact());
+  }
+
+  linear_phase = false;
+  global_it    = order_lg->fast(visit_sub).begin();
+
+  fwd_get_from_pending();
+}
+
+void Fwd_edge_iterator::Fwd_iter::fwd_record() {
+  if (!record)
+    return;
+
+  if (order_lg->get_edit_version() != order_version) {  // Edited while traversing, the order is not reusable
+    record = false;
+    record_order.clear();
+    return;
+  }
+
+  if (current_node.is_invalid()) {  // Complete traversal
+    order_lg->set_fwd_order(std::move(record_order), order_version);
+    record = false;
+    return;
+  }
+
+  record_order.emplace_back(current_node.get_compact());
+}
+
 void Fwd_edge_iterator::Fwd_iter::fwd_first(LGraph *lg) {
   I(!lg->is_empty());
   I(current_node.is_invalid());
   I(linear_phase);
 
+  order_version = lg->get_edit_version();
+  if (!visit_sub) {
+    replay_order = lg->get_fwd_order();
+    if (replay_order) {
+      fwd_get_from_replay();
+      I(!current_node.is_invalid());
+      return;
+    }
+    record = true;
+  }
+
   fwd_get_from_linear(lg);
   if (current_node.is_invalid()) {
     I(!linear_phase);
@@ -288,20 +355,28 @@ void Fwd_edge_iterator::Fwd_iter::fwd_first(LGraph *lg) {
 
   I(!current_node.is_invalid());
   I(current_node.get_class_lgraph()->is_valid_node(current_node.get_nid()));
+
+  fwd_record();
 }
 
 void Fwd_edge_iterator::Fwd_iter::fwd_next() {
+  if (replay_order) {
+    fwd_get_from_replay();
+    return;
+  }
+
   if (linear_phase) {
     fwd_get_from_linear(current_node.get_top_lgraph());
     GI(current_node.is_invalid(), !linear_phase);
 
     if (current_node.is_invalid() || !current_node.get_class_lgraph()->is_valid_node(current_node.get_nid()))
       fwd_get_from_pending();
-    return;
+  } else {
+    fwd_get_from_pending();
+    GI(!current_node.is_invalid(), current_node.get_class_lgraph()->is_valid_node(current_node.get_nid()));
   }
 
-  fwd_get_from_pending();
-  GI(!current_node.is_invalid(), current_node.get_class_lgraph()->is_valid_node(current_node.get_nid()));
+  fwd_record();
 }
 
 void Bwd_edge_iterator::Bwd_iter::bwd_first(LGraph *lg) {
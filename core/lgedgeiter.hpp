@@ -64,7 +64,9 @@ public:
   };
 
   Fast_edge_iterator() = delete;
-  explicit Fast_edge_iterator(LGraph *_g, bool _visit_sub) : top_g(_g), visit_sub(_visit_sub) {}
+  explicit Fast_edge_iterator(LGraph *_g, bool _visit_sub) : top_g(_g), visit_sub(_visit_sub) { top_g->fast_walk_begin(); }
+  Fast_edge_iterator(const Fast_edge_iterator &other) : top_g(other.top_g), visit_sub(other.visit_sub) { top_g->fast_walk_begin(); }
+  ~Fast_edge_iterator() { top_g->fast_walk_end(); }
 
   Fast_iter begin() const;
   Fast_iter end() const { return Fast_iter(visit_sub); }
@@ -114,16 +116,34 @@ class Fwd_edge_iterator {
 public:
   class Fwd_iter : public Flow_base_iterator {
   protected:
+    // Non-hierarchical traversals of an unmodified graph replay the order
+    // cached in the LGraph (linear scan, no hashing). The first traversal
+    // records it.
+    LGraph *                                          order_lg;
+    uint64_t                                          order_version;
+    std::shared_ptr<const std::vector<Node::Compact>> replay_order;
+    size_t                                            replay_pos;
+    bool                                              record;
+    std::vector<Node::Compact>                        record_order;
+
     void topo_add_chain_down(const Node_pin &dst_pin);
     void topo_add_chain_fwd(const Node_pin &driver_pin);
     void fwd_get_from_linear(LGraph *top);
     void fwd_get_from_pending();
+    void fwd_get_from_replay();
+    void fwd_replay_fallback();
+    void fwd_record();
     void fwd_first(LGraph *lg);
     void fwd_next();
 
   public:
-    Fwd_iter(LGraph *lg, bool _visit_sub) : Flow_base_iterator(lg, _visit_sub) { fwd_first(lg); }
-    Fwd_iter(bool _visit_sub) : Flow_base_iterator(_visit_sub) { I(current_node.is_invalid()); }
+    Fwd_iter(LGraph *lg, bool _visit_sub) : Flow_base_iterator(lg, _visit_sub), order_lg(lg), replay_pos(0), record(false) {
+      fwd_first(lg);
+    }
+    Fwd_iter(bool _visit_sub)
+        : Flow_base_iterator(_visit_sub), order_lg(nullptr), order_version(0), replay_pos(0), record(false) {
+      I(current_node.is_invalid());
+    }
 
     bool operator!=(const Fwd_iter &other) const {
       GI(!current_node.is_invalid() && !other.current_node.is_invalid(),
@@ -30,10 +30,13 @@ LGraph::~LGraph() {
 bool LGraph::exists(std::string_view path, std::string_view name) { return Graph_library::try_find_lgraph(path, name) != nullptr; }
 
 LGraph *LGraph::create(std::string_view path, std::string_view name, std::string_view source) {
+  std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());  // find + new must be atomic
+
   LGraph *lg = Graph_library::try_find_lgraph(path, name);
   if (lg == nullptr) {
     lg = new LGraph(path, name, source);
   }
+  Graph_library::touch_lgraph(lg);
 
   lg->clear();
 
@@ -62,40 +65,46 @@ LGraph *LGraph::clone_skeleton(std::string_view new_lg_name) {
 }
 
 LGraph *LGraph::open(std::string_view path, Lg_type_id lgid) {
+  std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());  // find + new must be atomic
+
   auto *lib = Graph_library::instance(path);
   if (unlikely(lib == nullptr))
     return nullptr;
 
   LGraph *lg = lib->try_find_lgraph(lgid);
-  if (likely(lg != nullptr)) {
-    return lg;
-  }
+  if (unlikely(lg == nullptr)) {
+    if (!lib->exists(lgid))
+      return nullptr;
 
-  if (!lib->exists(lgid))
-    return nullptr;
+    auto        name = lib->get_name(lgid);
+    std::string source{lib->get_source(lgid)};
 
-  auto name   = lib->get_name(lgid);
-  std::string source{lib->get_source(lgid)};
+    lg = new LGraph(path, name, source);  // no mmaps until the first access
+  }
 
-  return new LGraph(path, name, source);
+  Graph_library::touch_lgraph(lg);
+  return lg;
 }
 
 LGraph *LGraph::open(std::string_view path, std::string_view name) {
+  std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());  // find + new must be atomic
+
   LGraph *lg = Graph_library::try_find_lgraph(path, name);
-  if (lg) {
-    return lg;
-  }
+  if (lg == nullptr) {
+    auto *lib = Graph_library::instance(path);
+    if (lib == nullptr)
+      return nullptr;
 
-  auto *lib = Graph_library::instance(path);
-  if (lib == nullptr)
-    return nullptr;
+    if (unlikely(!lib->has_name(name)))
+      return nullptr;
 
-  if (unlikely(!lib->has_name(name)))
-    return nullptr;
+    std::string source{lib->get_source(name)};
 
-  std::string source{lib->get_source(name)};
+    lg = new LGraph(path, name, source);  // no mmaps until the first access
+  }
 
-  return new LGraph(path, name, source);
+  Graph_library::touch_lgraph(lg);
+  return lg;
 }
 
 void LGraph::rename(std::string_view path, std::string_view orig, std::string_view dest) {
@@ -123,8 +132,10 @@ void LGraph::clear() {
   set_type(nid2, Ntype_op::IO);
 
   htree.clear();
+  bump_hier_version();  // lgraphs instantiating this one
 
-  std::fill(memoize_const_hint.begin(), memoize_const_hint.end(), 0);  // Not needed but neat
+  const_memo.clear();
+  const_memo_ready = true;  // empty graph, nothing to scan
 }
 
 void LGraph::sync() {
@@ -135,6 +146,27 @@ void LGraph::sync() {
   LGraph_Base::sync();  // last. Removes lock at the end
 }
 
+bool LGraph::unmap_tables() {
+  if (locked)
+    return false;
+
+  Ann_support::unmap(this);
+
+  node_internal.sync();
+  const_map.sync();
+  subid_map.sync();
+  lut_map.sync();
+
+  return true;
+}
+
+void LGraph::relocate_const(const Lconst_pool::Relocation &old2new) {
+  LGraph_Node_Type::relocate_const(old2new);
+
+  const_memo.clear();
+  const_memo_ready = false;
+}
+
 Node_pin LGraph::get_graph_input(std::string_view str) {
   I(get_self_sub_node().is_input(str)); // The input does not exist, do not call get_input
   auto io_pid = get_self_sub_node().get_instance_pid(str);
@@ -194,10 +226,14 @@ Node_pin LGraph::add_graph_input(std::string_view str, Port_ID pos, uint32_t bit
   I(!is_graph_output(str));
 
   Port_ID inst_pid;
-  if (get_self_sub_node().has_pin(str)) {
-    inst_pid = ref_self_sub_node()->map_graph_pos(str, Sub_node::Direction::Input, pos);  // reset pin stats
-  } else {
-    inst_pid = ref_self_sub_node()->add_pin(str, Sub_node::Direction::Input, pos);
+  {
+    // The parents (compiled in other threads) may read or add pins to this Sub_node
+    std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());
+    if (get_self_sub_node().has_pin(str)) {
+      inst_pid = ref_self_sub_node()->map_graph_pos(str, Sub_node::Direction::Input, pos);  // reset pin stats
+    } else {
+      inst_pid = ref_self_sub_node()->add_pin(str, Sub_node::Direction::Input, pos);
+    }
   }
   I(node_internal[Hardcoded_input_nid].get_type() == Ntype_op::IO);
 
@@ -218,10 +254,13 @@ Node_pin LGraph::add_graph_output(std::string_view str, Port_ID pos, uint32_t bi
   I(!is_graph_input(str));
 
   Port_ID inst_pid;
-  if (get_self_sub_node().has_pin(str)) {
-    inst_pid = ref_self_sub_node()->map_graph_pos(str, Sub_node::Direction::Output, pos);  // reset pin stats
-  } else {
-    inst_pid = ref_self_sub_node()->add_pin(str, Sub_node::Direction::Output, pos);
+  {
+    std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());  // same as add_graph_input
+    if (get_self_sub_node().has_pin(str)) {
+      inst_pid = ref_self_sub_node()->map_graph_pos(str, Sub_node::Direction::Output, pos);  // reset pin stats
+    } else {
+      inst_pid = ref_self_sub_node()->add_pin(str, Sub_node::Direction::Output, pos);
+    }
   }
   I(node_internal[Hardcoded_output_nid].get_type() == Ntype_op::IO);
 
@@ -748,6 +787,8 @@ int LGraph::get_num_inp_edges(const Node_pin &pin) const {
 void LGraph::del_pin(const Node_pin &pin) {
   Node_pin inv;
 
+  bump_edit_version();
+
   if (pin.is_graph_io()) {
     ref_self_sub_node()->del_pin(pin.get_pid());
   }
@@ -763,6 +804,8 @@ void LGraph::del_node(const Node &node) {
   auto idx2 = node.get_nid();
   I(node_internal.size()>idx2);
 
+  bump_edit_version();
+
   auto op = node_internal[idx2].get_type();
 
   if (op == Ntype_op::Const) {
@@ -773,6 +816,7 @@ void LGraph::del_node(const Node &node) {
     lut_map.erase(node.get_compact_class());
   } else if (op == Ntype_op::Sub) {
     subid_map.erase(node.get_compact_class());
+    bump_hier_version();
   }
 
   // In hierarchy, not allowed to remove nodes (mark as deleted attribute?)
@@ -1080,6 +1124,8 @@ bool LGraph::del_edge(const Node_pin &dpin, const Node_pin &spin) {
   I(dpin.is_driver());
   I(spin.is_sink());
 
+  bump_edit_version();
+
   bool found = del_edge_driver_int(dpin, spin);
   if (!found)
     return false;
@@ -1146,17 +1192,29 @@ Node LGraph::create_node(const Ntype_op op, Bits_t bits) {
 
 Node LGraph::create_node_const(const Lconst &value) {
   // WARNING: There is a const_map, but it is NOT a bimap (speed). Just from
-  // nid to const.
-  Index_ID nid = memoize_const_hint[value.hash() % memoize_const_hint.size()];
+  // nid to pool handle. The const_memo is the reverse hint.
+  if (!const_memo_ready) {
+    for (auto &cnode : const_map) {
+      const_memo[cnode.second] = cnode.first.get_nid();
+    }
+    const_memo_ready = true;
+  }
+
+  auto handle = library->ref_const_pool().intern(value);
+
+  Index_ID nid = 0;
+  auto     it  = const_memo.find(handle);
+  if (it != const_memo.end())
+    nid = it->second;
+
   if (nid == 0
       || nid >= node_internal.size()
       || !node_internal[nid].is_valid()
       || node_internal[nid].get_type() != Ntype_op::Const
-      || get_type_const(nid) != value
-      || get_type_const(nid).get_bits() != value.get_bits()) {
+      || get_type_const_handle(nid) != handle) {
     nid = create_node_int();
     set_type_const(nid, value);
-    memoize_const_hint[value.hash() % memoize_const_hint.size()] = nid;
+    const_memo[handle] = nid;
   }
 
   I(node_internal[nid].get_dst_pid() == 0);
@@ -1253,11 +1311,33 @@ void LGraph::trace_forward2sink(XEdge_iterator &xiter, const Node_pin &dpin, con
 
 }
 
-Fwd_edge_iterator LGraph::forward(bool visit_sub) { return Fwd_edge_iterator(this, visit_sub); }
-Bwd_edge_iterator LGraph::backward(bool visit_sub) { return Bwd_edge_iterator(this, visit_sub); }
+Fwd_edge_iterator LGraph::forward(bool visit_sub) {
+  touch();
+  return Fwd_edge_iterator(this, visit_sub);
+}
+
+Bwd_edge_iterator LGraph::backward(bool visit_sub) {
+  touch();
+  return Bwd_edge_iterator(this, visit_sub);
+}
 
 // Skip after 1, but first may be deleted, so fast_next
-Fast_edge_iterator LGraph::fast(bool visit_sub) { return Fast_edge_iterator(this, visit_sub); }
+Fast_edge_iterator LGraph::fast(bool visit_sub) {
+  touch();
+  return Fast_edge_iterator(this, visit_sub);
+}
+
+// Linear scan of the node table. Only the first of concurrent walks (pass
+// threads) advises, and the last one restores the default readahead.
+void LGraph::fast_walk_begin() {
+  if (n_fast_walks.fetch_add(1, std::memory_order_relaxed) == 0)
+    node_internal.advise(mmap_lib::mmap_gc::Access::sequential);
+}
+
+void LGraph::fast_walk_end() {
+  if (n_fast_walks.fetch_sub(1, std::memory_order_relaxed) == 1 && node_internal.is_mapped())
+    node_internal.advise(mmap_lib::mmap_gc::Access::normal);
+}
 
 void LGraph::dump() {
   fmt::print("lgraph name:{} size:{}\n", name, node_internal.size());
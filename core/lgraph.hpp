@@ -23,11 +23,25 @@ protected:
   friend class Bwd_edge_iterator;
   friend class Fast_edge_iterator;
 
-  // Memoize tables that provide hints (not certainty because add/del operations)
-  std::array<Index_ID, 16> memoize_const_hint;
+  // Memoize table that provides hints (not certainty because add/del
+  // operations). Pool handle to a Const node with that value. Built lazily
+  // from the const_map the first time that create_node_const is called.
+  absl::flat_hash_map<Lconst_pool::Handle, Index_ID> const_memo;
+  bool                                               const_memo_ready = false;
+
+  // Order of the last complete forward (non-hierarchical) traversal. Valid
+  // while there are no edits (fwd_order_version == edit_version)
+  std::shared_ptr<const std::vector<Node::Compact>> fwd_order;
+  uint64_t                                          fwd_order_version = 0;
 
   Hierarchy_tree htree;
 
+  std::atomic<uint64_t> last_access = 0;  // Graph_library::release_unused picks the oldest
+  std::atomic<int>      n_fast_walks = 0;  // live fast() ranges, the node table is advised sequential while > 0
+
+  void fast_walk_begin();  // Fast_edge_iterator lifetime
+  void fast_walk_end();
+
   explicit LGraph(std::string_view _path, std::string_view _name, std::string_view _source);
 
   Index_ID get_root_idx(Index_ID idx) const {
@@ -151,13 +165,11 @@ public:
   }
 
   Hierarchy_tree *ref_htree() {
-    if (htree.empty())
-      htree.regenerate();
+    htree.update();
     return &htree;
   }
   const Hierarchy_tree &get_htree() {
-    if (htree.empty())
-      htree.regenerate();
+    htree.update();
     return htree;
   }
 
@@ -174,6 +186,19 @@ public:
     set_bits(dpin.get_root_idx(), bits);
   }
 
+  // Cached topological order used by Fwd_edge_iterator (nullptr if the graph was edited)
+  std::shared_ptr<const std::vector<Node::Compact>> get_fwd_order() const {
+    if (fwd_order_version != edit_version)
+      return nullptr;
+    return fwd_order;
+  }
+  void set_fwd_order(std::vector<Node::Compact> &&order, uint64_t version) {
+    if (version != edit_version)
+      return;  // edited during the traversal
+    fwd_order         = std::make_shared<const std::vector<Node::Compact>>(std::move(order));
+    fwd_order_version = version;
+  }
+
   Fwd_edge_iterator  forward(bool visit_sub = false);
   Bwd_edge_iterator  backward(bool visit_sub = false);
   Fast_edge_iterator fast(bool visit_sub = false);
@@ -189,6 +214,19 @@ public:
   void clear() override;
   void sync() override;
 
+  // Release the node table and attribute mmaps (reloaded on demand). False
+  // (nothing released) while the lgraph is being edited (locked).
+  bool unmap_tables();
+  bool is_mapped() const { return node_internal.is_mapped(); }  // any access maps the node table again
+
+  // After an Lconst_pool compaction (also resets the const_memo hints)
+  void relocate_const(const Lconst_pool::Relocation &old2new);
+
+  // Access stamp (open, create and traversals) for Graph_library::release_unused
+  void     touch() { last_access.store(Graph_library::next_access(), std::memory_order_relaxed); }
+  uint64_t get_last_access() const { return last_access.load(std::memory_order_relaxed); }
+  void     touch_mmaps() const { node_internal.touch(); }  // mmap_gc budget order (safe point only)
+
   Node_pin add_graph_input(std::string_view str, Port_ID pos, uint32_t bits);
   Node_pin add_graph_output(std::string_view str, Port_ID pos, uint32_t bits);
 
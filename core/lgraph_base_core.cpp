@@ -16,7 +16,7 @@
 static_assert(sizeof(Hierarchy_data) == 8);
 static_assert(sizeof(Hierarchy_index) == 8);
 
-std::string Lgraph_base_core::Setup_path::last_path = "";
+thread_local std::string Lgraph_base_core::Setup_path::last_path = "";
 
 Lgraph_base_core::Setup_path::Setup_path(std::string_view path) {
   if (last_path == path)
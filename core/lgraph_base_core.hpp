@@ -54,7 +54,7 @@ class Lgraph_base_core {
 protected:
   class Setup_path {
   private:
-    static std::string last_path;  // Just try to optimize to avoid too many frequent syscalls
+    static thread_local std::string last_path;  // Just try to optimize to avoid too many frequent syscalls
 
   public:
     Setup_path(std::string_view path);
@@ -8,6 +8,8 @@
 #include "sub_node.hpp"
 
 void LGraph::each_sorted_graph_io(std::function<void(Node_pin &pin, Port_ID pos)> f1, bool hierarchical) {
+  touch();
+
   if (node_internal.size() < Hardcoded_output_nid)
     return;
 
@@ -78,6 +80,8 @@ void LGraph::each_pin(const Node_pin &dpin, std::function<bool(Index_ID idx)> f1
 }
 
 void LGraph::each_graph_input(std::function<void(Node_pin &pin)> f1, bool hierarchical) {
+  touch();
+
   if (node_internal.size() < Hardcoded_output_nid)
     return;
 
@@ -97,6 +101,8 @@ void LGraph::each_graph_input(std::function<void(Node_pin &pin)> f1, bool hierar
 }
 
 void LGraph::each_graph_output(std::function<void(Node_pin &pin)> f1, bool hierarchical) {
+  touch();
+
   if (node_internal.size() < Hardcoded_output_nid)
     return;
 
@@ -116,6 +122,8 @@ void LGraph::each_graph_output(std::function<void(Node_pin &pin)> f1, bool hiera
 }
 
 void LGraph::each_sub_fast_direct(const std::function<bool(Node &, Lg_type_id)> fn) {
+  touch();
+
   const auto &m = get_down_nodes_map();
   for (auto it = m.begin(), end = m.end(); it != end; ++it) {
     Index_ID cid = it->first.nid;
@@ -132,6 +140,8 @@ void LGraph::each_sub_fast_direct(const std::function<bool(Node &, Lg_type_id)>
 }
 
 void LGraph::each_sub_unique_fast(const std::function<bool(Node &, Lg_type_id)> fn) {
+  touch();
+
   const auto &m = get_down_nodes_map();
   std::set<Lg_type_id> visited;
   for (auto it = m.begin(), end = m.end(); it != end; ++it) {
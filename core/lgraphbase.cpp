@@ -41,6 +41,7 @@ LGraph_Base::_init::_init() {
 
 void LGraph_Base::clear() {
   idx_insert_cache.clear();
+  bump_edit_version();
 
   node_internal.clear();
 
@@ -80,6 +81,7 @@ void LGraph_Base::emplace_back() {
 Index_ID LGraph_Base::create_node_int() {
   get_lock();  // FIXME: change to Copy on Write permissions (mmap exception, and remap)
   emplace_back();
+  bump_edit_version();
 
   I(node_internal[node_internal.size() - 1].get_dst_pid() == 0);
   I(node_internal[node_internal.size() - 1].get_nid() == node_internal.size() - 1);
@@ -444,6 +446,8 @@ void LGraph_Base::add_edge_int(const Index_ID dst_idx, const Port_ID inp_pid, In
   I(node_internal[dst_idx].is_root());
   I(node_internal[src_idx].is_root());
 
+  bump_edit_version();
+
   Index_ID root_idx = src_idx;
 
   bool out_done = false;
@@ -1,6 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <type_traits>
@@ -27,6 +28,17 @@ protected:
 
   absl::flat_hash_map<uint32_t, uint32_t> idx_insert_cache;
 
+  uint64_t edit_version = 1;  // Bumped by node/edge/type edits. Invalidates cached traversals (not persistent)
+  void     bump_edit_version() { ++edit_version; }
+
+  // Bumped when sub instances are added/removed. Hierarchy_tree updates the changed lgraphs (not persistent)
+  uint64_t                            hier_version = 1;
+  inline static std::atomic<uint64_t> global_hier_version{1};  // any lgraph (cheap up to date check)
+  void                                bump_hier_version() {
+    ++hier_version;
+    global_hier_version.fetch_add(1, std::memory_order_relaxed);
+  }
+
   Index_ID create_node_space(const Index_ID idx, const Port_ID dst_pid, const Index_ID master_nid, const Index_ID root_nid);
   Index_ID get_space_output_pin(const Index_ID idx, const Port_ID dst_pid, Index_ID &root_nid);
   Index_ID get_space_output_pin(const Index_ID master_nid, const Index_ID idx, const Port_ID dst_pid, const Index_ID root_nid);
@@ -72,6 +84,10 @@ public:
   virtual void clear();
   virtual void sync();
 
+  uint64_t        get_edit_version() const { return edit_version; }
+  uint64_t        get_hier_version() const { return hier_version; }
+  static uint64_t get_global_hier_version() { return global_hier_version.load(std::memory_order_relaxed); }
+
   void emplace_back();
 
   void add_edge(const Index_ID dst_idx, const Index_ID src_idx) {
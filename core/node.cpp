@@ -407,6 +407,8 @@ Sub_node *Node::ref_type_sub_node() const { return current_g->ref_type_sub_node(
 
 Lconst Node::get_type_const() const { return current_g->get_type_const(nid); }
 
+Lconst_pool::Handle Node::get_type_const_handle() const { return current_g->get_type_const_handle(nid); }
+
 void Node::nuke() {
   I(false);  // TODO:
 }
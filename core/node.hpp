@@ -6,6 +6,7 @@
 
 #include "mmap_map.hpp"
 #include "lconst.hpp"
+#include "lconst_pool.hpp"
 #include "lgraph_base_core.hpp"
 #include "node_pin.hpp"
 #include "cell.hpp"
@@ -105,6 +106,7 @@ public:
     friend class Bwd_edge_iterator;
     friend class Hierarchy_tree;
     friend class mmap_lib::hash<Compact_class>;
+    friend class mmap_lib::dense_key<Compact_class>;
 
   public:
     //constexpr operator size_t() const { return nid; }
@@ -292,7 +294,8 @@ public:
   LGraph *        ref_type_sub_lgraph() const;  // Slower than other get_type_sub
   bool            is_type_sub_present() const;
 
-  Lconst get_type_const() const;
+  Lconst              get_type_const() const;
+  Lconst_pool::Handle get_type_const_handle() const;
 
   void connect_sink(const Node &n2)   const { setup_sink_pin().connect_driver(n2.setup_driver_pin()); }
   void connect_driver(const Node &n2) const { setup_driver_pin().connect_sink(n2.setup_sink_pin()); }
@@ -363,4 +366,10 @@ struct hash<Node::Compact_class> {
     return hash<uint32_t>{}(o.nid);
   }
 };
+
+template <>
+struct dense_key<Node::Compact_class> {
+  static constexpr bool enabled = true;
+  constexpr uint64_t operator()(Node::Compact_class const &o) const { return o.nid; }
+};
 }  // namespace mmap_lib
@@ -431,22 +431,14 @@ Node_pin Node_pin::get_down_pin() const {
   I(node.is_type_sub_present());
 
   // 1st: Get down_hidx
-  const auto *tree_pos = Ann_node_tree_pos::ref(current_g);
-  I(tree_pos);
-  auto tree_it = tree_pos->find(node.get_compact_class());
-  if (tree_it == tree_pos->end()) {
+  auto down_hidx = top_g->ref_htree()->go_down(node);  // incremental update if any sub instance changed
+  if (down_hidx.is_invalid()) {
     top_g->regenerate_htree(); // force regenerate
-    tree_it = tree_pos->find(node.get_compact_class());
-    I(tree_it != tree_pos->end());
+    down_hidx = top_g->get_htree().go_down(node);
+    I(!down_hidx.is_invalid());
   }
 
-  auto delta_pos = tree_pos->get(tree_it);
-
   const auto &htree= top_g->get_htree();
-  I(!htree.is_leaf(hidx));
-  auto first_child = htree.get_first_child(hidx);
-
-  Hierarchy_index down_hidx(first_child.level, first_child.pos + delta_pos);
   I(htree.get_parent(down_hidx) == hidx);
 
   // 2nd: get down_pid
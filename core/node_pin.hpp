@@ -151,6 +151,7 @@ public:
     friend class Fwd_edge_iterator;
     friend class Bwd_edge_iterator;
     friend class mmap_lib::hash<Node_pin::Compact_class>;
+    friend class mmap_lib::dense_key<Node_pin::Compact_class>;
 
   public:
     // constexpr operator size_t() const { I(0); return idx|(sink<<31); }
@@ -190,6 +191,7 @@ public:
     friend class Fwd_edge_iterator;
     friend class Bwd_edge_iterator;
     friend class mmap_lib::hash<Node_pin::Compact_class_driver>;
+    friend class mmap_lib::dense_key<Node_pin::Compact_class_driver>;
 
   public:
     // constexpr operator size_t() const { I(0); return idx|(sink<<31); }
@@ -412,4 +414,17 @@ template <>
 struct hash<Node_pin::Compact_class_driver> {
   size_t operator()(Node_pin::Compact_class_driver const &o) const { return hash<uint32_t>{}(o.idx); }
 };
+
+// Compact_driver/Compact have a hidx (not dense), the class ones are just the idx
+template <>
+struct dense_key<Node_pin::Compact_class> {
+  static constexpr bool enabled = true;
+  uint64_t operator()(Node_pin::Compact_class const &o) const { return (static_cast<uint64_t>(o.idx) << 1) + o.sink; }
+};
+
+template <>
+struct dense_key<Node_pin::Compact_class_driver> {
+  static constexpr bool enabled = true;
+  uint64_t operator()(Node_pin::Compact_class_driver const &o) const { return o.idx; }
+};
 }  // namespace mmap_lib
@@ -2,6 +2,9 @@
 
 #include "node.hpp"
 #include "node_type.hpp"
+
+#include <unistd.h>
+
 #include "annotate.hpp"
 #include "graph_library.hpp"
 
@@ -9,7 +12,7 @@ static_assert(static_cast<int>(Ntype_op::Last_invalid) < 127, "lgedge has 8 bits
 
 LGraph_Node_Type::LGraph_Node_Type(std::string_view _path, std::string_view _name, Lg_type_id _lgid) noexcept
     : LGraph_Base(_path, _name, _lgid)
-    , const_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_const"))
+    , const_map(_path, const_map_name(_lgid))
     , subid_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_subid"))
     , lut_map(_path, absl::StrCat("lg_", std::to_string(_lgid), "_lut")) {}
 
@@ -22,6 +25,7 @@ void LGraph_Node_Type::clear() {
 void LGraph_Node_Type::set_type(Index_ID nid, const Ntype_op op) {
   I(node_internal[nid].is_master_root());
 
+  bump_edit_version();  // loop breakers and subs change the traversal order
   node_internal.ref(nid)->set_type(op);
 }
 
@@ -34,10 +38,10 @@ bool LGraph_Node_Type::is_type_const(Index_ID nid) const {
 void LGraph_Node_Type::set_type_sub(Index_ID nid, Lg_type_id subgraphid) {
   I(node_internal[nid].is_master_root());
 
+  bump_edit_version();
+  bump_hier_version();
   subid_map.set(Node::Compact_class(nid), subgraphid.value);
 
-  // Ann_node_tree_pos::ref(static_cast<const LGraph *>(this))->set(Node::Compact_class(nid), subid_map.size());
-
   node_internal.ref(nid)->set_type(Ntype_op::Sub);
 }
 
@@ -70,6 +74,7 @@ Sub_node *LGraph_Node_Type::ref_type_sub_node(std::string_view sub_name) {
 }
 
 void LGraph_Node_Type::set_type_lut(Index_ID nid, const Lconst &lutid) {
+  bump_edit_version();
   auto *ptr = node_internal.ref(nid);
   ptr->set_type(Ntype_op::LUT);
 
@@ -83,18 +88,78 @@ Lconst LGraph_Node_Type::get_type_lut(Index_ID nid) const {
 }
 
 Lconst LGraph_Node_Type::get_type_const(Index_ID nid) const {
+  return library->ref_const_pool().get(get_type_const_handle(nid));
+}
+
+Lconst_pool::Handle LGraph_Node_Type::get_type_const_handle(Index_ID nid) const {
   I(node_internal[nid].is_master_root());
 
-  return Lconst(const_map.get(Node::Compact_class(nid)));
+  return const_map.get(Node::Compact_class(nid));
 }
 
 void LGraph_Node_Type::set_type_const(Index_ID nid, const Lconst &value) {
-  const_map.set(Node::Compact_class(nid), value.serialize());
+  bump_edit_version();
+  const_map.set(Node::Compact_class(nid), library->ref_const_pool().intern(value));
   auto *ptr = node_internal.ref(nid);
   ptr->set_type(Ntype_op::Const);
   ptr->set_bits(value.get_bits());
 }
 
+void LGraph_Node_Type::each_const_handle(const std::function<void(Lconst_pool::Handle)> &fn) const {
+  for (const auto &it : const_map) {
+    fn(it.second);
+  }
+}
+
+void LGraph_Node_Type::relocate_const_map(Node_value_map &map, const Lconst_pool::Relocation &old2new) {
+  std::vector<std::pair<Node::Compact_class, Lconst_pool::Handle>> moved;
+  for (const auto &it : map) {
+    moved.emplace_back(it.first, old2new.at(it.second));
+  }
+  for (const auto &[key, handle] : moved) {
+    map.set(key, handle);
+  }
+}
+
+void LGraph_Node_Type::relocate_const(const Lconst_pool::Relocation &old2new) { relocate_const_map(const_map, old2new); }
+
+void LGraph_Node_Type::each_const_handle(std::string_view path, Lg_type_id lgid, const std::function<void(Lconst_pool::Handle)> &fn) {
+  if (access(absl::StrCat(path, "/", const_map_name(lgid)).c_str(), F_OK) != 0)
+    return;  // no constants (do not create the file)
+
+  Node_value_map map(path, const_map_name(lgid));
+  for (const auto &it : map) {
+    fn(it.second);
+  }
+}
+
+void LGraph_Node_Type::relocate_const(std::string_view path, Lg_type_id lgid, const Lconst_pool::Relocation &old2new) {
+  if (access(absl::StrCat(path, "/", const_map_name(lgid)).c_str(), F_OK) != 0)
+    return;
+
+  Node_value_map map(path, const_map_name(lgid));
+  relocate_const_map(map, old2new);
+}
+
+void LGraph_Node_Type::upgrade_const(std::string_view path, Lg_type_id lgid, Lconst_pool &pool) {
+  if (access(absl::StrCat(path, "/", const_map_name(lgid), "txt").c_str(), F_OK) != 0)
+    return;  // already handles (or no constants)
+
+  std::vector<std::pair<Node::Compact_class, Lconst_pool::Handle>> interned;
+  {
+    mmap_lib::map<Node::Compact_class, Lconst::Container> old_map(path, const_map_name(lgid));
+    for (const auto &it : old_map) {
+      interned.emplace_back(it.first, pool.intern(Lconst(old_map.get(it.first))));
+    }
+    old_map.clear();  // also the txt file
+  }
+
+  Node_value_map map(path, const_map_name(lgid));
+  for (const auto &[key, handle] : interned) {
+    map.set(key, handle);
+  }
+}
+
 void LGraph_Node_Type::set_type_const(Index_ID nid, std::string_view sv) { set_type_const(nid, Lconst(sv)); }
 
 void LGraph_Node_Type::set_type_const(Index_ID nid, int64_t value) { set_type_const(nid, Lconst(value)); }
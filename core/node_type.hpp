@@ -1,6 +1,7 @@
 //  this file is distributed under the bsd 3-clause license. see license for details.
 #pragma once
 
+#include "lconst_pool.hpp"
 #include "lgraphbase.hpp"
 #include "mmap_bimap.hpp"
 #include "mmap_map.hpp"
@@ -13,10 +14,10 @@ using Node_down_map = mmap_lib::map<Node::Compact_class, Lg_type_id>;
 
 class LGraph_Node_Type : virtual public LGraph_Base {
 protected:
-  using Node_value_map = mmap_lib::map<Node::Compact_class, Lconst::Container>;
+  using Node_value_map = mmap_lib::map<Node::Compact_class, Lconst_pool::Handle>;
   using Node_lut_map   = mmap_lib::map<Node::Compact_class, Lconst::Container>;
 
-  Node_value_map const_map;  // bimap to avoid unnecessary constant replication
+  Node_value_map const_map;  // handle in the library Lconst_pool (one copy per constant)
 
   Node_down_map subid_map;
   Node_lut_map  lut_map;
@@ -47,11 +48,26 @@ protected:
   void set_type_const(Index_ID nid, int64_t value);
 
   // No const because Lconst created
-  Lconst get_type_const(Index_ID nid) const;
+  Lconst              get_type_const(Index_ID nid) const;
+  Lconst_pool::Handle get_type_const_handle(Index_ID nid) const;
+
+  static std::string const_map_name(Lg_type_id lgid) { return absl::StrCat("lg_", std::to_string(lgid), "_const"); }
+  static void        relocate_const_map(Node_value_map &map, const Lconst_pool::Relocation &old2new);
 
 public:
   LGraph_Node_Type() = delete;
   explicit LGraph_Node_Type(std::string_view path, std::string_view name, Lg_type_id lgid) noexcept;
 
   const Node_down_map &get_down_nodes_map() const { return subid_map; };
+
+  // Lconst_pool compaction (Graph_library sync). The static versions access
+  // the const_map file of an lgraph that is not open.
+  void        each_const_handle(const std::function<void(Lconst_pool::Handle)> &fn) const;
+  void        relocate_const(const Lconst_pool::Relocation &old2new);
+  static void each_const_handle(std::string_view path, Lg_type_id lgid, const std::function<void(Lconst_pool::Handle)> &fn);
+  static void relocate_const(std::string_view path, Lg_type_id lgid, const Lconst_pool::Relocation &old2new);
+
+  // Before the Lconst_pool (graph_library.json lgdbs), the const_map had the
+  // serialized Lconst (lg_<id>_consttxt file). Interns them in the pool.
+  static void upgrade_const(std::string_view path, Lg_type_id lgid, Lconst_pool &pool);
 };
@@ -2,6 +2,8 @@
 
 #include "sub_node.hpp"
 
+#include <cstring>
+
 void Sub_node::copy_from(std::string_view new_name, Lg_type_id new_lgid, const Sub_node &sub) {
   name = new_name;
   lgid = new_lgid;
@@ -112,6 +114,71 @@ void Sub_node::from_json(const rapidjson::Value &entry) {
   std::sort(deleted.begin(), deleted.end(), std::greater<>());
 }
 
+// Per pin: instance_pid, graph_io_pos, dir, name size, name
+void Sub_node::to_bin(std::string &buf) const {
+  auto append_u32 = [&buf](uint32_t v) { buf.append(reinterpret_cast<const char *>(&v), sizeof(v)); };
+
+  append_u32(io_pins.empty() ? 0 : io_pins.size() - 1);
+  for (auto pos = 1u; pos < io_pins.size(); ++pos) {  // No id ZERO
+    const auto &pin = io_pins[pos];
+    append_u32(pos);
+    append_u32(pin.graph_io_pos);
+    buf.push_back(static_cast<char>(pin.dir));
+    append_u32(pin.name.size());
+    buf.append(pin.name);
+  }
+}
+
+size_t Sub_node::from_bin(std::string_view data) {
+  size_t pos      = 0;
+  auto   read_u32 = [&data, &pos](uint32_t &v) {
+    if (pos + sizeof(v) > data.size())
+      return false;
+    memcpy(&v, data.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+  };
+
+  io_pins.resize(1);  // No id ZERO
+
+  uint32_t n_pins;
+  if (!read_u32(n_pins))
+    return 0;
+
+  for (auto i = 0u; i < n_pins; ++i) {
+    uint32_t instance_pid, graph_pos, name_sz;
+    if (!read_u32(instance_pid) || !read_u32(graph_pos) || pos >= data.size())
+      return 0;
+    auto dir = static_cast<Direction>(data[pos++]);
+    if (!read_u32(name_sz) || pos + name_sz > data.size())
+      return 0;
+    auto io_name = data.substr(pos, name_sz);
+    pos += name_sz;
+
+    if (io_pins.size() <= instance_pid)
+      io_pins.resize(instance_pid + 1);
+
+    io_pins[instance_pid].name         = io_name;
+    io_pins[instance_pid].dir          = dir;
+    io_pins[instance_pid].graph_io_pos = graph_pos;
+
+    if (io_pins[instance_pid].is_invalid()) {
+      deleted.emplace_back(instance_pid);
+      if (io_name.empty())
+        continue;  // del_pin slot
+    }
+    name2id[io_name] = instance_pid;
+
+    if (graph_pos != Port_invalid) {
+      map_pin_int(instance_pid, graph_pos);
+    }
+  }
+
+  std::sort(deleted.begin(), deleted.end(), std::greater<>());
+
+  return pos;
+}
+
 /* LCOV_EXCL_START */
 void Sub_node::dump() const {
   fmt::print("lgid:{} name:{} #iopins:{}\n", lgid, name, io_pins.size());
@@ -102,6 +102,10 @@ public:
   void to_json(rapidjson::PrettyWriter<rapidjson::StringBuffer> &writer) const;
   void from_json(const rapidjson::Value &entry);
 
+  // Binary io_pins (graph_library.bin), name and lgid are kept by the library record
+  void   to_bin(std::string &buf) const;
+  size_t from_bin(std::string_view data);  // bytes used, 0 if the data is truncated
+
   void reset_pins() {
     clear_io_pins();
     io_pins.clear();    // WARNING: Do NOT remove mappings, just port id. (allows to reload designs)
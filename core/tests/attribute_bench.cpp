@@ -0,0 +1,94 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Attribute lookup cost when the accesses alternate across N lgraphs (like a
+// hierarchical traversal going up and down between parent and subs).
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "attribute.hpp"
+#include "lbench.hpp"
+#include "lgraph.hpp"
+
+using namespace std::chrono;
+
+static constexpr char bench_name[] = "bench_attr";
+using Bench_attr                   = Attribute<bench_name, Node, mmap_lib::map<Node::Compact_class, int>>;
+
+// The previous scheme: one last_lg entry, string key on miss
+class Strcat_cache {
+  absl::flat_hash_map<std::string, void *> lg2attr;
+  const LGraph *                           last_lg   = nullptr;
+  void *                                   last_attr = nullptr;
+
+public:
+  void *ref(const LGraph *lg) {
+    if (likely(lg == last_lg))
+      return last_attr;
+
+    last_lg        = lg;
+    const auto key = absl::StrCat(lg->get_unique_name(), bench_name);
+    auto       it  = lg2attr.find(key);
+    if (it != lg2attr.end()) {
+      last_attr = it->second;
+    } else {
+      last_attr    = (void *)lg;
+      lg2attr[key] = last_attr;
+    }
+    return last_attr;
+  }
+};
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  constexpr int max_lgs = 32;
+  constexpr int n_refs  = 4000000;
+
+  std::vector<LGraph *> lgs;
+  for (int i = 0; i < max_lgs; ++i) {
+    lgs.emplace_back(LGraph::create("lgdb_attr_bench", absl::StrCat("alt_", i), "-"));
+  }
+
+  for (int n : {1, 2, 3, 4, 8, 32}) {
+    uint64_t chk = 0;
+
+    auto start = high_resolution_clock::now();
+    {
+      Lbench b(absl::StrCat("core.ATTR_bench_tl_cache_", n));
+      for (int i = 0; i < n_refs; ++i) {
+        chk += reinterpret_cast<uint64_t>(Bench_attr::ref(lgs[i % n]));
+      }
+    }
+    auto   stop    = high_resolution_clock::now();
+    double tl_secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+
+    Strcat_cache old_cache;
+    start = high_resolution_clock::now();
+    {
+      Lbench b(absl::StrCat("core.ATTR_bench_strcat_", n));
+      for (int i = 0; i < n_refs; ++i) {
+        chk += reinterpret_cast<uint64_t>(old_cache.ref(lgs[i % n]));
+      }
+    }
+    stop               = high_resolution_clock::now();
+    double strcat_secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+
+    fmt::print("alternating lgraphs:{:<3} thread_local cache {:.2f} Mref/s, strcat key {:.2f} Mref/s (chk:{})\n",
+               n,
+               n_refs / tl_secs / 1e6,
+               n_refs / strcat_secs / 1e6,
+               chk & 0xFF);
+  }
+
+  for (auto *lg : lgs) {
+    Bench_attr::clear(lg);
+    lg->sync();
+  }
+
+  return 0;
+}
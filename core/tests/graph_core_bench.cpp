@@ -0,0 +1,219 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Storage comparison: the same netlist stored in the LGraph Node_internal
+// pages and in the Graph_core 16/64 byte entries. Graph_core is not an LGraph
+// backend, so this compares the two stores directly (footprint, RSS and edge
+// traversal), not LGraph running on top of each one.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "absl/container/flat_hash_map.h"
+#include "graph_core.hpp"
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+using namespace std::chrono;
+
+static int get_rss_kb() {
+  FILE *file   = fopen("/proc/self/status", "r");
+  int   result = -1;
+  char  line[128];
+
+  if (file == nullptr)
+    return result;
+
+  while (fgets(line, 128, file) != nullptr) {
+    if (strncmp(line, "VmRSS:", 6) == 0) {
+      result = atoi(line + 6);
+      break;
+    }
+  }
+  fclose(file);
+  return result;
+}
+
+LGraph *create_random_lgraph(int n_nodes) {
+  LGraph *lg = LGraph::create("lgdb_gc_bench", "random", "-");
+
+  Lrand<int> rint;
+
+  std::vector<Node> nodes;
+  nodes.reserve(n_nodes);
+  for (int i = 0; i < n_nodes; ++i) {
+    nodes.emplace_back(lg->create_node(Ntype_op::Sum));
+  }
+
+  for (int i = 1; i < n_nodes; ++i) {
+    auto spin = nodes[i].setup_sink_pin("A");
+    for (int j = 0; j < 2; ++j) {
+      int d;
+      if (rint.max(10) < 8)  // netlists have mostly local connections
+        d = i - 1 - rint.max(std::min(i, 64));
+      else
+        d = rint.max(n_nodes);
+      if (d == i)
+        continue;
+
+      nodes[d].setup_driver_pin().connect_sink(spin);
+    }
+  }
+
+  return lg;
+}
+
+// LGraph node/pin to Graph_core id. All the keys are inserted before the
+// Graph_core RSS is sampled, so the Graph_core RSS only counts its own tables.
+struct Gc_ids {
+  absl::flat_hash_map<uint32_t, Index_ID> node2gc;
+  absl::flat_hash_map<uint64_t, Index_ID> pin2gc;
+
+  static uint64_t pin_key(const Node_pin &pin) {
+    uint64_t key = pin.get_node().get_compact_class().get_nid().value;
+    return (key << 16) | pin.get_pid();
+  }
+
+  void reserve(LGraph *lg) {
+    for (auto node : lg->fast()) {
+      for (auto e : node.out_edges()) {
+        for (const auto &pin : {e.sink, e.driver}) {
+          node2gc.emplace(pin.get_node().get_compact_class().get_nid().value, 0);
+          pin2gc.emplace(pin_key(pin), 0);
+        }
+      }
+    }
+  }
+
+  Index_ID get_pin_id(Graph_core &gc, const Node_pin &pin) {
+    auto &id = pin2gc.at(pin_key(pin));  // no insertions (reserve added all the keys)
+    if (id)
+      return id;
+
+    auto  node = pin.get_node();
+    auto &root = node2gc.at(node.get_compact_class().get_nid().value);
+    if (!root)
+      root = gc.create_master_root(static_cast<uint8_t>(node.get_type_op()));
+
+    id = root;
+    if (pin.get_pid())
+      id = gc.create_master(root, pin.get_pid());
+
+    return id;
+  }
+};
+
+void populate_graph_core(LGraph *lg, Graph_core &gc, Gc_ids &ids) {
+  for (auto node : lg->fast()) {
+    for (auto e : node.out_edges()) {
+      gc.add_edge(ids.get_pin_id(gc, e.sink), ids.get_pin_id(gc, e.driver));
+    }
+  }
+}
+
+int traverse_lgraph_in_out(LGraph *lg) {
+  int i = 0;
+  for (const auto &node : lg->fast()) {
+    for (const auto &e : node.inp_edges()) {
+      (void)e;
+      i++;
+    }
+    for (const auto &e : node.out_edges()) {
+      (void)e;
+      i++;
+    }
+  }
+  return i;
+}
+
+int traverse_graph_core_in_out(Graph_core &gc) {
+  int i = 0;
+  for (auto nid = gc.fast_first(); nid; nid = gc.fast_next(nid)) {
+    for (auto pin : gc.get_setup_sinks(nid)) {
+      for (auto id : gc.inp_ids(pin)) {
+        (void)id;
+        i++;
+      }
+    }
+    for (auto pin : gc.get_setup_drivers(nid)) {
+      for (auto id : gc.out_ids(pin)) {
+        (void)id;
+        i++;
+      }
+    }
+  }
+  return i;
+}
+
+int main(int argc, char **argv) {
+  int     start_rss = get_rss_kb();
+  LGraph *lg;
+  if (argc == 1) {
+    lg = create_random_lgraph(1000000);
+  } else if (argc == 3) {
+    fmt::print("benchmark the graph lgdb:{} name:{}\n", argv[1], argv[2]);
+    lg = LGraph::open(argv[1], argv[2]);
+  } else {
+    fmt::print("usage:\n\t{} <lgdb> <lg_name>\n", argv[0]);
+    exit(-2);
+  }
+  if (lg == nullptr) {
+    fmt::print("could not open lgraph\n");
+    exit(-3);
+  }
+  int lg_rss = get_rss_kb();
+
+  Gc_ids ids;
+  ids.reserve(lg);
+  int ids_rss = get_rss_kb();
+
+  Graph_core gc("lgdb_gc_bench", "graph_core");
+  gc.clear();
+  populate_graph_core(lg, gc, ids);
+  int gc_rss = get_rss_kb();
+
+  // The footprint is the table entries only. The LGraph RSS also has the
+  // heap left by the netlist creation (random) or the library open.
+  fmt::print("LGraph     entries:{} footprint:{}KB rss:{}KB\n",
+             lg->size(),
+             lg->size() * sizeof(Node_internal) / 1024,
+             lg_rss - start_rss);
+  fmt::print("Graph_core entries:{} overflow:{} footprint:{}KB rss:{}KB (id map rss:{}KB, not included)\n",
+             gc.size(),
+             gc.overflow_size(),
+             (gc.size() * 16 + gc.overflow_size() * 64) / 1024,
+             gc_rss - ids_rss,
+             ids_rss - lg_rss);
+
+  int iterations = 10;
+
+  {
+    Lbench b("core.GRAPH_CORE_lgraph_traverse");
+    auto   start = high_resolution_clock::now();
+    int    n     = 0;
+    for (int i = 0; i < iterations; ++i) {
+      n += traverse_lgraph_in_out(lg);
+    }
+    auto   stop = high_resolution_clock::now();
+    double secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+    fmt::print("LGraph     traversed {} edges in {}s ({:.2f} Medges/s)\n", n, secs, n / secs / 1e6);
+  }
+
+  {
+    Lbench b("core.GRAPH_CORE_graph_core_traverse");
+    auto   start = high_resolution_clock::now();
+    int    n     = 0;
+    for (int i = 0; i < iterations; ++i) {
+      n += traverse_graph_core_in_out(gc);
+    }
+    auto   stop = high_resolution_clock::now();
+    double secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+    fmt::print("Graph_core traversed {} edges in {}s ({:.2f} Medges/s)\n", n, secs, n / secs / 1e6);
+  }
+
+  return 0;
+}
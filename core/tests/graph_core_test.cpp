@@ -2,9 +2,11 @@
 
 #include "graph_core.hpp"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "lbench.hpp"
@@ -19,12 +21,137 @@ protected:
   void TearDown() override {
     // Graph_library::sync_all();
   }
+
+  static std::vector<Index_ID> collect(Index_iter it) {
+    std::vector<Index_ID> v;
+    for (auto id : it) {
+      v.emplace_back(id);
+    }
+    std::sort(v.begin(), v.end());
+    return v;
+  }
 };
 
 TEST_F(Setup_graph_core, shallow_tree) {
   Lbench b("core.GRAPH_CORE_shallow_tree");
 
   Graph_core c1("lgdb_gc", "shallow_tree");
+  c1.clear();
+
+  auto root = c1.create_master_root(3);
+  EXPECT_TRUE(c1.is_valid(root));
+  EXPECT_TRUE(c1.is_master_root(root));
+  EXPECT_EQ(c1.get_type(root), 3);
+  EXPECT_EQ(c1.get_pid(root), 0);
+
+  std::vector<Index_ID> leafs;
+  for (int i = 0; i < 40; ++i) {
+    auto leaf = c1.create_master_root(1);
+    auto dpin = c1.create_master(leaf, 1);
+    EXPECT_EQ(c1.get_master_root(dpin), leaf);
+    EXPECT_EQ(c1.get_pid(dpin), 1);
+    EXPECT_EQ(c1.get_type(dpin), 1);
+    EXPECT_EQ(c1.find_master(leaf, 1), dpin);
+
+    c1.add_edge(root, dpin);  // root is the sink of every leaf
+    leafs.emplace_back(dpin);
+  }
+
+  std::sort(leafs.begin(), leafs.end());
+  EXPECT_EQ(collect(c1.inp_ids(root)), leafs);
+  EXPECT_TRUE(collect(c1.out_ids(root)).empty());
+
+  std::vector<Index_ID> ev;
+  c1.fill_inp_ids(root, ev);
+  std::sort(ev.begin(), ev.end());
+  EXPECT_EQ(ev, leafs);
+
+  for (auto dpin : leafs) {
+    auto out = collect(c1.out_ids(dpin));
+    ASSERT_EQ(out.size(), 1);
+    EXPECT_EQ(out[0], root);
+    EXPECT_EQ(c1.get_setup_drivers(c1.get_master_root(dpin)).size(), 1);
+  }
+
+  // Delete half the edges, and then a few nodes
+  for (size_t i = 0; i < leafs.size(); i += 2) {
+    c1.del_edge(root, leafs[i]);
+    EXPECT_TRUE(collect(c1.out_ids(leafs[i])).empty());
+  }
+  EXPECT_EQ(collect(c1.inp_ids(root)).size(), leafs.size() / 2);
+
+  c1.del(c1.get_master_root(leafs[1]));
+  EXPECT_FALSE(c1.is_valid(leafs[1]));
+  EXPECT_EQ(collect(c1.inp_ids(root)).size(), leafs.size() / 2 - 1);
+
+  int n_roots = 0;
+  for (auto id = c1.fast_first(); id; id = c1.fast_next(id)) {
+    EXPECT_TRUE(c1.is_master_root(id));
+    ++n_roots;
+  }
+  EXPECT_EQ(n_roots, 1 + leafs.size() - 1);
+
+  // Deleted entries are recycled
+  auto sz = c1.size();
+  c1.create_master(c1.create_master_root(2), 4);
+  EXPECT_EQ(sz, c1.size());
+}
 
-  // TEST now
+TEST_F(Setup_graph_core, random_edges) {
+  Lbench b("core.GRAPH_CORE_random_edges");
+
+  Graph_core c1("lgdb_gc", "random_edges");
+  c1.clear();
+
+  Lrand<int> rint;
+
+  std::vector<Index_ID> pins;
+  for (int i = 0; i < 20000; ++i) {
+    auto root = c1.create_master_root(i & 0xFF);
+    pins.emplace_back(root);
+    if (i & 1)
+      pins.emplace_back(c1.create_master(root, 1 + (i & 7)));
+  }
+
+  absl::flat_hash_map<uint32_t, std::vector<Index_ID>> drivers;  // sink -> drivers
+  absl::flat_hash_map<uint32_t, std::vector<Index_ID>> sinks;    // driver -> sinks
+
+  for (int i = 0; i < 100000; ++i) {
+    auto d = pins[rint.max(pins.size())];
+    auto s = pins[rint.max(pins.size())];
+    if (d == s)
+      continue;
+    if (i & 1) {  // keep half the edges local so that short edges are used
+      auto pos = rint.max(pins.size() - 16);
+      d        = pins[pos];
+      s        = pins[pos + 1 + rint.max(15)];
+    }
+
+    c1.add_edge(s, d);
+    drivers[s.value].emplace_back(d);
+    sinks[d.value].emplace_back(s);
+  }
+
+  for (auto pin : pins) {
+    auto &dv = drivers[pin.value];
+    auto &sv = sinks[pin.value];
+    std::sort(dv.begin(), dv.end());
+    std::sort(sv.begin(), sv.end());
+
+    EXPECT_EQ(collect(c1.inp_ids(pin)), dv);
+    EXPECT_EQ(collect(c1.out_ids(pin)), sv);
+  }
+
+  b.sample("check");
+
+  for (auto pin : pins) {
+    for (auto d : drivers[pin.value]) {
+      c1.del_edge(pin, d);
+    }
+  }
+
+  for (auto pin : pins) {
+    EXPECT_TRUE(collect(c1.inp_ids(pin)).empty());
+    EXPECT_TRUE(collect(c1.out_ids(pin)).empty());
+  }
 }
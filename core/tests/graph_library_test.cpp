@@ -0,0 +1,347 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_library.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+
+class Graph_library_test : public ::testing::Test {
+protected:
+  const std::string path = "lgdb_graph_library_test";
+
+  void SetUp() override {
+    Graph_library::shutdown();
+    unlink((path + "/graph_library.bin").c_str());
+    unlink((path + "/graph_library.json").c_str());
+    unlink((path + "/lconst_pool").c_str());
+    mkdir(path.c_str(), 0755);
+  }
+
+  off_t file_size(const std::string &file) const {
+    struct stat sb;
+    if (stat(file.c_str(), &sb) != 0)
+      return -1;
+    return sb.st_size;
+  }
+
+  Graph_library *reopen() {
+    Graph_library::shutdown();  // drop the instances, the next instance reads the file again
+    return Graph_library::instance(path);
+  }
+};
+
+TEST_F(Graph_library_test, reload_pins) {
+  auto *lib = Graph_library::instance(path);
+
+  auto &sub_a = lib->setup_sub("sub_a", "a.v");
+  sub_a.add_input_pin("x", 1);
+  sub_a.add_output_pin("y", 2);
+  auto pid_z = sub_a.add_input_pin("z");
+
+  auto &sub_b = lib->setup_sub("sub_b", "b.v");
+  sub_b.add_output_pin("out");
+  lib->sync();
+
+  lib = reopen();
+  ASSERT_TRUE(lib->has_name("sub_a"));
+  ASSERT_TRUE(lib->has_name("sub_b"));
+  EXPECT_EQ(lib->get_source("sub_a"), "a.v");
+
+  const auto &a = lib->get_sub("sub_a");
+  EXPECT_TRUE(a.is_input("x"));
+  EXPECT_TRUE(a.is_output("y"));
+  EXPECT_EQ(a.get_graph_pos("y"), 2);
+  EXPECT_EQ(a.get_instance_pid("z"), pid_z);
+  EXPECT_TRUE(lib->get_sub("sub_b").is_output("out"));
+}
+
+TEST_F(Graph_library_test, header_check) {
+  auto *lib = Graph_library::instance(path);
+  lib->setup_sub("sub_hdr", "-");
+  lib->sync();
+  Graph_library::shutdown();
+
+  const auto bin = path + "/graph_library.bin";
+  for (uint32_t word : {0x4C474C42u, 0x424C474Cu}) {  // other byte order, same magic
+    uint32_t header[2] = {word, 99};                  // unsupported version
+    int      fd        = ::open(bin.c_str(), O_WRONLY);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(::pwrite(fd, header, sizeof(header), 0), sizeof(header));
+    ::close(fd);
+
+    EXPECT_THROW(Graph_library::instance(path), std::runtime_error);
+  }
+}
+
+// get_sub decodes the io_pins on demand while another thread adds lgraphs
+TEST_F(Graph_library_test, get_sub_while_adding) {
+  auto *lib = Graph_library::instance(path);
+  for (int i = 0; i < 64; ++i) {
+    lib->setup_sub("old_" + std::to_string(i), "-").add_input_pin("i", 1);
+  }
+  lib->sync();
+  lib = reopen();  // all the io_pins pending
+
+  std::thread adder([lib]() {
+    for (int i = 0; i < 2000; ++i) {
+      lib->setup_sub("new_" + std::to_string(i), "-");
+    }
+  });
+  for (int i = 0; i < 64; ++i) {
+    EXPECT_TRUE(lib->get_sub("old_" + std::to_string(i)).is_input("i"));
+  }
+  adder.join();
+
+  EXPECT_TRUE(lib->has_name("new_1999"));
+}
+
+TEST_F(Graph_library_test, append_only) {
+  auto *lib = Graph_library::instance(path);
+  for (int i = 0; i < 100; ++i) {
+    auto &sub = lib->setup_sub("sub_" + std::to_string(i), "-");
+    sub.add_input_pin("i", 1);
+    sub.add_output_pin("o", 2);
+  }
+  lib->sync();
+
+  const auto bin  = path + "/graph_library.bin";
+  const auto size = file_size(bin);
+  ASSERT_GT(size, 0);
+
+  lib->sync();  // nothing changed
+  EXPECT_EQ(file_size(bin), size);
+
+  lib = reopen();
+  lib->sync();  // not decoded subs are not rewritten
+  EXPECT_EQ(file_size(bin), size);
+
+  lib->ref_sub(lib->get_lgid("sub_7"))->add_input_pin("extra");
+  lib->sync();
+  auto new_size = file_size(bin);
+  EXPECT_GT(new_size, size);
+  EXPECT_LT(new_size - size, size / 10);  // only sub_7 was appended
+
+  lib = reopen();
+  EXPECT_TRUE(lib->get_sub("sub_7").has_pin("extra"));
+  EXPECT_FALSE(lib->get_sub("sub_8").has_pin("extra"));
+}
+
+TEST_F(Graph_library_test, const_pool_compact) {
+  {
+    auto *lg_a = LGraph::create(path, "const_a", "-");
+    for (int i = 0; i < 3000; ++i) {
+      lg_a->create_node_const(i);
+    }
+    auto *lg_b = LGraph::create(path, "const_b", "-");
+    lg_b->create_node_const(Lconst("0xdead_beef"));
+    lg_b->create_node_const(1000);
+  }
+  auto *lib = reopen();  // const_b is not open during the compaction
+
+  auto *lg_a = LGraph::open(path, "const_a");
+  for (auto node : lg_a->fast()) {
+    if (node.is_type_const() && node.get_type_const().to_i() % 10)
+      node.del_node();
+  }
+  lg_a->sync();
+  EXPECT_LE(lib->ref_const_pool().size(), 300 + 1);
+
+  int n_const = 0;
+  for (auto node : lg_a->fast()) {
+    if (!node.is_type_const())
+      continue;
+    EXPECT_EQ(node.get_type_const().to_i() % 10, 0);
+    ++n_const;
+  }
+  EXPECT_EQ(n_const, 300);
+  EXPECT_EQ(lg_a->create_node_const(20).get_type_const().to_i(), 20);
+  EXPECT_EQ(lib->ref_const_pool().size(), 300 + 1);
+
+  auto *lg_b = LGraph::open(path, "const_b");
+  std::vector<Lconst> b_consts;
+  for (auto node : lg_b->fast()) {
+    if (node.is_type_const())
+      b_consts.emplace_back(node.get_type_const());
+  }
+  ASSERT_EQ(b_consts.size(), 2);
+  EXPECT_TRUE(b_consts[0] == Lconst("0xdead_beef") || b_consts[1] == Lconst("0xdead_beef"));
+  EXPECT_TRUE(b_consts[0] == Lconst(1000) || b_consts[1] == Lconst(1000));
+}
+
+TEST_F(Graph_library_test, const_pool_compact_shared) {
+  auto *lib = Graph_library::instance(path);
+
+  // Many Const nodes with a few constants (one handle per Const node)
+  std::vector<LGraph *> lgs;
+  for (int i = 0; i < 250; ++i) {
+    lgs.emplace_back(LGraph::create(path, "const_shared_" + std::to_string(i), "-"));
+    for (int v = 0; v < 4; ++v) {
+      lgs.back()->create_node_const(v);
+    }
+  }
+  auto *lg_dead = LGraph::create(path, "const_dead", "-");
+  for (int i = 0; i < 1000; ++i) {
+    lg_dead->create_node_const(1000 + i);
+  }
+  EXPECT_EQ(lib->ref_const_pool().size(), 4 + 1000);
+
+  LGraph::create(path, "const_dead", "-");  // clear, the 1000 constants are dead
+  EXPECT_EQ(lib->ref_const_pool().size(), 4 + 1000);
+  lib->sync();
+
+  EXPECT_EQ(lib->ref_const_pool().size(), 4);
+  for (auto *lg : lgs) {
+    std::vector<int> n_value(4, 0);
+    for (auto node : lg->fast()) {
+      if (node.is_type_const())
+        n_value[node.get_type_const().to_i()]++;
+    }
+    EXPECT_EQ(n_value, std::vector<int>(4, 1));
+  }
+}
+
+TEST_F(Graph_library_test, json_export_import) {
+  auto *lib = Graph_library::instance(path);
+  lib->setup_sub("sub_json", "j.v").add_input_pin("inp", 1);
+  lib->sync();
+
+  const auto json = path + "/graph_library.json";
+  lib->export_json(json);
+
+  std::ifstream     fs(json);
+  std::stringstream txt;
+  txt << fs.rdbuf();
+  EXPECT_NE(txt.str().find("sub_json"), std::string::npos);
+
+  // Without the binary file, the json is imported
+  Graph_library::shutdown();
+  unlink((path + "/graph_library.bin").c_str());
+  lib = Graph_library::instance(path);
+  ASSERT_TRUE(lib->has_name("sub_json"));
+  EXPECT_TRUE(lib->get_sub("sub_json").is_input("inp"));
+
+  lib->sync();
+  EXPECT_GT(file_size(path + "/graph_library.bin"), 0);
+}
+
+TEST_F(Graph_library_test, open_budget) {
+  const auto budget = Graph_library::get_open_budget();
+  Graph_library::set_open_budget(2);
+
+  std::vector<int> n_nodes;
+  for (int i = 0; i < 6; ++i) {
+    auto *lg = LGraph::create(path, "lru_" + std::to_string(i), "-");
+    for (int j = 0; j <= i; ++j) {
+      lg->create_node_const(Lconst(j)).set_name("c" + std::to_string(j));
+    }
+    int n = 0;
+    for (auto node : lg->fast()) {
+      (void)node;
+      ++n;
+    }
+    n_nodes.emplace_back(n);
+    lg->sync();  // done editing
+  }
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 6);  // nothing released outside a safe point
+  Graph_library::release_unused();
+  EXPECT_LE(Graph_library::get_n_open_mapped(), 2);
+
+  // Released lgraphs reload their tables on the next access
+  for (int i = 0; i < 6; ++i) {
+    auto *lg = LGraph::open(path, "lru_" + std::to_string(i));
+    ASSERT_NE(lg, nullptr);
+
+    int n = 0;
+    for (auto node : lg->fast()) {
+      EXPECT_TRUE(!node.is_type_const() || node.has_name());
+      ++n;
+    }
+    EXPECT_EQ(n, n_nodes[i]);
+
+    Graph_library::release_unused();
+    EXPECT_LE(Graph_library::get_n_open_mapped(), 2);
+  }
+
+  // Recency is the last access, not the last open
+  auto *lg0 = LGraph::open(path, "lru_0");
+  auto *lg1 = LGraph::open(path, "lru_1");
+  for (auto node : lg0->fast()) {
+    (void)node;
+  }
+  Graph_library::set_open_budget(1);
+  Graph_library::release_unused();
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 1);
+  EXPECT_GT(lg0->get_last_access(), lg1->get_last_access());
+
+  // Being edited (locked) lgraphs are not released
+  auto *edit = LGraph::open(path, "lru_2");
+  edit->create_node_const(Lconst(100));
+  for (int i = 3; i < 6; ++i) {
+    LGraph::open(path, "lru_" + std::to_string(i));
+  }
+  Graph_library::release_unused();
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 1);  // lru_2 (locked) fills the budget
+  edit->sync();
+
+  Graph_library::set_open_budget(budget);
+}
+
+TEST_F(Graph_library_test, open_budget_hier) {
+  const auto budget = Graph_library::get_open_budget();
+  Graph_library::set_open_budget(1);
+
+  std::vector<LGraph *> subs;
+  for (int i = 0; i < 3; ++i) {
+    auto *sub = LGraph::create(path, "hier_sub_" + std::to_string(i), "-");
+    sub->create_node_const(Lconst(i));
+    sub->sync();
+    subs.emplace_back(sub);
+  }
+  auto *top = LGraph::create(path, "hier_top", "-");
+  for (auto *sub : subs) {
+    top->create_node_sub(sub->get_lgid());
+  }
+  top->sync();
+
+  auto count_walk = [top]() {
+    int n = 0;
+    for (auto node : top->fast(true)) {
+      (void)node;
+      ++n;
+    }
+    return n;
+  };
+  auto count_mapped = [&subs]() {
+    return std::count_if(subs.begin(), subs.end(), [](const LGraph *lg) { return lg->is_mapped(); });
+  };
+
+  const auto n_walk = count_walk();
+  EXPECT_EQ(n_walk, 3);  // one const per sub instance
+
+  Graph_library::release_unused();
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 1);
+
+  // The hierarchical walk maps the released subs again (no LGraph::open)
+  EXPECT_EQ(count_walk(), n_walk);
+  EXPECT_EQ(count_mapped(), 3);
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 4);
+
+  // and the next safe point releases them again
+  Graph_library::release_unused();
+  EXPECT_EQ(Graph_library::get_n_open_mapped(), 1);
+  EXPECT_LE(count_mapped(), 1);
+
+  Graph_library::set_open_budget(budget);
+}
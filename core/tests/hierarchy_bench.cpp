@@ -0,0 +1,93 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Per edit cost of keeping the Hierarchy_tree up to date on a deep hierarchy:
+// incremental update (only the edited lgraph) vs clear()+regenerate().
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "lbench.hpp"
+#include "lgraph.hpp"
+
+using namespace std::chrono;
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  constexpr int depth    = 6;   // levels below top
+  constexpr int variants = 16;  // unique lgraphs per level (each instantiates all the variants of the next level)
+  constexpr int n_edits  = 2000;
+
+  std::vector<std::vector<LGraph *>> levels(depth);
+  for (int d = depth - 1; d >= 0; --d) {
+    for (int v = 0; v < variants; ++v) {
+      auto *lg = LGraph::create("lgdb_hier_bench", absl::StrCat("lvl", d, "_", v), "-");
+      lg->add_graph_input("a", 1, 8);
+      lg->add_graph_output("z", 2, 8);
+      if (d + 1 < depth) {
+        for (auto *sub : levels[d + 1]) {
+          lg->create_node_sub(sub->get_lgid());
+        }
+      }
+      levels[d].emplace_back(lg);
+    }
+  }
+
+  auto *top = LGraph::create("lgdb_hier_bench", "hier_top", "-");
+  for (auto *sub : levels[0]) {
+    top->create_node_sub(sub->get_lgid());
+  }
+
+  const auto &htree = top->get_htree();
+  fmt::print("hierarchy unique lgraphs:{} instances:{}\n", htree.get_n_classes(), htree.size());
+
+  // Edit: add/remove a sub instance in the middle of the hierarchy
+  auto *edit_lg  = levels[depth / 2][0];
+  auto *edit_sub = levels[depth / 2 + 1][0];
+
+  uint64_t chk   = 0;
+  auto     start = high_resolution_clock::now();
+  {
+    Lbench b("core.HIER_bench_incremental");
+    for (int i = 0; i < n_edits; ++i) {
+      auto node = edit_lg->create_node_sub(edit_sub->get_lgid());
+      chk += top->get_htree().size();
+      node.del_node();
+      chk += top->get_htree().size();
+    }
+  }
+  auto   stop     = high_resolution_clock::now();
+  double inc_secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+
+  start = high_resolution_clock::now();
+  {
+    Lbench b("core.HIER_bench_regenerate");
+    for (int i = 0; i < n_edits; ++i) {
+      auto node = edit_lg->create_node_sub(edit_sub->get_lgid());
+      top->regenerate_htree();
+      chk += top->get_htree().size();
+      node.del_node();
+      top->regenerate_htree();
+      chk += top->get_htree().size();
+    }
+  }
+  stop            = high_resolution_clock::now();
+  double reg_secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+
+  fmt::print("per edit: incremental {:.2f} us, regenerate {:.2f} us (chk:{})\n",
+             inc_secs * 1e6 / (2 * n_edits),
+             reg_secs * 1e6 / (2 * n_edits),
+             chk & 0xFF);
+
+  for (auto &level : levels) {
+    for (auto *lg : level) {
+      lg->sync();
+    }
+  }
+  top->sync();
+
+  return 0;
+}
@@ -1,5 +1,6 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <chrono>
 #include <set>
 
 #include "lbench.hpp"
@@ -218,6 +219,77 @@ bool fwd(int n) {
   return true;
 }
 
+// First forward traversal computes (and caches) the order, later ones replay it
+bool fwd_cached(int n) {
+  double first_secs = 0;
+  double later_secs = 0;
+
+  for (int i = 0; i < n; i++) {
+    std::string gname = "test_" + std::to_string(i);
+    LGraph *    g     = LGraph::open("lgdb_iter_test", gname);
+    if (g == nullptr)
+      return false;
+
+    g->create_node(Ntype_op::Sum);  // Any edit invalidates the cached order
+
+    std::vector<Node::Compact> first_order;
+    {
+      Lbench b("core.ITER_fwd_first" + std::to_string(i + 1));
+      auto   start = std::chrono::high_resolution_clock::now();
+      for (auto node : g->forward()) {
+        first_order.emplace_back(node.get_compact());
+      }
+      auto stop = std::chrono::high_resolution_clock::now();
+      first_secs += std::chrono::duration<double>(stop - start).count();
+    }
+
+    constexpr int n_later = 8;
+    {
+      Lbench b("core.ITER_fwd_later" + std::to_string(i + 1));
+      auto   start = std::chrono::high_resolution_clock::now();
+      for (int j = 0; j < n_later; ++j) {
+        size_t pos = 0;
+        for (auto node : g->forward()) {
+          if (pos >= first_order.size() || first_order[pos] != node.get_compact()) {
+            fmt::print("ERROR: cached fwd order differs at pos:{} for {}\n", pos, gname);
+            return false;
+          }
+          ++pos;
+        }
+        if (pos != first_order.size()) {
+          fmt::print("ERROR: cached fwd visited {} nodes, expected {} for {}\n", pos, first_order.size(), gname);
+          return false;
+        }
+      }
+      auto stop = std::chrono::high_resolution_clock::now();
+      later_secs += std::chrono::duration<double>(stop - start).count() / n_later;
+    }
+
+    // Edit the graph while replaying: all the nodes still must be visited once
+    absl::flat_hash_set<Node::Compact> visited;
+    bool                               edited = false;
+    for (auto node : g->forward()) {
+      I(!visited.contains(node.get_compact()));
+      visited.insert(node.get_compact());
+      if (!edited && visited.size() == first_order.size() / 2) {
+        edited = true;
+        g->create_node(Ntype_op::Sum);  // Not in the cached order
+      }
+    }
+    if (visited.size() != first_order.size() + 1) {
+      fmt::print("ERROR: fwd after edit visited {} nodes, expected {} for {}\n", visited.size(), first_order.size() + 1, gname);
+      return false;
+    }
+  }
+
+  fmt::print("fwd traversal first:{:.6f}s later:{:.6f}s (avg per graph, {:.1f}x)\n",
+             first_secs / n,
+             later_secs / n,
+             later_secs > 0 ? first_secs / later_secs : 0.0);
+
+  return true;
+}
+
 bool bwd(int n) {
   for (int i = 0; i < n; i++) {
     std::string gname = "test_" + std::to_string(i);
@@ -515,6 +587,10 @@ int main() {
     failed = true;
   }
 
+  if (!fwd_cached(n)) {
+    failed = true;
+  }
+
 #if 0
   if(!bwd(n)) {
     failed = true;
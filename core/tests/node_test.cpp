@@ -233,3 +233,164 @@ TEST_F(Setup_graphs_test, annotate2_hier) {
     used[it.second] = true;
   }
 }
+
+TEST_F(Setup_graphs_test, hierarchy_dag) {
+  auto *leaf = LGraph::create("lgdb_node_test", "dag_leaf", "nosource");
+  leaf->add_graph_input("a", 1, 8);
+  leaf->add_graph_output("z", 2, 8);
+  leaf->create_node(Ntype_op::Sum);
+
+  auto *tile = LGraph::create("lgdb_node_test", "dag_tile", "nosource");
+  tile->add_graph_input("a", 1, 8);
+  tile->add_graph_output("z", 2, 8);
+  for (int i = 0; i < 3; ++i) {
+    tile->create_node_sub("dag_leaf");
+  }
+
+  auto *dag_top = LGraph::create("lgdb_node_test", "dag_top", "nosource");
+  for (int i = 0; i < 4; ++i) {
+    dag_top->create_node_sub("dag_tile");
+  }
+
+  const auto &htree = dag_top->get_htree();
+  EXPECT_EQ(htree.size(), 1 + 4 * (1 + 3));
+  EXPECT_EQ(htree.get_n_classes(), 3);  // dag_top, dag_tile and dag_leaf stored once
+
+  int n = 0;
+  for (auto hidx : htree.depth_preorder()) {
+    EXPECT_EQ(hidx.pos, n);  // preorder position
+    ++n;
+
+    auto *lg = htree.ref_lgraph(hidx);
+    if (hidx.is_root()) {
+      EXPECT_EQ(lg, dag_top);
+      continue;
+    }
+    EXPECT_EQ(lg, hidx.level == 1 ? tile : leaf);
+    EXPECT_EQ(htree.is_leaf(hidx), hidx.level == 2);
+
+    auto up_node = htree.get_instance_up_node(hidx);
+    EXPECT_EQ(up_node.get_hidx(), htree.get_parent(hidx));
+    EXPECT_EQ(up_node.ref_type_sub_lgraph(), lg);
+    EXPECT_EQ(up_node.hierarchy_go_down(), hidx);
+  }
+  EXPECT_EQ(n, 17);
+
+  // Hierarchical traversals still visit every instance
+  int n_sum = 0;
+  for (auto node : dag_top->fast(true)) {
+    if (node.get_type_op() == Ntype_op::Sum)
+      ++n_sum;
+  }
+  EXPECT_EQ(n_sum, 4 * 3);
+
+  leaf->sync();
+  tile->sync();
+  dag_top->sync();
+}
+
+TEST_F(Setup_graphs_test, hierarchy_incremental) {
+  auto *leaf = LGraph::create("lgdb_node_test", "inc_leaf", "nosource");
+  leaf->add_graph_input("a", 1, 8);
+  leaf->add_graph_output("z", 2, 8);
+  leaf->create_node(Ntype_op::Sum);
+
+  auto *tile = LGraph::create("lgdb_node_test", "inc_tile", "nosource");
+  tile->add_graph_input("a", 1, 8);
+  tile->add_graph_output("z", 2, 8);
+  std::vector<Node> leaf_nodes;
+  for (int i = 0; i < 3; ++i) {
+    leaf_nodes.emplace_back(tile->create_node_sub("inc_leaf"));
+  }
+
+  auto *inc_top = LGraph::create("lgdb_node_test", "inc_top", "nosource");
+  for (int i = 0; i < 4; ++i) {
+    inc_top->create_node_sub("inc_tile");
+  }
+
+  const auto &htree = inc_top->get_htree();
+  EXPECT_EQ(htree.size(), 1 + 4 * (1 + 3));
+
+  std::vector<Hierarchy_index> before;
+  for (auto hidx : htree.depth_preorder()) {
+    before.emplace_back(hidx);
+  }
+
+  // Add a tile: appended, previous instances keep the same position
+  auto new_tile = inc_top->create_node_sub("inc_tile");
+  EXPECT_EQ(inc_top->get_htree().size(), 1 + 5 * (1 + 3));
+  EXPECT_EQ(htree.get_n_classes(), 3);
+  for (const auto &hidx : before) {
+    EXPECT_EQ(htree.ref_lgraph(hidx), hidx.is_root() ? inc_top : (hidx.level == 1 ? tile : leaf));
+  }
+  auto new_tile_hidx = Node(inc_top, Hierarchy_tree::root_index(), new_tile.get_compact_class()).hierarchy_go_down();
+  EXPECT_EQ(new_tile_hidx.pos, 17);
+
+  // Remove a leaf from the tile (all the tile instances change)
+  leaf_nodes[1].del_node();
+  EXPECT_EQ(inc_top->get_htree().size(), 1 + 5 * (1 + 2));
+
+  int n = 0;
+  for (auto hidx : htree.depth_preorder()) {
+    EXPECT_EQ(hidx.pos, n);
+    ++n;
+    if (hidx.is_root())
+      continue;
+
+    EXPECT_EQ(htree.is_leaf(hidx), hidx.level == 2);
+    auto up_node = htree.get_instance_up_node(hidx);
+    EXPECT_EQ(up_node.get_hidx(), htree.get_parent(hidx));
+    EXPECT_EQ(up_node.hierarchy_go_down(), hidx);
+  }
+  EXPECT_EQ(n, 16);
+
+  int n_sum = 0;
+  for (auto node : inc_top->fast(true)) {
+    if (node.get_type_op() == Ntype_op::Sum)
+      ++n_sum;
+  }
+  EXPECT_EQ(n_sum, 5 * 2);
+
+  leaf->sync();
+  tile->sync();
+  inc_top->sync();
+}
+
+TEST_F(Setup_graphs_test, hierarchy_shared_sub) {
+  auto *leaf = LGraph::create("lgdb_node_test", "shr_leaf", "nosource");
+  leaf->add_graph_input("a", 1, 8);
+  leaf->add_graph_output("z", 2, 8);
+
+  auto *tile = LGraph::create("lgdb_node_test", "shr_tile", "nosource");
+  std::vector<Node> leaf_nodes;
+  for (int i = 0; i < 3; ++i) {
+    leaf_nodes.emplace_back(tile->create_node_sub("shr_leaf"));
+  }
+
+  auto *top_a = LGraph::create("lgdb_node_test", "shr_top_a", "nosource");
+  top_a->create_node_sub("shr_tile");
+  auto *top_b = LGraph::create("lgdb_node_test", "shr_top_b", "nosource");
+  top_b->create_node_sub("shr_tile");
+
+  EXPECT_EQ(top_a->get_htree().size(), 1 + 1 + 3);
+
+  // top_a updates its tree (tile keeps an empty slot), top_b builds it from scratch
+  leaf_nodes[1].del_node();
+  EXPECT_EQ(top_a->get_htree().size(), 1 + 1 + 2);
+  EXPECT_EQ(top_b->get_htree().size(), 1 + 1 + 2);
+
+  for (auto *top : {top_a, top_b}) {
+    const auto &htree = top->get_htree();
+    for (auto hidx : htree.depth_preorder()) {
+      if (hidx.is_root())
+        continue;
+      auto up_node = htree.get_instance_up_node(hidx);
+      EXPECT_EQ(up_node.hierarchy_go_down(), hidx);
+    }
+  }
+
+  leaf->sync();
+  tile->sync();
+  top_a->sync();
+  top_b->sync();
+}
@@ -1,6 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <string>
@@ -183,8 +184,10 @@ private:
 
   int         max_errors;
   int         max_warnings;
-  mutable int n_errors;  // NOTE: mutable to allow const methods for error/warning reporting
-  mutable int n_warnings;
+  // NOTE: mutable to allow const methods for error/warning reporting. Atomic
+  // because the pipelined eprp stages report from several threads.
+  mutable std::atomic<int> n_errors;
+  mutable std::atomic<int> n_warnings;
 
   void setup_translate();
 
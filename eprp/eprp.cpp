@@ -84,6 +84,7 @@ bool Eprp::rule_reg(bool first) {
     }
     last_cmd_var = variables[var];
   } else {
+    run_pipe();  // the register gets the pipe result
     variables[var] = last_cmd_var;
   }
 
@@ -141,7 +142,15 @@ bool Eprp::rule_cmd_full() {
   } while (path_found);
 
   ast->down();
-  run_cmd(cmd_line, next_var);
+  if (pipe_queue_size) {
+    if (!has_method(cmd_line)) {
+      parser_error("method {} not registered", cmd_line);
+      return false;
+    }
+    pipe_stages.emplace_back(Pipe_stage{cmd_line, next_var});
+  } else {
+    run_cmd(cmd_line, next_var);
+  }
   ast->up(Eprp_rule_cmd_full);
 
   return true;
@@ -182,6 +191,8 @@ bool Eprp::rule_cmd_or_reg(bool first) {
 
 // rule_top = rule_cmd_or_reg(first) rule_pipe*
 bool Eprp::rule_top() {
+  pipe_stages.clear();
+
   ast->down();
   bool try_either = rule_cmd_or_reg(true);
   ast->up(Eprp_rule_top);
@@ -198,6 +209,7 @@ bool Eprp::rule_top() {
       scan_error("eprp pipe is |> not |");
       return false;
     } else if (scan_is_end()) {
+      run_pipe();
       return true;
     } else {
       scan_error("invalid command");
@@ -212,6 +224,8 @@ bool Eprp::rule_top() {
     ;
   }
 
+  run_pipe();
+
   return true;
 }
 
@@ -278,11 +292,22 @@ void Eprp::run_cmd(const std::string &cmd, Eprp_var &var) {
 
   last_cmd_var.add(var);
 
+  if (!prepare_var(m, last_cmd_var))
+    return;
+
+  m.method(last_cmd_var);
+
+  if (idle)
+    idle();
+}
+
+// Check the required labels and add the defaults
+bool Eprp::prepare_var(const Eprp_method &m, Eprp_var &var) {
   std::string err_msg;
-  bool        err = m.check_labels(last_cmd_var, err_msg);
+  bool        err = m.check_labels(var, err_msg);
   if (err) {
     parser_error(err_msg);
-    return;
+    return false;
   }
 
 #if 0
@@ -294,11 +319,11 @@ void Eprp::run_cmd(const std::string &cmd, Eprp_var &var) {
 #endif
 
   for (const auto &label : m.labels) {
-    if (!label.second.default_value.empty() && !last_cmd_var.has_label(label.first))
-      last_cmd_var.add(label.first, label.second.default_value);
+    if (!label.second.default_value.empty() && !var.has_label(label.first))
+      var.add(label.first, label.second.default_value);
   }
 
-  m.method(last_cmd_var);
+  return true;
 }
 
 const std::string &Eprp::get_command_help(const std::string &cmd) const {
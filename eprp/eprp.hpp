@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include "ast.hpp"
@@ -18,6 +19,31 @@ protected:
 
   std::unique_ptr<Ast_parser> ast;
 
+  // Pipelined mode (pipe_queue_size>0): the commands of a pipe are collected
+  // and run once the pipe is parsed (run_pipe)
+  struct Pipe_stage {
+    std::string cmd;
+    Eprp_var    var;  // labels from the command line
+  };
+  class Pipe_queue;
+  struct Pipe_status;
+
+  size_t                  pipe_queue_size = 0;
+  std::vector<Pipe_stage> pipe_stages;
+
+public:
+  // Key of an lgraph, and the keys of the sub-lgraphs that it instantiates
+  // (the pass layer sets it, eprp does not know LGraph)
+  using Pipe_subs_fn = std::function<std::string(LGraph *lg, std::vector<std::string> &subs)>;
+
+  // Safe point: no method is running (after each command, or after all the
+  // stages of an overlapped pipe). Memory held by idle lgraphs is released there.
+  using Idle_fn = std::function<void()>;
+
+protected:
+  Pipe_subs_fn pipe_subs;
+  Idle_fn      idle;
+
   enum Eprp_rules : Rule_id {
     Eprp_invalid = 0,  // zero is not a valid Rule_id
     Eprp_rule,
@@ -47,6 +73,11 @@ protected:
   void process_ast_handler(const mmap_lib::Tree_index &self, const Ast_parser_node &node);
   void process_ast();
 
+  bool prepare_var(const Eprp_method &m, Eprp_var &var);
+
+  void run_pipe();
+  void run_pipe_stage(const Pipe_stage &stage, bool stream, Pipe_queue &in, Pipe_queue &out, Pipe_status &status);
+
 public:
   Eprp();
 
@@ -58,6 +89,18 @@ public:
   bool has_method(const std::string &cmd) const { return methods.find(cmd) != methods.end(); }
 
   void run_cmd(const std::string &cmd, Eprp_var &var);
+
+  // Overlap the stages of a `|>` pipe: a module (lnast/lgraph/file) moves to
+  // the next streamable stage once produced, with at most queue_size modules
+  // waiting between stages. 0 runs each command to completion (default).
+  void   set_pipeline(size_t queue_size) { pipe_queue_size = queue_size; }
+  size_t get_pipeline() const { return pipe_queue_size; }
+
+  // A streamed stage only calls the method on an lgraph once all its subs
+  // went through the stage (bottom-up, like Pass_hier_driver). Without it,
+  // the modules are streamed in arrival order.
+  void set_pipe_subs(const Pipe_subs_fn &fn) { pipe_subs = fn; }
+  void set_idle(const Idle_fn &fn) { idle = fn; }
   void set_variable(const std::string &name, const Eprp_var &var) { variables[name] = var; }
 
   bool readline(const char *line);
@@ -18,6 +18,8 @@ protected:
   void add_label(const std::string &attr, const std::string &help, bool required, const std::string &default_value = "");
   const std::string name;
 
+  bool streamable = false;
+
 public:
   absl::flat_hash_map<std::string, Label_attr> labels;
 
@@ -36,4 +38,10 @@ public:
   };
   void               add_label_required(const std::string &attr, const std::string &help_txt) { add_label(attr, help_txt, true); };
   const std::string &get_label_help(const std::string &label) const;
+
+  // The method handles each lgraph/lnast/file in the var independently (no
+  // state across modules), so a pipelined eprp can call it one module at a
+  // time while other stages work on other modules.
+  void set_streamable() { streamable = true; }
+  bool is_streamable() const { return streamable; }
 };
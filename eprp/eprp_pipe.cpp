@@ -0,0 +1,288 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_split.h"
+#include "eprp.hpp"
+
+// Pipelined eprp. Each stage of the pipe has its own thread, and the stages
+// talk through bounded queues of Eprp_var (one module per entry):
+//
+//  * A streamable stage calls the method once per module as soon as the
+//    module arrives, and pushes the result downstream.
+//  * Other stages (or hier:true, they read the whole hierarchy) are a
+//    barrier. They wait for all the modules and call the method once.
+//
+// Each stage handles the modules in arrival order, so the result (and the
+// order of lgs/lnasts) is the same as running each command to completion.
+// The exception is an lgraph that arrives before its subs (set_pipe_subs): a
+// streamed stage holds it until the subs went through the stage, so a pass
+// still sees the hierarchy bottom-up.
+
+class Eprp::Pipe_queue {
+  std::mutex              mutex;
+  std::condition_variable cv_push;
+  std::condition_variable cv_pop;
+  std::deque<Eprp_var>    items;
+  const size_t            max_size;
+  bool                    closed = false;
+
+public:
+  explicit Pipe_queue(size_t _max_size) : max_size(_max_size) {}
+
+  void push(Eprp_var &&var) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv_push.wait(lock, [this]() { return items.size() < max_size; });
+    items.emplace_back(std::move(var));
+    cv_pop.notify_one();
+  }
+
+  // false once closed and empty
+  bool pop(Eprp_var &var) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv_pop.wait(lock, [this]() { return !items.empty() || closed; });
+    if (items.empty())
+      return false;
+
+    var = std::move(items.front());
+    items.pop_front();
+    cv_push.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> guard(mutex);
+    closed = true;
+    cv_pop.notify_all();
+  }
+};
+
+struct Eprp::Pipe_status {
+  std::atomic<bool>  abort{false};
+  std::mutex         mutex;
+  std::exception_ptr error;
+
+  void set_error(std::exception_ptr e) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!error)
+      error = e;
+    abort = true;
+  }
+};
+
+static void pipe_merge(Eprp_var &dst, Eprp_var &src) {
+  dst.add(src);  // labels and lgs
+  for (auto &ln : src.lnasts) {
+    dst.lnasts.emplace_back(ln);
+  }
+}
+
+// One entry per module when the var has only one kind of module (lgs, lnasts,
+// or files to read). Mixed vars are handled as a single module.
+static std::vector<Eprp_var> pipe_split(Eprp_var &var) {
+  std::vector<Eprp_var> mods;
+
+  if (var.lnasts.empty() && var.lgs.size() > 1) {
+    for (auto *lg : var.lgs) {
+      mods.emplace_back(var.dict);
+      mods.back().lgs.emplace_back(lg);
+    }
+  } else if (var.lgs.empty() && var.lnasts.size() > 1) {
+    for (auto &ln : var.lnasts) {
+      mods.emplace_back(var.dict);
+      mods.back().lnasts.emplace_back(ln);
+    }
+  } else if (var.lgs.empty() && var.lnasts.empty() && var.get("files").find(',') != std::string_view::npos) {
+    for (auto f : absl::StrSplit(var.get("files"), ',')) {
+      mods.emplace_back(var.dict);
+      mods.back().dict["files"] = std::string(f);
+    }
+  } else {
+    mods.emplace_back(std::move(var));
+  }
+
+  return mods;
+}
+
+void Eprp::run_pipe_stage(const Pipe_stage &stage, bool stream, Pipe_queue &in, Pipe_queue &out, Pipe_status &status) {
+  const auto &m = methods.find(stage.cmd)->second;
+
+  auto run_mod = [this, &m, &out](Eprp_var &mod) {
+    if (!prepare_var(m, mod))
+      return;
+    m.method(mod);
+    out.push(std::move(mod));
+  };
+
+  // Streamed lgraphs wait here until their subs went through this stage
+  struct Pipe_pending {
+    Eprp_var                 mod;
+    std::vector<std::string> keys;
+    std::vector<std::string> subs;
+  };
+  std::vector<Pipe_pending>        pending;
+  absl::flat_hash_set<std::string> pending_keys;
+  absl::flat_hash_set<std::string> done_keys;
+
+  // Once the upstream is closed, a sub that is not pending will never come
+  auto is_ready = [&pending_keys, &done_keys](const Pipe_pending &p, bool closed) {
+    for (const auto &sub : p.subs) {
+      if (done_keys.contains(sub) || std::find(p.keys.begin(), p.keys.end(), sub) != p.keys.end())
+        continue;
+      if (!closed || pending_keys.contains(sub))
+        return false;
+    }
+    return true;
+  };
+
+  auto flush = [&](bool closed) {
+    bool progress = true;
+    while (progress && !pending.empty()) {
+      progress = false;
+      for (auto i = 0u; i < pending.size();) {
+        if (!is_ready(pending[i], closed)) {
+          ++i;
+          continue;
+        }
+        auto p = std::move(pending[i]);
+        pending.erase(pending.begin() + i);
+        for (const auto &k : p.keys) {
+          pending_keys.erase(k);
+          done_keys.insert(k);
+        }
+        run_mod(p.mod);
+        progress = true;
+      }
+    }
+
+    if (closed) {  // only with a loop in the hierarchy
+      for (auto &p : pending) {
+        run_mod(p.mod);
+      }
+      pending.clear();
+    }
+  };
+
+  Eprp_var all;  // barrier stage input
+  Eprp_var var;
+  while (in.pop(var)) {
+    if (status.abort)
+      continue;  // drain, so the upstream stages do not block
+
+    if (!stream) {
+      pipe_merge(all, var);
+      continue;
+    }
+
+    try {
+      var.add(stage.var);
+      for (auto &mod : pipe_split(var)) {
+        if (!pipe_subs || mod.lgs.empty()) {
+          run_mod(mod);
+          continue;
+        }
+
+        Pipe_pending p;
+        for (auto *lg : mod.lgs) {
+          p.keys.emplace_back(pipe_subs(lg, p.subs));
+          pending_keys.insert(p.keys.back());
+        }
+        p.mod = std::move(mod);
+        pending.emplace_back(std::move(p));
+        flush(false);
+      }
+    } catch (...) {
+      status.set_error(std::current_exception());
+    }
+  }
+
+  if (stream && !status.abort) {
+    try {
+      flush(true);
+    } catch (...) {
+      status.set_error(std::current_exception());
+    }
+  }
+
+  if (!stream && !status.abort) {
+    try {
+      all.add(stage.var);
+      if (prepare_var(m, all)) {
+        m.method(all);
+        out.push(std::move(all));
+      }
+    } catch (...) {
+      status.set_error(std::current_exception());
+    }
+  }
+
+  out.close();
+}
+
+void Eprp::run_pipe() {
+  if (pipe_stages.empty())
+    return;
+
+  std::vector<Pipe_stage> stages;
+  std::swap(stages, pipe_stages);
+
+  // Labels accumulate through the pipe (hier:true in a stage also applies to the next ones)
+  std::vector<bool> stream(stages.size());
+  bool              any_stream = false;
+  Eprp_var          acc;
+  for (auto i = 0u; i < stages.size(); ++i) {
+    acc.add(stages[i].var.dict);
+    const auto &m = methods.find(stages[i].cmd)->second;
+    stream[i]     = m.is_streamable() && acc.get("hier") != "true";
+    any_stream    = any_stream || stream[i];
+  }
+
+  if (stages.size() == 1 || !any_stream) {
+    for (auto &s : stages) {
+      run_cmd(s.cmd, s.var);
+    }
+    return;
+  }
+
+  std::vector<std::unique_ptr<Pipe_queue>> queues;
+  for (auto i = 0u; i <= stages.size(); ++i) {
+    queues.emplace_back(std::make_unique<Pipe_queue>(pipe_queue_size));
+  }
+
+  Pipe_status status;
+
+  std::vector<std::thread> threads;
+  for (auto i = 0u; i < stages.size(); ++i) {
+    threads.emplace_back([this, &stages, &stream, &queues, &status, i]() {
+      run_pipe_stage(stages[i], stream[i], *queues[i], *queues[i + 1], status);
+    });
+  }
+
+  queues[0]->push(std::move(last_cmd_var));
+  queues[0]->close();
+
+  Eprp_var result;
+  Eprp_var var;
+  while (queues.back()->pop(var)) {
+    pipe_merge(result, var);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  last_cmd_var = std::move(result);
+
+  if (status.error)
+    std::rethrow_exception(status.error);
+
+  if (idle)
+    idle();
+}
@@ -7,6 +7,9 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <mutex>
+
 // Fake lgraph class for testing
 class LGraph {
 public:
@@ -164,3 +167,134 @@ TEST_F(Eprp_test, SimpleReadlinePipe) {
   EXPECT_TRUE(is_equal_called);
 }
 
+
+static std::mutex                             pipe_mutex;
+static std::vector<std::pair<std::string, int>> pipe_calls;
+
+class test3 {
+public:
+  static inline int first_id = 0;
+
+  static void gen(Eprp_var &var) {
+    for (int i = 0; i < 8; ++i) {
+      var.add(new LGraph());
+      if (i == 0)
+        first_id = var.lgs.back()->id;
+    }
+  }
+
+  // Each lgraph instantiates the next one (the last is a leaf)
+  static std::string subs(LGraph *lg, std::vector<std::string> &sub_keys) {
+    if (lg->id + 1 < first_id + 8)
+      sub_keys.emplace_back(std::to_string(lg->id + 1));
+    return std::to_string(lg->id);
+  }
+
+  static void stage(Eprp_var &var, const std::string &name) {
+    EXPECT_EQ(var.lgs.size(), 1);  // one module at a time
+    std::lock_guard<std::mutex> guard(pipe_mutex);
+    for (const auto *lg : var.lgs) {
+      pipe_calls.emplace_back(name, lg->id);
+    }
+  }
+  static void stage_a(Eprp_var &var) { stage(var, "a"); }
+  static void stage_b(Eprp_var &var) { stage(var, "b"); }
+
+  static void all(Eprp_var &var) {
+    std::lock_guard<std::mutex> guard(pipe_mutex);
+    for (const auto *lg : var.lgs) {
+      pipe_calls.emplace_back("all", lg->id);
+    }
+  }
+};
+
+class Eprp_pipe : public ::testing::Test {
+public:
+protected:
+  Eprp eprp;
+  void SetUp() override {
+    Eprp_method m1("test3.gen", "create 8 lgraphs", &test3::gen);
+    Eprp_method m2("test3.stage_a", "per module stage", &test3::stage_a);
+    m2.set_streamable();
+    Eprp_method m3("test3.stage_b", "per module stage", &test3::stage_b);
+    m3.set_streamable();
+    Eprp_method m4("test3.all", "whole design stage", &test3::all);
+
+    eprp.register_method(m1);
+    eprp.register_method(m2);
+    eprp.register_method(m3);
+    eprp.register_method(m4);
+
+    pipe_calls.clear();
+  }
+};
+
+TEST_F(Eprp_pipe, SameOrderAsSerial) {
+  const char *buffer = "test3.gen |> test3.stage_a |> test3.stage_b |> test3.all";
+
+  eprp.set_pipeline(2);
+  eprp.parse_inline(buffer);
+
+  std::vector<int> order_a, order_b, order_all;
+  for (const auto &c : pipe_calls) {
+    if (c.first == "a")
+      order_a.emplace_back(c.second);
+    else if (c.first == "b")
+      order_b.emplace_back(c.second);
+    else
+      order_all.emplace_back(c.second);
+  }
+
+  EXPECT_EQ(order_a.size(), 8);
+  EXPECT_EQ(order_a, order_b);
+  EXPECT_EQ(order_a, order_all);  // the barrier sees all the modules, in order
+  EXPECT_TRUE(std::is_sorted(order_a.begin(), order_a.end()));
+}
+
+TEST_F(Eprp_pipe, RegisterGetsResult) {
+  eprp.set_pipeline(1);
+  eprp.parse_inline("test3.gen |> test3.stage_a |> #r");
+
+  pipe_calls.clear();
+  eprp.parse_inline("#r |> test3.all");
+
+  EXPECT_EQ(pipe_calls.size(), 8);
+}
+
+TEST_F(Eprp_pipe, SubsFirst) {
+  eprp.set_pipe_subs(&test3::subs);
+  eprp.set_pipeline(2);
+  eprp.parse_inline("test3.gen |> test3.stage_a |> test3.stage_b |> test3.all");
+
+  std::vector<int> order_a, order_b;
+  for (const auto &c : pipe_calls) {
+    if (c.first == "a")
+      order_a.emplace_back(c.second);
+    else if (c.first == "b")
+      order_b.emplace_back(c.second);
+  }
+
+  // Top first from gen, but each stage sees the leaf first (bottom-up)
+  EXPECT_EQ(order_a.size(), 8);
+  EXPECT_EQ(order_a, order_b);
+  EXPECT_TRUE(std::is_sorted(order_a.rbegin(), order_a.rend()));
+}
+
+TEST_F(Eprp_pipe, IdleAfterAllStages) {
+  size_t n_calls_at_idle = 0;
+  int    n_idle          = 0;
+  eprp.set_idle([&]() {
+    std::lock_guard<std::mutex> guard(pipe_mutex);
+    n_calls_at_idle = pipe_calls.size();
+    ++n_idle;
+  });
+
+  eprp.set_pipeline(2);
+  eprp.parse_inline("test3.gen |> test3.stage_a |> test3.stage_b |> test3.all");
+  EXPECT_EQ(n_idle, 1);  // not between the overlapped stages
+  EXPECT_EQ(n_calls_at_idle, 3 * 8);
+
+  eprp.set_pipeline(0);
+  eprp.parse_inline("test3.gen |> test3.all");
+  EXPECT_EQ(n_idle, 1 + 2);  // after each command
+}
@@ -1,14 +1,18 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 //
 
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <queue>
 
 #include "firrtl.pb.h"
 #include "google/protobuf/util/time_util.h"
 #include "inou_firrtl.hpp"
 #include "lbench.hpp"
+#include "pass_hier_driver.hpp"
+#include "thread_pool.hpp"
 
 using google::protobuf::util::TimeUtil;
 
@@ -22,11 +26,17 @@ void Inou_firrtl::toLNAST(Eprp_var& var) {
   Lbench b("inou.FIRRTL_tolnast");
 
   Inou_firrtl p(var);
+  p.n_threads = Pass_hier_driver::get_threads(var.get("threads"));
+  bool stream = var.get("stream") == "true";
 
   if (var.has_label("files")) {
     auto files = var.get("files");
     for (const auto& f : absl::StrSplit(files, ",")) {
       fmt::print("FILE: {}\n", f);
+      if (stream) {
+        p.IterateCircuitsStream(var, std::string(f));
+        continue;
+      }
       firrtl::FirrtlPB firrtl_input;
       std::fstream     input(std::string(f).c_str(), std::ios::in | std::ios::binary);
       if (!firrtl_input.ParseFromIstream(&input)) {
@@ -762,19 +772,23 @@ void Inou_firrtl::create_module_inst(Lnast& lnast, const firrtl::FirrtlPB_Statem
 
   // If any parameters exist (for ext module), specify those.
   // NOTE->hunter: We currently specify parameters the same way as inputs.
-  for (const auto& param : emod_to_param_map[inst.module_id()]) {
-    auto temp_var_name_p  = create_temp_var(lnast);
-    auto idx_dot_p = lnast.add_child(parent_node, Lnast_node::create_dot("param"));
-    lnast.add_child(idx_dot_p, Lnast_node::create_ref(temp_var_name_p));
-    lnast.add_child(idx_dot_p, Lnast_node::create_ref(inp_name));
-    lnast.add_child(idx_dot_p, Lnast_node::create_ref(lnast.add_string(param.first)));
-
-    auto idx_asg_p = lnast.add_child(parent_node, Lnast_node::create_assign("param"));
-    lnast.add_child(idx_asg_p, Lnast_node::create_ref(temp_var_name_p));
-    if (isdigit(param.second[0])) {
-      lnast.add_child(idx_asg_p, Lnast_node::create_const(lnast.add_string(param.second)));
-    } else {
-      lnast.add_child(idx_asg_p, Lnast_node::create_ref(lnast.add_string(param.second)));
+  // NOTE: find (not []), the circuit tables are shared by the module workers
+  auto emod_it = emod_to_param_map.find(inst.module_id());
+  if (emod_it != emod_to_param_map.end()) {
+    for (const auto& param : emod_it->second) {
+      auto temp_var_name_p  = create_temp_var(lnast);
+      auto idx_dot_p = lnast.add_child(parent_node, Lnast_node::create_dot("param"));
+      lnast.add_child(idx_dot_p, Lnast_node::create_ref(temp_var_name_p));
+      lnast.add_child(idx_dot_p, Lnast_node::create_ref(inp_name));
+      lnast.add_child(idx_dot_p, Lnast_node::create_ref(lnast.add_string(param.first)));
+
+      auto idx_asg_p = lnast.add_child(parent_node, Lnast_node::create_assign("param"));
+      lnast.add_child(idx_asg_p, Lnast_node::create_ref(temp_var_name_p));
+      if (isdigit(param.second[0])) {
+        lnast.add_child(idx_asg_p, Lnast_node::create_const(lnast.add_string(param.second)));
+      } else {
+        lnast.add_child(idx_asg_p, Lnast_node::create_ref(lnast.add_string(param.second)));
+      }
     }
   }
 
@@ -1226,7 +1240,8 @@ std::string_view Inou_firrtl::HandleBundVecAcc(Lnast& ln, const firrtl::FirrtlPB
     }
     auto str_without_inst = alter_full_str.substr(alter_full_str.find(".") + 1);
     auto module_name      = inst_to_mod_map[inst_name];
-    auto dir              = mod_to_io_dir_map[std::make_pair(module_name, str_without_inst)];
+    auto dir_it           = mod_to_io_dir_map.find(std::make_pair(module_name, str_without_inst));
+    auto dir              = dir_it == mod_to_io_dir_map.end() ? 0 : dir_it->second;
     if (dir == 1) {  // PORT_DIRECTION_IN
       flattened_str = absl::StrCat("inp_", flattened_str);
     } else if (dir == 2) {
@@ -2001,8 +2016,22 @@ void Inou_firrtl::PerformLateMemAssigns(Lnast& lnast, Lnast_nid& parent_node) {
 
 //--------------Modules/Circuits--------------------
 // Create basis of LNAST tree. Set root to "top" and have "stmts" be top's child.
-void Inou_firrtl::ListUserModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Module& module, const std::string& file_name) {
-  fmt::print("Module (user): {}\n", module.user_module().id());
+// Only reads the circuit tables (mod_to_io_*, emod_to_param_map), so several
+// Inou_firrtl copies can convert different modules in parallel.
+std::unique_ptr<Lnast> Inou_firrtl::ListUserModuleInfo(const firrtl::FirrtlPB_Module& module, const std::string& file_name) {
+  // Between modules, module specific lists.
+  temp_var_count = 0;
+  seq_counter    = 0;
+  input_names.clear();
+  output_names.clear();
+  register_names.clear();
+  memory_names.clear();
+  async_rst_names.clear();
+  inst_to_mod_map.clear();
+  mem_props_map.clear();
+  dangling_ports_map.clear();
+  late_assign_ports.clear();
+
   std::unique_ptr<Lnast> lnast = std::make_unique<Lnast>(module.user_module().id(), file_name);
 
   const firrtl::FirrtlPB_Module_UserModule& user_module = module.user_module();
@@ -2023,44 +2052,38 @@ void Inou_firrtl::ListUserModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Modul
     ListStatementInfo(*lnast, stmt, idx_stmts);
   }
   PerformLateMemAssigns(*lnast, idx_stmts);
-  var.add(std::move(lnast));
-}
 
-void Inou_firrtl::ListModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Module& module, const std::string& file_name) {
-  if (module.has_external_module()) {
-    GrabExtModuleInfo(module.external_module());
-  } else if (module.has_user_module()) {
-    ListUserModuleInfo(var, module, file_name);
-  } else {
-    Pass::error("Module not set.");
-  }
+  return lnast;
 }
 
 void Inou_firrtl::PopulateAllModsIO(Eprp_var& var, const firrtl::FirrtlPB_Circuit& circuit, const std::string& file_name) {
   for (int i = 0; i < circuit.module_size(); i++) {
-    // std::vector<std::pair<std::string, uint8_t>> vec;
-    if (circuit.module(i).has_external_module()) {
-      /* NOTE->hunter: This is a Verilog blackbox. If we want to link it, it'd have to go through either V->LG
-       * or V->LN->LG. I will create a Sub_Node in case the Verilog isn't provided. */
-      auto sub = AddModToLibrary(var, circuit.module(i).external_module().id(), file_name);
-      uint64_t inp_pos = 0;
-      uint64_t out_pos = 0;
-      for (int j = 0; j < circuit.module(i).external_module().port_size(); j++) {
-        auto port = circuit.module(i).external_module().port(j);
-        AddPortToMap(circuit.module(i).external_module().id(), port.type(), port.direction(), port.id(), sub, inp_pos, out_pos);
-      }
-      continue;
-    } else if (circuit.module(i).has_user_module()) {
-      auto sub = AddModToLibrary(var, circuit.module(i).user_module().id(), file_name);
-      uint64_t inp_pos = 0;
-      uint64_t out_pos = 0;
-      for (int j = 0; j < circuit.module(i).user_module().port_size(); j++) {
-        auto port = circuit.module(i).user_module().port(j);
-        AddPortToMap(circuit.module(i).user_module().id(), port.type(), port.direction(), port.id(), sub, inp_pos, out_pos);
-      }
-    } else {
-      Pass::error("Module not set.");
+    PopulateModIO(var, circuit.module(i), file_name);
+  }
+}
+
+void Inou_firrtl::PopulateModIO(Eprp_var& var, const firrtl::FirrtlPB_Module& module, const std::string& file_name) {
+  // std::vector<std::pair<std::string, uint8_t>> vec;
+  if (module.has_external_module()) {
+    /* NOTE->hunter: This is a Verilog blackbox. If we want to link it, it'd have to go through either V->LG
+     * or V->LN->LG. I will create a Sub_Node in case the Verilog isn't provided. */
+    auto sub = AddModToLibrary(var, module.external_module().id(), file_name);
+    uint64_t inp_pos = 0;
+    uint64_t out_pos = 0;
+    for (int j = 0; j < module.external_module().port_size(); j++) {
+      auto port = module.external_module().port(j);
+      AddPortToMap(module.external_module().id(), port.type(), port.direction(), port.id(), sub, inp_pos, out_pos);
+    }
+  } else if (module.has_user_module()) {
+    auto sub = AddModToLibrary(var, module.user_module().id(), file_name);
+    uint64_t inp_pos = 0;
+    uint64_t out_pos = 0;
+    for (int j = 0; j < module.user_module().port_size(); j++) {
+      auto port = module.user_module().port(j);
+      AddPortToMap(module.user_module().id(), port.type(), port.direction(), port.id(), sub, inp_pos, out_pos);
     }
+  } else {
+    Pass::error("Module not set.");
   }
 }
 
@@ -2229,23 +2252,88 @@ void Inou_firrtl::IterateModules(Eprp_var& var, const firrtl::FirrtlPB_Circuit&
     I(false);
   }
 
-  // Create ModuleName to I/O Pair List
+  // Create ModuleName to I/O Pair List (and the shared Sub_node table)
   PopulateAllModsIO(var, circuit, file_name);
 
+  // External modules only fill the circuit tables. Done before any user module
+  // converts, so the tables are read-only afterwards.
+  std::vector<int> user_mods;
   for (int i = 0; i < circuit.module_size(); i++) {
-    // Between modules, module specific lists.
-    temp_var_count = 0;
-    input_names.clear();
-    output_names.clear();
-    register_names.clear();
-    memory_names.clear();
-    async_rst_names.clear();
-    inst_to_mod_map.clear();
-    mem_props_map.clear();
-    dangling_ports_map.clear();
-    late_assign_ports.clear();
-
-    ListModuleInfo(var, circuit.module(i), file_name);
+    const firrtl::FirrtlPB_Module& module = circuit.module(i);
+    if (module.has_external_module()) {
+      GrabExtModuleInfo(module.external_module());
+    } else if (module.has_user_module()) {
+      user_mods.emplace_back(i);
+    } else {
+      Pass::error("Module not set.");
+    }
+  }
+
+  ConvertUserModules(
+      var,
+      user_mods.size(),
+      [&circuit, &user_mods](size_t pos, google::protobuf::Arena& arena) {
+        (void)arena;  // already decoded
+        return &circuit.module(user_mods[pos]);
+      },
+      file_name);
+}
+
+void Inou_firrtl::ConvertUserModules(Eprp_var& var, size_t n_mods, const Get_module_fn& get_module, const std::string& file_name) {
+  std::vector<std::unique_ptr<Lnast>> lnasts(n_mods);
+
+  if (n_threads == 1 || n_mods <= 1) {
+    for (auto i = 0u; i < n_mods; ++i) {
+      google::protobuf::Arena arena;
+      lnasts[i] = ListUserModuleInfo(*get_module(i, arena), file_name);
+    }
+  } else {
+    // Each worker is a copy of this Inou_firrtl (own module specific lists).
+    // Copies are recycled, so the circuit tables are copied once per thread,
+    // not once per module.
+    Thread_pool pool(n_threads);
+
+    std::mutex                                idle_mutex;
+    std::vector<std::unique_ptr<Inou_firrtl>> idle;
+    std::vector<std::exception_ptr>           errors(n_mods);
+
+    Thread_pool::Sync sync{0};
+    for (auto i = 0u; i < n_mods; ++i) {
+      pool.spawn(sync, [this, &get_module, &file_name, &lnasts, &errors, &idle, &idle_mutex, i]() {
+        std::unique_ptr<Inou_firrtl> worker;
+        {
+          std::lock_guard<std::mutex> guard(idle_mutex);
+          if (!idle.empty()) {
+            worker = std::move(idle.back());
+            idle.pop_back();
+          }
+        }
+        if (!worker)
+          worker = std::make_unique<Inou_firrtl>(*this);
+
+        try {
+          google::protobuf::Arena arena;  // module message freed once converted
+          lnasts[i] = worker->ListUserModuleInfo(*get_module(i, arena), file_name);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> guard(idle_mutex);
+        idle.emplace_back(std::move(worker));
+      });
+    }
+    pool.sync(sync);
+
+    for (auto &e : errors) {
+      if (e)
+        std::rethrow_exception(e);  // first failing module in circuit order
+    }
+  }
+
+  // Circuit order, independent of the number of threads
+  for (auto i = 0u; i < n_mods; ++i) {
+    fmt::print("Module (user): {}\n", lnasts[i]->get_top_module_name());
+    var.add(std::move(lnasts[i]));
   }
 }
 
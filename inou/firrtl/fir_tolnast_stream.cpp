@@ -0,0 +1,89 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string_view>
+#include <vector>
+
+#include "fir_tolnast_stream.hpp"
+#include "inou_firrtl.hpp"
+
+/* Streaming FIRRTL protobuf reader (inou.firrtl.tolnast stream:true).
+ *
+ * The whole FirrtlPB message is never built. The file is mmap, the
+ * FirrtlPB/Circuit framing is walked at the wire level, and each module is
+ * decoded with a CodedInputStream over the mapped bytes into its own Arena.
+ * The first walk only decodes the module ports (Sub_node and IO tables), the
+ * second decodes and converts one full module at a time. Peak memory is the
+ * largest module (per worker thread), not the whole circuit. */
+
+void Inou_firrtl::IterateCircuitsStream(Eprp_var& var, const std::string& file_name) {
+  Pb_mmap pb(file_name);
+  if (!pb.is_valid()) {
+    Pass::error("Failed to open or mmap FIRRTL protobuf file: {}", file_name);
+    return;
+  }
+
+  Pb_walker        top(pb.get_buffer());
+  uint32_t         field;
+  std::string_view circuit_data;
+  while (top.next(field, circuit_data)) {
+    if (field != 1)  // FirrtlPB.circuit
+      continue;
+
+    mod_to_io_dir_map.clear();
+    mod_to_io_map.clear();
+    emod_to_param_map.clear();
+
+    // 1st walk: IO of all the modules (Sub_node table) and external modules
+    std::vector<std::string_view> user_mods;
+    int                           n_tops = 0;
+    Pb_walker                     circuit(circuit_data);
+    std::string_view              mod_data;
+    while (circuit.next(field, mod_data)) {
+      if (field == 2) {  // Circuit.top
+        n_tops++;
+        continue;
+      }
+      if (field != 1)  // Circuit.module
+        continue;
+
+      google::protobuf::Arena arena;
+      auto *module = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+      if (!parse_module_io(module, mod_data)) {
+        Pass::error("Failed to parse FIRRTL module from protobuf format: {}", file_name);
+        return;
+      }
+
+      PopulateModIO(var, *module, file_name);
+      if (module->has_external_module()) {
+        GrabExtModuleInfo(module->external_module());
+      } else if (module->has_user_module()) {
+        user_mods.emplace_back(mod_data);
+      }
+      pb.drop(mod_data);
+    }
+    if (!circuit.is_ok()) {
+      Pass::error("Failed to parse FIRRTL circuit from protobuf format: {}", file_name);
+      return;
+    }
+    if (n_tops > 1) {
+      Pass::error("More than 1 top module specified.");
+      I(false);
+    }
+
+    // 2nd walk: decode and convert one full module at a time
+    ConvertUserModules(
+        var,
+        user_mods.size(),
+        [&pb, &user_mods, &file_name](size_t pos, google::protobuf::Arena& arena) {
+          auto *module = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+          if (!parse_pb(module, user_mods[pos]))
+            Pass::error("Failed to parse FIRRTL module from protobuf format: {}", file_name);
+          pb.drop(user_mods[pos]);  // decoded, the mapped pages are not needed
+          return module;
+        },
+        file_name);
+  }
+
+  if (!top.is_ok())
+    Pass::error("Failed to parse FIRRTL from protobuf format: {}", file_name);
+}
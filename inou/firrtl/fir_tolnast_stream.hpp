@@ -0,0 +1,165 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <climits>
+#include <string>
+#include <string_view>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+
+#include "firrtl.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+
+#pragma GCC diagnostic pop
+
+// Wire level helpers of the streaming FIRRTL protobuf reader
+// (fir_tolnast_stream.cpp). The whole FirrtlPB message is never built.
+
+// Length delimited fields of the outer messages (FirrtlPB and Circuit). A
+// circuit can be larger than a CodedInputStream buffer (int size), so the
+// framing uses this small varint reader. Modules are decoded by protobuf.
+class Pb_walker {
+  const uint8_t *ptr;
+  const uint8_t *end;
+  bool           ok;
+
+  bool read_varint(uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+      auto b = *ptr++;
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  bool skip(uint64_t n) {
+    if (n > static_cast<uint64_t>(end - ptr))
+      return false;
+    ptr += n;
+    return true;
+  }
+
+public:
+  explicit Pb_walker(std::string_view buf)
+      : ptr(reinterpret_cast<const uint8_t *>(buf.data())), end(ptr + buf.size()), ok(true) {}
+
+  // Next length delimited field (other wire types are skipped). False at the
+  // end of the buffer or when the buffer is malformed (!is_ok()).
+  bool next(uint32_t &field, std::string_view &data) {
+    while (ok && ptr < end) {
+      uint64_t tag;
+      uint64_t v = 0;
+      if (!read_varint(tag)) {
+        ok = false;
+        break;
+      }
+      field = tag >> 3;
+
+      switch (tag & 0x7) {
+        case 0: ok = read_varint(v); break;  // varint
+        case 1: ok = skip(8); break;         // fixed64
+        case 5: ok = skip(4); break;         // fixed32
+        case 2:                              // length delimited
+          ok = read_varint(v) && v <= static_cast<uint64_t>(end - ptr);
+          if (ok) {
+            data = std::string_view(reinterpret_cast<const char *>(ptr), v);
+            ptr += v;
+            return true;
+          }
+          break;
+        default: ok = false;  // groups are not used by firrtl.proto
+      }
+    }
+    return false;
+  }
+
+  bool is_ok() const { return ok; }
+};
+
+class Pb_mmap {
+  const char *base;
+  size_t      size;
+
+public:
+  explicit Pb_mmap(const std::string &file_name) : base(nullptr), size(0) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) {
+      auto *b = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (b != MAP_FAILED) {
+        base = static_cast<const char *>(b);
+        size = sb.st_size;
+        madvise(b, size, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);  // the mapping keeps the file
+  }
+
+  ~Pb_mmap() {
+    if (base)
+      munmap(const_cast<char *>(base), size);
+  }
+
+  bool             is_valid() const { return base != nullptr; }
+  std::string_view get_buffer() const { return std::string_view(base, size); }
+
+  // Release the pages of an already decoded range (whole pages only). The
+  // mapping is read-only, so a later access just reads the file again.
+  void drop(std::string_view data) const {
+    const uintptr_t page  = sysconf(_SC_PAGESIZE);
+    auto            start = (reinterpret_cast<uintptr_t>(data.data()) + page - 1) & ~(page - 1);
+    auto            stop  = (reinterpret_cast<uintptr_t>(data.data()) + data.size()) & ~(page - 1);
+    if (start < stop)
+      madvise(reinterpret_cast<void *>(start), stop - start, MADV_DONTNEED);
+  }
+};
+
+inline bool parse_pb(google::protobuf::MessageLite *msg, std::string_view data) {
+  if (data.size() > INT_MAX)
+    return false;  // CodedInputStream limit (a single >2GB module)
+
+  google::protobuf::io::CodedInputStream cis(reinterpret_cast<const uint8_t *>(data.data()), data.size());
+  cis.SetTotalBytesLimit(data.size());
+  return msg->ParseFromCodedStream(&cis);
+}
+
+// Module with the ports only (the statements are skipped, not decoded)
+inline bool parse_module_io(firrtl::FirrtlPB_Module *module, std::string_view data) {
+  Pb_walker        mod(data);
+  uint32_t         field;
+  std::string_view fdata;
+  while (mod.next(field, fdata)) {
+    if (field == 1) {  // Module.external_module (small, no statements)
+      if (!parse_pb(module->mutable_external_module(), fdata))
+        return false;
+    } else if (field == 2) {  // Module.user_module
+      auto            *umod = module->mutable_user_module();
+      Pb_walker        user(fdata);
+      std::string_view udata;
+      while (user.next(field, udata)) {
+        if (field == 1) {  // UserModule.id
+          umod->set_id(std::string(udata));
+        } else if (field == 2) {  // UserModule.port
+          if (!parse_pb(umod->add_port(), udata))
+            return false;
+        }
+      }
+      if (!user.is_ok())
+        return false;
+    }
+  }
+
+  return mod.is_ok();
+}
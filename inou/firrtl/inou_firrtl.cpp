@@ -15,6 +15,9 @@ void Inou_firrtl::setup() {
   Eprp_method m1("inou.firrtl.tolnast", "Translate FIRRTL to LNAST (in progress)", &Inou_firrtl::toLNAST);
   m1.add_label_required("files", "FIRRTL-protobuf data file[s]");
   m1.add_label_optional("path", "location to store lgraph subgraph nodes", "lgdb");
+  m1.add_label_optional("threads", "threads to convert the modules of a circuit (0 for all the cores)", "1");
+  m1.add_label_optional("stream", "mmap the files and decode one module at a time (memory bounded by the largest module)", "false");
+  m1.set_streamable();
   register_inou("firrtl", m1);
 
   Eprp_method m2("inou.firrtl.tofirrtl", "LNAST to FIRRTL", &Inou_firrtl::toFIRRTL);
@@ -6,12 +6,14 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wsign-compare"
 
+#include <functional>
 #include <string>
 #include <tuple>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "firrtl.pb.h"
+#include "google/protobuf/arena.h"
 
 #pragma GCC diagnostic pop
 // LiveHD includes
@@ -90,18 +92,26 @@ protected:
   void PerformLateMemAssigns(Lnast &lnast, Lnast_nid& parent_node);
 
   void PopulateAllModsIO(Eprp_var& var, const firrtl::FirrtlPB_Circuit &circuit, const std::string& file_name);
+  void PopulateModIO(Eprp_var& var, const firrtl::FirrtlPB_Module &module, const std::string& file_name);
   void AddPortToMap(const std::string &mod_id, const firrtl::FirrtlPB_Type &type, uint8_t dir, const std::string &port_id, Sub_node& sub, uint64_t &inp_pos, uint64_t &out_pos);
   void AddPortToSub(Sub_node& sub, uint64_t &inp_pos, uint64_t &out_pos, const std::string& port_id, const uint8_t& dir);
   Sub_node AddModToLibrary(Eprp_var& var, const std::string& mod_name, const std::string& file_name);
 
   std::string ConvertBigIntToStr(const firrtl::FirrtlPB_BigInt& bigint);
 
-  void ListUserModuleInfo(Eprp_var &var, const firrtl::FirrtlPB_Module &module, const std::string& file_name);
+  std::unique_ptr<Lnast> ListUserModuleInfo(const firrtl::FirrtlPB_Module &module, const std::string& file_name);
   void GrabExtModuleInfo(const firrtl::FirrtlPB_Module_ExternalModule& emod);
-  void ListModuleInfo(Eprp_var &var, const firrtl::FirrtlPB_Module &module, const std::string& file_name);
   void IterateModules(Eprp_var &var, const firrtl::FirrtlPB_Circuit &circuit, const std::string& file_name);
   void IterateCircuits(Eprp_var &var, const firrtl::FirrtlPB &firrtl_input, const std::string& file_name);
 
+  // Decodes the user module pos (0..n_mods-1, circuit order). The module may be
+  // allocated in the arena (freed once the module is converted).
+  using Get_module_fn = std::function<const firrtl::FirrtlPB_Module *(size_t pos, google::protobuf::Arena &arena)>;
+  void ConvertUserModules(Eprp_var &var, size_t n_mods, const Get_module_fn &get_module, const std::string &file_name);
+
+  // Streaming mode: mmap the pb file and decode one module at a time
+  void IterateCircuitsStream(Eprp_var &var, const std::string &file_name);
+
   static void toLNAST(Eprp_var &var);
 
   //----------- FOR toFIRRTL ----------
@@ -187,6 +197,8 @@ private:
   uint32_t temp_var_count;
   uint32_t seq_counter;
 
+  int n_threads = 1;  // module to LNAST workers (0 for all the cores)
+
   //----------- FOR toFIRRTL ---------
   absl::flat_hash_map<std::string, firrtl::FirrtlPB_Port *>      io_map;
   absl::flat_hash_map<std::string, firrtl::FirrtlPB_Statement *> reg_wire_map;
@@ -0,0 +1,126 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fir_tolnast_stream.hpp"
+#include "gtest/gtest.h"
+
+// The streaming reader must see the same circuits, modules and ports as the
+// full FirrtlPB parse (inou.firrtl.tolnast stream:false).
+class Fir_tolnast_stream_test : public ::testing::Test {
+protected:
+  static constexpr const char *proto_path = "inou/firrtl/tests/proto";
+
+  static std::vector<std::string> get_pb_files() {
+    std::vector<std::string> files;
+
+    DIR *dir = opendir(proto_path);
+    if (dir == nullptr)
+      return files;
+    while (auto *ent = readdir(dir)) {
+      std::string name(ent->d_name);
+      if (name.size() > 3 && name.compare(name.size() - 3, 3, ".pb") == 0)
+        files.emplace_back(std::string(proto_path) + "/" + name);
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  static bool full_parse(const std::string &file_name, firrtl::FirrtlPB &firrtl_input) {
+    std::fstream input(file_name, std::ios::in | std::ios::binary);
+    return firrtl_input.ParseFromIstream(&input);
+  }
+
+  static void check_module_io(const firrtl::FirrtlPB_Module &full, const firrtl::FirrtlPB_Module &io) {
+    EXPECT_EQ(full.has_external_module(), io.has_external_module());
+    EXPECT_EQ(full.has_user_module(), io.has_user_module());
+
+    if (full.has_external_module()) {
+      EXPECT_EQ(full.external_module().SerializeAsString(), io.external_module().SerializeAsString());
+    }
+    if (full.has_user_module()) {
+      const auto &fmod = full.user_module();
+      const auto &imod = io.user_module();
+      EXPECT_EQ(fmod.id(), imod.id());
+      EXPECT_EQ(imod.statement_size(), 0);  // skipped, not decoded
+      ASSERT_EQ(fmod.port_size(), imod.port_size()) << fmod.id();
+      for (int i = 0; i < fmod.port_size(); ++i) {
+        EXPECT_EQ(fmod.port(i).SerializeAsString(), imod.port(i).SerializeAsString()) << fmod.id() << " port " << i;
+      }
+    }
+  }
+};
+
+TEST_F(Fir_tolnast_stream_test, same_as_full_parse) {
+  auto files = get_pb_files();
+  ASSERT_FALSE(files.empty()) << "no FIRRTL protobuf files in " << proto_path;
+
+  for (const auto &file_name : files) {
+    SCOPED_TRACE(file_name);
+
+    firrtl::FirrtlPB full;
+    ASSERT_TRUE(full_parse(file_name, full));
+
+    Pb_mmap pb(file_name);
+    ASSERT_TRUE(pb.is_valid());
+
+    int              n_circuits = 0;
+    Pb_walker        top(pb.get_buffer());
+    uint32_t         field;
+    std::string_view circuit_data;
+    while (top.next(field, circuit_data)) {
+      if (field != 1)  // FirrtlPB.circuit
+        continue;
+      ASSERT_LT(n_circuits, full.circuit_size());
+      const auto &full_circuit = full.circuit(n_circuits++);
+
+      int              n_mods = 0;
+      Pb_walker        circuit(circuit_data);
+      std::string_view mod_data;
+      while (circuit.next(field, mod_data)) {
+        if (field != 1)  // Circuit.module
+          continue;
+        ASSERT_LT(n_mods, full_circuit.module_size());
+        const auto &full_mod = full_circuit.module(n_mods++);
+
+        google::protobuf::Arena arena;
+        auto *io_mod = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+        ASSERT_TRUE(parse_module_io(io_mod, mod_data));
+        check_module_io(full_mod, *io_mod);
+
+        auto *stream_mod = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+        ASSERT_TRUE(parse_pb(stream_mod, mod_data));
+        EXPECT_EQ(full_mod.SerializeAsString(), stream_mod->SerializeAsString());
+      }
+      EXPECT_TRUE(circuit.is_ok());
+      EXPECT_EQ(n_mods, full_circuit.module_size());
+    }
+    EXPECT_TRUE(top.is_ok());
+    EXPECT_EQ(n_circuits, full.circuit_size());
+  }
+}
+
+TEST_F(Fir_tolnast_stream_test, truncated) {
+  auto files = get_pb_files();
+  ASSERT_FALSE(files.empty());
+
+  Pb_mmap pb(files.front());
+  ASSERT_TRUE(pb.is_valid());
+
+  auto buf = pb.get_buffer();
+  buf.remove_suffix(1);  // the last circuit is cut
+
+  Pb_walker        top(buf);
+  uint32_t         field;
+  std::string_view data;
+  while (top.next(field, data)) {
+  }
+  EXPECT_FALSE(top.is_ok());
+}
@@ -0,0 +1,42 @@
+#!/bin/bash
+# inou.firrtl.tolnast must produce the same LNASTs (same order) for any
+# number of threads.
+rm -rf ./lgdb
+pts='Adder4 SubModule ICache RocketCore Router MemoryController Life MaxN'
+
+LGSHELL=./bazel-bin/main/lgshell
+PATTERN_PATH=./inou/firrtl/tests/proto
+
+if [ ! -f $LGSHELL ]; then
+    if [ -f ./main/lgshell ]; then
+        LGSHELL=./main/lgshell
+        echo "lgshell is in $(pwd)"
+    else
+        echo "ERROR: could not find lgshell binary in $(pwd)";
+        exit 1
+    fi
+fi
+
+for pt in $pts
+do
+    for th in 1 4
+    do
+        rm -rf ./lgdb
+        ${LGSHELL} "inou.firrtl.tolnast files:${PATTERN_PATH}/${pt}.lo.pb threads:${th} |> lnast.dump" > ${pt}.threads${th}.txt
+        if [ $? -ne 0 ]; then
+            echo "ERROR: FIRRTL -> LNAST failed for ${pt} with threads:${th}"
+            exit 1
+        fi
+    done
+
+    diff -q ${pt}.threads1.txt ${pt}.threads4.txt
+    if [ $? -ne 0 ]; then
+        echo "FAIL: ${pt} LNAST differs between threads:1 and threads:4"
+        exit 1
+    fi
+    echo "Successfully matched serial and parallel LNAST: ${pt}"
+
+    rm -f ${pt}.threads*.txt
+done
+
+rm -rf ./lgdb
@@ -13,6 +13,7 @@ void setup_inou_pyrope() { Inou_pyrope::setup(); }
 void Inou_pyrope::setup() {
   Eprp_method m1("inou.pyrope", "Parse the input file and convert to an LNAST", &Inou_pyrope::parse_to_lnast);
   m1.add_label_required("files", "pyrope files to process (comma separated)");
+  m1.set_streamable();
 
   register_pass(m1);
 }
@@ -15,7 +15,7 @@ inline void Prp::eat_comments() {
   }
 }
 
-uint8_t Prp::rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_start(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_start.");
 
   eat_comments();
@@ -30,7 +30,7 @@ uint8_t Prp::rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_SUCCESS("Matched rule_start.\n", Prp_rule_start);
 }
 
-uint8_t Prp::rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_code_blocks(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_code_blocks.");
 
   if (!CHECK_RULE(&Prp::rule_code_block_int)) {
@@ -57,7 +57,7 @@ uint8_t Prp::rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_
   RULE_SUCCESS("Matched rule_code_blocks.\n", Prp_rule_code_blocks);
 }
 
-uint8_t Prp::rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_code_block_int(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_code_block_int.");
 
   check_lb();
@@ -92,7 +92,7 @@ uint8_t Prp::rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_FAILED("Failed rule_code_block_int.\n");
 }
 
-uint8_t Prp::rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_if_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_if_statement.");
 
   // optional
@@ -130,7 +130,7 @@ uint8_t Prp::rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass
   RULE_SUCCESS("Matched rule_if_statement (with condition).\n", Prp_rule_if_statement);
 }
 
-uint8_t Prp::rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_for_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_for)) {
@@ -151,7 +151,7 @@ uint8_t Prp::rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // NOTE: modified from PEGjs grammar: range notation now allowed.
-uint8_t Prp::rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_in_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_in_notation.");
 
   if (!CHECK_RULE(&Prp::rule_identifier)) {
@@ -167,7 +167,7 @@ uint8_t Prp::rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_in_notation.\n", Prp_rule_for_in_notation);
 }
 
-uint8_t Prp::rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_index(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_for_index.");
 
   if (!CHECK_RULE(&Prp::rule_for_in_notation)) {
@@ -208,7 +208,7 @@ uint8_t Prp::rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_li
   RULE_SUCCESS("Matched rule_for_index.\n", Prp_rule_for_index);
 }
 
-uint8_t Prp::rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_else_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_else_statement.");
 
   // option 1
@@ -246,7 +246,7 @@ uint8_t Prp::rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_else_statement.\n", Prp_rule_else_statement);
 }
 
-uint8_t Prp::rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_while_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_while_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_while)) {
@@ -266,7 +266,7 @@ uint8_t Prp::rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Failed rule_while_statement; couldn't find a while token.\n", Prp_rule_while_statement);
 }
 
-uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_try_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_try_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_try, Prp_rule_try_statement)) {
@@ -293,7 +293,7 @@ uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // TODO: check correctness of scanner with ASSERTION token ("I")
-/*uint8_t Prp::rule_assertion_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_assertion_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assertion_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_assertion, Prp_rule_assertion_statement)) {
@@ -308,7 +308,7 @@ uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // TODO: check correctness of scanner with NEGATION token ("N")
-uint8_t Prp::rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_negation_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_negation_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_negation)) {
@@ -322,7 +322,7 @@ uint8_t Prp::rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_logical_expression.\n", Prp_rule_negation_statement);
 }*/
 
-uint8_t Prp::rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_empty_scope_colon(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_empty_scope_colon.");
 
   check_ws();
@@ -343,7 +343,7 @@ uint8_t Prp::rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_empty_scope_colon.\n", Prp_rule_empty_scope_colon);
 }
 
-uint8_t Prp::rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_else(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_else.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_else, Prp_rule_scope_else)) {
@@ -367,7 +367,7 @@ uint8_t Prp::rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
 }
 
 // WARNING: this rule was modified to look more like block_body
-uint8_t Prp::rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_body(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_body.");
 
   // option 1 and 2 - logical expression inside only or just a closing brace
@@ -406,7 +406,7 @@ uint8_t Prp::rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
   RULE_SUCCESS("Matched rule_scope_body (option 3).\n", Prp_rule_scope_body);
 }
 
-uint8_t Prp::rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope.");
 
   if (SCAN_IS_TOKEN(Token_id_colon, Prp_rule_scope)) {
@@ -424,7 +424,7 @@ uint8_t Prp::rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_FAILED("Failed rule_scope; generic.\n");
 }
 
-uint8_t Prp::rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_condition(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_condition.");
 
   // optional
@@ -433,7 +433,7 @@ uint8_t Prp::rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_scope_condition.\n", Prp_rule_scope_condition);
 }
 
-uint8_t Prp::rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_colon(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_colon.");
 
   check_ws();
@@ -460,7 +460,7 @@ uint8_t Prp::rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_
   RULE_SUCCESS("Matched rule_scope_colon.\n", Prp_rule_scope_colon);
 }
 
-uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_argument(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_argument.");
   if (!CHECK_RULE(&Prp::rule_fcall_arg_notation)) {
     RULE_FAILED("Failed rule_scope_argument; couldn't find an fcall_arg_notation.\n");
@@ -469,7 +469,7 @@ uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_scope_argument.\n", Prp_rule_scope_argument);
 }
 
-/*uint8_t Prp::rule_punch_format(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_punch_format(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_punch_format.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_punch)) {
@@ -489,7 +489,7 @@ uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_punch_format.\n", Prp_rule_punch_format);
 }*/
 
-uint8_t Prp::rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_declaration(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_declaration.");
 
   if (!CHECK_RULE(&Prp::rule_scope)) {
@@ -520,7 +520,7 @@ uint8_t Prp::rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_scope_declaration.\n", Prp_rule_scope_declaration);
 }
 
-uint8_t Prp::rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_punch_rhs(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_punch_rhs.");
 
   if (!SCAN_IS_TOKEN(Token_id_div)) {
@@ -567,7 +567,7 @@ uint8_t Prp::rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_li
   RULE_SUCCESS("Matched rule_punch_rhs.\n", Prp_rule_punch_rhs);
 }
 
-uint8_t Prp::rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_function_pipe(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_function_pipe.");
 
   check_ws();
@@ -602,7 +602,7 @@ uint8_t Prp::rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_function_pipe.\n", Prp_rule_function_pipe);
 }
 
-uint8_t Prp::rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_explicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_explicit.");
 
   INIT_PSEUDO_FAIL();
@@ -649,7 +649,7 @@ uint8_t Prp::rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_fcall_explicit", Prp_rule_fcall_explicit);
 }
 
-uint8_t Prp::rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_arg_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_arg_notation.");
 
   if (!SCAN_IS_TOKEN(Token_id_op, Prp_rule_fcall_arg_notation)) {
@@ -692,7 +692,7 @@ uint8_t Prp::rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_fcall_arg_notation.\n", Prp_rule_fcall_arg_notation);
 }
 
-uint8_t Prp::rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_implicit_start(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_implicit_start.");
 
   // option 1
@@ -747,7 +747,7 @@ uint8_t Prp::rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry
   RULE_SUCCESS("Matched rule_fcall_implicit.\n", Prp_rule_fcall_implicit);
 }
 
-uint8_t Prp::rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_implicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_implicit.");
 
   if (CHECK_RULE(&Prp::rule_constant)) {
@@ -785,7 +785,7 @@ uint8_t Prp::rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_fcall_implicit.\n", Prp_rule_fcall_implicit);
 }
 
-uint8_t Prp::rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_not_in_implicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_not_in_implicit");
 
   if (SCAN_IS_TOKEN(Token_id_colon)) {
@@ -855,7 +855,7 @@ uint8_t Prp::rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_FAILED("Failed rule_not_in_implicit.\n");
 }
 
-uint8_t Prp::rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_assignment_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assignment_expression.");
 
   if (CHECK_RULE(&Prp::rule_constant)) {
@@ -891,7 +891,7 @@ uint8_t Prp::rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_assignment_expression.\n", Prp_rule_assignment_expression);
 }
 
-uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_return_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_return_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_return)) {
@@ -904,7 +904,7 @@ uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_return_statement.\n", Prp_rule_return_statement);
 }
 
-/*uint8_t Prp::rule_compile_check_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_compile_check_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_compile_check_statement.");
 
   if (!scan_is_token(Token_id_pound)) {
@@ -917,7 +917,7 @@ uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_compile_check_statement.\n", Prp_rule_compile_check_statement);
 }*/
 
-uint8_t Prp::rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_block_body(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_block_body.\n");
 
   // optional
@@ -933,7 +933,7 @@ uint8_t Prp::rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
   RULE_SUCCESS("Matched rule_block_body.\n", Prp_rule_block_body);
 }
 
-uint8_t Prp::rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_lhs_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_lhs_expression.");
 
   if (SCAN_IS_TOKEN(Token_id_backslash)) {
@@ -950,7 +950,7 @@ uint8_t Prp::rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_lhs_expression.\n", Prp_rule_lhs_expression);
 }
 
-uint8_t Prp::rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_notation.");
 
   // options 1 and 2
@@ -1011,7 +1011,7 @@ uint8_t Prp::rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_tuple_notation; fourth option.\n", Prp_rule_tuple_notation);
 }
 
-uint8_t Prp::rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_range_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_range_notation.");
 
   // optional
@@ -1033,7 +1033,7 @@ uint8_t Prp::rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_range_notation.\n", Prp_rule_range_notation);
 }
 
-uint8_t Prp::rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bit_selection_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_bit_selection_notation.");
 
   if (!CHECK_RULE(&Prp::rule_tuple_dot_notation)) {
@@ -1046,7 +1046,7 @@ uint8_t Prp::rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_ent
   RULE_SUCCESS("Matched rule_bit_selection_notation.\n", Prp_rule_bit_selection_notation);
 }
 
-uint8_t Prp::rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_dot_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_dot_notation.");
 
   if (!CHECK_RULE(&Prp::rule_tuple_array_notation)) {
@@ -1059,7 +1059,7 @@ uint8_t Prp::rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_tuple_dot_notation.\n", Prp_rule_tuple_dot_notation);
 }
 
-uint8_t Prp::rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_dot_dot(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_dot_dot.");
   bool next = true;
 
@@ -1083,7 +1083,7 @@ uint8_t Prp::rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_tuple_dot_dot\n", Prp_rule_tuple_dot_dot);
 }
 
-uint8_t Prp::rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_array_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_array_notation.");
 
   if (!CHECK_RULE(&Prp::rule_lhs_var_name)) {
@@ -1096,7 +1096,7 @@ uint8_t Prp::rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry
   RULE_SUCCESS("Matched rule_tuple_array_notation.\n", Prp_rule_tuple_array_notation);
 }
 
-uint8_t Prp::rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_lhs_var_name(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_lhs_var_name.");
 
   if (!(CHECK_RULE(&Prp::rule_identifier) || CHECK_RULE(&Prp::rule_constant))) {
@@ -1106,7 +1106,7 @@ uint8_t Prp::rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass
   RULE_SUCCESS("Matched rule_lhs_var_name.\n", Prp_rule_lhs_var_name);
 }
 
-uint8_t Prp::rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_array_bracket(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_array_bracket.");
 
   bool next = true;
@@ -1131,7 +1131,7 @@ uint8_t Prp::rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>
   RULE_SUCCESS("Matched rule_tuple_array_bracket.\n", Prp_rule_tuple_array_bracket);
 }
 
-uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_identifier(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_identifier.");
 
   if (CHECK_RULE(&Prp::rule_keyword)) {
@@ -1153,17 +1153,17 @@ uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
     if (SCAN_IS_TOKEN(Token_id_bang, Prp_rule_reference)) {
       SCAN_IS_TOKEN(Token_id_bang, Prp_rule_reference);
       if (op) {
-        loc_list.emplace(std::next(loc_list.begin()), 0, 0);
+        loc_list.emplace_at(1, 0, 0);
       } else {
-        loc_list.emplace(loc_list.begin(), 0, 0);
+        loc_list.emplace_front(0, 0);
       }
       loc_list.emplace_back(Prp_rule_reference, 0);
     }
   } else {
     if (op) {
-      loc_list.emplace(std::next(loc_list.begin()), 0, 0);
+      loc_list.emplace_at(1, 0, 0);
     } else {
-      loc_list.emplace(loc_list.begin(), 0, 0);
+      loc_list.emplace_front(0, 0);
     }
     loc_list.emplace_back(Prp_rule_reference, 0);
   }
@@ -1172,7 +1172,7 @@ uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
 }
 
 // some rules want there to not be a constant; in this case, we don't want AST changes or tokens consumed if the rule is matched.
-uint8_t Prp::rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_constant");
 
   // option 1 - numerical constant
@@ -1194,7 +1194,7 @@ uint8_t Prp::rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_lis
   RULE_FAILED("Failed rule_constant.\n", Prp_rule_constant);
 }
 
-uint8_t Prp::rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_numerical_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_numerical_constant.");
 
   SCAN_IS_TOKEN(Token_id_minus, Prp_rule_numerical_constant);
@@ -1207,7 +1207,7 @@ uint8_t Prp::rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>>
 }
 
 // TODO: add support for single tick strings
-uint8_t Prp::rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_string_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_string_constant.");
 
   // option 1: double " string
@@ -1230,7 +1230,7 @@ uint8_t Prp::rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &p
         next = false;
       } else {  // WARNING: unfortunately, since we cannot easily make SCAN_IS_TOKEN match and add any token to the list, we need
                 // this extra code here.
-        loc_list.push_back(std::make_tuple(Prp_rule_string_constant, scan_token()));
+        loc_list.emplace_back(Prp_rule_string_constant, scan_token());
         sub_cnt++;
         consume_token();
       }
@@ -1240,7 +1240,7 @@ uint8_t Prp::rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_string_constant.\n", Prp_rule_string_constant);
 }
 
-uint8_t Prp::rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_assignment_operator(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assignment_operator.");
 
 #ifdef DEBUG_AST
@@ -1304,7 +1304,7 @@ uint8_t Prp::rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>
   RULE_FAILED("Failed rule_assignment_operator; couldn't find any of the operators.\n");
 }
 
-uint8_t Prp::rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_by_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_by_notation.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_by)) {
@@ -1317,7 +1317,7 @@ uint8_t Prp::rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_tuple_by_notation.\n", Prp_rule_tuple_by_notation);
 }
 
-uint8_t Prp::rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bit_selection_bracket(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_bit_selection_bracket.");
 
   bool next = true;
@@ -1348,7 +1348,7 @@ uint8_t Prp::rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_bit_selection_bracket.\n", Prp_rule_bit_selection_bracket);
 }
 
-uint8_t Prp::rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_logical_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_logical_expression.");
 
   if (!CHECK_RULE(&Prp::rule_relational_expression)) {
@@ -1386,7 +1386,7 @@ uint8_t Prp::rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_logical_expression.\n", Prp_rule_logical_expression);
 }
 
-uint8_t Prp::rule_relational_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_relational_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_relational_expression.");
 
   if (!CHECK_RULE(&Prp::rule_additive_expression)) {
@@ -1422,7 +1422,7 @@ uint8_t Prp::rule_relational_expression(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_relational_expression.\n", Prp_rule_relational_expression);
 }
 
-uint8_t Prp::rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_additive_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_additive_expression.");
 
   if (!CHECK_RULE(&Prp::rule_unary_expression)) {
@@ -1503,7 +1503,7 @@ uint8_t Prp::rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>
   RULE_SUCCESS("Matched rule_additive_expression.\n", Prp_rule_additive_expression);
 }
 
-uint8_t Prp::rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bitwise_expression(Prp_event_list &pass_list) {
   fmt::print("BITWISE EXPRESSION RULE CURRENTLY UNUSED. THERE IS A BUG. EXITING...\n");
   exit(1);
   INIT_FUNCTION("rule_bitwise_expression.");
@@ -1542,7 +1542,7 @@ uint8_t Prp::rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_bitwise_expression.\n", Prp_rule_bitwise_expression);
 }
 
-uint8_t Prp::rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_multiplicative_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_multiplicative_expression.");
 
   if (!CHECK_RULE(&Prp::rule_unary_expression)) {
@@ -1579,7 +1579,7 @@ uint8_t Prp::rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_
   RULE_SUCCESS("Matched rule_multiplicative_expression.\n", Prp_rule_multiplicative_expression);
 }
 
-uint8_t Prp::rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_unary_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_unary_expression.");
 
   // option 1
@@ -1596,7 +1596,7 @@ uint8_t Prp::rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_unary_expression, option 2.\n", Prp_rule_unary_expression);
 }
 
-uint8_t Prp::rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_factor(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_factor.");
 
   // option 1
@@ -1633,7 +1633,7 @@ uint8_t Prp::rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_SUCCESS("Matched rule_factor; option 2.\n", Prp_rule_factor);
 }
 
-uint8_t Prp::rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_notation.");
 
   if (!SCAN_IS_TOKEN(Token_id_dot, Prp_rule_overload_notation)) {
@@ -1656,7 +1656,7 @@ uint8_t Prp::rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>>
 }
 
 // WARNING: not sure how this behaves when we aren't explicitly looking for a line terminator
-uint8_t Prp::rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_name(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_name.");
 
   if (!CHECK_RULE(&Prp::rule_overload_exception)) {
@@ -1694,7 +1694,7 @@ uint8_t Prp::rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_overload_name.\n", Prp_rule_overload_name);
 }
 
-uint8_t Prp::rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_exception(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_exception.\n");
 
   Token_id toks[] = {Token_id_dot,
@@ -1722,7 +1722,7 @@ uint8_t Prp::rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_FAILED("Failed rule_overload_exception; couldn't find an excepting character.\n");
 }
 
-uint8_t Prp::rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_rhs_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_rhs_expression.");
 
   if (!(CHECK_RULE(&Prp::rule_fcall_explicit) || CHECK_RULE(&Prp::rule_lhs_expression)
@@ -1733,7 +1733,7 @@ uint8_t Prp::rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_rhs_expression.\n", Prp_rule_rhs_expression);
 }
 
-uint8_t Prp::rule_keyword(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_keyword(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_keyword");
 
   Token_id toks[]
@@ -1827,7 +1827,12 @@ void Prp::elaborate() {
   PRINT_DBG_AST("RULE AND AST CALL TRACE \n\n");
 
   ast = std::make_unique<Ast_parser>(get_memblock(), Prp_rule);
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list;
+
+  // A few events per token (rule down/up plus the token). Reserve once so that
+  // the backtracking does not reallocate in most files.
+  parse_events.clear();
+  parse_events.reserve(4 * token_list.size() + 64);
+  Prp_event_list loc_list(parse_events);
   gen_ws_map();
 
   int      failed  = 0;
@@ -1965,7 +1970,7 @@ void Prp::ast_handler() {
   }
 }
 
-void Prp::ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list) {
+void Prp::ast_builder(Prp_event_list &passed_list) {
   for (auto it = passed_list.begin(); it != passed_list.end(); ++it) {
     auto ast_op  = *it;
     auto rule_id = std::get<0>(ast_op);
@@ -1987,7 +1992,7 @@ void Prp::ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list)
   }
 }
 
-uint8_t Prp::check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, Token_entry>> &), uint64_t *sub_cnt, std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+uint8_t Prp::check_function(uint8_t (Prp::*rule)(Prp_event_list &), uint64_t *sub_cnt, Prp_event_list &loc_list) {
   PRINT_DBG_AST("Called check_function.\n");
   uint64_t starting_size = loc_list.size();
   uint8_t  ret           = (this->*rule)(loc_list);
@@ -2003,7 +2008,7 @@ uint8_t Prp::check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, T
   return ret;
 }
 
-bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, Prp_event_list &loc_list) {
   // PRINT_DBG_AST("Checking  token {} from rule {}.\n", scan_text(scan_token()), rule_id_to_string(rid));
   if (tok != TOKEN_ID_ANY) {
     if (!scan_is_token(tok))
@@ -2024,9 +2029,9 @@ bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::lis
 
   uint8_t allowed_ws_before = false;
   uint8_t allowed_ws_after  = false;
-  if (ws_map.find(tok) != ws_map.end()) {
-    allowed_ws_after  = ws_map[tok];
-    allowed_ws_before = (ws_map[tok] >> 8);
+  if (auto ws_it = ws_map.find(tok); ws_it != ws_map.end()) {
+    allowed_ws_after  = ws_it->second;
+    allowed_ws_before = (ws_it->second >> 8);
     PRINT_DBG_AST("Token {}: ws before = {}, ws after = {}.\n", scan_text(scan_token()), allowed_ws_before, allowed_ws_after);
   }
 
@@ -2052,7 +2057,7 @@ bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::lis
   }
   if (scan_line() == cur_line) {
     if (rid != Prp_invalid) {
-      loc_list.push_back(std::tuple<Rule_id, Token_entry>(rid, scan_token()));
+      loc_list.emplace_back(rid, scan_token());
       (*sub_cnt)++;
       PRINT_DBG_AST("chk_and_consume: incremented sub_cnt to {}\n", *sub_cnt);
     }
@@ -2091,7 +2096,7 @@ bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::lis
 }
 
 bool Prp::chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid, uint64_t *sub_cnt,
-                                  std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+                                  Prp_event_list &loc_list) {
   PRINT_DBG_AST("Checking many tokens from rule {}.\n", rule_id_to_string(rid));
   bool found = false;
   int  i;
@@ -2118,9 +2123,9 @@ bool Prp::chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid,
 
   uint8_t allowed_ws_before = false;
   uint8_t allowed_ws_after  = false;
-  if (ws_map.find(toks[i]) != ws_map.end()) {
-    allowed_ws_after  = ws_map[toks[i]];
-    allowed_ws_before = (ws_map[toks[i]] >> 8);
+  if (auto ws_it = ws_map.find(toks[i]); ws_it != ws_map.end()) {
+    allowed_ws_after  = ws_it->second;
+    allowed_ws_before = (ws_it->second >> 8);
     PRINT_DBG_AST("Token {}: ws before = {}, ws after = {}.\n", scan_text(scan_token()), allowed_ws_before, allowed_ws_after);
   }
 
@@ -2146,7 +2151,7 @@ bool Prp::chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid,
   }
   if (scan_line() == cur_line) {
     if (rid != Prp_invalid) {
-      loc_list.push_back(std::tuple<Rule_id, Token_entry>(rid, scan_token()));
+      loc_list.emplace_back(rid, scan_token());
       (*sub_cnt)++;
       PRINT_DBG_AST("chk_and_consume_options: incremented sub_cnt to {}\n", *sub_cnt);
     }
@@ -2248,7 +2253,7 @@ std::string Prp::rule_id_to_string(Rule_id rid) {
 }
 
 #ifdef DEBUG_AST
-inline void Prp::print_loc_list(std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+inline void Prp::print_loc_list(Prp_event_list &loc_list) {
   int i = 0;
   for (auto it = loc_list.begin(); it != loc_list.end(); it++) {
     PRINT_DBG_AST("loc_list[{}]:rule: {} token: {}.\n", i++, rule_id_to_string(std::get<0>(*it)), scan_text(std::get<1>(*it)));
@@ -5,6 +5,7 @@
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -69,14 +70,14 @@
   auto                                        starting_line   = cur_line;        \
   auto                                        starting_pos    = cur_pos;         \
   uint64_t                                    sub_cnt         = 0;               \
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list
+  Prp_event_list                              loc_list(parse_events)
 #else
 #define INIT_FUNCTION(...)                                                       \
   auto                                        starting_tokens = tokens_consumed; \
   auto                                        starting_line   = cur_line;        \
   auto                                        starting_pos    = cur_pos;         \
   uint64_t                                    sub_cnt         = 0;               \
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list
+  Prp_event_list                              loc_list(parse_events)
 #endif
 
 #ifdef DEBUG_AST
@@ -112,10 +113,10 @@
   fmt::print("Rule {} had a sub_cnt of {}.\n", rule_id_to_string(rule), sub_cnt);                                       \
   if (sub_cnt > 1) {                                                                                                    \
     fmt::print("Had a subtree of at least size two in rule {} it was of size {}.\n", rule_id_to_string(rule), sub_cnt); \
-    loc_list.push_front(std::make_tuple(0, 0));                                                                         \
-    loc_list.push_back(std::make_tuple(rule, 0));                                                                       \
+    loc_list.emplace_front(0, 0);                                                                                       \
+    loc_list.emplace_back(rule, 0);                                                                                     \
   }                                                                                                                     \
-  pass_list.splice(pass_list.end(), loc_list);                                                                          \
+  pass_list.splice_back(loc_list);                                                                                      \
   return true
 #else
 #define RULE_SUCCESS(message, rule)            \
@@ -123,7 +124,7 @@
     loc_list.emplace_front(0, 0);              \
     loc_list.emplace_back(rule, 0);            \
   }                                            \
-  pass_list.splice(pass_list.end(), loc_list); \
+  pass_list.splice_back(loc_list);             \
   return true
 #endif
 
@@ -197,6 +198,72 @@ constexpr Token_id Pyrope_id_then = 159;
 // any token
 #define TOKEN_ID_ANY 255
 
+// Parse event: (0, 0) goes down a level, (rule, 0) goes up closing the rule,
+// and (rule, token) adds a token.
+using Prp_event = std::tuple<Rule_id, Token_entry>;
+
+// Window of events at the top of the parse_events buffer. Each rule appends
+// its events to its own window, so the buffer grows like a stack and the
+// backtracking is a resize (no per event allocation like the old std::list).
+//
+// A window that is not spliced into its parent (failed rule) drops its events
+// when it goes out of scope.
+class Prp_event_list {
+protected:
+  std::vector<Prp_event> &buffer;
+  const size_t            start;
+  bool                    kept = false;
+
+public:
+  explicit Prp_event_list(std::vector<Prp_event> &_buffer) : buffer(_buffer), start(_buffer.size()) {}
+
+  Prp_event_list(const Prp_event_list &) = delete;
+  Prp_event_list &operator=(const Prp_event_list &) = delete;
+
+  ~Prp_event_list() {
+    if (!kept)
+      buffer.resize(start);
+  }
+
+  size_t size() const {
+    I(buffer.size() >= start);
+    return buffer.size() - start;
+  }
+  bool empty() const { return size() == 0; }
+
+  void emplace_back(Rule_id rid, Token_entry te) { buffer.emplace_back(rid, te); }
+  void push_back(const Prp_event &ev) { buffer.push_back(ev); }
+  void pop_back() {
+    I(!empty());
+    buffer.pop_back();
+  }
+
+  // Inserts move the rest of the window. Only used for the rule wrappers
+  // (emplace_front), and those windows are small.
+  void emplace_at(size_t pos, Rule_id rid, Token_entry te) {
+    I(pos <= size());
+    buffer.emplace(buffer.begin() + start + pos, rid, te);
+  }
+  void emplace_front(Rule_id rid, Token_entry te) { emplace_at(0, rid, te); }
+
+  // Only shrinks (backtrack to a previous size)
+  void resize(size_t sz) {
+    I(sz <= size());
+    buffer.resize(start + sz);
+  }
+
+  // The child window is at the top of this one, keeping its events moves them
+  void splice_back(Prp_event_list &child) {
+    I(&child.buffer == &buffer && child.start >= start);
+    child.kept = true;
+  }
+
+  std::vector<Prp_event>::iterator       begin() { return buffer.begin() + start; }
+  std::vector<Prp_event>::iterator       end() { return buffer.end(); }
+  std::vector<Prp_event>::const_iterator begin() const { return buffer.begin() + start; }
+  std::vector<Prp_event>::const_iterator end() const { return buffer.end(); }
+};
+
 class Prp : public Elab_scanner {
 protected:
   struct debug_statistics {
@@ -225,72 +292,74 @@ protected:
   std::vector<std::string>                   rule_call_stack;
   uint64_t                 term_token = 1;
 
+  std::vector<Prp_event> parse_events;  // reused across the rules (and parses), see Prp_event_list
+
   void elaborate();
 
-  uint8_t rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_punch_format(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_relational_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation_no_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation_with_object(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_rhs_expression_property(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_reference(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_compile_check_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assertion_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_keyword(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
+  uint8_t rule_start(Prp_event_list &pass_list);
+  uint8_t rule_code_blocks(Prp_event_list &pass_list);
+  uint8_t rule_code_block_int(Prp_event_list &pass_list);
+  uint8_t rule_if_statement(Prp_event_list &pass_list);
+  uint8_t rule_else_statement(Prp_event_list &pass_list);
+  uint8_t rule_for_statement(Prp_event_list &pass_list);
+  uint8_t rule_while_statement(Prp_event_list &pass_list);
+  uint8_t rule_try_statement(Prp_event_list &pass_list);
+  uint8_t rule_punch_format(Prp_event_list &pass_list);
+  uint8_t rule_function_pipe(Prp_event_list &pass_list);
+  uint8_t rule_fcall_explicit(Prp_event_list &pass_list);
+  uint8_t rule_fcall_implicit_start(Prp_event_list &pass_list);
+  uint8_t rule_fcall_implicit(Prp_event_list &pass_list);
+  uint8_t rule_for_index(Prp_event_list &pass_list);
+  uint8_t rule_assignment_expression(Prp_event_list &pass_list);
+  uint8_t rule_logical_expression(Prp_event_list &pass_list);
+  uint8_t rule_relational_expression(Prp_event_list &pass_list);
+  uint8_t rule_additive_expression(Prp_event_list &pass_list);
+  uint8_t rule_bitwise_expression(Prp_event_list &pass_list);
+  uint8_t rule_multiplicative_expression(Prp_event_list &pass_list);
+  uint8_t rule_unary_expression(Prp_event_list &pass_list);
+  uint8_t rule_factor(Prp_event_list &pass_list);
+  uint8_t rule_tuple_by_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation_no_bracket(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation_with_object(Prp_event_list &pass_list);
+  uint8_t rule_range_notation(Prp_event_list &pass_list);
+  uint8_t rule_bit_selection_bracket(Prp_event_list &pass_list);
+  uint8_t rule_bit_selection_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_array_bracket(Prp_event_list &pass_list);
+  uint8_t rule_tuple_array_notation(Prp_event_list &pass_list);
+  uint8_t rule_lhs_expression(Prp_event_list &pass_list);
+  uint8_t rule_lhs_var_name(Prp_event_list &pass_list);
+  uint8_t rule_rhs_expression_property(Prp_event_list &pass_list);
+  uint8_t rule_rhs_expression(Prp_event_list &pass_list);
+  uint8_t rule_identifier(Prp_event_list &pass_list);
+  uint8_t rule_reference(Prp_event_list &pass_list);
+  uint8_t rule_constant(Prp_event_list &pass_list);
+  uint8_t rule_assignment_operator(Prp_event_list &pass_list);
+  uint8_t rule_tuple_dot_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_dot_dot(Prp_event_list &pass_list);
+  uint8_t rule_overload_notation(Prp_event_list &pass_list);
+  uint8_t rule_overload_name(Prp_event_list &pass_list);
+  uint8_t rule_overload_exception(Prp_event_list &pass_list);
+  uint8_t rule_scope_else(Prp_event_list &pass_list);
+  uint8_t rule_scope_body(Prp_event_list &pass_list);
+  uint8_t rule_scope_declaration(Prp_event_list &pass_list);
+  uint8_t rule_scope(Prp_event_list &pass_list);
+  uint8_t rule_scope_condition(Prp_event_list &pass_list);
+  uint8_t rule_scope_argument(Prp_event_list &pass_list);
+  uint8_t rule_punch_rhs(Prp_event_list &pass_list);
+  uint8_t rule_fcall_arg_notation(Prp_event_list &pass_list);
+  uint8_t rule_return_statement(Prp_event_list &pass_list);
+  uint8_t rule_compile_check_statement(Prp_event_list &pass_list);
+  uint8_t rule_block_body(Prp_event_list &pass_list);
+  uint8_t rule_empty_scope_colon(Prp_event_list &pass_list);
+  uint8_t rule_assertion_statement(Prp_event_list &pass_list);
+  uint8_t rule_negation_statement(Prp_event_list &pass_list);
+  uint8_t rule_scope_colon(Prp_event_list &pass_list);
+  uint8_t rule_numerical_constant(Prp_event_list &pass_list);
+  uint8_t rule_string_constant(Prp_event_list &pass_list);
+  uint8_t rule_for_in_notation(Prp_event_list &pass_list);
+  uint8_t rule_not_in_implicit(Prp_event_list &pass_list);
+  uint8_t rule_keyword(Prp_event_list &pass_list);
 
   inline void check_lb();
   inline void check_ws();
@@ -303,17 +372,17 @@ protected:
   bool        go_back(uint64_t num_tok);
   std::string rule_id_to_string(Rule_id rid);
 
-  uint8_t check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, Token_entry>> &), uint64_t *sub_cnt,
-                         std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
-  bool    chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+  uint8_t check_function(uint8_t (Prp::*rule)(Prp_event_list &), uint64_t *sub_cnt,
+                         Prp_event_list &loc_list);
+  bool    chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, Prp_event_list &loc_list);
   bool    chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid, uint64_t *sub_cnt,
-                                  std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+                                  Prp_event_list &loc_list);
 
   void ast_handler();
-  void ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list);
+  void ast_builder(Prp_event_list &passed_list);
 
 #ifdef DEBUG_AST
-  void print_loc_list(std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+  void print_loc_list(Prp_event_list &loc_list);
   void print_rule_call_stack();
 #endif
 
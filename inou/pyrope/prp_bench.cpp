@@ -0,0 +1,67 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Parse throughput (tokens/sec and MB/sec) of the Pyrope parser over a set of
+// files (e.g: inou/pyrope/tests/*.prp). Each file is parsed several times, the
+// scanner is created per parse like inou.pyrope does.
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "prp.hpp"
+
+using namespace std::chrono;
+
+class Prp_bench : public Prp {
+public:
+  size_t get_n_tokens() const { return token_list.size(); }
+  size_t get_n_bytes() const { return get_memblock().size(); }
+};
+
+int main(int argc, char **argv) {
+  int                      n_iter = 10;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg(argv[i]);
+    if (arg == "-n" && i + 1 < argc) {
+      if (!absl::SimpleAtoi(argv[++i], &n_iter) || n_iter <= 0) {
+        fmt::print("invalid iteration count {}\n", argv[i]);
+        exit(1);
+      }
+      continue;
+    }
+    files.emplace_back(arg);
+  }
+
+  if (files.empty()) {
+    fmt::print("Usage: {} [-n iterations] file.prp...\n", argv[0]);
+    exit(1);
+  }
+
+  size_t n_tokens = 0;
+  size_t n_bytes  = 0;
+
+  auto start = high_resolution_clock::now();
+  {
+    Lbench b("inou.PYROPE_prp_bench");
+    for (int i = 0; i < n_iter; ++i) {
+      for (const auto &f : files) {
+        Prp_bench scanner;
+        scanner.parse_file(f);
+        n_tokens += scanner.get_n_tokens();
+        n_bytes += scanner.get_n_bytes();
+      }
+    }
+  }
+  auto   stop = high_resolution_clock::now();
+  double secs = duration_cast<microseconds>(stop - start).count() / 1e6;
+
+  fmt::print("prp_bench files:{} iterations:{} tokens:{} bytes:{} secs:{:.3f}\n", files.size(), n_iter, n_tokens, n_bytes, secs);
+  fmt::print("prp_bench {:.2f} Mtokens/s {:.2f} MB/s\n", n_tokens / secs / 1e6, n_bytes / secs / 1e6);
+
+  return 0;
+}
@@ -551,7 +551,7 @@ void Prp_lnast::eval_if_statement(mmap_lib::Tree_index idx_start_ast, mmap_lib::
       return;
     }
 
-    std::list<Lnast_node> cond_nodes;
+    std::deque<Lnast_node> cond_nodes;
     // loop over the if tree and evaluate conditions
 
     idx_nxt_ast            = ast->get_sibling_next(idx_nxt_ast);
@@ -715,7 +715,7 @@ Lnast_node Prp_lnast::eval_tuple(mmap_lib::Tree_index idx_start_ast, mmap_lib::T
     }
   }
 
-  std::list<std::array<Lnast_node, 3>> tuple_nodes;
+  std::vector<std::array<Lnast_node, 3>> tuple_nodes;
   evaluate_all_tuple_nodes(idx_tuple_not_root, idx_pre_tuple_vals, idx_post_tuple_vals, tuple_nodes);
 
   // the list has every element in that we want to add to the tuple, and all of them have been evaluated if they needed to be
@@ -746,7 +746,7 @@ Lnast_node Prp_lnast::eval_tuple(mmap_lib::Tree_index idx_start_ast, mmap_lib::T
   return retnode;
 }
 
-void Prp_lnast::add_tuple_nodes(mmap_lib::Tree_index idx_start_ln, std::list<std::array<Lnast_node, 3>> &tuple_nodes) {
+void Prp_lnast::add_tuple_nodes(mmap_lib::Tree_index idx_start_ln, std::vector<std::array<Lnast_node, 3>> &tuple_nodes) {
   for (const auto &node_subtrees : tuple_nodes) {
     if (node_subtrees[0].type.get_raw_ntype() == Lnast_ntype::Lnast_ntype_invalid) {
       lnast->add_child(idx_start_ln, node_subtrees[2]);
@@ -760,7 +760,7 @@ void Prp_lnast::add_tuple_nodes(mmap_lib::Tree_index idx_start_ln, std::list<std
 
 void Prp_lnast::evaluate_all_tuple_nodes(mmap_lib::Tree_index idx_start_ast, mmap_lib::Tree_index idx_pre_tuple_vals,
                                          mmap_lib::Tree_index                  idx_post_tuple_vals,
-                                         std::list<std::array<Lnast_node, 3>> &tuple_nodes) {
+                                         std::vector<std::array<Lnast_node, 3>> &tuple_nodes) {
   mmap_lib::Tree_index tuple_idxs[] = {idx_pre_tuple_vals, idx_start_ast, idx_post_tuple_vals};
 
   for (const auto &idx : tuple_idxs) {
@@ -873,8 +873,8 @@ Lnast_node Prp_lnast::eval_expression(mmap_lib::Tree_index idx_start_ast, mmap_l
   auto                 idx_nxt_ast = idx_start_ast;
   // print_tree_index(idx_nxt_ast);
 
-  std::list<Lnast_node> operand_stack;
-  std::list<Lnast_node> operator_stack;
+  std::deque<Lnast_node>  operand_stack;
+  std::vector<Lnast_node> operator_stack;
   Lnast_node            assign_operator, assign_operand;
   bool                  has_assign_op = false;
   // first, we need to see if we're an expression of the form (op)=, e.g. +=
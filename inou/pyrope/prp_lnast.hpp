@@ -1,6 +1,8 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
 #include <array>
+#include <deque>
+#include <vector>
 
 #include "lnast.hpp"
 #include "lnast_ntype.hpp"
@@ -57,9 +59,9 @@ protected:
                                     Lnast_node name_node = Lnast_node());
   Lnast_node eval_sub_expression(mmap_lib::Tree_index idx_start_ast, Lnast_node operator_node);
 
-  void add_tuple_nodes(mmap_lib::Tree_index idx_start_ln, std::list<std::array<Lnast_node, 3>> &tuple_nodes);
+  void add_tuple_nodes(mmap_lib::Tree_index idx_start_ln, std::vector<std::array<Lnast_node, 3>> &tuple_nodes);
   void evaluate_all_tuple_nodes(mmap_lib::Tree_index idx_start_ast, mmap_lib::Tree_index idx_pre_tuple_vals,
-                                mmap_lib::Tree_index idx_post_tuple_vals, std::list<std::array<Lnast_node, 3>> &tuple_nodes);
+                                mmap_lib::Tree_index idx_post_tuple_vals, std::vector<std::array<Lnast_node, 3>> &tuple_nodes);
 
   Lnast_node     gen_operator(mmap_lib::Tree_index idx, uint8_t *skip_sibs);
   inline bool    is_expr(mmap_lib::Tree_index idx);
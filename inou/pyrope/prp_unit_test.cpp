@@ -14,7 +14,8 @@ public:
       patch_pass(pyrope_keyword);
 
       ast = std::make_unique<Ast_parser>(get_memblock(), Prp_rule);
-      std::list<std::tuple<Rule_id, Token_entry>> loc_list;
+      parse_events.clear();
+      Prp_event_list loc_list(parse_events);
       gen_ws_map();
 
       int      failed  = 0;
@@ -177,3 +178,33 @@ TEST_F(Prp_test, if_statement1) {
   EXPECT_EQ(tree_traversal_check_tokens, scanner.tree_traversal_tokens);
   EXPECT_EQ(tree_traversal_check_rules, scanner.tree_traversal_rules);
 }
+
+TEST_F(Prp_test, event_list_backtrack) {
+  std::vector<Prp_event> buffer;
+
+  Prp_event_list top(buffer);
+  top.emplace_back(1, 1);
+  {
+    Prp_event_list matched(buffer);
+    matched.emplace_back(2, 2);
+    matched.emplace_back(2, 3);
+    matched.emplace_front(0, 0);
+    matched.emplace_back(2, 0);
+    top.splice_back(matched);
+  }
+  EXPECT_EQ(top.size(), 5);
+  {
+    Prp_event_list failed(buffer);
+    failed.emplace_back(3, 4);
+    failed.emplace_back(3, 5);
+    EXPECT_EQ(failed.size(), 2);
+    EXPECT_EQ(buffer.size(), 7);
+  }
+  EXPECT_EQ(top.size(), 5);  // failed rule dropped its events
+
+  std::vector<Prp_event> expected{{1, 1}, {0, 0}, {2, 2}, {2, 3}, {2, 0}};
+  EXPECT_TRUE(std::equal(top.begin(), top.end(), expected.begin(), expected.end()));
+
+  top.resize(1);  // pseudo fail
+  EXPECT_EQ(buffer.size(), 1);
+}
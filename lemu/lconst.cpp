@@ -77,24 +77,38 @@ Lconst::Container Lconst::serialize() const {
   v.emplace_back(bits>>8 );
   v.emplace_back(bits    );
 
-  boost::multiprecision::export_bits(num, std::back_inserter(v), 8);
+  if (big) {
+    boost::multiprecision::export_bits(num, std::back_inserter(v), 8);
+  } else {
+    // Same bytes as export_bits: magnitude, msb first, at least one byte
+    const uint64_t mag    = small < 0 ? -static_cast<uint64_t>(small) : small;
+    const int      nbytes = mag ? (64 - __builtin_clzll(mag) + 7) / 8 : 1;
+    for (int i = nbytes - 1; i >= 0; --i) {
+      v.emplace_back(static_cast<unsigned char>(mag >> (8 * i)));
+    }
+  }
 
   return v;
 }
 
 uint64_t Lconst::hash() const {
 
-  std::vector<uint64_t> v;
   uint64_t c = (explicit_str?0x10:0) | (explicit_bits?0x04:0) | (is_negative()?0x01:0);
   c = (c<<32) | bits;
-  v.emplace_back(c);
 
+  if (!big) {
+    const uint64_t v[2] = {c, small < 0 ? -static_cast<uint64_t>(small) : small};  // magnitude like export_bits
+    return mmap_lib::hash64(v, sizeof(v));
+  }
+
+  std::vector<uint64_t> v;
+  v.emplace_back(c);
   boost::multiprecision::export_bits(num, std::back_inserter(v), 64);
 
   return mmap_lib::hash64(v.data(),v.size()*8);
 }
 
-Lconst::Lconst(absl::Span<unsigned char> v) {
+Lconst::Lconst(absl::Span<const unsigned char> v) {
 
   I(v.size()>3); // invalid otherwise
 
@@ -108,12 +122,7 @@ Lconst::Lconst(absl::Span<unsigned char> v) {
 
   bits = (c1<<16) | (c2<<8) | c3;
 
-  auto s = v.subspan(4);
-  boost::multiprecision::import_bits(num,s.begin(),s.end());
-
-  if (c0&0x01) { // negative
-    num = -num;
-  }
+  set_num(v.subspan(4), c0&0x01);
 }
 
 Lconst::Lconst(const Container &v) {
@@ -130,30 +139,47 @@ Lconst::Lconst(const Container &v) {
 
   bits = (c1<<16) | (c2<<8) | c3;
 
-  boost::multiprecision::import_bits(num,v.begin()+4,v.end());
-  if (c0&0x01) { // negative
-    num = -num;
+  set_num(absl::MakeConstSpan(v).subspan(4), c0&0x01);
+}
+
+void Lconst::set_num(absl::Span<const unsigned char> mag_bytes, bool negative) {
+  if (mag_bytes.size() <= 8) {
+    uint64_t mag = 0;
+    for (auto ch : mag_bytes) {
+      mag = (mag << 8) | ch;
+    }
+    if (mag <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+      set_num(negative ? -static_cast<int64_t>(mag) : static_cast<int64_t>(mag));
+      return;
+    }
+  }
+
+  Number tmp;
+  boost::multiprecision::import_bits(tmp, mag_bytes.begin(), mag_bytes.end());
+  if (negative) {
+    tmp = -tmp;
   }
+  set_num(tmp);
 }
 
 Lconst::Lconst() {
   explicit_str  = false;
   explicit_bits = false;
   bits          = 1;
-  num           = 0;
+  set_num(int64_t(0));
 }
 
 Lconst::Lconst(int64_t v) {
   explicit_str  = false;
   explicit_bits = false;
-  num           = v;
+  set_num(v);
   bits          = calc_num_bits();
 }
 
 Lconst::Lconst(Number v) {
   explicit_str  = false;
   explicit_bits = false;
-  num           = v;
+  set_num(v);
   bits          = calc_num_bits();
 }
 
@@ -162,11 +188,19 @@ Lconst::Lconst(std::string_view orig_txt) {
   explicit_str  = false;
   explicit_bits = false;
   bits          = 0;
-  num           = 0;
+  set_num(int64_t(0));
 
   if (orig_txt.empty())
     return;
 
+  // The parsing works with num (big), set_num makes it small if it fits
+  big = true;
+  parse(orig_txt);
+  set_num(Number(num));
+}
+
+void Lconst::parse(std::string_view orig_txt) {
+
   // Skip leading _ as needed
 
   std::string_view txt { orig_txt };
@@ -336,7 +370,7 @@ void Lconst::dump() const {
   if (explicit_str)
     fmt::print("str:{} bits:{}\n", to_string(), bits);
   else
-    fmt::print("num:{} bits:{} explicit_bits:{}\n", num.str(), bits, explicit_bits);
+    fmt::print("num:{} bits:{} explicit_bits:{}\n", get_num().str(), bits, explicit_bits);
 }
 
 Lconst Lconst::adjust(const Number &res_num, const Lconst &o) const {
@@ -347,7 +381,17 @@ Lconst Lconst::adjust(const Number &res_num, const Lconst &o) const {
   return Lconst(res_explicit_str, res_explicit_bits, calc_num_bits(res_num), res_num);
 }
 
+Lconst Lconst::adjust(int64_t res_num, const Lconst &o) const {
+  auto res_explicit_str  = explicit_str && o.explicit_str;
+  bool res_explicit_bits = false;
+
+  return Lconst(res_explicit_str, res_explicit_bits, calc_num_bits(res_num), res_num);
+}
+
 Lconst Lconst::get_mask(Bits_t bits) {
+  if (bits < 63)
+    return Lconst(static_cast<int64_t>((1ULL<<bits)-1));
+
   return Lconst((Number(1)<<bits)-1);
 }
 
@@ -357,11 +401,20 @@ Lconst Lconst::get_mask() const {
 
 Lconst Lconst::tposs_op() const {
 
+  if (!big && (small >= 0 || get_bits() < 63)) {
+    int64_t res_num = small;
+    if (small < 0)
+      res_num += static_cast<int64_t>(1ULL << get_bits());  // mask+num+1
+
+    return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
+  }
+
+  Number val = get_num();
   Number res_num;
-  if (num<0) {
-    res_num = (Number(1)<<get_bits())+num;  // mask+num+1
+  if (val<0) {
+    res_num = (Number(1)<<get_bits())+val;  // mask+num+1
   }else{
-    res_num = num;
+    res_num = val;
   }
 
   return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
@@ -387,6 +440,12 @@ Lconst Lconst::add_op(const Lconst &o) const {
     return Lconst(qmarks);
   }
 
+  if (!big && !o.big) {
+    int64_t res_num;
+    if (!__builtin_add_overflow(small, o.small, &res_num))
+      return adjust(res_num, o);
+  }
+
   Number res_num = get_num() + o.get_num();
 
   return adjust(res_num, o);
@@ -402,6 +461,12 @@ Lconst Lconst::sub_op(const Lconst &o) const {
     return Lconst(qmarks);
   }
 
+  if (!big && !o.big) {
+    int64_t res_num;
+    if (!__builtin_sub_overflow(small, o.small, &res_num))
+      return adjust(res_num, o);
+  }
+
   Number res_num = get_num() - o.get_num();
 
   return adjust(res_num, o);
@@ -415,7 +480,13 @@ Lconst Lconst::lsh_op(Bits_t amount) const {
     return Lconst(qmarks);
   }
 
-  auto res_num  = num << amount;
+  if (!big && amount < 63) {
+    auto res_num = static_cast<int64_t>(static_cast<uint64_t>(small) << amount);
+    if ((res_num >> amount) == small)  // no bits lost
+      return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
+  }
+
+  auto res_num  = get_num() << amount;
 
   return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
 }
@@ -427,6 +498,11 @@ Lconst Lconst::rsh_op(Bits_t amount) const {
     return Lconst(s);
   }
 
+  if (!big) {
+    auto res_num = small >> std::min<Bits_t>(amount, 63);
+    return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
+  }
+
   auto res_num  = num >> amount;
 
   return Lconst(explicit_str, explicit_bits, calc_num_bits(res_num), res_num);
@@ -466,6 +542,9 @@ Lconst Lconst::or_op(const Lconst &o) const {
     return Lconst(qmarks);
   }
 
+  if (!big && !o.big)
+    return adjust(small | o.small, o);
+
   Number res_num  = get_num() | o.get_num();
 
   return adjust(res_num, o);
@@ -504,6 +583,9 @@ Lconst Lconst::and_op(const Lconst &o) const {
     qmarks.append(res_bits, '?');
     return Lconst(qmarks);
   }
+  if (!big && !o.big)
+    return adjust(small & o.small, o);
+
   Number res_num  = get_num() & o.get_num();
 
   return adjust(res_num, o);
@@ -514,7 +596,12 @@ int Lconst::eq_op(const Lconst &o) const {
     I(false); // if any of them has ??, it can not be computed at compile time. Runtime random answer
   }
 
-  return num == o.num?-1:0;
+  if (big != o.big)
+    return 0;  // canonical, a small value is never big
+
+  if (big)
+    return num == o.num?-1:0;
+  return small == o.small?-1:0;
 
 #if 0
   auto b = num & o.num;  // zero-extend or drop bits from negative
@@ -530,8 +617,13 @@ int Lconst::eq_op(const Lconst &o) const {
 Lconst Lconst::adjust_bits(Bits_t amount) const {
   I(amount>0);
 
+  if (!big && amount < 63) {
+    int64_t res_num = small & static_cast<int64_t>((1ULL<<amount)-1);
+    return Lconst(explicit_str, true, calc_num_bits(res_num), res_num);
+  }
+
   Number r(1);
-  Number res_num = num & ((r<<amount)-1);
+  Number res_num = get_num() & ((r<<amount)-1);
 
   return Lconst(explicit_str, true, calc_num_bits(res_num), res_num);
 }
@@ -540,7 +632,7 @@ std::string Lconst::to_string() const {
   I(explicit_str);
 
   std::string str;
-  Number tmp = num;
+  Number tmp = get_num();
   while(tmp) {
     unsigned char ch = static_cast<unsigned char>(tmp & 0xFF);
     str.append(1, ch);
@@ -554,7 +646,7 @@ std::string Lconst::to_string_no_xz() const {
   I(explicit_str);
 
   std::string str;
-  Number tmp = num;
+  Number tmp = get_num();
   while(tmp) {
     unsigned char ch = static_cast<unsigned char>(tmp & 0xFF);
     if (ch == 'z' || ch == 'x')
@@ -572,10 +664,10 @@ void Lconst::add_pyrope_bits(std::string *str) const {
     return;
   }
 
-  absl::StrAppend(str,((num<0 && bits>1) || explicit_str)?"s":"u");
+  absl::StrAppend(str,((is_negative() && bits>1) || explicit_str)?"s":"u");
 
   if (explicit_bits && bits>0) {
-    if (num>0 && bits>1 && !explicit_str) {
+    if ((big ? num>0 : small>0) && bits>1 && !explicit_str) {
       absl::StrAppend(str, bits-1, (bits-1)>1?"bits":"bit");
     }else{
       absl::StrAppend(str, bits, bits>1?"bits":"bit");
@@ -659,6 +751,8 @@ std::string Lconst::to_firrtl() const {
 
 int64_t Lconst::to_i() const {
   I(is_i());
+  if (!big)
+    return small;
   return static_cast<long int>(num);
 }
 
@@ -1,6 +1,8 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 #include "iassert.hpp"
@@ -70,21 +72,44 @@ private:
 
   static Bits_t read_bits(std::string_view txt);
   bool process_ending(std::string_view txt, size_t pos);
+  void parse(std::string_view txt);
 
 protected:
   using Number=boost::multiprecision::cpp_int;
 
   bool     explicit_str;
   bool     explicit_bits;
+  bool     big;    // num has the value (does not fit in small)
 
-  Bits_t bits;
+  Bits_t   bits;
+  int64_t  small;  // value when !big (most constants fit)
   Number   num;
 
+  // Canonical: a value that fits in int64 is always small (num is zero)
+  void set_num(const Number &n) {
+    if (n >= std::numeric_limits<int64_t>::min() && n <= std::numeric_limits<int64_t>::max()) {
+      big   = false;
+      small = static_cast<int64_t>(n);
+      num   = 0;
+    } else {
+      big   = true;
+      small = 0;
+      num   = n;
+    }
+  }
+  void set_num(int64_t v) {
+    big   = false;
+    small = v;
+    num   = 0;
+  }
+  void set_num(absl::Span<const unsigned char> mag_bytes, bool negative);  // serialized magnitude
+
   void add_pyrope_bits(std::string *str) const;
 
   std::string_view skip_underscores(std::string_view txt) const;
 
-  Lconst(bool str, bool b, Bits_t d, Number n) : explicit_str(str), explicit_bits(b), bits(d), num(n) {}
+  Lconst(bool str, bool b, Bits_t d, const Number &n) : explicit_str(str), explicit_bits(b), bits(d) { set_num(n); }
+  Lconst(bool str, bool b, Bits_t d, int64_t v) : explicit_str(str), explicit_bits(b), big(false), bits(d), small(v) {}
 
   static Bits_t calc_num_bits(const Number &num) {
     if (num == 0 || num == -1)
@@ -93,8 +118,14 @@ protected:
       return msb(num)+2;   // +2 because values are signed (msb==0 is 1 bit)
     return msb(-num-1)+2;
   }
+  static Bits_t calc_num_bits(int64_t v) {
+    if (v == 0 || v == -1)
+      return 1;
+    uint64_t u = v > 0 ? v : ~v;  // ~v == -v-1
+    return (63 - __builtin_clzll(u)) + 2;
+  }
   Bits_t calc_num_bits() const {
-    return calc_num_bits(num);
+    return big ? calc_num_bits(num) : calc_num_bits(small);
   }
   bool same_explicit_bits(const Lconst &o) const {
     bool s1 = explicit_bits && o.explicit_bits && bits == o.bits;
@@ -103,13 +134,14 @@ protected:
     return s1 || s2;
   }
 
-  Number get_num() const { return num; }
+  Number get_num() const { return big ? num : Number(small); }
   Lconst adjust(const Number &res_num, const Lconst &o) const;
+  Lconst adjust(int64_t res_num, const Lconst &o) const;
 
 public:
   using Container=std::vector<unsigned char>;
 
-  Lconst(absl::Span<unsigned char> v);
+  Lconst(absl::Span<const unsigned char> v);
   Lconst(const Container &v);
   Lconst(std::string_view txt);
   Lconst(Number v);
@@ -138,13 +170,14 @@ public:
   [[nodiscard]] Lconst adjust_bits(Bits_t amount) const;
 
   // WARNING: unsigned can still be negative. It is a way to indicate as many 1s are needed
-  bool     is_negative() const { return num < 0; }
+  bool     is_negative() const { return big ? num < 0 : small < 0; }
   bool     is_explicit_bits() const { return explicit_bits; }
   bool     is_string() const { return explicit_str; }
 
   Bits_t get_bits() const { return bits; } // note: this is returning signed bits of the constant
 
   bool is_i() const { return !explicit_str && bits <= 62; } // 62 to handle sign (int)
+  bool is_small() const { return !big; } // value kept as int64 (no cpp_int), even if it is a string
   int64_t to_i() const; // must fit in int or exception raised
 
   std::string to_yosys(bool do_unsign=false) const;
@@ -176,24 +209,26 @@ public:
 #endif
 
   bool operator==(const Lconst &other) const {
-    return get_num() == other.get_num() && bits == other.bits; // same_explicit_bits(other);
+    if (big != other.big)
+      return false;  // canonical, a small value is never big
+    return (big ? num == other.num : small == other.small) && bits == other.bits; // same_explicit_bits(other);
   }
   bool operator!=(const Lconst &other) const {
-    return get_num() != other.get_num() || bits != other.bits; //!same_explicit_bits(other);
+    return !(*this == other); //!same_explicit_bits(other);
   }
 
   bool operator==(int other) const {
-    return get_num() == other && !is_string();
+    return (big ? num == other : small == other) && !is_string();
   }
   bool operator!=(int other) const {
-    return get_num() != other || is_string();
+    return !(*this == other);
   }
 
-  bool operator<(const Lconst &other) const  { return num <  other.num; }
-  bool operator<=(const Lconst &other) const { return num <= other.num; }
-  bool operator>(const Lconst &other) const  { return num >  other.num; }
-  bool operator>=(const Lconst &other) const { return num >= other.num; }
+  bool operator<(const Lconst &other) const  { return (!big && !other.big) ? small <  other.small : get_num() <  other.get_num(); }
+  bool operator<=(const Lconst &other) const { return (!big && !other.big) ? small <= other.small : get_num() <= other.get_num(); }
+  bool operator>(const Lconst &other) const  { return (!big && !other.big) ? small >  other.small : get_num() >  other.get_num(); }
+  bool operator>=(const Lconst &other) const { return (!big && !other.big) ? small >= other.small : get_num() >= other.get_num(); }
 
-  Number get_raw_num() const { return num; } // for debugging mostly
+  Number get_raw_num() const { return get_num(); } // for debugging mostly
 };
 
@@ -0,0 +1,61 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "lconst_pool.hpp"
+
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+void Lconst_pool::check_format_int() const {
+  if (txt.get_entries() == 0)
+    return;  // empty, intern adds the Format_tag
+
+  if (txt.get(Tag_handle) != Format_tag) {
+    throw std::runtime_error(fmt::format("ERROR: constant pool {} is not in the {} format (regenerate the lgdb)", file, Format_tag));
+  }
+  format_checked = true;
+}
+
+Lconst_pool::Handle Lconst_pool::intern(const Lconst &v) {
+  const auto h = v.hash();
+
+  std::lock_guard<std::mutex> guard(mutex);
+
+  check_format();
+  if (!format_checked) {
+    auto tag = txt.insert(Format_tag);
+    I(tag == Tag_handle);
+    (void)tag;
+    format_checked = true;
+  }
+
+  auto it = hash2handle.find(h);
+  if (it != hash2handle.end() && same(get_int(it->second), v))
+    return it->second;
+
+  const auto data = v.serialize();
+  Handle     handle = txt.insert(std::string_view(reinterpret_cast<const char *>(data.data()), data.size()));
+  I(handle);
+
+  if (it == hash2handle.end())
+    hash2handle.emplace(h, handle);  // on a hash collision, the first keeps the memo
+
+  return handle;
+}
+
+Lconst_pool::Relocation Lconst_pool::compact(std::vector<Handle> &live) {
+  std::lock_guard<std::mutex> guard(mutex);
+
+  check_format();
+  if (!format_checked)
+    return Relocation();  // empty pool
+
+  live.emplace_back(Tag_handle);  // compact keeps the order, the tag stays first
+
+  auto old2new = txt.compact(live);
+  I(old2new[Tag_handle] == Tag_handle);
+
+  hash2handle.clear();  // warms up again
+
+  return old2new;
+}
@@ -0,0 +1,97 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "lconst.hpp"
+#include "mmap_txt.hpp"
+
+// Interned (hash-consed) constants. Each distinct Lconst (value, bits, and
+// explicit flags) is stored once, and equal constants get the same Handle.
+//
+// The serialized constants live in a txt_arena (one file per library path),
+// so the lgraphs only keep a 32bit handle per Const node. The first entry of
+// the file is the Format_tag (a pool from another format is an error, not
+// garbage handles). Entries are not erased on use, the owner (Graph_library
+// sync) calls compact with the live handles and relocates its references.
+//
+// Thread safe (the passes create constants from several threads). compact is
+// not safe while other threads hold handles.
+class Lconst_pool {
+public:
+  using Handle     = uint32_t;                             // 0 is invalid
+  using Relocation = absl::flat_hash_map<Handle, Handle>;  // old to new handle (compact)
+
+  static constexpr std::string_view Format_tag = "lconst_pool 1";
+
+protected:
+  mutable std::mutex  mutex;
+  const std::string   file;
+  mmap_lib::txt_arena txt;
+  mutable bool        format_checked = false;
+
+  // Lconst::hash() -> handle. Memoizes the txt_arena lookups (no serialize for
+  // already seen constants). Only in memory, it warms up again after reopen.
+  absl::flat_hash_map<uint64_t, Handle> hash2handle;
+
+  static bool same(const Lconst &a, const Lconst &b) {
+    return a == b && a.is_string() == b.is_string() && a.is_explicit_bits() == b.is_explicit_bits();
+  }
+
+  static constexpr Handle Tag_handle = mmap_lib::txt_arena::first_pos();
+
+  void check_format() const {
+    if (!format_checked)
+      check_format_int();
+  }
+  void check_format_int() const;
+
+  Lconst get_int(Handle h) const {
+    I(h != Tag_handle);
+    auto data = txt.get(h);
+    I(data.size() > 3);  // invalid handle otherwise
+    return Lconst(absl::MakeConstSpan(reinterpret_cast<const unsigned char *>(data.data()), data.size()));
+  }
+
+public:
+  explicit Lconst_pool(std::string_view _file) : file(_file), txt(file) {}
+
+  Lconst_pool(const Lconst_pool &) = delete;
+  Lconst_pool &operator=(const Lconst_pool &) = delete;
+
+  Handle intern(const Lconst &v);
+
+  Lconst get(Handle h) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    check_format();
+    return get_int(h);
+  }
+
+  // Worth to compact if most of the constants are not used by the n_live
+  // handles. False if not accessed since the last sync.
+  bool should_compact(size_t n_live) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return txt.should_compact(n_live + 1);  // +1 Format_tag
+  }
+
+  // Keeps only the live handles (any order, duplicates OK)
+  Relocation compact(std::vector<Handle> &live);
+
+  // Release the mmap (reopened on demand)
+  void sync() {
+    std::lock_guard<std::mutex> guard(mutex);
+    txt.sync();
+  }
+
+  // Number of different constants inserted (live or not)
+  size_t size() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    check_format();
+    auto n = txt.get_entries();
+    return n ? n - 1 : 0;  // not the Format_tag
+  }
+};
@@ -0,0 +1,79 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Lconst operator throughput. The small values (most constants in cprop and
+// bitwidth) use the int64 fast path, the wide values still use cpp_int. The
+// raw cpp_int loop is the cost that every small Lconst paid before.
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "boost/multiprecision/cpp_int.hpp"
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "lconst.hpp"
+#include "lrand.hpp"
+
+using namespace std::chrono;
+
+static constexpr int n_vals = 1024;
+static constexpr int n_ops  = 4000000;
+
+template <typename Func> double run(const std::string &name, Func fn) {
+  auto start = high_resolution_clock::now();
+  {
+    Lbench b(name);
+    for (int i = 0; i < n_ops; ++i) {
+      fn(i % n_vals, (i * 7 + 3) % n_vals);
+    }
+  }
+  auto stop = high_resolution_clock::now();
+  return n_ops / (duration_cast<microseconds>(stop - start).count() / 1e6) / 1e6;
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  Lrand<int32_t> rnd;
+
+  std::vector<Lconst>                          small_vals;
+  std::vector<Lconst>                          big_vals;
+  std::vector<boost::multiprecision::cpp_int> num_vals;
+  for (int i = 0; i < n_vals; ++i) {
+    int64_t v = rnd.any() - (1 << 30);
+    small_vals.emplace_back(Lconst(v));
+    num_vals.emplace_back(v);
+    big_vals.emplace_back(Lconst(v).lsh_op(80).or_op(Lconst(i)));  // >64 bits
+    I(small_vals.back().is_small());
+    I(!big_vals.back().is_small());
+  }
+
+  uint64_t chk = 0;
+
+  auto lconst_ops = [&chk](const char *kind, std::vector<Lconst> &vals) {
+    auto add = run(fmt::format("lemu.LCONST_{}_add", kind), [&](int a, int b) { chk += vals[a].add_op(vals[b]).get_bits(); });
+    auto sub = run(fmt::format("lemu.LCONST_{}_sub", kind), [&](int a, int b) { chk += vals[a].sub_op(vals[b]).get_bits(); });
+    auto aop = run(fmt::format("lemu.LCONST_{}_and", kind), [&](int a, int b) { chk += vals[a].and_op(vals[b]).get_bits(); });
+    auto oop = run(fmt::format("lemu.LCONST_{}_or", kind), [&](int a, int b) { chk += vals[a].or_op(vals[b]).get_bits(); });
+    auto lsh = run(fmt::format("lemu.LCONST_{}_lsh", kind), [&](int a, int b) { chk += vals[a].lsh_op(b & 0x1F).get_bits(); });
+    auto eq  = run(fmt::format("lemu.LCONST_{}_eq", kind), [&](int a, int b) { chk += vals[a].eq_op(vals[b]); });
+    auto ser = run(fmt::format("lemu.LCONST_{}_serialize", kind), [&](int a, int b) {
+      (void)b;
+      chk += Lconst(vals[a].serialize()).get_bits();
+    });
+
+    fmt::print("{:<6} Mops/s add:{:.2f} sub:{:.2f} and:{:.2f} or:{:.2f} lsh:{:.2f} eq:{:.2f} serialize:{:.2f}\n",
+               kind, add, sub, aop, oop, lsh, eq, ser);
+  };
+
+  lconst_ops("small", small_vals);
+  lconst_ops("big", big_vals);
+
+  auto add = run("lemu.LCONST_cpp_int_add", [&](int a, int b) { chk += msb(abs(num_vals[a] + num_vals[b]) + 1); });
+  auto aop = run("lemu.LCONST_cpp_int_and", [&](int a, int b) { chk += msb(abs(num_vals[a] & num_vals[b]) + 1); });
+  auto lsh = run("lemu.LCONST_cpp_int_lsh", [&](int a, int b) { chk += msb(abs(num_vals[a] << (b & 0x1F)) + 1); });
+  fmt::print("cpp_int Mops/s add:{:.2f} and:{:.2f} lsh:{:.2f} (chk:{})\n", add, aop, lsh, chk & 0xFF);
+
+  return 0;
+}
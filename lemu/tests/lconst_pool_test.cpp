@@ -0,0 +1,136 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lconst_pool.hpp"
+
+class Lconst_pool_test : public ::testing::Test {};
+
+TEST_F(Lconst_pool_test, intern_dedup) {
+  Lconst_pool pool("");
+
+  auto h1 = pool.intern(Lconst(33));
+  auto h2 = pool.intern(Lconst(33));
+  auto h3 = pool.intern(Lconst(34));
+
+  EXPECT_NE(h1, 0);
+  EXPECT_EQ(h1, h2);
+  EXPECT_NE(h1, h3);
+  EXPECT_EQ(pool.size(), 2);
+
+  EXPECT_EQ(pool.get(h1), Lconst(33));
+  EXPECT_EQ(pool.get(h3), Lconst(34));
+}
+
+TEST_F(Lconst_pool_test, bits_and_kind) {
+  Lconst_pool pool("");
+
+  // Same value, but different bits or kind are different constants
+  auto h_plain    = pool.intern(Lconst(3));
+  auto h_explicit = pool.intern(Lconst("0b11s4"));
+  auto h_neg      = pool.intern(Lconst(-1));
+  auto h_str      = pool.intern(Lconst("hello"));
+  auto h_big      = pool.intern(Lconst("0xFFFF_FFFF_FFFF_FFFF_FFFF_FFFF"));
+
+  EXPECT_NE(h_plain, h_explicit);
+  EXPECT_NE(h_plain, h_neg);
+  EXPECT_EQ(h_str, pool.intern(Lconst("hello")));
+  EXPECT_EQ(h_big, pool.intern(Lconst("0xFFFF_FFFF_FFFF_FFFF_FFFF_FFFF")));
+
+  EXPECT_EQ(pool.get(h_explicit).get_bits(), 4);
+  EXPECT_TRUE(pool.get(h_explicit).is_explicit_bits());
+  EXPECT_TRUE(pool.get(h_str).is_string());
+  EXPECT_EQ(pool.get(h_str).to_string(), "hello");
+  EXPECT_EQ(pool.get(h_big), Lconst("0xFFFF_FFFF_FFFF_FFFF_FFFF_FFFF"));
+  EXPECT_EQ(pool.get(h_neg), Lconst(-1));
+}
+
+TEST_F(Lconst_pool_test, persistence) {
+  std::string file("lgdb_lconst_pool_test");
+  unlink(file.c_str());
+
+  Lconst_pool::Handle h1, h2;
+  {
+    Lconst_pool pool(file);
+    h1 = pool.intern(Lconst(1234));
+    h2 = pool.intern(Lconst("0x1234_5678_9ABC_DEF0_1234"));
+    pool.sync();
+  }
+
+  Lconst_pool pool(file);
+  EXPECT_EQ(pool.get(h1), Lconst(1234));
+  EXPECT_EQ(pool.get(h2), Lconst("0x1234_5678_9ABC_DEF0_1234"));
+  EXPECT_EQ(pool.intern(Lconst(1234)), h1);  // dedup also after reopen
+  EXPECT_EQ(pool.size(), 2);
+
+  unlink(file.c_str());
+}
+
+TEST_F(Lconst_pool_test, threads) {
+  Lconst_pool pool("");
+
+  std::vector<std::vector<Lconst_pool::Handle>> handles(4);
+  std::vector<std::thread>                      workers;
+  for (auto t = 0u; t < handles.size(); ++t) {
+    workers.emplace_back([&pool, &handles, t] {
+      for (int i = 0; i < 1000; ++i) {
+        handles[t].emplace_back(pool.intern(Lconst(i % 100)));
+      }
+    });
+  }
+  for (auto &w : workers) w.join();
+
+  EXPECT_EQ(pool.size(), 100);
+  for (auto t = 1u; t < handles.size(); ++t) {
+    EXPECT_EQ(handles[t], handles[0]);
+  }
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(pool.get(handles[0][i]), Lconst(i));
+  }
+}
+
+TEST_F(Lconst_pool_test, compact) {
+  Lconst_pool pool("");
+
+  std::vector<Lconst_pool::Handle> handles;
+  for (int i = 0; i < 2000; ++i) {
+    handles.emplace_back(pool.intern(Lconst(i)));
+  }
+  EXPECT_FALSE(pool.should_compact(handles.size()));
+
+  std::vector<Lconst_pool::Handle> live;
+  for (int i = 0; i < 2000; i += 10) {
+    live.emplace_back(handles[i]);
+  }
+  ASSERT_TRUE(pool.should_compact(live.size()));
+
+  auto live_copy = live;
+  auto old2new   = pool.compact(live_copy);
+  EXPECT_EQ(pool.size(), live.size());
+
+  for (int i = 0; i < 2000; i += 10) {
+    auto h = old2new.at(handles[i]);
+    EXPECT_EQ(pool.get(h), Lconst(i));
+    EXPECT_EQ(pool.intern(Lconst(i)), h);  // dedup with the new handles
+  }
+  EXPECT_EQ(pool.size(), live.size());
+}
+
+TEST_F(Lconst_pool_test, format_tag) {
+  std::string file("lgdb_lconst_pool_test_tag");
+  unlink(file.c_str());
+  {
+    mmap_lib::txt_arena txt(file);  // not a pool (other format)
+    txt.insert("some other data");
+  }
+
+  Lconst_pool pool(file);
+  EXPECT_THROW(pool.intern(Lconst(1)), std::runtime_error);
+
+  unlink(file.c_str());
+}
@@ -1419,3 +1419,42 @@ TEST_F(Lconst_test, lconst_add) {
   }
 
 }
+
+TEST_F(Lconst_test, small_promotion) {
+  Lconst max(std::numeric_limits<int64_t>::max());
+  EXPECT_TRUE(max.is_small());
+  EXPECT_EQ(max.get_bits(), 64);
+
+  auto over = max + 1;  // overflows int64
+  EXPECT_FALSE(over.is_small());
+  EXPECT_EQ(over, Lconst("0x8000000000000000"));
+  EXPECT_EQ(over.get_bits(), 65);
+
+  auto back = over - 1;  // fits again
+  EXPECT_TRUE(back.is_small());
+  EXPECT_EQ(back, max);
+  EXPECT_EQ(back.hash(), max.hash());
+
+  auto min = Lconst(std::numeric_limits<int64_t>::min());
+  EXPECT_TRUE(min.is_small());
+  EXPECT_FALSE((min - 1).is_small());
+  EXPECT_EQ((min - 1) + 1, min);
+
+  auto sh62 = Lconst(1) << 62u;
+  EXPECT_TRUE(sh62.is_small());
+  auto sh63 = Lconst(1) << 63u;
+  EXPECT_FALSE(sh63.is_small());
+  EXPECT_EQ(sh63.rsh_op(63), Lconst(1));
+  EXPECT_TRUE(sh63.rsh_op(63).is_small());
+  EXPECT_EQ((Lconst(-3) << 70u).rsh_op(70), Lconst(-3));
+
+  for (const auto &v : {Lconst(0), Lconst(-1), max, min, over, min - 1, Lconst("0xFFu12"), Lconst("-1u8")}) {
+    Lconst v2(v.serialize());
+    EXPECT_EQ(v, v2);
+    EXPECT_EQ(v.hash(), v2.hash());
+    EXPECT_EQ(v.is_small(), v2.is_small());
+  }
+
+  EXPECT_EQ(Lconst("0x123456789abcdef").serialize(), Lconst(0x123456789abcdefLL).serialize());
+  EXPECT_EQ(Lconst(-12345).hash(), Lconst("-12345").hash());
+}
@@ -15,6 +15,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/strings/numbers.h"
 #include "eprp.hpp"
 #include "iassert.hpp"
 #include "lgraph.hpp"
@@ -272,7 +273,8 @@ unsigned long minor_version = 0;
 int main(int argc, char** argv) {
   I_setup();
 
-  bool option_quiet = false;
+  bool option_quiet    = false;
+  int  option_pipeline = 0;
 
   std::string cmd;
 
@@ -282,9 +284,10 @@ int main(int argc, char** argv) {
   struct option longopts[] = {{"version", no_argument, nullptr, 'v'},
                               {"quiet", no_argument, nullptr, 0},
                               {"command", required_argument, nullptr, 'c'},
+                              {"pipeline", required_argument, nullptr, 'p'},
                               {0, 0, 0, 0}};
 
-  while ((c = getopt_long(argc, argv, "qvc:", longopts, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "qvc:p:", longopts, &option_index)) != -1) {
     switch (c) {
       case 'q': option_quiet = true; break;
       case 'v': fmt::print("lgshell, version {}.{}", major_version, minor_version); return 0;
@@ -295,6 +298,12 @@ int main(int argc, char** argv) {
           absl::StrAppend(&cmd, " ", optarg);
         }
         break;
+      case 'p':
+        if (!absl::SimpleAtoi(optarg, &option_pipeline) || option_pipeline < 0) {
+          fmt::print("lgshell --pipeline {} should be the queue size between stages (0 disables)\n", optarg);
+          return 1;
+        }
+        break;
       case '?': break;
       default:;
     }
@@ -308,6 +317,7 @@ int main(int argc, char** argv) {
   }
 
   Main_api::init();
+  Pass::eprp.set_pipeline(option_pipeline);
 
   if (!cmd.empty()) {
     fmt::print("livehd cmd {}\n", cmd);
@@ -1,11 +1,14 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <cctype>
 #include <regex>
 #include <string>
 
+#include "absl/strings/numbers.h"
 #include "graph_library.hpp"
 #include "lgraph.hpp"
 #include "main_api.hpp"
+#include "mmap_gc.hpp"
 
 #include "meta_api.hpp"
 
@@ -62,6 +65,68 @@ void Meta_api::copy(Eprp_var &var) {
   glibrary->copy_lgraph(name, dest);
 }
 
+void Meta_api::library_json(Eprp_var &var) {
+  auto path = var.get("path");
+  auto file = var.get("file");
+
+  const auto *library = Graph_library::instance(path);
+  if (library == 0) {
+    Main_api::warn("lgraph.library_json could not open {} path", path);
+    return;
+  }
+
+  std::string json_file = file.empty() ? absl::StrCat(path, "/graph_library.json") : std::string(file);
+  library->export_json(json_file);
+}
+
+void Meta_api::mmap_budget(Eprp_var &var) {
+  auto size = var.get("size");
+
+  // 16G, 512M, 1024K or bytes. 0 disables the budget
+  size_t mult = 1;
+  auto   num  = size;
+  if (!num.empty()) {
+    switch (std::toupper(num.back())) {
+      case 'K': mult = 1ULL << 10; break;
+      case 'M': mult = 1ULL << 20; break;
+      case 'G': mult = 1ULL << 30; break;
+      case 'T': mult = 1ULL << 40; break;
+      default: mult = 0;
+    }
+    if (mult)
+      num.remove_suffix(1);
+    else
+      mult = 1;
+  }
+
+  uint64_t n;
+  if (num.empty() || !absl::SimpleAtoi(num, &n)) {
+    Main_api::error("mmap.budget invalid size:{}. Use bytes or a K/M/G/T suffix (size:16G)", size);
+    return;
+  }
+
+  mmap_lib::mmap_gc::set_budget(n * mult);
+}
+
+void Meta_api::mmap_stats(Eprp_var &var) {
+  (void)var;
+
+  const auto s = mmap_lib::mmap_gc::get_stats();
+
+  fmt::print("mmap mapped:{}MB max_mapped:{}MB budget:{}MB open_mmaps:{} open_fds:{}\n",
+             s.mapped_bytes >> 20,
+             s.max_mapped_bytes >> 20,
+             s.budget_bytes >> 20,
+             s.n_open_mmaps,
+             s.n_open_fds);
+  fmt::print("mmap mmaps:{} remaps:{} collects:{} evictions:{} evict_aborts:{}\n",
+             s.n_mmaps,
+             s.n_remaps,
+             s.n_collects,
+             s.n_evictions,
+             s.n_evict_aborts);
+}
+
 void Meta_api::match(Eprp_var &var) {
   auto path  = var.get("path");
   auto match = var.get("match");
@@ -236,4 +301,22 @@ void Meta_api::setup(Eprp &eprp) {
   m11.add_label_required("dest", "lgraph destination name");
 
   eprp.register_method(m11);
+
+  //---------------------
+  Eprp_method m12("lgraph.library_json", "write the lgraph library (graph_library.bin) as json for debugging", &Meta_api::library_json);
+  m12.add_label_optional("path", "lgraph path", "lgdb");
+  m12.add_label_optional("file", "json output file (path/graph_library.json by default)");
+
+  eprp.register_method(m12);
+
+  //---------------------
+  Eprp_method m13("mmap.budget", "limit the memory mapped by lgraphs (least recently used files are unmapped between commands)", &Meta_api::mmap_budget);
+  m13.add_label_required("size", "budget in bytes or with K/M/G/T suffix (e.g: size:16G). 0 is no limit");
+
+  eprp.register_method(m13);
+
+  //---------------------
+  Eprp_method m14("mmap.stats", "print mmap statistics (mapped memory, remaps, evictions)", &Meta_api::mmap_stats);
+
+  eprp.register_method(m14);
 }
@@ -10,6 +10,7 @@ protected:
   static void copy(Eprp_var &var);
 
   static void match(Eprp_var &var);
+  static void library_json(Eprp_var &var);
 
   static void stats(Eprp_var &var);
   static void dump(Eprp_var &var);
@@ -22,6 +23,9 @@ protected:
   static void lgdump(Eprp_var &var);
   static void lnastdump(Eprp_var &var);
 
+  static void mmap_budget(Eprp_var &var);
+  static void mmap_stats(Eprp_var &var);
+
   Meta_api() {}
 
 public:
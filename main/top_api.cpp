@@ -10,6 +10,8 @@
 #include <regex>
 #include <string>
 
+#include "absl/strings/numbers.h"
+
 void Top_api::files(Eprp_var &var) {
   std::string path(var.get("path"));
   std::string match(var.get("match"));
@@ -64,6 +66,16 @@ void Top_api::files(Eprp_var &var) {
   }
 }
 
+void Top_api::pipeline(Eprp_var &var) {
+  int queue = 0;
+  if (!absl::SimpleAtoi(var.get("queue"), &queue) || queue < 0) {
+    Main_api::error("pipeline queue:{} should be a positive number (0 to disable)", var.get("queue"));
+    return;
+  }
+
+  Pass::eprp.set_pipeline(queue);
+}
+
 void Top_api::setup(Eprp &eprp) {
   // Alphabetical order sorted to avoid undeterminism in different file orders
   Eprp_method m1("files", "match file names in alphabetical order. Like `ls {path} | grep -E {match} | sort`", &Top_api::files);
@@ -72,4 +84,9 @@ void Top_api::setup(Eprp &eprp) {
   m1.add_label_optional("filter", "quoted string of regex to filter.");
 
   eprp.register_method(m1);
+
+  Eprp_method m2("pipeline", "overlap the `|>` stages, each module moves to the next stage once done", &Top_api::pipeline);
+  m2.add_label_optional("queue", "max modules waiting between two stages (0 runs each stage to completion)", "4");
+
+  eprp.register_method(m2);
 }
@@ -5,6 +5,7 @@
 class Top_api {
 protected:
   static void files(Eprp_var &var);
+  static void pipeline(Eprp_var &var);
 
 public:
   static void setup(Eprp &eprp);
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <string_view>
+#include <vector>
 
 #include "mmap_map.hpp"
 
@@ -12,19 +13,59 @@ class bimap {
 public:
   using Key2val_type = typename mmap_lib::map<Key, T>;
   using Val2key_type = typename mmap_lib::map<T, Key>;
+
+protected:
+  static constexpr bool using_sview = is_array_serializable<Key>::value || is_array_serializable<T>::value;
+
+  txt_arena txt;  // Shared by key2val and val2key (each string stored once). Declared first (destroyed last)
+
+public:
   Key2val_type key2val;
   Val2key_type val2key;
 
   using iterator       = typename Key2val_type::iterator;
   using const_iterator = typename Key2val_type::const_iterator;
 
-  explicit bimap(std::string_view _map_name) : key2val(std::string(_map_name) + "_k2v"), val2key(std::string(_map_name) + "_v2k") {}
+  explicit bimap(std::string_view _map_name) : bimap(".", _map_name) {}
   explicit bimap(std::string_view _path, std::string_view _map_name)
-      : key2val(_path, std::string(_map_name) + "_k2v"), val2key(_path, std::string(_map_name) + "_v2k") {}
+      : txt(_map_name.empty() ? "" : std::string(_path.empty() ? "." : _path) + "/" + std::string(_map_name) + "_txt")
+      , key2val(_path, std::string(_map_name) + "_k2v", &txt)
+      , val2key(_path, std::string(_map_name) + "_v2k", &txt) {}
+
+  // Drop the dead txt entries (overwrites/erases) if most of them are dead
+  void compact_txt() {
+    if constexpr (using_sview) {
+      if (txt.iter_cntr || !txt.is_mapped())
+        return;  // nothing inserted since the last sync
+      if (!txt.should_compact(key2val.size()))
+        return;
+
+      std::vector<uint32_t> live;
+      key2val.txt_positions(live);
+      val2key.txt_positions(live);
+      auto old2new = txt.compact(live);
+      key2val.txt_relocate(old2new);
+      val2key.txt_relocate(old2new);
+    }
+  }
+
+  ~bimap() { compact_txt(); }
 
   void clear() {
     key2val.clear();
     val2key.clear();
+    txt.clear();
+  }
+
+  // Release the mmaps (reloaded on demand). Not while iterating
+  void sync() {
+    if (txt.iter_cntr)
+      return;
+
+    compact_txt();
+    key2val.sync();
+    val2key.sync();
+    txt.sync();
   }
   const_iterator set(Key &&key, T &&val) {
     val2key.set(val, key);
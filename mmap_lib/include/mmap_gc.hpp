@@ -6,10 +6,14 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 
@@ -25,17 +29,32 @@ struct mmap_gc_entry {
   static inline int global_age = 1;
   int               age;  // signed (to do quadrants in cleanup)
   mmap_gc_entry() {
-    age  = global_age++;
-    size = 0;
-    fd   = -1;
+    age    = global_age++;
+    size   = 0;
+    fd     = -1;
+    advice = MADV_NORMAL;
   }
   std::string                       name;  // Mostly for debugging
   int                               fd;
   size_t                            size;
   void *                            base;
+  int                               advice;  // last madvise (kept by mremap)
   std::function<bool(void *, bool)> gc_function;
 };
 
+struct mmap_gc_stats {
+  uint64_t n_mmaps          = 0;  // mmap calls (first map or reload after a recycle)
+  uint64_t n_remaps         = 0;
+  uint64_t n_collects       = 0;  // recycle_older calls (out of mmaps/fds)
+  uint64_t n_evictions      = 0;  // mappings released to stay under the budget
+  uint64_t n_evict_aborts   = 0;  // eviction denied by the owner (live iterators)
+  size_t   mapped_bytes     = 0;
+  size_t   max_mapped_bytes = 0;
+  size_t   budget_bytes     = 0;  // 0 is no budget
+  int      n_open_mmaps     = 0;
+  int      n_open_fds       = 0;
+};
+
 class mmap_gc {
 protected:
   using gc_pool_type = absl::flat_hash_map<void *, mmap_gc_entry>;  // pointer stability for delete
@@ -47,8 +66,53 @@ protected:
   static inline int n_max_mmaps = 512;
   static inline int n_max_fds   = 512;
 
+  static inline std::recursive_mutex gc_mutex;  // passes can open/remap lgraphs from several threads
+
+  // Memory budget: mapped bytes (an upper bound of the resident memory). Over
+  // the budget, collect_budget releases the file backed mappings with the
+  // oldest age: the last (re)map, or the last touch. mmap_gc does not see
+  // reads and writes, so owners that know the last use call touch (e.g.
+  // Graph_library restamps the lgraph node tables before collecting).
+  // Anonymous mappings can not be released (no file to reload from).
+  static inline size_t        budget_bytes = 0;
+  static inline size_t        mapped_bytes = 0;
+  static inline mmap_gc_stats stats;
+
+  static void add_mapped(size_t sz) {
+    mapped_bytes += sz;
+    if (mapped_bytes > stats.max_mapped_bytes)
+      stats.max_mapped_bytes = mapped_bytes;
+  }
+
+  static void enforce_budget() {
+    if (budget_bytes == 0 || mapped_bytes <= budget_bytes)
+      return;
+
+    std::vector<std::pair<int, void *>> sorted;  // age, base
+    for (const auto &it : mmap_gc_pool) {
+      if (it.second.fd < 0)
+        continue;
+      sorted.emplace_back(it.second.age, it.first);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    for (const auto &e : sorted) {
+      if (mapped_bytes <= budget_bytes)
+        break;
+      auto it = mmap_gc_pool.find(e.second);
+      assert(it != mmap_gc_pool.end());
+      if (recycle_int(it, false)) {
+        mmap_gc_pool.erase(it);
+        stats.n_evictions++;
+      } else {
+        stats.n_evict_aborts++;
+      }
+    }
+  }
+
   static void recycle_older() {
     // Recycle around 1/2 of the newer open fds with mmap
+    stats.n_collects++;
 
     int may_recycle_fds   = 0;
     int may_recycle_mmaps = 0;
@@ -164,6 +228,8 @@ protected:
 
     ::munmap(it->first, it->second.size);
     n_open_mmaps--;
+    assert(mapped_bytes >= it->second.size);
+    mapped_bytes -= it->second.size;
 
     // std::cerr << "mmap_gc_pool del name:" << it->second.name << " fd:" << it->second.fd << " base:" << it->first << std::endl;
 
@@ -232,7 +298,81 @@ public:
   }
   /* LCOV_EXCL_STOP */
 
+  enum class Access { normal, sequential, random, willneed };
+
+  // 0 disables the budget. Enforced by collect_budget, not by mmap/remap
+  static void set_budget(size_t bytes) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+    budget_bytes = bytes;
+  }
+
+  // Release mappings over the budget. Safe point only: the owners (e.g.
+  // vector::gc_function) accept the release, so no thread may hold pointers
+  // into the file backed mappings (Graph_library calls it between commands).
+  static void collect_budget() {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+    enforce_budget();
+  }
+
+  static size_t get_budget() {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+    return budget_bytes;
+  }
+
+  static mmap_gc_stats get_stats() {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+    auto s         = stats;
+    s.mapped_bytes = mapped_bytes;
+    s.budget_bytes = budget_bytes;
+    s.n_open_mmaps = n_open_mmaps;
+    s.n_open_fds   = n_open_fds;
+    return s;
+  }
+
+  static void clear_stats() {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+    stats                  = mmap_gc_stats();
+    stats.max_mapped_bytes = mapped_bytes;
+  }
+
+  // Access pattern hint (madvise) for the whole mapping. No syscall if the
+  // mapping already has it. Not a use for the budget (see touch)
+  static void advise(void *base, Access access) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
+    auto it = mmap_gc_pool.find(base);
+    if (it == mmap_gc_pool.end())
+      return;
+
+    int advice = MADV_NORMAL;
+    switch (access) {
+      case Access::sequential: advice = MADV_SEQUENTIAL; break;
+      case Access::random: advice = MADV_RANDOM; break;
+      case Access::willneed: advice = MADV_WILLNEED; break;
+      default: advice = MADV_NORMAL;
+    }
+    if (advice == it->second.advice)
+      return;
+
+    ::madvise(base, it->second.size, advice);  // just a hint, errors are ignored
+    if (advice != MADV_WILLNEED)  // one shot readahead, not a mode
+      it->second.advice = advice;
+  }
+
+  // Mark the mapping as the most recently used for collect_budget
+  static void touch(void *base) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
+    auto it = mmap_gc_pool.find(base);
+    if (it == mmap_gc_pool.end())
+      return;
+
+    it->second.age = mmap_gc_entry::global_age++;
+  }
+
   static void delete_file(void *base) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
     auto it = mmap_gc_pool.find(base);
     assert(it != mmap_gc_pool.end());
     assert(it->second.fd >= 0);
@@ -244,9 +384,11 @@ public:
 
   // mmap_map.hpp:    mmap_fd     = mmap_gc::open(mmap_name);
   //
-  // mmap_map.hpp:    mmap_txt_fd = mmap_gc::open(mmap_name + "txt");
+  // mmap_txt.hpp:    mmap_fd     = mmap_gc::open(mmap_name);
   // mmap_vector.hpp: mmap_fd     = mmap_gc::open(mmap_name);
   static int open(const std::string &name) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
 #if 0
     std::cerr << "mmap_gc_pool open filename:" << name 
       << " n_open_fds=" << n_open_fds
@@ -287,6 +429,8 @@ public:
   // mmap_map.hpp:    mmap_gc::recycle(mmap_base);
   // mmap_vector.hpp: mmap_gc::recycle(mmap_base);
   static void recycle(void *base) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
     // Remove from gc
     auto it = mmap_gc_pool.find(base);
     assert(it != mmap_gc_pool.end());
@@ -303,6 +447,8 @@ public:
   // std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_function, this, std::placeholders::_1));
   static std::tuple<void *, size_t> mmap(std::string_view name, int fd, size_t size,
                                          std::function<bool(void *, bool)> gc_function) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
     auto [base, final_size] = mmap_step(name, fd, size);
     if (base == MAP_FAILED) {
       try_collect_mmap();
@@ -315,6 +461,8 @@ public:
       /* LCOV_EXCL_STOP */
     }
     n_open_mmaps++;
+    add_mapped(final_size);
+    stats.n_mmaps++;
 
     mmap_gc_entry entry;
     entry.name        = name;
@@ -331,8 +479,10 @@ public:
   }
 
   // mmap_vector.hpp: mmap_base     = reinterpret_cast<uint8_t *>(mmap_gc::remap(mmap_name, mmap_base, old_mmap_size, mmap_size));
-  // mmap_map.hpp:    mmap_txt_base = reinterpret_cast<uint64_t *>(mmap_gc::remap(mmap_name, mmap_txt_base, mmap_txt_size, size));
+  // mmap_txt.hpp:    std::tie(base, mmap_size) = mmap_gc::remap(mmap_name, mmap_base, mmap_size, size);
   static std::tuple<void *, size_t> remap(std::string_view mmap_name, void *mmap_old_base, size_t old_size, size_t new_size) {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
     if (new_size & 0xFFF) {
       new_size >>= 12;
       new_size++;
@@ -395,6 +545,11 @@ public:
 #endif
     auto entry = it->second;
     entry.size = new_size;
+    entry.age  = mmap_gc_entry::global_age++;  // growing, so in use
+
+    mapped_bytes -= old_size;
+    add_mapped(new_size);
+    stats.n_remaps++;
 
     // std::cerr << "mmap_gc_pool del name:" << entry.name << " fd:" << entry.fd << " base:" << mmap_old_base << std::endl;
     mmap_gc_pool.erase(it);  // old mmap_old_base
@@ -407,6 +562,8 @@ public:
   }
 
   static void try_collect_fd() {
+    std::lock_guard<std::recursive_mutex> guard(gc_mutex);
+
     // std::cerr << "try_collect_fd\n";
     if (n_open_fds < n_max_fds) {  // readjust max
       n_max_fds = 1 + 3 * n_open_fds / 4;
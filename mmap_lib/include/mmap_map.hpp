@@ -47,14 +47,17 @@
 #include <algorithm>
 
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <iostream>
 
 #include "mmap_gc.hpp"
 #include "mmap_hash.hpp"
+#include "mmap_txt.hpp"
 
 //#define mmap_map_LOG_ENABLED
 #ifdef mmap_map_LOG_ENABLED
@@ -411,6 +414,28 @@ struct hash<std::vector<T>> {
 	}
 };
 
+// Keys that are (close to) dense ids can be directly indexed by the map (no
+// hashing). The position must be unique for each key (a == b iff pos(a) ==
+// pos(b)). Integral types use the value, specialize it for id classes like:
+//
+// template <>
+// struct dense_key<Node::Compact_class> {
+//   static constexpr bool enabled = true;
+//   constexpr uint64_t operator()(Node::Compact_class const &o) const { return o.nid; }
+// };
+template <typename T, typename Enable = void>
+struct dense_key {
+	static constexpr bool enabled = false;
+};
+
+template <typename T>
+struct dense_key<T, std::enable_if_t<std::is_integral<T>::value>> {
+	static constexpr bool enabled = true;
+	constexpr uint64_t operator()(T const& obj) const {
+		return static_cast<uint64_t>(obj); // negative numbers are too big for dense
+	}
+};
+
 
 namespace detail {
 
@@ -421,7 +446,7 @@ namespace detail {
 //
 // This implementation uses the following memory layout:
 //
-// [Node, Node, ... Node | info, info, ... infoSentinel ]
+// [header | Node, Node, ... Node | info, info, ... infoSentinel ]
 //
 // * Node: either a DataNode that directly has the std::pair<key, val> as member,
 //   or a DataNode with a pointer to std::pair<key,val>. Which DataNode representation to use
@@ -438,6 +463,33 @@ namespace detail {
 // for a idx
 //   variable.
 //
+// * header: mMask, mNumElements, mMaxNumElementsAllowed, mInfoInc, mInfoHashShift, mDense,
+//   mLevel, mSplit, mDenseMax, mDenseMaxStale, mChunk[4], and the Header_format word (Header_words,
+//   some reserved). A file without the current Header_format is rejected at reload (older
+//   layouts do not have it).
+//
+// The file has space for mMask+1 (capacity) buckets plus Overflow_slots. Probing does not
+// wrap around, the overflow slots are always enough because the info byte limits the probe
+// distance. The info array is after the Nodes so that a capacity change only moves the info
+// bytes (mremap keeps the Nodes in place).
+//
+// Sparse mode uses linear hashing (incremental resize). There are mLevel+mSplit buckets. The
+// bucket is hash&(mLevel-1), or hash&(2*mLevel-1) if it is smaller than mSplit. The buckets
+// not split yet get twice the keys, so the limit is MaxLoadFactor100 over buckets/2 (the
+// unsplit buckets stay under MaxLoadFactor100, and the level is done when the load reaches
+// it). Over the limit one bucket is split (mSplit++); under half the limit one bucket is
+// merged back (mSplit--). A split/merge only moves the entries of one bucket, there is no
+// full rehash when the map grows or shrinks.
+//
+// Dense mode (mDense set in the header): When the Key has a dense_key, and at least
+// Dense_min_use100% of the positions up to the largest key are used, the key position is
+// the Node index. The info byte is just 1 (valid) or 0 (empty), no hashing or probing. The
+// Key is still stored in the Node so that iterators work and it can switch back to sparse.
+// A dense insert out of range grows the dense table in place (remap) or switches to sparse.
+// Sparse switches to dense when it starts a new level (mSplit==0) if the keys are dense
+// enough (mDenseMax is conservative, erase just marks it stale). Erase does not trigger a
+// switch, but it shrinks the dense table when the upper 3 chunks (mChunk) are empty.
+//
 // According to STL, order of templates has effect on throughput. That's why I've moved the boolean
 // to the front.
 // https://www.reddit.com/r/cpp/comments/ahp6iu/compile_time_binary_size_reductions_and_cs_future/eeguck4/
@@ -456,7 +508,13 @@ private:
   static constexpr bool    using_key_sview      = is_array_serializable<Key>::value;
   static constexpr bool    using_val_sview      = is_array_serializable<T>::value;
   static constexpr bool    using_sview          = using_key_sview || using_val_sview;
+  static constexpr bool    using_dense          = dense_key<Key>::enabled && !using_key_sview;
+	static constexpr size_t  Dense_min_use100     = 20;
 	static constexpr size_t  InitialNumElements   = 1024;
+	static constexpr size_t  Overflow_slots       = 256;  // > max probe distance (info byte limit)
+	static constexpr size_t  Header_words         = 16;
+	static constexpr size_t  Header_format_pos    = 14;
+	static constexpr uint64_t Header_format       = 0x3230765F70616D6DULL; // "mmap_v02" bump with any file layout change
 	static constexpr int     InitialInfoNumBits   = 5;
 	static constexpr uint8_t InitialInfoInc       = 1 << InitialInfoNumBits;
 	static constexpr uint8_t InitialInfoHashShift = sizeof(size_t) * 8 - InitialInfoNumBits;
@@ -538,14 +596,33 @@ private:
   void iter_free() const {
     assert(iter_cntr>0);
     iter_cntr--;
+    if constexpr (using_sview) {
+      txt->iter_cntr--;
+    }
   }
 
   void iter_new() const {
     iter_cntr++;
+    if constexpr (using_sview) {
+      txt->iter_cntr++;
+    }
   }
 
 	using Node = DataNode<Self>;
 
+	void setup_txt(txt_arena *shared_txt) {
+		if constexpr (using_sview) {
+			if (shared_txt) {
+				txt = shared_txt;
+			} else {
+				own_txt = std::make_unique<txt_arena>(mmap_name.empty() ? "" : mmap_name + "txt");
+				txt     = own_txt.get();
+			}
+		} else {
+			(void)shared_txt;  // No array_serializable data
+		}
+	}
+
 	// Iter ////////////////////////////////////////////////////////////
 
 	struct fast_forward_tag {};
@@ -673,14 +750,14 @@ private:
 	////////////////////////////////////////////////////////////////////
 
 	size_t calcNumBytesInfo(size_t numElements) const noexcept {
-		const size_t s = sizeof(uint8_t) * (numElements + 1);
-		assert(s / sizeof(uint8_t) == numElements + 1);
+		const size_t s = sizeof(uint8_t) * (numElements + Overflow_slots + 1);
+		assert(s / sizeof(uint8_t) == numElements + Overflow_slots + 1);
 		// make sure it's a bit larger, so we can load 64bit numbers
 		return s + sizeof(uint64_t);
 	}
 	size_t calcNumBytesNode(size_t numElements) const noexcept {
-		const size_t s = sizeof(Node) * numElements;
-		assert(s / sizeof(Node) == numElements);
+		const size_t s = sizeof(Node) * (numElements + Overflow_slots);
+		assert(s / sizeof(Node) == numElements + Overflow_slots);
 		return s;
 	}
 	size_t calcNumBytesTotal(size_t numElements) const noexcept {
@@ -691,7 +768,6 @@ private:
 		return s;
 	}
 
-  // gc_done can be called for mmap_base or mmap_txt_base
 	bool gc_done(void *base, bool force_recycle) const noexcept {
     if (iter_cntr && !force_recycle)
       return true;
@@ -709,54 +785,17 @@ private:
     // mmap_size = 0;
     mmap_fd   = -1;
 
-    return false;
-	}
-
-	bool gc_txt_done(void *base, bool force_recycle) const {
-    if (iter_cntr && !force_recycle)
-      return true; // abort
-
-    assert(using_sview);
-    assert(mmap_txt_base == base);
-
-    if (mmap_txt_fd>=0 && mmap_txt_base[0] == 0) {
-      unlink((mmap_name+"txt").c_str());
-    }
-
-    mmap_txt_base = nullptr;
-    // NOTE: preserve mmap_txt_size to avoid read file in reload
-    // mmap_txt_size = 0;
-    mmap_txt_fd   = -1;
-
     return false;
 	}
 
 	size_t calc_mmap_size(size_t nelems) const {
-		size_t total = (3+2)*sizeof(uint64_t); // m* fields + 2 for alignment
+		size_t total = Header_words*sizeof(uint64_t);
 		total += calcNumBytesTotal(nelems);
 
 		return total;
 	}
 
-	void grow_txt_mmap(size_t size) {
-    assert(mmap_txt_size<size);
-    assert(mmap_txt_base);
-
-    void *base;
-    std::tie(base, mmap_txt_size) = mmap_gc::remap(mmap_name, mmap_txt_base, mmap_txt_size, size);
-    mmap_txt_base = reinterpret_cast<uint64_t *>(base);
-  }
-
-	std::tuple<uint64_t *, size_t> create_mmap(std::string name, int fd, size_t size) const {
-    auto gc_func = std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_done, this, std::placeholders::_1, std::placeholders::_2);
-
-    void *base = nullptr;
-    std::tie(base, size) = mmap_gc::mmap(name, fd, size, gc_func);
-
-		return std::make_tuple(reinterpret_cast<uint64_t *>(base),size);
-	}
-
-  __attribute__((noinline,cold)) void setup_mmap(size_t n_entries) const {
+  __attribute__((noinline,cold)) void setup_mmap(size_t n_entries, bool dense = using_dense) const {
 		assert(mmap_base == nullptr);
 
     auto new_mmap_size     = mmap_size;
@@ -781,11 +820,16 @@ private:
       if (n_entries) { // force a size
         new_mmap_size = calc_mmap_size(n_entries);
       }else if (mmap_size==0) { // first reload
-        int sz = read(mmap_fd,&n_entries,8);
-        if (sz!=8) {
+        uint64_t header[Header_words];
+        auto sz = pread(mmap_fd, header, sizeof(header), 0);
+        if (sz<=0 || (sz == sizeof(header) && header[0] == 0)) { // new (or never initialized) file
           n_entries = InitialNumElements;
         }else{
-          n_entries++; // We read mMask at base 0
+          if (sz != sizeof(header) || header[Header_format_pos] != Header_format) {
+            std::cerr << "mmap_map::reload ERROR " << mmap_name << " has an incompatible format (created by an older mmap_lib?). Delete it and regenerate it\n";
+            exit(-3);
+          }
+          n_entries = header[0] + 1; // mMask at base 0
           assert(n_entries>=InitialNumElements);
         }
         new_mmap_size = calc_mmap_size(n_entries);
@@ -801,68 +845,60 @@ private:
       mmap_base                 = reinterpret_cast<uint64_t*>(base);
     }
 
-    mMask                  = &mmap_base[0];
-    mNumElements           = &mmap_base[1];
-		mMaxNumElementsAllowed = &mmap_base[2];
-		mInfoInc               = reinterpret_cast<InfoType *>(&mmap_base[3]);
-		mInfoHashShift         = reinterpret_cast<InfoType *>(&mmap_base[4]);
+		setup_header_pointers();
 
-		mInfo = reinterpret_cast<uint8_t*>(&mmap_base[5]);
 		if (*mMask == n_entries - 1 || n_entries==0) {
-			assert(*mMaxNumElementsAllowed<*mMask);
+			assert(*mMaxNumElementsAllowed<=*mMask);
 			assert(calc_mmap_size(*mMask+1)<=mmap_size);
-			assert(mInfo[*mMask+1] == 1); // Sentinel
-			mKeyVals = reinterpret_cast<Node*>(&mmap_base[5+(*mMask+9)/sizeof(uint64_t)]);
+			assert(mInfo[slot_end()] == 1); // Sentinel
     }else{
 			assert(*mMaxNumElementsAllowed <= n_entries); // less due to load factor
 			assert(*mNumElements==0);
       // Setup intial mmap values
-			*mMaxNumElementsAllowed = calcMaxNumElementsAllowed(n_entries);
-			*mMask = n_entries - 1;
-			mInfo[n_entries] = 1; // Sentinel
+			*mMaxNumElementsAllowed = dense ? calcMaxNumElementsAllowed(n_entries) : calc_max_sparse(n_entries);
+			*mMask          = n_entries - 1;
       *mInfoInc       = InitialInfoInc;
       *mInfoHashShift = InitialInfoHashShift;
-			mKeyVals = reinterpret_cast<Node*>(&mmap_base[5+(*mMask+9)/sizeof(uint64_t)]); // 9 to be 8 byte aligned
+      *mDense         = dense ? 1 : 0;
+      *mLevel         = n_entries;
+      *mSplit         = 0;
+      *mDenseMax      = 0;
+      *mDenseMaxStale = 0;
+      for (auto i = 0; i < 4; ++i)
+        mChunk[i] = 0;
+      mmap_base[Header_format_pos] = Header_format;
+			setup_header_pointers(); // mInfo position depends on mMask
+			mInfo[slot_end()] = 1; // Sentinel
 		}
 	}
 
-  __attribute__((noinline,cold)) void setup_mmap_txt() const {
-    if constexpr (!using_sview) {
-      return;
-    }
-		assert(mmap_txt_base == nullptr);
-
-    auto new_mmap_txt_size = mmap_txt_size;
+	void setup_header_pointers() const {
+    mMask                  = &mmap_base[0];
+    mNumElements           = &mmap_base[1];
+		mMaxNumElementsAllowed = &mmap_base[2];
+		mInfoInc               = reinterpret_cast<InfoType *>(&mmap_base[3]);
+		mInfoHashShift         = reinterpret_cast<InfoType *>(&mmap_base[4]);
+		mDense                 = &mmap_base[5];
+		mLevel                 = &mmap_base[6];
+		mSplit                 = &mmap_base[7];
+		mDenseMax              = &mmap_base[8];
+		mDenseMaxStale         = &mmap_base[9];
+		mChunk                 = &mmap_base[10]; // 4 words
 
-    if (mmap_name.empty()) {
-      // MMAP_TXT------------------------------
-      assert(mmap_txt_fd == -1);
-      if (mmap_txt_size == 0) {  // First reload
-        new_mmap_txt_size = 8192;
-      }
-    }else{
-      // MMAP_TXT------------------------------
-      if (mmap_txt_fd<0) {
-        mmap_txt_fd = mmap_gc::open(mmap_name + "txt");
-        assert(mmap_txt_fd>=0);
-      }
-      if (mmap_txt_size==0) { // First reload
-        size_t entries;
-        int sz = read(mmap_txt_fd,&entries,8);
-        if (sz!=8) {
-          entries = 1024;
-        } else {
-          entries++;  // We read base 0
-        }
+		mKeyVals = reinterpret_cast<Node*>(&mmap_base[Header_words]);
+		mInfo    = reinterpret_cast<uint8_t*>(mKeyVals) + calcNumBytesNode(*mMask+1);
+	}
 
-        new_mmap_txt_size = entries*8;
-      }
-    }
+	// Number of buckets (linear hashing) in sparse mode
+	size_t buckets() const {
+		return *mLevel + *mSplit;
+	}
 
-    auto gc_func = std::bind(&map<MaxLoadFactor100, Key, T, Hash>::gc_txt_done, this, std::placeholders::_1, std::placeholders::_2);
-    void *base = nullptr;
-    std::tie(base, mmap_txt_size) = mmap_gc::mmap(mmap_name + "txt", mmap_txt_fd, new_mmap_txt_size, gc_func);
-		mmap_txt_base = reinterpret_cast<uint64_t *>(base);
+	// Slot with the infoSentinel (end() iterator)
+	size_t slot_end() const {
+		if (*mDense)
+			return *mMask + 1;
+		return buckets() + Overflow_slots;
 	}
 
 	__attribute__((inline)) void reload() const {
@@ -874,16 +910,6 @@ private:
 
       assert(mmap_base);
     }
-    if constexpr (using_sview) {
-      if (MMAP_LIB_UNLIKELY(mmap_txt_base == nullptr)) {
-        assert(mmap_txt_base == nullptr);
-        assert(mmap_txt_fd < 0);
-
-        setup_mmap_txt();
-
-        assert(mmap_txt_base);
-      }
-    }
   }
 
         // highly performance relevant code.
@@ -897,15 +923,35 @@ private:
 
     reload();
 
-    idx = Hash::operator()(key) * bad_hash_prevention;
-		info = static_cast<InfoType>(*mInfoInc + static_cast<InfoType>(idx >> *mInfoHashShift));
-		idx &= *mMask;
+    const size_t h = Hash::operator()(key) * bad_hash_prevention;
+		info = static_cast<InfoType>(*mInfoInc + static_cast<InfoType>(h >> *mInfoHashShift));
+		idx  = static_cast<int>(bucket_of(h));
+	}
+
+	size_t bucket_of(size_t h) const {
+		auto b = h & (*mLevel - 1);
+		if (b < *mSplit)
+			b = h & (2 * *mLevel - 1);
+		return b;
 	}
 
-	// forwards the index by one, wrapping around at the end
+	// Same hash used by keyToIdx for an entry already in the map
+	size_t node_hash(const Node &n) const {
+		static constexpr size_t bad_hash_prevention =
+			std::is_same<::mmap_lib::hash<key_type>, hasher>::value
+			? 1
+			: (mmap_map_BITNESS == 64 ? UINT64_C(0xb3727c1f779b8d8b) : UINT32_C(0xda4afe47));
+
+		if constexpr (using_key_sview) {
+			return Hash::operator()(get_sview(n.getFirst())) * bad_hash_prevention;
+		} else {
+			return Hash::operator()(n.getFirst()) * bad_hash_prevention;
+		}
+	}
+
+	// forwards the index by one (no wrap around, overflow slots at the end)
 	inline int next_idx(int idx) const {
-		idx = (idx + 1) & *mMask;
-    return idx;
+    return idx + 1;
 	}
 
 	inline InfoType next_info(InfoType info) const {
@@ -939,7 +985,7 @@ private:
 		}
 #endif
 		while (idx != insertion_idx) {
-			unsigned int prev_idx = (idx - 1) & *mMask;
+			int prev_idx = idx - 1;
 #if 1
 			std::memmove(&mKeyVals[idx],&mKeyVals[prev_idx],sizeof(Node));
 #else
@@ -991,6 +1037,10 @@ private:
 	template <typename Other>
 		int findIdx(Other const& key) const {
       reload();
+			if constexpr (using_dense) {
+				if (*mDense)
+					return dense_findIdx(key);
+			}
 			int idx;
 			InfoType info;
 			keyToIdx(key, idx, info);
@@ -1013,6 +1063,27 @@ private:
 			return -1; //*mMask == 0 ? 0 : *mMask + 1;
 		}
 
+	int dense_findIdx(const Key &key) const {
+		const auto pos = dense_key<Key>{}(key);
+		if (pos > *mMask || mInfo[pos] == 0)
+			return -1;
+		return static_cast<int>(pos);
+	}
+
+	// insert_move for dense mode (key guaranteed to be new and in range)
+	size_t dense_insert_move(Node&& keyval) {
+		const auto pos = dense_key<Key>{}(keyval.getFirst());
+		assert(pos <= *mMask);
+		assert(mInfo[pos] == 0);
+
+		std::memmove(&mKeyVals[pos], &keyval, sizeof(Node));
+		mInfo[pos] = 1;
+		++mChunk[chunk_of(pos)];
+
+		++(*mNumElements);
+		return pos;
+	}
+
 	// inserts a keyval that is guaranteed to be new, e.g. when the hashmap is resized.
 	// @return index where the element was created
 	size_t insert_move(Node&& keyval) {
@@ -1083,6 +1154,12 @@ private:
   static inline uint64_t static_mMaxNumElementsAllowed = 0;
   static inline InfoType static_InitialInfoInc         = InitialInfoInc;
   static inline InfoType static_InitialInfoHashShift   = InitialInfoHashShift;
+  static inline uint64_t static_mDense                 = 0;
+  static inline uint64_t static_mLevel                 = 0;
+  static inline uint64_t static_mSplit                 = 0;
+  static inline uint64_t static_mDenseMax              = 0;
+  static inline uint64_t static_mDenseMaxStale         = 0;
+  static inline uint64_t static_mChunk[4]              = {0, 0, 0, 0};
 
   void setup_pointers() {
 
@@ -1093,6 +1170,12 @@ private:
 		mMaxNumElementsAllowed = &static_mMaxNumElementsAllowed;
 		mInfoInc               = &static_InitialInfoInc;
 		mInfoHashShift         = &static_InitialInfoHashShift;
+		mDense                 = &static_mDense;
+		mLevel                 = &static_mLevel;
+		mSplit                 = &static_mSplit;
+		mDenseMax              = &static_mDenseMax;
+		mDenseMaxStale         = &static_mDenseMaxStale;
+		mChunk                 = static_mChunk;
 
 #if 0
     for(auto &ent:memoize_sview_insert) {
@@ -1104,7 +1187,8 @@ public:
 	using iterator = Iter<false>;
 	using const_iterator = Iter<true>;
 
-	explicit map(std::string_view _path, std::string_view _map_name)
+	// shared_txt: txt_arena owned by the caller (bimap). Otherwise the map has its own
+	explicit map(std::string_view _path, std::string_view _map_name, txt_arena *shared_txt = nullptr)
 		: Hash{Hash{}}
 	  , mmap_path(_path.empty()?".":_path)
 	  , mmap_name{_map_name.empty()?"":(std::string(_path) + std::string("/") + std::string(_map_name))} {
@@ -1117,12 +1201,14 @@ public:
       }
     }
 
+    setup_txt(shared_txt);
     setup_pointers();
 	}
 
 	explicit map()
 		: Hash{Hash{}} {
 
+    setup_txt(nullptr);
     setup_pointers();
 	}
 
@@ -1143,18 +1229,19 @@ public:
     mmap_size = 0;
 
     if constexpr (using_sview) {
-      assert(using_sview);
-      if (mmap_txt_base != nullptr) {
-        mmap_gc::recycle(mmap_txt_base);
-      }
-      if (!mmap_name.empty()) {
-        unlink((mmap_name + "txt").c_str());
-      }
-      mmap_txt_base = nullptr;
-      mmap_txt_size = 0;
+      if (own_txt) // A shared txt_arena is cleared by the owner
+        own_txt->clear();
     }
 	}
 
+  // Release the mmap and fd (reloaded on demand). Not while iterating, or for anonymous maps
+  void sync() {
+    if (iter_cntr || mmap_name.empty())
+      return;
+
+    destroy();
+  }
+
 	// Destroys the map and all it's contents.
 	virtual ~map() {
 		destroy();
@@ -1209,19 +1296,14 @@ public:
 
   // FIXME: enable_if T or Key is array_serializable
 	array_type get_sview(uint32_t key_pos) const {
-    reload();
-		if(MMAP_LIB_UNLIKELY(key_pos>=mmap_txt_base[0])) {
-      array_type sview;
-      return sview;
-    }
+		const auto data = txt->get(key_pos);
 
     using tt = typename array_type::value_type;
     if constexpr (std::is_same_v<array_type,std::string_view>) {
-      array_type sview(reinterpret_cast<const tt *>(&mmap_txt_base[key_pos+1]),mmap_txt_base[key_pos]);
-      return sview;
+      return data;
     }else{
-      array_type sview(reinterpret_cast<const tt *>(&mmap_txt_base[key_pos+1]),
-                       reinterpret_cast<const tt *>(((const char *)&mmap_txt_base[key_pos+1])+mmap_txt_base[key_pos]));
+      array_type sview(reinterpret_cast<const tt *>(data.data()),
+                       reinterpret_cast<const tt *>(data.data() + data.size()));
       return sview;
     }
 	}
@@ -1348,19 +1430,19 @@ public:
     reload();
 		// no need to supply valid info pointer: end() must not be dereferenced, and only node
 		// pointer is compared.
-		return iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1]), nullptr};
+		return iterator{this, reinterpret_cast<Node*>(&mKeyVals[slot_end()]), nullptr};
 	}
 	[[nodiscard]] const_iterator end() const {
 		return cend();
 	}
 	[[nodiscard]] const_iterator cend() const {
     reload();
-		return const_iterator{this, reinterpret_cast<Node*>(&mKeyVals[*mMask+1]), nullptr};
+		return const_iterator{this, reinterpret_cast<Node*>(&mKeyVals[slot_end()]), nullptr};
 	}
 
 	iterator erase(const_iterator &pos) {
 		// its safe to perform const cast here
-		return erase(iterator{nullptr, const_cast<Node*>(pos.mKeyVals), const_cast<uint8_t*>(pos.mInfo)});
+		return erase(iterator{this, const_cast<Node*>(pos.mKeyVals), const_cast<uint8_t*>(pos.mInfo)});
 	}
 
 	// Erases element at pos, returns iterator to the next element.
@@ -1368,6 +1450,18 @@ public:
 		// we assume that pos always points to a valid entry, and not end().
 		auto const idx = static_cast<size_t>(pos.mKeyVals - mKeyVals);
 
+		if constexpr (using_dense) {
+			if (*mDense) {
+				mKeyVals[idx].destroy(*this);
+				mInfo[idx] = 0;
+				--mChunk[chunk_of(idx)];
+				--(*mNumElements);
+				return ++pos;
+			}
+			if (dense_key<Key>{}(pos->first) == *mDenseMax)
+				*mDenseMaxStale = 1;
+		}
+
 		shiftDown(idx);
 		--(*mNumElements);
 
@@ -1381,6 +1475,21 @@ public:
 	}
 
 	size_t erase(const key_type& key) {
+		if constexpr (using_dense) {
+			reload();
+			if (*mDense) {
+				const auto pos = dense_findIdx(key);
+				if (pos < 0)
+					return 0;
+				mKeyVals[pos].destroy(*this);
+				mInfo[pos] = 0;
+				--mChunk[chunk_of(pos)];
+				--(*mNumElements);
+				try_shrink();
+				return 1;
+			}
+		}
+
 		int idx;
 		InfoType info;
 		keyToIdx(key, idx, info);
@@ -1388,8 +1497,13 @@ public:
 		// check while info matches with the source idx
 		do {
 			if (info == mInfo[idx] && equals(key, mKeyVals[idx].getFirst())) {
+				if constexpr (using_dense) {
+					if (dense_key<Key>{}(key) == *mDenseMax)
+						*mDenseMaxStale = 1;
+				}
 				shiftDown(idx);
 				--(*mNumElements);
+				try_shrink();
 				return 1;
 			}
       idx  = next_idx(idx);
@@ -1401,20 +1515,32 @@ public:
 	}
 
 	void reserve(size_t count) {
+		reload();
+
+		const bool dense = is_dense();
+
 		auto newSize = InitialNumElements > *mMask + 1 ? InitialNumElements : *mMask + 1;
-		while (calcMaxNumElementsAllowed(newSize) < count && newSize != 0) {
+		while ((dense ? calcMaxNumElementsAllowed(newSize) : calc_max_sparse(newSize)) < count && newSize != 0) {
 			newSize *= 2;
 		}
 		assert(newSize != 0);
 
-		rehash(newSize);
+		if (dense) {
+			if (newSize > *mMask + 1)
+				resize_capacity(newSize);
+			return;
+		}
+
+		rehash(newSize, false);
 	}
 
 	[[nodiscard]] size_type size() const {
+		reload();  // the header may be released (sync or mmap_gc)
 		return *mNumElements;
 	}
 
 	[[nodiscard]] bool empty() const {
+		reload();
 		return 0 == *mNumElements;
 	}
 
@@ -1427,23 +1553,77 @@ public:
 		return calcMaxNumElementsAllowed(InitialNumElements);
 	}
 
+	// True when the keys are directly indexed (no hashing)
+	[[nodiscard]] bool is_dense() const {
+		if constexpr (using_dense) {
+			reload();
+			return *mDense != 0;
+		} else {
+			return false;
+		}
+	}
+
 	[[nodiscard]] float max_load_factor() const {
 		return MaxLoadFactor100 / 100.0f;
 	}
 
 	// Average number of elements per bucket. Since we allow only 1 per bucket
 	[[nodiscard]] float load_factor() const {
-		return static_cast<float>(size()) / (*mMask + 1);
+		if (is_dense())
+			return static_cast<float>(size()) / (*mMask + 1);
+		return static_cast<float>(size()) / buckets();
 	}
 
 	[[nodiscard]] size_t txt_size() const {
 		if constexpr (using_sview) {
-			return mmap_txt_size;
+			return txt->size();
 		}else{
 			return 0;
 		}
 	}
 
+	// Positions used in the txt_arena (for the compaction of a shared txt_arena)
+	void txt_positions(std::vector<uint32_t> &live) const {
+		static_assert(using_sview);
+		reload();
+		for (size_t i = 0; i < slot_end(); ++i) {
+			if (mInfo[i] == 0)
+				continue;
+			if constexpr (using_key_sview) {
+				live.emplace_back(mKeyVals[i].getFirst());
+			} else {
+				live.emplace_back(mKeyVals[i].getSecond());
+			}
+		}
+	}
+
+	// Update the positions after a txt_arena compact (the hash does not change)
+	void txt_relocate(const absl::flat_hash_map<uint32_t, uint32_t> &old2new) {
+		static_assert(using_sview);
+		reload();
+		for (size_t i = 0; i < slot_end(); ++i) {
+			if (mInfo[i] == 0)
+				continue;
+			if constexpr (using_key_sview) {
+				auto &pos = mKeyVals[i].getFirst();
+				pos       = old2new.at(pos);
+			} else {
+				auto &pos = mKeyVals[i].getSecond();
+				pos       = old2new.at(pos);
+			}
+		}
+	}
+
+	// Drop the dead entries of the txt_arena (only when not shared)
+	void compact_txt() {
+		static_assert(using_sview);
+		assert(own_txt);
+
+		std::vector<uint32_t> live;
+		txt_positions(live);
+		txt_relocate(own_txt->compact(live));
+	}
+
 #ifndef NDEBUG
 	float conflict_factor() const {
 		return static_cast<float>(conflicts) / (*mNumElements + 1);
@@ -1453,13 +1633,16 @@ public:
 #endif
 
 private:
-	void rehash(size_t numBuckets) {
+	// Full rehash to a new mmap. Only for dense/sparse switches, reserve, or a really bad hash
+	// (grow/shrink is incremental with split_bucket/merge_bucket)
+	void rehash(size_t numBuckets, bool dense) {
 		assert(MMAP_LIB_UNLIKELY((numBuckets & (numBuckets - 1)) == 0)); // rehash only allowed for power of two
+		assert(!dense || using_dense);
 
     reload();
 
-		const size_t oldMaxElements = *mMask + 1;
-		if (oldMaxElements >= numBuckets)
+		const size_t oldMaxElements = slot_end();
+		if (is_dense() == dense && (dense ? *mMask + 1 : buckets()) >= numBuckets)
 			return; // done
 
     if (mmap_fd >= 0) {
@@ -1475,20 +1658,29 @@ private:
 
     assert(mmap_fd == -1);
     mmap_base = nullptr;
-		setup_mmap(numBuckets);
+		setup_mmap(numBuckets, dense);
 
     assert(old_mmap_base != mmap_base);
     assert(oldKeyVals != mKeyVals);
     assert(oldInfo != mInfo);
 		assert(*mNumElements == 0);
 		assert(*mMask == numBuckets - 1);
-		assert(*mMaxNumElementsAllowed == calcMaxNumElementsAllowed(numBuckets));
+		assert(*mMaxNumElementsAllowed == (dense ? calcMaxNumElementsAllowed(numBuckets) : calc_max_sparse(numBuckets)));
 
 		//std::cout << "resize sz:" << numBuckets << " mmap_name:" << mmap_name << "\n";
 
 		for (size_t i = 0; i < oldMaxElements; ++i) {
 			if (oldInfo[i] != 0) {
-				insert_move(std::move(oldKeyVals[i]));
+				if constexpr (using_dense) {
+					if (dense) {
+						dense_insert_move(std::move(oldKeyVals[i]));
+					} else {
+						*mDenseMax = std::max(*mDenseMax, dense_key<Key>{}(oldKeyVals[i].getFirst()));
+						insert_move(std::move(oldKeyVals[i]));
+					}
+				} else {
+					insert_move(std::move(oldKeyVals[i]));
+				}
 				// destroy the node but DON'T destroy the data.
 				oldKeyVals[i].~Node();
 			}
@@ -1502,75 +1694,55 @@ private:
 		return *mMask;
 	}
 
-#if 0
-  int recently_inserted(array_type txt) const {
-    uint32_t h = hash_bytes(txt.data(), txt.size());
-    const auto &ent = memoize_sview_insert[h%memoize_sview_insert.size()];
-
-    if (ent.second == h && ent.first) {
-      // OK, check contents if there is a match
-      const auto *data = get_sview(ent.first).data(); // data is null if empty array
-      if (data && std::memcmp(data, txt.data(), txt.size()) == 0) return ent.first;
-    }
-
-    return -1;
-  }
-#endif
-
-  uint32_t allocate_sview_id(array_type txt) {
-#if 0
-    auto pos = recently_inserted(txt);
-    if (pos >= 0) {
-      return pos;
-    }
-#endif
-
-    reload();
-
+  uint32_t allocate_sview_id(array_type data) {
     static_assert(using_sview);
 
-    assert(txt.size()<40000); // OK to go bigger but likely bug
-
-    auto insert_point = mmap_txt_base[0]+1;
-    if (mmap_txt_size <= (8*insert_point+8*txt.size())) {
-      auto new_size = mmap_txt_size*2;
-      if (new_size < 8*insert_point+8*txt.size())
-        new_size = 8*insert_point+8*txt.size();
-      grow_txt_mmap(new_size);
-    }
-    assert(mmap_txt_size > (8*insert_point+txt.size()));
-
-    char *ptr = reinterpret_cast<char *>(&mmap_txt_base[insert_point+1]);
-    std::memcpy(ptr, txt.data(), txt.size());
-    assert(txt.size()<4096); // Objects should not be insane (optimize otherwise)
-    mmap_txt_base[insert_point] = txt.size();
-    auto bytes = txt.size();
-
-    // Extra space from bytes&0xF to xtra_space
-    // 0 -> 0
-    // 1 -> 15
-    // 2 -> 14
-    // 14 -> 2
-    // 15 -> 1
-    uint8_t xtra_space = bytes&0xF;
-    xtra_space = (~xtra_space)&0xF;
-    mmap_txt_base[0] += 1+(bytes+xtra_space+7)/8; // +7 to cheaply round up, +1 for the strlen
-
-#if 0
-    {
-      uint32_t h = hash_bytes(txt.data(), txt.size());
-      auto &ent = memoize_sview_insert[h%memoize_sview_insert.size()];
-      ent.first = insert_point;
-      ent.second = h;
-    }
-#endif
-
-		return insert_point;
+    using tt = typename array_type::value_type;
+    return txt->insert(std::string_view(reinterpret_cast<const char *>(data.data()), sizeof(tt) * data.size()));
 	}
 
+	template <typename Arg, typename Data>
+		void construct_node(Node &l, Arg&& key, Data&& val) {
+			if constexpr (using_key_sview) {
+				uint32_t key_pos = allocate_sview_id(key);
+				::new (static_cast<void*>(&l))
+					Node(*this, std::piecewise_construct,
+							std::forward_as_tuple(key_pos), std::forward_as_tuple(val));
+			}else if constexpr (using_val_sview) {
+				uint32_t val_pos = allocate_sview_id(val);
+				::new (static_cast<void*>(&l))
+					Node(*this, std::piecewise_construct,
+							std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
+			}else{
+				::new (static_cast<void*>(&l))
+					Node(*this, std::piecewise_construct,
+							std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val));
+			}
+		}
+
 	template <typename Arg, typename Data>
 		iterator doCreate(Arg&& key, Data&& val) {
 			while (true) {
+				if constexpr (using_dense) {
+					reload();
+					if (*mDense) {
+						const auto pos = dense_key<Key>{}(key);
+						if (MMAP_LIB_UNLIKELY(pos > *mMask)) {
+							dense_grow(pos);
+							continue;
+						}
+
+						construct_node(mKeyVals[pos], std::forward<Arg>(key), std::forward<Data>(val));
+						if (mInfo[pos] == 0) {
+							mInfo[pos] = 1;
+							++mChunk[chunk_of(pos)];
+							++(*mNumElements);
+						}
+
+						return iterator{this, mKeyVals + pos, mInfo + pos};
+					}
+				}
+
 				int idx;
 				InfoType info;
 				keyToIdx(key, idx, info);
@@ -1593,10 +1765,18 @@ private:
         if (!found) {
           // unlikely that this evaluates to true
           if (MMAP_LIB_UNLIKELY(*mNumElements >= *mMaxNumElementsAllowed)) {
-            increase_size();
+            if constexpr (using_dense) {
+              increase_size(dense_key<Key>{}(key));
+            } else {
+              increase_size(0);
+            }
             continue;
           }
 
+          if constexpr (using_dense) {
+            *mDenseMax = std::max(*mDenseMax, dense_key<Key>{}(key));
+          }
+
           // key not found, so we are now exactly where we want to insert it.
           if (MMAP_LIB_UNLIKELY(insertion_info + *mInfoInc > 0xFF)) {
             *mMaxNumElementsAllowed = 0;
@@ -1610,40 +1790,13 @@ private:
         }
 
 				auto& l = mKeyVals[insertion_idx];
-				if (idx == insertion_idx) {
-					// put at empty spot. This forwards all arguments into the node where the object is
-					// constructed exactly where it is needed.
-					if constexpr (using_key_sview) {
-						uint32_t key_pos = allocate_sview_id(key);
-						::new (static_cast<void*>(&l))
-							Node(*this, std::piecewise_construct,
-									std::forward_as_tuple(key_pos), std::forward_as_tuple(val));
-          }else if constexpr (using_val_sview) {
-						uint32_t val_pos = allocate_sview_id(val);
-						::new (static_cast<void*>(&l))
-							Node(*this, std::piecewise_construct,
-									std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
-					}else{
-						::new (static_cast<void*>(&l))
-							Node(*this, std::piecewise_construct,
-									std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val));
-					}
-				} else {
+				if (idx != insertion_idx) {
           assert(!found);
 					shiftUp(idx, insertion_idx);
-					if constexpr (using_key_sview) {
-						uint32_t key_pos = allocate_sview_id(key);
-            ::new (&l) Node(*this, std::piecewise_construct,
-								std::forward_as_tuple(key_pos), std::forward_as_tuple(val));
-          }else if constexpr (using_val_sview) {
-						uint32_t val_pos = allocate_sview_id(val);
-            ::new (&l) Node(*this, std::piecewise_construct,
-								std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val_pos));
-					}else{
-            ::new (&l) Node(*this, std::piecewise_construct,
-								std::forward_as_tuple(std::forward<Arg>(key)), std::forward_as_tuple(val));
-					}
 				}
+				// This forwards all arguments into the node where the object is constructed exactly
+				// where it is needed.
+				construct_node(l, std::forward<Arg>(key), std::forward<Data>(val));
 
         if (!found) {
           // mKeyVals[idx].getFirst() = std::move(key);
@@ -1657,6 +1810,11 @@ private:
 			}
 		}
 
+	// Linear hashing limit: the buckets not split yet have twice the load
+	size_t calc_max_sparse(size_t n_buckets) const {
+		return calcMaxNumElementsAllowed(n_buckets / 2);
+	}
+
 	size_t calcMaxNumElementsAllowed(size_t maxElements) const {
 		static constexpr size_t overflowLimit = (std::numeric_limits<size_t>::max)() / 100;
 		static constexpr double factor = MaxLoadFactor100 / 100.0;
@@ -1672,7 +1830,7 @@ private:
 	bool try_increase_info() {
 		mmap_map_LOG("mInfoInc=" << *mInfoInc << ", numElements=" << mNumElements
 				<< ", maxNumElementsAllowed="
-				<< calcMaxNumElementsAllowed(mMask + 1));
+				<< calc_max_sparse(buckets()));
 		if (*mInfoInc <= 2) {
 			// need to be > 2 so that shift works (otherwise undefined behavior!)
 			return false;
@@ -1684,58 +1842,286 @@ private:
 		// This is extremely fast because we can operate on 8 bytes at once.
 		++(*mInfoHashShift);
 		auto const data = reinterpret_cast<uint64_t*>(mInfo);
-		auto const numEntries = (*mMask + 1) / 8;
+		auto const numEntries = (slot_end() + 7) / 8;
 
 		for (size_t i = 0; i < numEntries; ++i) {
 			data[i] = (data[i] >> 1) & UINT64_C(0x7f7f7f7f7f7f7f7f);
 		}
-		*mMaxNumElementsAllowed = calcMaxNumElementsAllowed(*mMask + 1);
+		mInfo[slot_end()] = 1; // Sentinel
+		*mMaxNumElementsAllowed = calc_max_sparse(buckets());
 		return true;
 	}
 
-	void increase_size() {
+	// Dense table size for keys up to max_pos, 0 if too sparse
+	size_t calc_dense_buckets(uint64_t max_pos, size_t n_elements) const {
+		if (max_pos < InitialNumElements)
+			return InitialNumElements; // same size as the smallest sparse map
+
+		if (max_pos >= (n_elements * 100) / Dense_min_use100)
+			return 0;
+
+		size_t buckets = InitialNumElements;
+		while (buckets <= max_pos)
+			buckets *= 2;
+
+		if (buckets * Dense_min_use100 > n_elements * 100)
+			return 0;
+
+		return buckets;
+	}
+
+	// Dense insert with a key position out of the table
+	void dense_grow(uint64_t pos) {
+		assert(is_dense());
+		assert(pos > *mMask);
+
+		const auto n_elements = *mNumElements + 1;
+
+		auto buckets = calc_dense_buckets(pos, n_elements);
+		if (buckets) {
+			resize_capacity(buckets); // keys do not move
+			return;
+		}
+
+		buckets = InitialNumElements;
+		while (calc_max_sparse(buckets) <= n_elements)
+			buckets *= 2;
+
+		rehash(buckets, false);
+		*mDenseMax = std::max(*mDenseMax, pos);
+	}
+
+	// Change the mmap capacity without moving the Nodes (only the info bytes move)
+	void resize_capacity(size_t new_cap) {
+		assert((new_cap & (new_cap - 1)) == 0);
+		assert(new_cap >= InitialNumElements);
+
+		const auto old_cap = *mMask + 1;
+		const auto old_end = slot_end();
+		const auto new_end = *mDense ? new_cap : old_end;
+		assert(*mDense || buckets() <= new_cap);
+		const auto n_copy  = std::min(old_end, new_end); // info is zero after the last bucket+Overflow_slots
+
+		const auto old_size = mmap_size;
+		const auto new_size = calc_mmap_size(new_cap);
+		if (new_cap > old_cap)
+			remap_mmap(new_size);
+
+		uint8_t *old_info = mInfo;
+		uint8_t *new_info = reinterpret_cast<uint8_t*>(mKeyVals) + calcNumBytesNode(new_cap);
+		std::memmove(new_info, old_info, n_copy);
+
+		// The file grows with zeroes, only clear what was inside the old file
+		uint8_t *clear_start = new_info + n_copy;
+		uint8_t *clear_end   = std::min(new_info + calcNumBytesInfo(new_cap), reinterpret_cast<uint8_t*>(mmap_base) + old_size);
+		if (clear_start < clear_end)
+			std::memset(clear_start, 0, clear_end - clear_start);
+		new_info[new_end] = 1; // Sentinel
+
+		*mMask = new_cap - 1;
+		if (new_cap < old_cap)
+			remap_mmap(new_size);
+		setup_header_pointers();
+
+		if (*mDense) {
+			*mMaxNumElementsAllowed = calcMaxNumElementsAllowed(new_cap);
+			if (new_cap == 2 * old_cap) { // keys do not move, the quarters merge in pairs
+				mChunk[0] += mChunk[1];
+				mChunk[1] = mChunk[2] + mChunk[3];
+				mChunk[2] = 0;
+				mChunk[3] = 0;
+			} else {
+				recount_chunks();
+			}
+		}
+	}
+
+	void remap_mmap(size_t new_size) {
+		if (((new_size + 0xFFF) & ~size_t(0xFFF)) == mmap_size)
+			return; // same number of pages
+
+		void *base;
+		std::tie(base, mmap_size) = mmap_gc::remap(mmap_name, mmap_base, mmap_size, new_size);
+		mmap_base = reinterpret_cast<uint64_t *>(base);
+		setup_header_pointers();
+	}
+
+	// mChunk has the number of dense entries in each quarter of the capacity
+	size_t chunk_of(size_t pos) const {
+		return (pos * 4) >> mmap_map_CTZ(*mMask + 1);
+	}
+
+	void recount_chunks() {
+		for (auto i = 0; i < 4; ++i)
+			mChunk[i] = 0;
+
+		const auto quarter = (*mMask + 1) / 4;
+		for (size_t i = 0; i <= *mMask; ++i) {
+			if (mInfo[i])
+				++mChunk[i / quarter];
+		}
+	}
+
+	// Move the entries of bucket mSplit that belong to the new bucket (mLevel+mSplit)
+	void split_bucket() {
+		assert(!is_dense());
+
+		const auto level = *mLevel;
+		const auto split = *mSplit;
+		if (buckets() + 1 > *mMask + 1)
+			resize_capacity(2 * (*mMask + 1));
+
+		std::vector<value_type> moved;
+		auto idx = split;
+		while (mInfo[idx]) { // entries are sorted by bucket, and there is no wrap around
+			const auto h = node_hash(mKeyVals[idx]);
+			const auto b = bucket_of(h);
+			if (b > split)
+				break;
+			if (b == split && (h & level)) {
+				moved.emplace_back(*mKeyVals[idx]);
+				shiftDown(idx);
+				--(*mNumElements);
+				continue;
+			}
+			++idx;
+		}
+
+		mInfo[slot_end()] = 0;
+		if (split + 1 == level) {
+			*mLevel = 2 * level;
+			*mSplit = 0;
+		} else {
+			*mSplit = split + 1;
+		}
+		mInfo[slot_end()] = 1; // Sentinel
+		if (*mMaxNumElementsAllowed) // 0 means info overflow, keep it
+			*mMaxNumElementsAllowed = calc_max_sparse(buckets());
+
+		for (auto &v : moved) {
+			insert_move(Node(*this, std::move(v)));
+		}
+	}
+
+	// Inverse of split_bucket: the last bucket goes back to its pair
+	void merge_bucket() {
+		assert(!is_dense());
+		assert(buckets() > InitialNumElements);
+
+		if (*mSplit == 0) { // same buckets, previous level
+			*mLevel = *mLevel / 2;
+			*mSplit = *mLevel;
+		}
+		const auto split = *mSplit - 1;
+		const auto src   = *mLevel + split;
+
+		std::vector<value_type> moved;
+		auto idx = src;
+		while (mInfo[idx]) {
+			const auto b = bucket_of(node_hash(mKeyVals[idx]));
+			if (b > src)
+				break;
+			if (b == src) {
+				moved.emplace_back(*mKeyVals[idx]);
+				shiftDown(idx);
+				--(*mNumElements);
+				continue;
+			}
+			++idx;
+		}
+
+		mInfo[slot_end()] = 0;
+		*mSplit = split;
+		mInfo[slot_end()] = 1; // Sentinel
+		if (*mMaxNumElementsAllowed) // 0 means info overflow, keep it
+			*mMaxNumElementsAllowed = calc_max_sparse(buckets());
+
+		for (auto &v : moved) {
+			insert_move(Node(*this, std::move(v)));
+		}
+
+		if (buckets() * 4 <= *mMask + 1 && *mMask + 1 > InitialNumElements)
+			resize_capacity((*mMask + 1) / 2);
+	}
+
+	// Called after an erase. Not when there are iterators (they would skip entries)
+	void try_shrink() {
+		if (iter_cntr)
+			return;
+
+		if (is_dense()) {
+			while (*mMask + 1 > InitialNumElements && mChunk[1] == 0 && mChunk[2] == 0 && mChunk[3] == 0)
+				resize_capacity((*mMask + 1) / 2);
+			return;
+		}
+
+		// A few merges per erase (each merge lowers the limit by less than one element)
+		while (buckets() > InitialNumElements && *mNumElements * 2 < calc_max_sparse(buckets()))
+			merge_bucket();
+	}
+
+	// pending_pos is the dense position of the key being inserted (if dense_key)
+	void increase_size(uint64_t pending_pos) {
 		// nothing allocated yet? just allocate InitialNumElements
 		if (*mMask == 0) {
 			reload();
 			return;
 		}
 
-		auto const maxNumElementsAllowed = calcMaxNumElementsAllowed(*mMask + 1);
-		if (*mNumElements < maxNumElementsAllowed && try_increase_info()) {
+		auto const maxNumElementsAllowed = calc_max_sparse(buckets());
+		if (*mMaxNumElementsAllowed == 0 || *mNumElements < maxNumElementsAllowed) {
+			if (try_increase_info())
+				return;
+
+			mmap_map_LOG("mNumElements=" << *mNumElements << ", maxNumElementsAllowed="
+					<< maxNumElementsAllowed << ", load="
+					<< (static_cast<double>(*mNumElements) * 100.0 / buckets()));
+			// it seems we have a really bad hash function! full rehash to get a clean info
+			rehash(2 * (*mMask + 1), false);
 			return;
 		}
 
-		mmap_map_LOG("mNumElements=" << *mNumElements << ", maxNumElementsAllowed="
-				<< maxNumElementsAllowed << ", load="
-				<< (static_cast<double>(*mNumElements) * 100.0 /
-					(static_cast<double>(*mMask) + 1)));
-		// it seems we have a really bad hash function! don't try to resize again
-		assert(*mNumElements * 2 >= calcMaxNumElementsAllowed(*mMask + 1));
+		if constexpr (using_dense) {
+			if (*mSplit == 0) { // New level, check if it is worth to switch to dense
+				if (*mDenseMaxStale) {
+					*mDenseMax      = 0;
+					*mDenseMaxStale = 0;
+					for (size_t i = 0; i < slot_end(); ++i) {
+						if (mInfo[i])
+							*mDenseMax = std::max(*mDenseMax, dense_key<Key>{}(mKeyVals[i].getFirst()));
+					}
+				}
 
-		rehash((*mMask + 1) * 2);
+				auto buckets = calc_dense_buckets(std::max(*mDenseMax, pending_pos), *mNumElements + 1);
+				if (buckets) {
+					rehash(buckets, true);
+					return;
+				}
+			}
+		} else {
+			(void)pending_pos;
+		}
+
+		split_bucket();
 	}
 
 	void destroy() {
+    if constexpr (using_sview) {
+      if (own_txt) {
+        // Most of the txt entries are dead (overwrites/erases). Compact while both are mapped
+        if (mmap_base && own_txt->should_compact(*mNumElements))
+          compact_txt();
+        own_txt->sync();
+      }
+    }
+
     if (mmap_base) {
       mmap_gc::recycle(mmap_base);
       assert(mmap_base == nullptr);
       assert(mmap_fd   == -1);
     }
-
-    if constexpr (using_sview) {
-      if (mmap_txt_base) {
-        mmap_gc::recycle(mmap_txt_base);
-        assert(mmap_txt_base == nullptr);
-        assert(mmap_txt_fd   == -1);
-      }
-    }
   }
 
-#if 0
-	// members are sorted so no padding occurs
-  std::array<std::pair<uint32_t,uint32_t>,8> memoize_sview_insert;
-#endif
-
 	mutable Node      *mKeyVals = nullptr;
 	mutable uint8_t   *mInfo = nullptr;
 	mutable uint64_t  *mNumElements;
@@ -1743,15 +2129,20 @@ private:
 	mutable uint64_t  *mMaxNumElementsAllowed;
 	mutable InfoType  *mInfoInc;
 	mutable InfoType  *mInfoHashShift;
+	mutable uint64_t  *mDense;
+	mutable uint64_t  *mLevel;
+	mutable uint64_t  *mSplit;
+	mutable uint64_t  *mDenseMax;
+	mutable uint64_t  *mDenseMaxStale;
+	mutable uint64_t  *mChunk;
 	const std::string  mmap_name;
 	const std::string  mmap_path;
 	mutable int        mmap_fd       = -1;
 	mutable size_t     mmap_size     = 0;
 	mutable uint64_t  *mmap_base     = 0;
   mutable int        iter_cntr     = 0;
-	mutable int        mmap_txt_fd   = -1;
-	mutable size_t     mmap_txt_size = 0;
-	mutable uint64_t  *mmap_txt_base = 0;
+	std::unique_ptr<txt_arena> own_txt;         // nullptr when shared (bimap)
+	txt_arena                 *txt = nullptr;
 #ifndef NDEBUG
 	size_t conflicts = 0;
 #endif
@@ -0,0 +1,277 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "mmap_gc.hpp"
+#include "mmap_hash.hpp"
+
+namespace mmap_lib {
+
+// Append-only storage for the array_serializable data (string_view, vector)
+// of map, bimap, and vset. An insert of data already in the txt_arena returns
+// the same position, and a bimap shares one txt_arena between the key2val and
+// val2key maps, so each string is stored once.
+//
+// File layout (64bit words):
+//   [0] next free word
+//   [1] number of entries appended (live or dead)
+//   [pos] size in bytes, followed by the data (zero padded)
+//
+// The dedup index (hash to position) is only in memory. It is built the first
+// time that something is inserted after open. Colliding hashes use the next
+// free hash value (probing), and a match always compares the data. Entries are never erased. The
+// owners call compact with the live positions and relocate them (the map/bimap
+// do it at sync when most of the entries are dead).
+class txt_arena {
+protected:
+  static constexpr uint64_t Header_words = 2;
+  static constexpr size_t   Min_size     = 8192;
+
+  const std::string mmap_name;  // empty is not persistent
+  mutable int       mmap_fd   = -1;
+  mutable size_t    mmap_size = 0;
+  mutable uint64_t *mmap_base = nullptr;
+
+  absl::flat_hash_map<uint64_t, uint32_t> dedup;  // hash -> pos
+  bool                                    dedup_ready = false;
+
+  // Words for an entry of bytes (+1 for the size). Keeps at least one zero
+  // byte after the data in most cases (C string friendly)
+  static uint64_t entry_words(uint64_t bytes) {
+    uint8_t xtra_space = bytes & 0xF;
+    xtra_space         = (~xtra_space) & 0xF;
+    return 1 + (bytes + xtra_space + 7) / 8;
+  }
+
+  bool gc_done(void *base, bool force_recycle) const {
+    if (iter_cntr && !force_recycle)
+      return true;  // abort
+
+    assert(mmap_base == base);
+    (void)base;
+
+    if (mmap_fd >= 0 && mmap_base[1] == 0) {
+      unlink(mmap_name.c_str());
+    }
+
+    mmap_base = nullptr;
+    // NOTE: preserve mmap_size to avoid read file in reload
+    mmap_fd = -1;
+
+    return false;
+  }
+
+  __attribute__((noinline, cold)) void setup_mmap() const {
+    assert(mmap_base == nullptr);
+
+    auto new_mmap_size = mmap_size;
+    if (mmap_name.empty()) {
+      assert(mmap_fd == -1);
+      if (mmap_size == 0)
+        new_mmap_size = Min_size;
+    } else {
+      if (mmap_fd < 0) {
+        mmap_fd = mmap_gc::open(mmap_name);
+        assert(mmap_fd >= 0);
+      }
+      if (mmap_size == 0) {  // First reload (mmap_gc uses the file size if bigger)
+        new_mmap_size = Min_size;
+      }
+    }
+
+    auto  gc_func = std::bind(&txt_arena::gc_done, this, std::placeholders::_1, std::placeholders::_2);
+    void *base    = nullptr;
+    std::tie(base, mmap_size) = mmap_gc::mmap(mmap_name, mmap_fd, new_mmap_size, gc_func);
+    mmap_base                 = reinterpret_cast<uint64_t *>(base);
+
+    if (mmap_base[0] == 0) {  // new file
+      mmap_base[0] = Header_words;
+      mmap_base[1] = 0;
+    }
+  }
+
+  void remap(size_t size) {
+    assert(mmap_base);
+
+    void *base;
+    std::tie(base, mmap_size) = mmap_gc::remap(mmap_name, mmap_base, mmap_size, size);
+    mmap_base                 = reinterpret_cast<uint64_t *>(base);
+  }
+
+  static uint64_t hash(std::string_view data) { return mmap_lib::hash64(data.data(), data.size()); }
+
+  void build_dedup() {
+    dedup.clear();
+    for (uint64_t pos = Header_words; pos < mmap_base[0]; pos += entry_words(mmap_base[pos])) {
+      auto h = hash(get_int(pos));
+      while (!dedup.try_emplace(h, pos).second) {
+        ++h;  // collision
+      }
+    }
+    dedup_ready = true;
+  }
+
+  std::string_view get_int(uint64_t pos) const {
+    return std::string_view(reinterpret_cast<const char *>(&mmap_base[pos + 1]), mmap_base[pos]);
+  }
+
+public:
+  mutable int iter_cntr = 0;  // Owner iterators alive (no gc)
+
+  explicit txt_arena(std::string _mmap_name) : mmap_name(std::move(_mmap_name)) {}
+
+  txt_arena(const txt_arena &o) = delete;
+  txt_arena &operator=(const txt_arena &o) = delete;
+
+  ~txt_arena() { sync(); }
+
+  void reload() const {
+    if (MMAP_LIB_UNLIKELY(mmap_base == nullptr)) {
+      setup_mmap();
+    }
+  }
+
+  // Releases the mmap (reopened on demand)
+  void sync() {
+    if (mmap_base) {
+      mmap_gc::recycle(mmap_base);
+      assert(mmap_base == nullptr);
+      assert(mmap_fd == -1);
+    }
+  }
+
+  void clear() {
+    if (mmap_base) {
+      mmap_gc::recycle(mmap_base);
+    }
+    if (!mmap_name.empty()) {
+      unlink(mmap_name.c_str());
+    }
+    mmap_base = nullptr;
+    mmap_size = 0;
+    dedup.clear();
+    dedup_ready = false;
+  }
+
+  // Position of data (same position if the data was already inserted)
+  uint32_t insert(std::string_view data) {
+    reload();
+
+    assert(data.size() < 40000);  // OK to go bigger but likely bug
+
+    if (!dedup_ready)
+      build_dedup();
+
+    auto h = hash(data);
+    while (true) {
+      auto it = dedup.find(h);
+      if (it == dedup.end())
+        break;
+      if (get_int(it->second) == data)
+        return it->second;
+      ++h;  // collision, not the same data
+    }
+
+    const uint64_t pos   = mmap_base[0];
+    const auto     words = entry_words(data.size());
+    if (mmap_size <= 8 * (pos + words)) {
+      auto new_size = std::max(mmap_size * 2, 8 * (pos + words + 1));
+      remap(new_size);
+    }
+    assert(pos + words <= (1ULL << 32));
+
+    mmap_base[pos] = data.size();
+    std::memcpy(&mmap_base[pos + 1], data.data(), data.size());
+    mmap_base[0] = pos + words;
+    mmap_base[1]++;
+
+    dedup.emplace(h, pos);
+
+    return pos;
+  }
+
+  // Empty if the position is not valid
+  std::string_view get(uint32_t pos) const {
+    reload();
+    if (MMAP_LIB_UNLIKELY(pos < Header_words || pos >= mmap_base[0]))
+      return std::string_view();
+
+    return get_int(pos);
+  }
+
+  // Position of the first entry inserted in an empty txt_arena
+  static constexpr uint32_t first_pos() { return Header_words; }
+
+  // Bytes mapped
+  size_t size() const { return mmap_size; }
+
+  // False if not accessed since the last sync
+  bool is_mapped() const { return mmap_base != nullptr; }
+
+  // Number of inserted (not deduplicated) entries, including the dead ones
+  size_t get_entries() const {
+    reload();
+    return mmap_base[1];
+  }
+
+  // Worth to compact if most of the entries are not used by the n_live owner entries
+  bool should_compact(size_t n_live) const {
+    if (mmap_base == nullptr)
+      return false;  // Not touched since last sync
+    return mmap_base[0] > Min_size / 8 && mmap_base[1] > 2 * n_live;
+  }
+
+  // Keeps only the live positions (any order, duplicates OK). Returns the
+  // old->new position for the owners to relocate their references.
+  absl::flat_hash_map<uint32_t, uint32_t> compact(std::vector<uint32_t> &live) {
+    reload();
+
+    std::sort(live.begin(), live.end());
+    live.erase(std::unique(live.begin(), live.end()), live.end());
+
+    absl::flat_hash_map<uint32_t, uint32_t> old2new;
+    old2new.reserve(live.size());
+
+    uint64_t dst = Header_words;
+    for (auto pos : live) {
+      assert(pos >= Header_words && pos < mmap_base[0]);
+      const auto words = entry_words(mmap_base[pos]);
+      if (dst != pos) {
+        std::memmove(&mmap_base[dst], &mmap_base[pos], 8 * words);  // dst < pos, same order
+      }
+      old2new[pos] = dst;
+      dst += words;
+    }
+
+    const auto old_end = mmap_base[0];
+    mmap_base[0]       = dst;
+    mmap_base[1]       = live.size();
+
+    auto new_size = std::max<size_t>(Min_size, 8 * (2 * dst));  // some room to grow
+    if (((new_size + 0xFFF) & ~size_t(0xFFF)) < mmap_size) {
+      remap(new_size);
+    }
+    const auto clear_end = std::min<uint64_t>(old_end, mmap_size / 8);
+    if (dst < clear_end) {
+      std::memset(&mmap_base[dst], 0, 8 * (clear_end - dst));  // zero padding for new entries
+    }
+
+    dedup.clear();
+    dedup_ready = false;
+
+    return old2new;
+  }
+};
+
+}  // namespace mmap_lib
@@ -316,10 +316,32 @@ public:
     assert(entries_size == nullptr);
   }
 
+  // Release the mmap and fd (reloaded on demand). Pointers to entries are not valid after it
+  void sync() const {
+    if (mmap_base == nullptr || mmap_name.empty())
+      return;  // nothing mapped, or anonymous (the data would be lost)
+
+    mmap_gc::recycle(mmap_base);
+    assert(mmap_base == nullptr);
+  }
+
+  // Access pattern hint for the whole vector (maps it if needed)
+  void advise(mmap_gc::Access access) const {
+    ref_base();
+    mmap_gc::advise(mmap_base, access);
+  }
+
+  // Most recently used for the mmap_gc budget (nothing if not mapped)
+  void touch() const {
+    if (mmap_base)
+      mmap_gc::touch(mmap_base);
+  }
+
   [[nodiscard]] inline std::string_view get_name() const { return mmap_name; }
   [[nodiscard]] inline std::string_view get_path() const { return mmap_path; }
 
   [[nodiscard]] inline size_t capacity() const { return entries_capacity; }
+  [[nodiscard]] inline bool   is_mapped() const { return mmap_base != nullptr; }  // false after sync (until the next access)
 
   uint64_t *ref_config_data(int offset) const {
     assert(offset < 4096 / 8);
@@ -3,6 +3,8 @@
 #include <strings.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 
@@ -267,6 +269,67 @@ void random_mmap_set(int max, std::string_view name) {
   printf("inserts random %d\n", conta);
 }
 
+// Worst case insert latency. A full rehash stalls one insert for O(n), the
+// incremental (linear hashing) resize should keep the max close to the p99.9
+template <typename Fn> static void insert_latency(int max, bool dense, const std::string &type_test, Fn insert) {
+  Lrand<uint64_t> rng;
+
+  std::vector<uint64_t> lat;
+  lat.reserve(max);
+
+  Lbench b(type_test);
+  for (int i = 0; i < max; ++i) {
+    uint32_t key   = dense ? i : static_cast<uint32_t>(rng.any());
+    auto     start = std::chrono::steady_clock::now();
+    insert(key, i);
+    auto     stop  = std::chrono::steady_clock::now();
+    lat.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  }
+  b.sample("insert");
+
+  std::sort(lat.begin(), lat.end());
+  printf("%s max:%lluns p99.9:%lluns p50:%lluns\n",
+         type_test.c_str(),
+         (unsigned long long)lat.back(),
+         (unsigned long long)lat[lat.size() * 999 / 1000],
+         (unsigned long long)lat[lat.size() / 2]);
+}
+
+void insert_latency_mmap_map(int max, std::string_view name) {
+  for (bool dense : {false, true}) {
+    std::string suffix(dense ? "_dense" : "_sparse");
+    suffix += name.empty() ? "_effemeral_" : "_persistent_";
+    suffix += std::to_string(max);
+
+    {
+      robin_hood::unordered_map<uint32_t, uint32_t> map;
+      insert_latency(max, dense, "mmap.robin_insert_latency" + suffix, [&map](uint32_t key, int val) { map[key] = val; });
+    }
+
+    std::string type_test("mmap.map_insert_latency" + suffix);
+
+    mmap_lib::map<uint32_t, uint32_t> map(name.empty() ? "" : "lgdb_bench", name);
+    map.clear();
+    insert_latency(max, dense, type_test, [&map](uint32_t key, int val) { map.set(key, val); });
+
+    // Erase 90%, the map should shrink (incremental merges, no rehash)
+    auto cap = map.capacity();
+    {
+      Lbench                b(type_test + "_erase");
+      std::vector<uint32_t> keys;
+      for (const auto &it : map) {
+        keys.emplace_back(it.first);
+      }
+      for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 10)
+          map.erase(keys[i]);
+      }
+    }
+    printf("%s capacity before:%zu after erasing 90%%:%zu\n", type_test.c_str(), cap, map.capacity());
+    map.clear();
+  }
+}
+
 void random_abseil_set(int max) {
   Lrand<int> rng;
 
@@ -721,6 +784,7 @@ int main(int argc, char **argv) {
     if (run_random_mmap_set) {
       random_mmap_set(i, "");
       random_mmap_set(i, "mmap_map_set.data");
+      insert_latency_mmap_map(4 * i, "mmap_map_latency.data");
     }
 
     if (run_random_mmap_vset) {
@@ -82,6 +82,123 @@ static bool trigger_clean2(void *base, bool force_recycle) {
   return false;
 }
 
+std::vector<void *> budget_mapped;
+
+static bool budget_clean(void *base, bool force_recycle) {
+  (void)force_recycle;
+  auto it = std::find(budget_mapped.begin(), budget_mapped.end(), base);
+  EXPECT_NE(it, budget_mapped.end());
+  if (it != budget_mapped.end())
+    budget_mapped.erase(it);
+  clean_called++;
+  return false;
+}
+
+TEST_F(Setup_mmap_gc_test, budget) {
+  clean_called = 0;
+  budget_mapped.clear();
+  mmap_lib::mmap_gc::clear_stats();
+
+  const size_t sz     = 1024 * 1024;
+  const auto   start  = mmap_lib::mmap_gc::get_stats();
+  const size_t budget = start.mapped_bytes + 4 * sz;
+  mmap_lib::mmap_gc::set_budget(budget);
+  EXPECT_EQ(mmap_lib::mmap_gc::get_budget(), budget);
+
+  for (int i = 0; i < 16; ++i) {
+    std::string name("mmap_gc_test_budget" + std::to_string(i) + ".data");
+    unlink(name.c_str());
+
+    int    fd = mmap_lib::mmap_gc::open(name);
+    void * base;
+    size_t size;
+    const auto n_evictions = mmap_lib::mmap_gc::get_stats().n_evictions;
+    std::tie(base, size) = mmap_lib::mmap_gc::mmap(name, fd, sz, budget_clean);
+    EXPECT_EQ(size, sz);
+    EXPECT_EQ(mmap_lib::mmap_gc::get_stats().n_evictions, n_evictions);  // only at collect_budget
+    budget_mapped.emplace_back(base);
+
+    if (i & 1)
+      mmap_lib::mmap_gc::advise(base, mmap_lib::mmap_gc::Access::sequential);
+
+    int *value = (int *)base;
+    for (size_t j = 0; j < sz / sizeof(int); j += 1024) {
+      value[j] = i;
+    }
+
+    mmap_lib::mmap_gc::collect_budget();  // safe point, no pointers held
+    EXPECT_LE(mmap_lib::mmap_gc::get_stats().mapped_bytes, budget);
+  }
+
+  auto stats = mmap_lib::mmap_gc::get_stats();
+  EXPECT_EQ(stats.n_mmaps, 16);
+  EXPECT_EQ(stats.n_evictions, 12);
+  EXPECT_EQ(clean_called, 12);
+  EXPECT_EQ(budget_mapped.size(), 4);
+  EXPECT_LE(stats.max_mapped_bytes, budget + sz);  // new mapping before the eviction
+
+  // Evicted files keep the data
+  for (int i = 0; i < 12; ++i) {
+    std::string name("mmap_gc_test_budget" + std::to_string(i) + ".data");
+    int         fd = ::open(name.c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    int val = -1;
+    EXPECT_EQ(::pread(fd, &val, sizeof(int), 0), sizeof(int));
+    EXPECT_EQ(val, i);
+    ::close(fd);
+  }
+
+  mmap_lib::mmap_gc::set_budget(0);
+  while (!budget_mapped.empty()) {
+    mmap_lib::mmap_gc::recycle(budget_mapped.back());  // budget_clean removes it
+  }
+  for (int i = 0; i < 16; ++i) {
+    std::string name("mmap_gc_test_budget" + std::to_string(i) + ".data");
+    unlink(name.c_str());
+  }
+}
+
+TEST_F(Setup_mmap_gc_test, budget_touch) {
+  budget_mapped.clear();
+  mmap_lib::mmap_gc::set_budget(0);
+
+  const size_t sz = 1024 * 1024;
+  std::vector<void *> bases;
+  for (int i = 0; i < 3; ++i) {
+    std::string name("mmap_gc_test_touch" + std::to_string(i) + ".data");
+    unlink(name.c_str());
+
+    int    fd = mmap_lib::mmap_gc::open(name);
+    void * base;
+    size_t size;
+    std::tie(base, size) = mmap_lib::mmap_gc::mmap(name, fd, sz, budget_clean);
+    budget_mapped.emplace_back(base);
+    bases.emplace_back(base);
+  }
+
+  // The oldest mapping is still in use (advise is only a hint, not a use)
+  mmap_lib::mmap_gc::advise(bases[1], mmap_lib::mmap_gc::Access::sequential);
+  mmap_lib::mmap_gc::advise(bases[1], mmap_lib::mmap_gc::Access::sequential);  // no syscall, already advised
+  mmap_lib::mmap_gc::touch(bases[0]);
+
+  mmap_lib::mmap_gc::set_budget(mmap_lib::mmap_gc::get_stats().mapped_bytes - 1);  // evict one
+  mmap_lib::mmap_gc::collect_budget();
+
+  EXPECT_EQ(budget_mapped.size(), 2);
+  EXPECT_NE(std::find(budget_mapped.begin(), budget_mapped.end(), bases[0]), budget_mapped.end());
+  EXPECT_EQ(std::find(budget_mapped.begin(), budget_mapped.end(), bases[1]), budget_mapped.end());
+  EXPECT_NE(std::find(budget_mapped.begin(), budget_mapped.end(), bases[2]), budget_mapped.end());
+
+  mmap_lib::mmap_gc::set_budget(0);
+  while (!budget_mapped.empty()) {
+    mmap_lib::mmap_gc::recycle(budget_mapped.back());  // budget_clean removes it
+  }
+  for (int i = 0; i < 3; ++i) {
+    std::string name("mmap_gc_test_touch" + std::to_string(i) + ".data");
+    unlink(name.c_str());
+  }
+}
+
 #ifdef __linux__
 TEST_F(Setup_mmap_gc_test, mmap_limit) {
     struct rlimit rval;
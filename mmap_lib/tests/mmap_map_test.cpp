@@ -1,5 +1,6 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "gmock/gmock.h"
@@ -443,6 +444,163 @@ TEST_F(Setup_mmap_map_test, big_key) {
   fmt::print("load_factor:{} conflict_factor:{}\n",map.load_factor(), map.conflict_factor());
 }
 
+TEST_F(Setup_mmap_map_test, dense_keys) {
+  Lrand<int> rng;
+
+  absl::flat_hash_map<uint32_t, uint32_t> map2;
+
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_test_dense");
+    map.clear();
+
+    for(uint32_t i=1;i<50000;i++) {  // Index_ID like (dense)
+      map.set(i, i+7);
+      map2[i] = i+7;
+    }
+    EXPECT_TRUE(map.is_dense());
+
+    for(int i=0;i<1000;i++) {
+      uint32_t key = rng.max(50000);
+      map.erase(key);
+      map2.erase(key);
+    }
+    EXPECT_TRUE(map.is_dense());
+    EXPECT_EQ(map.size(), map2.size());
+    EXPECT_FALSE(map.has(50000));
+    EXPECT_FALSE(map.has(1<<30));
+  }
+
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_test_dense");
+    EXPECT_TRUE(map.is_dense()); // mode preserved in the file
+    EXPECT_EQ(map.size(), map2.size());
+
+    int conta = 0;
+    for(const auto &it:map) {
+      EXPECT_EQ(map2[it.first], it.second);
+      conta++;
+    }
+    EXPECT_EQ(conta, map2.size());
+
+    // Too sparse, switch to hashing
+    for(int i=0;i<100;i++) {
+      uint32_t key = 0x10000000 + rng.max(0xFFFFFF);
+      map.set(key, i);
+      map2[key] = i;
+    }
+    EXPECT_FALSE(map.is_dense());
+    EXPECT_EQ(map.size(), map2.size());
+  }
+
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_test_dense");
+    EXPECT_FALSE(map.is_dense());
+
+    for(const auto &it:map2) {
+      EXPECT_TRUE(map.has(it.first));
+      EXPECT_EQ(map.get(it.first), it.second);
+    }
+
+    // The sparse keys are removed, next rehash goes back to dense
+    for(auto it=map.begin(); it!=map.end();) {
+      if (it->first >= 0x10000000) {
+        map2.erase(it->first);
+        it = map.erase(it);
+      }else{
+        ++it;
+      }
+    }
+    for(uint32_t i=50000;i<200000;i++) {
+      map.set(i, i+7);
+      map2[i] = i+7;
+    }
+    EXPECT_TRUE(map.is_dense());
+    EXPECT_EQ(map.size(), map2.size());
+
+    for(const auto &it:map2) {
+      EXPECT_EQ(map.get(it.first), it.second);
+    }
+    map.clear();
+  }
+}
+
+TEST_F(Setup_mmap_map_test, grow_shrink) {
+  Lrand<uint64_t> rng;
+
+  absl::flat_hash_map<uint64_t, uint32_t> map2;
+
+  {
+    mmap_lib::map<uint64_t, uint32_t> map("lgdb_bench", "mmap_map_test_grow");
+    map.clear();
+
+    for(uint32_t i=0;i<100000;i++) {
+      uint64_t key = rng.any() | (1ULL<<40); // sparse
+      map.set(key, i);
+      map2[key] = i;
+    }
+    EXPECT_FALSE(map.is_dense());
+    EXPECT_EQ(map.size(), map2.size());
+  }
+
+  size_t full_capacity;
+  {
+    mmap_lib::map<uint64_t, uint32_t> map("lgdb_bench", "mmap_map_test_grow");
+
+    std::vector<uint64_t> keys;
+    for(const auto &it:map)
+      keys.emplace_back(it.first);
+
+    EXPECT_EQ(map.size(), map2.size());
+    full_capacity = map.capacity();
+
+    for(size_t i=0;i<keys.size();i++) {
+      if ((i%10) == 0)
+        continue;
+      map.erase(keys[i]);
+      map2.erase(keys[i]);
+    }
+    EXPECT_EQ(map.size(), map2.size());
+    EXPECT_LT(map.capacity(), full_capacity/4); // shrinks as elements are erased
+  }
+
+  {
+    mmap_lib::map<uint64_t, uint32_t> map("lgdb_bench", "mmap_map_test_grow");
+    for(const auto &it:map2) {
+      EXPECT_TRUE(map.has(it.first));
+      EXPECT_EQ(map.get(it.first), it.second);
+    }
+    EXPECT_EQ(map.size(), map2.size());
+    int conta = 0;
+    for(const auto &it:map) {
+      EXPECT_EQ(map2[it.first], it.second);
+      conta++;
+    }
+    EXPECT_EQ(conta, map2.size());
+    map.clear();
+  }
+
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_test_grow_dense");
+    map.clear();
+
+    for(uint32_t i=0;i<100000;i++) {
+      map.set(i, i);
+    }
+    EXPECT_TRUE(map.is_dense());
+    full_capacity = map.capacity();
+
+    for(uint32_t i=1000;i<100000;i++) {
+      map.erase(i);
+    }
+    EXPECT_TRUE(map.is_dense());
+    EXPECT_LT(map.capacity(), full_capacity/16);
+    for(uint32_t i=0;i<1000;i++) {
+      EXPECT_EQ(map.get(i), i);
+    }
+    map.clear();
+  }
+}
+
 TEST_F(Setup_mmap_map_test, lots_of_strings) {
 
   const std::vector<std::string> roots = {"potato", "__t", "very_long_string", "a"};
@@ -494,6 +652,97 @@ TEST_F(Setup_mmap_map_test, lots_of_strings) {
   }
 }
 
+TEST_F(Setup_mmap_map_test, txt_dedup_compact) {
+
+  size_t txt_size_before;
+  {
+    mmap_lib::map<uint32_t, std::string_view> map("lgdb_bench", "mmap_map_txt_compact");
+    map.clear();
+
+    for (uint32_t i = 0; i < 20'000; ++i) {  // Same string stored once
+      map.set(i, "same_string_for_all_the_keys");
+    }
+    EXPECT_EQ(map.txt_size(), 8192);
+
+    for (int round = 0; round < 16; ++round) {  // Overwrite all, most entries become dead
+      for (uint32_t i = 0; i < 2'000; ++i) {
+        map.set(i, "value_" + std::to_string(i) + "_round_" + std::to_string(round));
+      }
+    }
+    for (uint32_t i = 2'000; i < 20'000; ++i) {
+      map.erase(i);
+    }
+    txt_size_before = map.txt_size();
+  }
+
+  {
+    mmap_lib::map<uint32_t, std::string_view> map("lgdb_bench", "mmap_map_txt_compact");
+    for (uint32_t i = 0; i < 2'000; ++i) {
+      EXPECT_EQ(map.get(i), "value_" + std::to_string(i) + "_round_15");
+    }
+    EXPECT_EQ(map.size(), 2'000);
+    EXPECT_LT(map.txt_size(), txt_size_before);  // compacted on sync
+  }
+
+  {
+    mmap_lib::bimap<uint32_t, std::string_view> bimap("lgdb_bench", "mmap_bimap_txt_compact");
+    bimap.clear();
+
+    for (int round = 0; round < 16; ++round) {
+      for (uint32_t i = 0; i < 2'000; ++i) {
+        if (round)
+          bimap.erase_key(i);
+        bimap.set(i, "val_" + std::to_string(i) + "_" + std::to_string(round));
+      }
+    }
+
+    auto txt_size = bimap.key2val.txt_size();
+    bimap.sync();  // compacts the shared txt
+    EXPECT_LT(bimap.key2val.txt_size(), txt_size);
+    EXPECT_EQ(bimap.size(), 2'000);
+    EXPECT_EQ(bimap.get_val(7), "val_7_15");
+
+    bimap.sync();  // the destructor runs after a sync
+  }
+
+  {
+    mmap_lib::bimap<uint32_t, std::string_view> bimap("lgdb_bench", "mmap_bimap_txt_compact");
+    for (uint32_t i = 0; i < 2'000; ++i) {
+      std::string val = "val_" + std::to_string(i) + "_15";
+      EXPECT_EQ(bimap.get_val(i), val);
+      EXPECT_EQ(bimap.get_key(val), i);
+    }
+    EXPECT_EQ(bimap.size(), 2'000);
+  }
+}
+
+TEST_F(Setup_mmap_map_test, header_format) {
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_format");
+    map.clear();
+    map.set(1, 2);
+  }
+
+  {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_format");
+    EXPECT_EQ(map.get(1), 2);
+  }
+
+  {  // Clear the format word (like a file from an older mmap_lib)
+    int fd = ::open("lgdb_bench/mmap_map_format", O_RDWR);
+    ASSERT_GE(fd, 0);
+    uint64_t old_format = 0;
+    EXPECT_EQ(pwrite(fd, &old_format, sizeof(old_format), 14 * sizeof(uint64_t)), sizeof(old_format));
+    close(fd);
+  }
+
+  auto reopen = []() {
+    mmap_lib::map<uint32_t, uint32_t> map("lgdb_bench", "mmap_map_format");
+    map.has(1);
+  };
+  EXPECT_EXIT(reopen(), ::testing::ExitedWithCode(253), "incompatible format");
+}
+
 static_assert( mmap_lib::is_array_serializable<std::string_view>::value);
 static_assert( mmap_lib::is_array_serializable<std::vector<int>>::value);
 static_assert(!mmap_lib::is_array_serializable<uint32_t>::value);
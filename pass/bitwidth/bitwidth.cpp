@@ -3,17 +3,25 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include "bitwidth.hpp"
 #include "bitwidth_range.hpp"
 #include "lbench.hpp"
 #include "lgraph.hpp"
+#include "thread_pool.hpp"
 
 // Useful for debug
 //#define PRESERVE_ATTR_NODE
 
-Bitwidth::Bitwidth(bool _hier, int _max_iterations, BWMap &_bwmap) :  max_iterations(_max_iterations), hier(_hier), bwmap(_bwmap) {}
+Bitwidth::Bitwidth(bool _hier, int _max_iterations, BWMap &_bwmap, int _n_threads)
+    : max_iterations(_max_iterations), hier(_hier), quiet(false), n_threads(_n_threads), bwmap(_bwmap) {}
+
+BWKey Bitwidth::bw_key(const Node_pin &dpin) { return BWKey(dpin.get_class_lgraph()->get_lgid().value, dpin.get_compact()); }
 
 void Bitwidth::do_trans(LGraph *lg) {
   /* Lbench b("pass.bitwidth"); */
@@ -22,7 +30,7 @@ void Bitwidth::do_trans(LGraph *lg) {
 
 void Bitwidth::process_const(Node &node) {
   auto dpin = node.get_driver_pin();
-  auto it = bwmap.insert_or_assign(dpin.get_compact(), Bitwidth_range(node.get_type_const()));
+  auto it = bwmap.insert_or_assign(bw_key(dpin), Bitwidth_range(node.get_type_const()));
   forward_adjust_dpin(dpin, it.first->second);
 }
 
@@ -33,17 +41,17 @@ void Bitwidth::process_flop(Node &node) {
 
   Lconst max_val;
   Lconst min_val;
-  auto   it_d_dpin = bwmap.find(d_dpin.get_compact());
-  auto   it_qpin   = bwmap.find(qpin.get_compact());
+  auto   it_d_dpin = bwmap.find(bw_key(d_dpin));
+  auto   it_qpin   = bwmap.find(bw_key(qpin));
   if (it_d_dpin != bwmap.end()) {
     max_val = it_d_dpin->second.get_max();
     min_val = it_d_dpin->second.get_min();
-    bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+    bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
     return;
   } else if (it_qpin != bwmap.end()) {  // At least propagate backward the width
     auto tmp_min  = Lconst(it_qpin->second.min);
     auto tmp_max  = Lconst(it_qpin->second.max);
-    bwmap.insert_or_assign(d_dpin.get_compact(), Bitwidth_range(tmp_min, tmp_max));
+    bwmap.insert_or_assign(bw_key(d_dpin), Bitwidth_range(tmp_min, tmp_max));
     return;
   } else {
     debug_unconstrained_msg(node, d_dpin);
@@ -58,7 +66,7 @@ void Bitwidth::process_ror(Node &node, XEdge_iterator &inp_edges) {
 
   Bitwidth_range bw;
   bw.set_sbits_range(1);
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), bw);
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), bw);
 }
 
 void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
@@ -67,7 +75,7 @@ void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
   Lconst max_val;
   Lconst min_val;
   for (auto e : inp_edges) {
-    auto it = bwmap.find(e.driver.get_compact());
+    auto it = bwmap.find(bw_key(e.driver));
     if (it != bwmap.end()) {
       auto pmax = it->second.get_max().to_i(); //pmax = parent_max
       auto pmin = it->second.get_min().to_i();
@@ -83,7 +91,7 @@ void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
 }
 
 void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
@@ -95,7 +103,7 @@ void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
     if (e.sink.get_pid() == 0)
       continue;  // Skip select
 
-    auto it = bwmap.find(e.driver.get_compact());
+    auto it = bwmap.find(bw_key(e.driver));
     if (it != bwmap.end()) {
       if (max_val < it->second.get_max())
         max_val = it->second.get_max();
@@ -105,14 +113,14 @@ void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
 
     } else {
       // update as soon as possible, don't wait everyone ready, so you could break the flop-loop
-      bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+      bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
 
       debug_unconstrained_msg(node, e.driver);
       not_finished = true;
       return;
     }
   }
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
 }
 
 
@@ -122,8 +130,8 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
   auto a_dpin = node.get_sink_pin("a").get_driver_pin();
   auto n_dpin = node.get_sink_pin("b").get_driver_pin();
 
-  auto a_it = bwmap.find(a_dpin.get_compact());
-  auto n_it = bwmap.find(n_dpin.get_compact());
+  auto a_it = bwmap.find(bw_key(a_dpin));
+  auto n_it = bwmap.find(bw_key(n_dpin));
 
   Bitwidth_range a_bw(0);
   if (a_it == bwmap.end()) {
@@ -154,7 +162,7 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
   auto max_val = Lconst(Lconst(max.get_raw_num()) << Lconst(amount));
   auto min_val = Lconst(Lconst(min.get_raw_num()) << Lconst(amount));
   Bitwidth_range bw(min_val, max_val);
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), bw);
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), bw);
 }
 
 
@@ -164,8 +172,8 @@ void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
   auto a_dpin = node.get_sink_pin("a").get_driver_pin();
   auto n_dpin = node.get_sink_pin("b").get_driver_pin();
 
-  auto a_it = bwmap.find(a_dpin.get_compact());
-  auto n_it = bwmap.find(n_dpin.get_compact());
+  auto a_it = bwmap.find(bw_key(a_dpin));
+  auto n_it = bwmap.find(bw_key(n_dpin));
 
   Bitwidth_range a_bw(0);
   if (a_it == bwmap.end()) {
@@ -206,9 +214,9 @@ void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
     auto min_val = Lconst(min);
     auto max_val = Lconst(max);
     Bitwidth_range bw(min_val, max_val);
-    bwmap.insert_or_assign(node.get_driver_pin().get_compact(), bw);
+    bwmap.insert_or_assign(bw_key(node.get_driver_pin()), bw);
   } else {
-    bwmap.insert_or_assign(node.get_driver_pin().get_compact(), a_bw);
+    bwmap.insert_or_assign(bw_key(node.get_driver_pin()), a_bw);
   }
 }
 
@@ -218,7 +226,7 @@ void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
   Lconst max_val;
   Lconst min_val;
   for (auto e : inp_edges) {
-    auto it = bwmap.find(e.driver.get_compact());
+    auto it = bwmap.find(bw_key(e.driver));
     if (it != bwmap.end()) {
       if (e.sink.get_pin_name() == "A") {
         max_val = max_val + it->second.get_max();
@@ -236,7 +244,7 @@ void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
 }
 
 
@@ -246,7 +254,7 @@ void Bitwidth::process_mult(Node &node, XEdge_iterator &inp_edges) {
   int max_val;
   int min_val;
   for (auto e : inp_edges) {
-    auto it = bwmap.find(e.driver.get_compact());
+    auto it = bwmap.find(bw_key(e.driver));
     if (it != bwmap.end()) {
       max_val = max_val * it->second.get_max().to_i();
       min_val = min_val * it->second.get_min().to_i();
@@ -259,14 +267,14 @@ void Bitwidth::process_mult(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(Lconst(min_val), Lconst(max_val)));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(Lconst(min_val), Lconst(max_val)));
 }
 
 void Bitwidth::process_tposs(Node &node, XEdge_iterator &inp_edges) {
   Lconst max_val, min_val;
 
   for (auto e : inp_edges) {
-    auto it = bwmap.find(e.driver.get_compact());
+    auto it = bwmap.find(bw_key(e.driver));
     if (it == bwmap.end()) {
       debug_unconstrained_msg(node, e.driver);
       not_finished = true;
@@ -285,20 +293,20 @@ void Bitwidth::process_tposs(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
 }
 
 
 void Bitwidth::process_comparator(Node &node) {
   Bitwidth_range bw;
   bw.set_sbits_range(1);
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), bw);
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), bw);
 }
 
 void Bitwidth::process_assignment_or(Node &node, XEdge_iterator &inp_edges) {
   Lconst max_val, min_val;
   for (auto e : inp_edges) {
-    auto   it = bwmap.find(e.driver.get_compact());
+    auto   it = bwmap.find(bw_key(e.driver));
     if (it == bwmap.end()) {
       debug_unconstrained_msg(node, e.driver);
       not_finished = true;
@@ -308,7 +316,7 @@ void Bitwidth::process_assignment_or(Node &node, XEdge_iterator &inp_edges) {
     min_val = it->second.get_min();
 
   }
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val));
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val));
   return;
 
 }
@@ -320,7 +328,7 @@ void Bitwidth::process_logic_or_xor(Node &node, XEdge_iterator &inp_edges) {
   Bits_t max_bits = 0;
 
   for (auto e : inp_edges) {
-    auto   it   = bwmap.find(e.driver.get_compact());
+    auto   it   = bwmap.find(bw_key(e.driver));
     Bits_t bits = 0;
     if (it == bwmap.end()) {
       debug_unconstrained_msg(node, e.driver);
@@ -345,7 +353,7 @@ void Bitwidth::process_logic_or_xor(Node &node, XEdge_iterator &inp_edges) {
 
   auto max_val = (Lconst(1UL) << Lconst(max_bits-1)) - 1;
   auto min_val = Lconst(-1)-max_val;
-  bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val)); // the max/min of AND MASK should be unsigned
+  bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val)); // the max/min of AND MASK should be unsigned
 }
 
 
@@ -357,7 +365,7 @@ void Bitwidth::process_logic_and(Node &node, XEdge_iterator &inp_edges) {
 
     bool any_constrained = false;
     for (auto e : inp_edges) {
-      auto   it  = bwmap.find(e.driver.get_compact());
+      auto   it  = bwmap.find(bw_key(e.driver));
       if (it == bwmap.end()) {
         continue;
       }
@@ -388,7 +396,7 @@ void Bitwidth::process_logic_and(Node &node, XEdge_iterator &inp_edges) {
       /* min_val = (Lconst(-1)); */
     }
     
-    bwmap.insert_or_assign(node.get_driver_pin().get_compact(), Bitwidth_range(min_val, max_val)); 
+    bwmap.insert_or_assign(bw_key(node.get_driver_pin()), Bitwidth_range(min_val, max_val)); 
 
     for (auto e : inp_edges) {
       auto bw_bits = e.driver.get_bits();
@@ -398,7 +406,7 @@ void Bitwidth::process_logic_and(Node &node, XEdge_iterator &inp_edges) {
       if (e.driver.get_num_edges() > 1) {
         must_perform_backward = true;
       } else if (bw_bits == 0 || bw_bits > min_sbits) {
-        bwmap.insert_or_assign(e.driver.get_compact(), Bitwidth_range(min_val, max_val));
+        bwmap.insert_or_assign(bw_key(e.driver), Bitwidth_range(min_val, max_val));
       }
     }
   }
@@ -440,7 +448,7 @@ void Bitwidth::process_attr_get(Node &node) {
   I(node.is_sink_connected("name"));
   auto dpin_val = node.get_sink_pin("name").get_driver_pin();
 
-  auto it = bwmap.find(dpin_val.get_compact());
+  auto it = bwmap.find(bw_key(dpin_val));
   if (it == bwmap.end()) {
     not_finished = true;
     return;
@@ -475,7 +483,7 @@ void Bitwidth::process_attr_set_dp_assign(Node &node_dp, Fwd_edge_iterator::Fwd_
   auto dpin_lhs = node_dp.get_sink_pin("value").get_driver_pin();
   auto dpin_rhs = node_dp.get_sink_pin("name").get_driver_pin();
 
-  auto it = bwmap.find(dpin_lhs.get_compact());
+  auto it = bwmap.find(bw_key(dpin_lhs));
   Bitwidth_range bw_lhs(0);
   if (it != bwmap.end()) {
     bw_lhs = it->second;
@@ -484,7 +492,7 @@ void Bitwidth::process_attr_set_dp_assign(Node &node_dp, Fwd_edge_iterator::Fwd_
     return;
   }
 
-  auto it2 = bwmap.find(dpin_rhs.get_compact());
+  auto it2 = bwmap.find(bw_key(dpin_rhs));
   Bitwidth_range bw_rhs(0);
   if (it2 != bwmap.end()) {
     bw_rhs = it2->second;
@@ -517,7 +525,7 @@ void Bitwidth::process_attr_set_dp_assign(Node &node_dp, Fwd_edge_iterator::Fwd_
 
 
     // Note: I set the unsigned k-bits (max, min) for the mask
-    bwmap.insert_or_assign(mask_dpin.get_compact(), Bitwidth_range(Lconst(0), mask_const));
+    bwmap.insert_or_assign(bw_key(mask_dpin), Bitwidth_range(Lconst(0), mask_const));
     dpin_rhs.connect_sink(mask_node.setup_sink_pin("A"));
     all_one_dpin.connect_sink(mask_node.setup_sink_pin("A"));
     for (auto e : node_dp.out_edges())
@@ -576,7 +584,7 @@ void Bitwidth::process_attr_set_new_attr(Node &node_attr, Fwd_edge_iterator::Fwd
     auto through_dpin = node_attr.get_sink_pin("name").get_driver_pin();
     parent_is_ginp    = through_dpin.is_graph_input();
     parent_is_flop    = through_dpin.get_node().is_type_flop();
-    auto it           = bwmap.find(through_dpin.get_compact());
+    auto it           = bwmap.find(bw_key(through_dpin));
     if (it != bwmap.end()) {
       bw = it->second;
     } else {
@@ -620,13 +628,13 @@ void Bitwidth::process_attr_set_new_attr(Node &node_attr, Fwd_edge_iterator::Fwd
   }
 
   for (auto out_dpin : node_attr.out_connected_pins()) {
-    bwmap.insert_or_assign(out_dpin.get_compact(), bw);
+    bwmap.insert_or_assign(bw_key(out_dpin), bw);
   }
 
   // upwards propagate for one step node_attr, most graph input bits are set here
   if (parent_pending) {
     auto through_dpin = node_attr.get_sink_pin("name").get_driver_pin();
-    bwmap.insert_or_assign(through_dpin.get_compact(), bw);
+    bwmap.insert_or_assign(bw_key(through_dpin), bw);
   }
 }
 
@@ -669,14 +677,14 @@ void Bitwidth::process_attr_set_propagate(Node &node_attr) {
   auto parent_attr_dpin = node_attr.get_sink_pin("chain").get_driver_pin();
 
   Bitwidth_range data_bw(0);
-  auto data_it = bwmap.find(data_dpin.get_compact());
+  auto data_it = bwmap.find(bw_key(data_dpin));
   if (data_it != bwmap.end()) {
     data_bw = data_it->second;
   } else {
     parent_data_pending = true;
   }
 
-  auto parent_attr_it = bwmap.find(parent_attr_dpin.get_compact());
+  auto parent_attr_it = bwmap.find(bw_key(parent_attr_dpin));
   if (parent_attr_it == bwmap.end()) {
     fmt::print("attr_set propagate bwmap to AttrSet name:{}\n", dpin_name);
     not_finished = true;
@@ -695,11 +703,11 @@ void Bitwidth::process_attr_set_propagate(Node &node_attr) {
   }
 
   for (auto out_dpin : node_attr.out_connected_pins())
-    bwmap.insert_or_assign(out_dpin.get_compact(), parent_attr_bw);
+    bwmap.insert_or_assign(bw_key(out_dpin), parent_attr_bw);
 
 
   if (parent_data_pending)
-    bwmap.insert_or_assign(data_dpin.get_compact(), parent_attr_bw);
+    bwmap.insert_or_assign(bw_key(data_dpin), parent_attr_bw);
 
 }
 
@@ -738,6 +746,9 @@ void Bitwidth::set_graph_boundary(Node_pin &dpin, Node_pin &spin) {
 
 
 void Bitwidth::debug_unconstrained_msg(Node &node, Node_pin &dpin) {
+  if (quiet)
+    return;
+
   if (dpin.has_name()) {
     fmt::print("BW-> gate:{} has input pin:{} unconstrained\n", node.debug_name(), dpin.debug_name());
   } else {
@@ -745,9 +756,336 @@ void Bitwidth::debug_unconstrained_msg(Node &node, Node_pin &dpin) {
   }
 }
 
+void Bitwidth::process_node(Node &node, XEdge_iterator &inp_edges) {
+  auto op = node.get_type_op();
+
+  if (op == Ntype_op::Or) {
+    if (inp_edges.size() == 1)
+      process_assignment_or(node, inp_edges);
+    else
+      process_logic_or_xor(node, inp_edges);
+  } else if (op == Ntype_op::Xor) {
+    process_logic_or_xor(node, inp_edges);
+  } else if (op == Ntype_op::Ror) {
+    process_ror(node, inp_edges);
+  } else if (op == Ntype_op::And) {
+    process_logic_and(node, inp_edges);
+  } else if (op == Ntype_op::Sum) {
+    process_sum(node, inp_edges);
+  } else if (op == Ntype_op::Mult) {
+    process_mult(node, inp_edges);
+  } else if (op == Ntype_op::SRA) {
+    process_sra(node, inp_edges);
+  } else if (op == Ntype_op::SHL) {
+    process_shl(node, inp_edges);
+  } else if (op == Ntype_op::Not) {
+    process_not(node, inp_edges);
+  } else if (op == Ntype_op::Sflop || op == Ntype_op::Aflop || op == Ntype_op::Fflop) {
+    process_flop(node);
+  } else if (op == Ntype_op::Mux) {
+    process_mux(node, inp_edges);
+  } else if (op == Ntype_op::GT || op == Ntype_op::LT || op == Ntype_op::EQ) {
+    process_comparator(node);
+  } else if (op == Ntype_op::Tposs) {
+    process_tposs(node, inp_edges);
+  } else {
+    fmt::print("FIXME: node:{} still not handled by bitwidth\n", node.debug_name());
+  }
+}
+
+bool Bitwidth::is_fixpoint_op(Ntype_op op) {
+  // Ops that only update the bwmap (no graph changes). Safe to process again, and in parallel
+  return op == Ntype_op::Or || op == Ntype_op::Xor || op == Ntype_op::Ror || op == Ntype_op::And || op == Ntype_op::Sum
+         || op == Ntype_op::Mult || op == Ntype_op::SRA || op == Ntype_op::SHL || op == Ntype_op::Not || op == Ntype_op::Sflop
+         || op == Ntype_op::Aflop || op == Ntype_op::Fflop || op == Ntype_op::Mux || op == Ntype_op::GT || op == Ntype_op::LT
+         || op == Ntype_op::EQ || op == Ntype_op::Tposs;
+}
+
+void Bitwidth::set_driver_bits(Node &node) {
+  for (auto dpin : node.out_connected_pins()) {
+    auto it = bwmap.find(bw_key(dpin));
+    if (it == bwmap.end())
+      continue;
+
+    auto bw_bits = it->second.get_sbits();
+    if (bw_bits == 0 && it->second.is_overflow()) {
+      fmt::print("BW-> dpin:{} has over {}bits (simplify first!)\n", dpin.debug_name(), it->second.get_raw_max());
+      continue;
+    }
+
+    if (dpin.get_bits() && dpin.get_bits() >= bw_bits)
+      continue;
+
+    dpin.set_bits(bw_bits);
+  }
+}
+
+void Bitwidth::build_scc_graph(LGraph *lg, Scc_graph &g) const {
+  absl::flat_hash_map<Node::Compact, uint32_t> node2pos;
+  for (auto node : lg->fast(hier)) {
+    if (!is_fixpoint_op(node.get_type_op()))
+      continue;
+    node2pos[node.get_compact()] = g.nodes.size();
+    g.nodes.emplace_back(node);
+  }
+
+  const uint32_t n_nodes = g.nodes.size();
+  g.inp_edges.resize(n_nodes);
+  g.out_pins.resize(n_nodes);
+  g.fanout.resize(n_nodes);
+  for (auto i = 0u; i < n_nodes; ++i) {
+    g.inp_edges[i] = g.nodes[i].inp_edges();
+    for (auto &e : g.inp_edges[i]) {
+      auto it = node2pos.find(e.driver.get_node().get_compact());
+      if (it == node2pos.end())
+        continue;  // const, graph input, attr... fixed during the fixpoint
+
+      g.fanout[it->second].emplace_back(i);
+      g.out_pins[it->second].emplace_back(bw_key(e.driver));
+    }
+  }
+
+  // Tarjan (iterative). The SCCs are found in reverse topological order
+  constexpr uint32_t unvisited = std::numeric_limits<uint32_t>::max();
+
+  std::vector<uint32_t>                      index(n_nodes, unvisited);
+  std::vector<uint32_t>                      lowlink(n_nodes, 0);
+  std::vector<bool>                          on_stack(n_nodes, false);
+  std::vector<uint32_t>                      stack;
+  std::vector<std::pair<uint32_t, uint32_t>> call;  // node, next fanout
+  uint32_t                                   next_index = 0;
+
+  auto visit = [&](uint32_t n) {
+    index[n]   = next_index;
+    lowlink[n] = next_index;
+    ++next_index;
+    stack.emplace_back(n);
+    on_stack[n] = true;
+    call.emplace_back(n, 0);
+  };
+
+  for (auto root = 0u; root < n_nodes; ++root) {
+    if (index[root] != unvisited)
+      continue;
+
+    visit(root);
+    while (!call.empty()) {
+      auto n = call.back().first;
+      if (call.back().second < g.fanout[n].size()) {
+        auto f = g.fanout[n][call.back().second++];
+        if (index[f] == unvisited)
+          visit(f);
+        else if (on_stack[f])
+          lowlink[n] = std::min(lowlink[n], index[f]);
+        continue;
+      }
+
+      call.pop_back();
+      if (!call.empty()) {
+        auto parent     = call.back().first;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[n]);
+      }
+      if (lowlink[n] != index[n])
+        continue;
+
+      std::vector<uint32_t> scc;
+      uint32_t              m;
+      do {
+        m = stack.back();
+        stack.pop_back();
+        on_stack[m] = false;
+        scc.emplace_back(m);
+      } while (m != n);
+      std::sort(scc.begin(), scc.end());
+      g.sccs.emplace_back(std::move(scc));
+    }
+  }
+
+  std::reverse(g.sccs.begin(), g.sccs.end());
+
+  g.node2scc.resize(n_nodes);
+  for (auto s = 0u; s < g.sccs.size(); ++s) {
+    for (auto n : g.sccs[s]) g.node2scc[n] = s;
+  }
+}
+
+void Bitwidth::solve_scc(const Scc_graph &g, uint32_t scc, Scc_result &res) const {
+  const auto &nodes = g.sccs[scc];
+
+  // Local copy of the ranges that the region reads or writes (the bwmap is read-only while regions run)
+  for (auto n : nodes) {
+    for (const auto &e : g.inp_edges[n]) {
+      auto it = bwmap.find(bw_key(e.driver));
+      if (it != bwmap.end())
+        res.local.insert(*it);
+    }
+    auto it = bwmap.find(bw_key(g.nodes[n].get_driver_pin()));
+    if (it != bwmap.end())
+      res.local.insert(*it);
+  }
+
+  Bitwidth worker(hier, max_iterations, res.local);
+  worker.quiet = true;
+
+  std::deque<uint32_t> queue;
+  std::vector<bool>    in_queue(nodes.size(), true);
+  std::vector<int>     visits(nodes.size(), 0);
+  std::vector<bool>    unresolved(nodes.size(), false);
+  for (auto i = 0u; i < nodes.size(); ++i) {
+    queue.emplace_back(i);
+  }
+
+  std::vector<std::optional<Bitwidth_range>> before;
+  while (!queue.empty()) {
+    auto li = queue.front();
+    queue.pop_front();
+    in_queue[li] = false;
+
+    if (visits[li] >= max_iterations) {
+      unresolved[li] = true;  // did not converge
+      continue;
+    }
+    ++visits[li];
+
+    auto n = nodes[li];
+    before.clear();
+    for (const auto &pin : g.out_pins[n]) {
+      auto it = res.local.find(pin);
+      if (it == res.local.end())
+        before.emplace_back(std::nullopt);
+      else
+        before.emplace_back(it->second);
+    }
+
+    auto node      = g.nodes[n];
+    auto inp_edges = g.inp_edges[n];
+    worker.not_finished = false;
+    worker.process_node(node, inp_edges);
+    unresolved[li] = worker.not_finished;
+
+    bool changed = false;
+    for (auto i = 0u; i < before.size() && !changed; ++i) {
+      auto it = res.local.find(g.out_pins[n][i]);
+      if (it == res.local.end())
+        continue;
+      changed = !before[i].has_value() || *before[i] != it->second;
+    }
+    if (!changed)
+      continue;
+
+    for (auto f : g.fanout[n]) {
+      if (g.node2scc[f] != scc)
+        continue;  // other regions are processed later
+      auto lf = std::lower_bound(nodes.begin(), nodes.end(), f) - nodes.begin();
+      if (in_queue[lf])
+        continue;
+      in_queue[lf] = true;
+      queue.emplace_back(lf);
+    }
+  }
+
+  res.unresolved = std::find(unresolved.begin(), unresolved.end(), true) != unresolved.end();
+}
+
+// Worklist fixpoint for the nodes left unconstrained by the forward pass
+// (flops visited before their din driver). The graph is split into strongly
+// connected regions (loops close through flops). Only the regions with
+// pending nodes, and the regions downstream of a change, are processed. The
+// regions at the same topological level are independent and run in parallel.
+void Bitwidth::bw_fixpoint(LGraph *lg) {
+  Scc_graph g;
+  build_scc_graph(lg, g);
+
+  std::vector<uint32_t> level(g.sccs.size(), 0);
+  uint32_t              max_level = 0;
+  for (auto s = 0u; s < g.sccs.size(); ++s) {  // topological order, the fanout always has a higher level
+    max_level = std::max(max_level, level[s]);
+    for (auto n : g.sccs[s]) {
+      for (auto f : g.fanout[n]) {
+        auto fs = g.node2scc[f];
+        if (fs != s)
+          level[fs] = std::max(level[fs], level[s] + 1);
+      }
+    }
+  }
+
+  std::vector<std::vector<uint32_t>> level2sccs(max_level + 1);
+  for (auto s = 0u; s < g.sccs.size(); ++s) {
+    level2sccs[level[s]].emplace_back(s);
+  }
+
+  std::vector<bool> dirty(g.sccs.size(), false);
+  for (auto n = 0u; n < g.nodes.size(); ++n) {
+    if (pending.contains(g.nodes[n].get_compact()))
+      dirty[g.node2scc[n]] = true;
+  }
+
+  // The regions only read the lgraph. Its tables were mapped by the forward
+  // pass and build_scc_graph, and nothing is unmapped while a pass runs
+  // (Graph_library::release_unused is called between commands). hier reaches
+  // sub-lgraphs that may be mapped on the first access, keep it serial.
+  std::unique_ptr<Thread_pool> pool;
+  if (n_threads != 1 && !hier)
+    pool = std::make_unique<Thread_pool>(n_threads);
+
+  bool                    unresolved = false;
+  std::vector<uint32_t>   work;
+  std::vector<Scc_result> results;
+  for (const auto &sccs : level2sccs) {
+    work.clear();
+    for (auto s : sccs) {
+      if (dirty[s])
+        work.emplace_back(s);
+    }
+    if (work.empty())
+      continue;
+
+    results.clear();
+    results.resize(work.size());
+    if (pool && work.size() > 1) {
+      Thread_pool::Sync sync{0};
+      for (auto i = 0u; i < work.size(); ++i) {
+        pool->spawn(sync, [this, &g, &work, &results, i]() { solve_scc(g, work[i], results[i]); });
+      }
+      pool->sync(sync);
+    } else {
+      for (auto i = 0u; i < work.size(); ++i) {
+        solve_scc(g, work[i], results[i]);
+      }
+    }
+
+    // Merge in region order (same result independent of the number of threads)
+    for (auto i = 0u; i < work.size(); ++i) {
+      unresolved = unresolved || results[i].unresolved;
+
+      bool changed = false;
+      for (const auto &[pin, bw] : results[i].local) {
+        auto it = bwmap.find(pin);
+        if (it == bwmap.end()) {
+          bwmap.emplace(pin, bw);
+          changed = true;
+        } else if (it->second != bw) {
+          it->second = bw;
+          changed    = true;
+        }
+      }
+      if (!changed)
+        continue;
+
+      for (auto n : g.sccs[work[i]]) {
+        set_driver_bits(g.nodes[n]);
+        for (auto f : g.fanout[n]) dirty[g.node2scc[f]] = true;
+      }
+    }
+  }
+
+  not_finished = not_finished || unresolved;
+}
+
 void Bitwidth::bw_pass(LGraph *lg) {
   must_perform_backward = false;
   not_finished          = false;
+  pending.clear();
 
   // note: lg input bits must be set by attr_set node, it will be handled through the algorithm runs
 
@@ -756,7 +1094,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
     if (dpin.get_bits()) {
       Bitwidth_range bw;
       bw.set_sbits_range(dpin.get_bits());
-      bwmap.insert_or_assign(dpin.get_compact(), bw);
+      bwmap.insert_or_assign(bw_key(dpin), bw);
     }
   }, hier);
 
@@ -779,17 +1117,6 @@ void Bitwidth::bw_pass(LGraph *lg) {
       process_const(node);
     } else if (op == Ntype_op::TupKey || op == Ntype_op::TupGet || op == Ntype_op::TupAdd) {
       continue; // Nothing to do for this
-    } else if (op == Ntype_op::Or) {
-      if (inp_edges.size() == 1)
-        process_assignment_or(node, inp_edges);
-      else
-        process_logic_or_xor(node, inp_edges);
-    } else if (op == Ntype_op::Xor) {
-      process_logic_or_xor(node, inp_edges);
-    } else if (op == Ntype_op::Ror) {
-      process_ror(node, inp_edges);
-    } else if (op == Ntype_op::And) {
-      process_logic_and(node, inp_edges);
     } else if (op == Ntype_op::AttrSet) {
       process_attr_set(node, fwd_it);
       if (node.is_invalid())
@@ -798,26 +1125,16 @@ void Bitwidth::bw_pass(LGraph *lg) {
       process_attr_get(node);
       if (node.is_invalid())
         continue;
-    } else if (op == Ntype_op::Sum) {
-      process_sum(node, inp_edges);
-    } else if (op == Ntype_op::Mult) {
-      process_mult(node, inp_edges);
-    } else if (op == Ntype_op::SRA) {
-      process_sra(node, inp_edges);
-    } else if (op == Ntype_op::SHL) {
-      process_shl(node, inp_edges);
-    } else if (op == Ntype_op::Not) {
-      process_not(node, inp_edges);
-    } else if (op == Ntype_op::Sflop || op == Ntype_op::Aflop || op == Ntype_op::Fflop) {
-      process_flop(node);
-    } else if (op == Ntype_op::Mux) {
-      process_mux(node, inp_edges);
-    } else if (op == Ntype_op::GT || op == Ntype_op::LT || op == Ntype_op::EQ) {
-      process_comparator(node);
-    } else if (op == Ntype_op::Tposs) {
-      process_tposs(node, inp_edges);
     } else {
-      fmt::print("FIXME: node:{} still not handled by bitwidth\n", node.debug_name());
+      auto prev_not_finished = not_finished;
+      not_finished           = false;
+      process_node(node, inp_edges);
+      if (not_finished && is_fixpoint_op(op)) {
+        pending.insert(node.get_compact());  // solved by bw_fixpoint
+        not_finished = prev_not_finished;
+      } else {
+        not_finished = not_finished || prev_not_finished;
+      }
     }
 
 
@@ -826,40 +1143,28 @@ void Bitwidth::bw_pass(LGraph *lg) {
         set_graph_boundary(e.driver, e.sink);
     }
 
-    for (auto dpin : node.out_connected_pins()) {
-      auto it = bwmap.find(dpin.get_compact());
-      if (it == bwmap.end())
-        continue;
-
-      auto bw_bits = it->second.get_sbits();
-      if (bw_bits == 0 && it->second.is_overflow()) {
-        fmt::print("BW-> dpin:{} has over {}bits (simplify first!)\n", dpin.debug_name(), it->second.get_raw_max());
-        continue;
-      }
-
-      if (dpin.get_bits() && dpin.get_bits() >= bw_bits)
-        continue;
-
-      dpin.set_bits(bw_bits);
-    }
+    set_driver_bits(node);
 
     //debug
     if (op != Ntype_op::Sub) {
       fmt::print("    ");
-      auto it = bwmap.find(node.get_driver_pin("Y").get_compact());
+      auto it = bwmap.find(bw_key(node.get_driver_pin("Y")));
       if (it != bwmap.end())
         it->second.dump();
     }
 
   }// end of lg->forward()
 
+  if (!pending.empty())
+    bw_fixpoint(lg);
+
 
 
   // set bits for graph input and output
   lg->each_graph_input([this](Node_pin &dpin) {
     if (dpin.get_name() == "$")
       return;
-    auto it = bwmap.find(dpin.get_compact());
+    auto it = bwmap.find(bw_key(dpin));
     if (it != bwmap.end()) {
       auto &bw = it->second;
       auto bw_bits = bw.get_sbits();
@@ -878,7 +1183,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
     auto out_driver = spin.get_driver_pin();
 
     I(!out_driver.is_invalid());
-    auto it = bwmap.find(out_driver.get_compact());
+    auto it = bwmap.find(bw_key(out_driver));
     if (it == bwmap.end()) {
       return;
     } else {
@@ -896,7 +1201,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
         set_graph_boundary(out_driver, spin);
     }
 
-    bwmap.insert_or_assign(dpin.get_compact(), it->second);
+    bwmap.insert_or_assign(bw_key(dpin), it->second);
   }, hier);
 
 
@@ -938,7 +1243,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
 
       /*   auto dpin = node.get_driver_pin("Y"); */
       /*   auto dpin_bits = dpin.get_bits(); */
-      /*   auto it = bwmap.find(dpin.get_compact()); */
+      /*   auto it = bwmap.find(bw_key(dpin)); */
       /*   if (it != bwmap.end()) { */
       /*     auto &bw = it->second; */
       /*     if (dpin.has_outputs()) */
@@ -955,7 +1260,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
     /*   lg->each_graph_output([this](Node_pin &dpin) { */
     /*     I(dpin.get_name() != "%"); */
     /*     auto dpin_bits = dpin.get_bits(); */
-    /*     auto it = bwmap.find(dpin.get_compact()); */
+    /*     auto it = bwmap.find(bw_key(dpin)); */
     /*     if (it != bwmap.end()) { */
     /*       auto & bw = it->second; */
     /*       if (dpin.has_outputs()) */
@@ -970,7 +1275,7 @@ void Bitwidth::bw_pass(LGraph *lg) {
     /*   lg->each_graph_input([this](Node_pin &dpin) { */
     /*     I(dpin.get_name() != "$"); */
     /*     auto dpin_bits = dpin.get_bits(); */
-    /*     auto it = bwmap.find(dpin.get_compact()); */
+    /*     auto it = bwmap.find(bw_key(dpin)); */
     /*     if (it != bwmap.end()) { */
     /*       auto &bw = it->second; */
     /*       auto min = bw.get_min(); */
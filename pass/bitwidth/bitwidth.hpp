@@ -1,6 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include "absl/container/flat_hash_set.h"
 #include "bitwidth_range.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
@@ -8,7 +9,10 @@
 #include "pass.hpp"
 #include "lgedgeiter.hpp"
 
-using BWMap = absl::flat_hash_map<Node_pin::Compact, Bitwidth_range>;
+// The lgid of the pin lgraph is part of the key: a bwmap can have the pins of
+// several lgraphs (pass.compiler merges the per module maps)
+using BWKey = std::pair<Lg_type_id::type, Node_pin::Compact>;
+using BWMap = absl::flat_hash_map<BWKey, Bitwidth_range>;
 
 class Bitwidth {
 protected:
@@ -21,8 +25,35 @@ protected:
   static Attr get_key_attr(std::string_view key);
 
   bool not_finished;
+  bool quiet;   // no unconstrained messages (fixpoint iterations)
+  int  n_threads;
   BWMap &bwmap; // reference the global bwmap outside
 
+  absl::flat_hash_set<Node::Compact> pending; // nodes with unconstrained inputs after the forward pass
+
+  // Fixpoint over the strongly connected regions (loops through flops)
+  struct Scc_graph {
+    std::vector<Node>                           nodes;
+    std::vector<XEdge_iterator>                 inp_edges;
+    std::vector<std::vector<BWKey>>             out_pins;  // driver pins with fanout in nodes
+    std::vector<std::vector<uint32_t>>          fanout;
+    std::vector<uint32_t>                       node2scc;
+    std::vector<std::vector<uint32_t>>          sccs;  // topological order
+  };
+  struct Scc_result {
+    BWMap local;
+    bool  unresolved = false;
+  };
+
+  static BWKey bw_key(const Node_pin &dpin);
+
+  static bool is_fixpoint_op(Ntype_op op);
+  void build_scc_graph(LGraph *lg, Scc_graph &g) const;
+  void solve_scc(const Scc_graph &g, uint32_t scc, Scc_result &res) const;
+  void bw_fixpoint(LGraph *lg);
+  void process_node(Node &node, XEdge_iterator &inp_edges);
+  void set_driver_bits(Node &node);
+
   void process_const(Node &node);
   void process_not(Node &node, XEdge_iterator &inp_edges);
   void process_flop(Node &node);
@@ -52,7 +83,7 @@ protected:
   void bw_pass(LGraph *lg);
 
 public:
-  Bitwidth (bool hier, int max_iterations, BWMap &bwmap);
+  Bitwidth (bool hier, int max_iterations, BWMap &bwmap, int n_threads = 1);
   void do_trans(LGraph *orig);
   bool is_finished() const { return !not_finished; }
 };
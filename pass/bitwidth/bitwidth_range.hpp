@@ -51,5 +51,8 @@ public:
   bool is_always_positive() const { return min >= 0; }
   bool is_2complement() const { return min < 0; }
 
+  bool operator==(const Bitwidth_range &other) const { return max == other.max && min == other.min && overflow == other.overflow; }
+  bool operator!=(const Bitwidth_range &other) const { return !(*this == other); }
+
   void dump() const;
 };
@@ -3,6 +3,7 @@
 
 #include "lgraph.hpp"
 #include "bitwidth.hpp"
+#include "pass_hier_driver.hpp"
 
 // Useful for debug
 //#define PRESERVE_ATTR_NODE
@@ -14,6 +15,8 @@ void Pass_bitwidth::setup() {
 
   m1.add_label_optional("max_iterations", "maximum number of iterations to try", "10");
   m1.add_label_optional("hier", "hierarchical bitwidth", "false");
+  m1.add_label_optional("threads", "threads to process independent lgraphs or loop regions (0 for all the cores)", "1");
+  m1.set_streamable();
 
   register_pass(m1);
 }
@@ -22,6 +25,8 @@ Pass_bitwidth::Pass_bitwidth(const Eprp_var &var) : Pass("pass.bitwidth", var) {
   auto miters = var.get("max_iterations");
   auto hier_txt = var.get("hier");
 
+  n_threads = Pass_hier_driver::get_threads(var.get("threads"));
+
   if (hier_txt != "false" && hier_txt != "0")
     hier = true;
   else
@@ -37,11 +42,27 @@ Pass_bitwidth::Pass_bitwidth(const Eprp_var &var) : Pass("pass.bitwidth", var) {
 void Pass_bitwidth::trans(Eprp_var &var) {
   Pass_bitwidth p(var);
 
-  Bitwidth bw(p.hier, p.max_iterations, p.bwmap);
+  if (p.n_threads == 1 || p.hier || var.lgs.size() == 1) {  // hier bitwidth walks the whole tree from the top
+    Bitwidth bw(p.hier, p.max_iterations, p.bwmap, p.n_threads);  // threads for the independent loop regions
+
+    for (const auto &lg : var.lgs) {
+      bw.do_trans(lg);
+    }
+    return;
+  }
 
-  std::vector<const LGraph *> lgs;
-  for (const auto &lg : var.lgs) {
+  Pass_hier_driver driver(p.n_threads);
+
+  // The bwmap is not thread safe, each thread gets its own and they are merged at the end
+  std::vector<BWMap> bwmaps(driver.get_n_threads());
+
+  driver.run(var.lgs, [&p, &bwmaps](LGraph *lg, int tid) {
+    Bitwidth bw(p.hier, p.max_iterations, bwmaps[tid]);
     bw.do_trans(lg);
+  });
+
+  for (auto &m : bwmaps) {
+    p.bwmap.insert(m.begin(), m.end());
   }
 }
 
@@ -9,13 +9,15 @@
 #include "node_pin.hpp"
 #include "pass.hpp"
 
-using BWMap = absl::flat_hash_map<Node_pin::Compact, Bitwidth_range>;
+using BWKey = std::pair<Lg_type_id::type, Node_pin::Compact>;  // same as bitwidth.hpp
+using BWMap = absl::flat_hash_map<BWKey, Bitwidth_range>;
 
 class Pass_bitwidth : public Pass {
 protected:
   int  max_iterations;
   bool must_perform_backward;
   bool hier;
+  int  n_threads;
   static void trans(Eprp_var &var);
   BWMap bwmap;
 
@@ -2,8 +2,28 @@
 
 #include <sys/stat.h>
 
+#include "absl/strings/str_cat.h"
+#include "lgraph.hpp"
+
 // Eprp Pass::eprp;
 
+// Pipelined eprp: a streamed stage holds an lgraph until the sub-lgraphs that
+// it instantiates went through the stage (same contract as Pass_hier_driver).
+// Idle lgraphs release their mmaps only between commands, never while a pass
+// (or one of its threads) may hold nodes from them.
+static bool pipe_subs_setup = []() {
+  Pass::eprp.set_pipe_subs([](LGraph *lg, std::vector<std::string> &subs) {
+    lg->each_sub_unique_fast([lg, &subs](Node &node, Lg_type_id lgid) -> bool {
+      (void)node;
+      subs.emplace_back(absl::StrCat(lg->get_path(), "/", lg->get_library().get_name(lgid)));
+      return true;
+    });
+    return absl::StrCat(lg->get_path(), "/", lg->get_name());
+  });
+  Pass::eprp.set_idle([]() { Graph_library::release_unused(); });
+  return true;
+}();
+
 const std::string Pass::get_files(const Eprp_var &var) const {
   std::string _files;
   if (var.has_label("files")) {
@@ -0,0 +1,149 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "pass_hier_driver.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/numbers.h"
+#include "lgraph.hpp"
+#include "pass.hpp"
+#include "thread_pool.hpp"
+
+Pass_hier_driver::Pass_hier_driver(int _n_threads) : n_threads(_n_threads) {
+  int max_threads = std::thread::hardware_concurrency();
+  if (n_threads <= 0 || n_threads > max_threads)
+    n_threads = max_threads;
+  if (n_threads <= 0)
+    n_threads = 1;
+}
+
+int Pass_hier_driver::get_threads(std::string_view txt) {
+  int n = 1;
+  if (!absl::SimpleAtoi(txt, &n) || n < 0) {
+    Pass::error("threads:{} should be a positive number (0 for all the cores)", txt);
+    return 1;
+  }
+
+  return n;
+}
+
+void Pass_hier_driver::run(const std::vector<LGraph *> &lgs, const Pass_fn &fn) const {
+  // Unique lgraphs (keep the pipe order)
+  std::vector<LGraph *>                    work;
+  absl::flat_hash_map<const LGraph *, int> lg2pos;
+  for (auto *lg : lgs) {
+    if (lg2pos.contains(lg))
+      continue;
+    lg2pos[lg] = work.size();
+    work.emplace_back(lg);
+  }
+
+  // Dependences: a parent waits for all the subs in the work set
+  std::vector<int>              n_pending(work.size(), 0);
+  std::vector<std::vector<int>> parents(work.size());
+  for (auto i = 0u; i < work.size(); ++i) {
+    auto *lg = work[i];
+    lg->each_sub_unique_fast([&](Node &node, Lg_type_id lgid) -> bool {
+      (void)node;
+      auto *sub_lg = lg->get_library().try_find_lgraph(lgid);
+      if (sub_lg == nullptr || sub_lg == lg)
+        return true;
+      auto it = lg2pos.find(sub_lg);
+      if (it == lg2pos.end())
+        return true;
+
+      n_pending[i]++;
+      parents[it->second].emplace_back(i);
+      return true;
+    });
+  }
+
+  std::deque<int> ready;
+  for (auto i = 0u; i < work.size(); ++i) {
+    if (n_pending[i] == 0)
+      ready.emplace_back(i);
+  }
+
+  size_t n_done = 0;
+  auto   mark_done = [&](int pos) {
+    n_done++;
+    for (auto parent : parents[pos]) {
+      I(n_pending[parent] > 0);
+      if (--n_pending[parent] == 0)
+        ready.emplace_back(parent);
+    }
+  };
+
+  if (n_threads <= 1 || work.size() <= 1) {
+    while (!ready.empty()) {
+      auto pos = ready.front();
+      ready.pop_front();
+      fn(work[pos], 0);
+      mark_done(pos);
+    }
+  } else {
+    // Only this thread schedules (it owns the dependence counters). Workers
+    // report back through the done list.
+    Thread_pool pool(n_threads);
+
+    std::mutex              done_mutex;
+    std::condition_variable done_cv;
+    std::vector<int>        done_list;
+
+    std::vector<int> free_tids;
+    for (int tid = pool.size() - 1; tid >= 0; --tid) {
+      free_tids.emplace_back(tid);
+    }
+    std::vector<int> pos2tid(work.size(), -1);
+
+    size_t n_running = 0;
+    while (n_done < work.size()) {
+      while (!ready.empty() && !free_tids.empty()) {
+        auto pos = ready.front();
+        ready.pop_front();
+        auto tid = free_tids.back();
+        free_tids.pop_back();
+        pos2tid[pos] = tid;
+        n_running++;
+
+        pool.add([&fn, &work, &done_mutex, &done_cv, &done_list, pos, tid]() {
+          fn(work[pos], tid);
+          {
+            std::lock_guard<std::mutex> guard(done_mutex);
+            done_list.emplace_back(pos);
+          }
+          done_cv.notify_one();
+        });
+      }
+
+      if (n_running == 0)
+        break;  // Nothing ready (recursive instantiation). Handled serially below
+
+      std::vector<int> finished;
+      {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&done_list]() { return !done_list.empty(); });
+        std::swap(finished, done_list);
+      }
+      for (auto pos : finished) {
+        n_running--;
+        free_tids.emplace_back(pos2tid[pos]);
+        mark_done(pos);
+      }
+    }
+    pool.wait_all();
+  }
+
+  if (n_done < work.size()) {
+    Pass::warn("hierarchy has a loop, the remaining {} lgraphs are processed serially", work.size() - n_done);
+    for (auto i = 0u; i < work.size(); ++i) {
+      if (n_pending[i] == 0)
+        continue;  // already done
+      fn(work[i], 0);
+    }
+  }
+}
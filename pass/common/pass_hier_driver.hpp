@@ -0,0 +1,34 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <vector>
+
+class LGraph;
+
+// Run a per-LGraph pass over a set of lgraphs following the hierarchy
+// bottom-up. An LGraph is scheduled once all the sub-lgraphs (in the set) that
+// it instantiates are done, so independent lgraphs run concurrently in the
+// Thread_pool.
+//
+// The pass function must only modify the LGraph passed. Reading done subs is
+// fine. Per-thread pass state can be indexed with the thread id argument
+// (0..get_n_threads()-1).
+class Pass_hier_driver {
+public:
+  using Pass_fn = std::function<void(LGraph *lg, int tid)>;
+
+protected:
+  int n_threads;
+
+public:
+  explicit Pass_hier_driver(int _n_threads);
+
+  // Parse the "threads" label value (0 means all the cores)
+  static int get_threads(std::string_view txt);
+
+  int get_n_threads() const { return n_threads; }
+
+  void run(const std::vector<LGraph *> &lgs, const Pass_fn &fn) const;
+};
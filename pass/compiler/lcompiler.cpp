@@ -8,11 +8,101 @@
 #include "bitwidth.hpp"
 #include "firmap.hpp"
 
-Lcompiler::Lcompiler(std::string_view _path, std::string_view _odir, std::string_view _top, bool _gviz) 
-  : path(_path), odir(_odir), top(_top), gviz(_gviz) {}
+Lcompiler::Lcompiler(std::string_view _path, std::string_view _odir, std::string_view _top, bool _gviz, int _n_threads)
+  : path(_path), odir(_odir), top(_top), gviz(_gviz), n_threads(_n_threads) {
+  int max_threads = std::thread::hardware_concurrency();
+  if (n_threads <= 0 || n_threads > max_threads)
+    n_threads = max_threads;
+  if (n_threads > 1)
+    thread_pool = std::make_unique<Thread_pool>(n_threads - 1);  // the thread in wait_local also runs jobs
+  else
+    n_threads = 1;
+}
+
+void Lcompiler::add_thread(std::shared_ptr<Lnast> ln, bool firrtl) {
+  if (local_results.empty())
+    local_start = std::chrono::steady_clock::now();
+
+  auto &res = local_results.emplace_back();  // deque, the reference stays valid
+  res.name  = ln->get_top_module_name();
+
+  submit_local(res, [this, ln, firrtl](Local_result &r) {
+    if (firrtl)
+      add_firrtl_thread(ln, r);
+    else
+      add_pyrope_thread(ln, r);
+  });
+}
+
+void Lcompiler::wait_local() { join_local("local"); }
+
+void Lcompiler::submit_local(Local_result &res, std::function<void(Local_result &res)> fn) {
+  auto job = [&res, fn = std::move(fn)]() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+      fn(res);
+    } catch (...) {
+      res.error = std::current_exception();
+    }
+    res.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  if (thread_pool)
+    thread_pool->add(std::move(job));
+  else
+    job();
+}
+
+void Lcompiler::join_local(std::string_view phase) {
+  if (local_results.empty())
+    return;
 
+  if (thread_pool)
+    thread_pool->wait_all();
 
-void Lcompiler::add_pyrope_thread(std::shared_ptr<Lnast> ln) {
+  auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - local_start).count();
+
+  // Same lgs order as a serial compile. The bwmap keys have the lgid, so the
+  // per module maps do not overlap.
+  for (auto &res : local_results) {
+    if (res.error)
+      std::rethrow_exception(res.error);
+
+    for (auto *lg : res.lgs)
+      lgs.emplace_back(lg);
+    for (const auto &it : res.bwmap)
+      global_bwmap.insert_or_assign(it.first, it.second);
+  }
+
+  print_scaling(phase, wall, local_results);
+  local_results.clear();
+}
+
+void Lcompiler::print_scaling(std::string_view phase, double wall, const std::deque<Local_result> &results) const {
+  double total   = 0;
+  double slowest = 0;
+  std::string_view slowest_name;
+  for (const auto &res : results) {
+    total += res.secs;
+    if (res.secs >= slowest) {
+      slowest      = res.secs;
+      slowest_name = res.name;
+    }
+  }
+
+  fmt::print("lcompiler {} passes: {} modules, {} threads, wall:{:.3f}s sum:{:.3f}s speedup:{:.2f}x slowest:{} {:.3f}s\n",
+             phase,
+             results.size(),
+             n_threads,
+             wall,
+             total,
+             wall > 0 ? total / wall : 1.0,
+             slowest_name,
+             slowest);
+}
+
+
+void Lcompiler::add_pyrope_thread(std::shared_ptr<Lnast> ln, Local_result &res) {
   Graphviz gv(true, false, odir); 
   gviz ? gv.do_from_lnast(ln, "raw") : void(); 
   
@@ -34,7 +124,7 @@ void Lcompiler::add_pyrope_thread(std::shared_ptr<Lnast> ln) {
   }
 
   Cprop    cp(false, false);                // hier = false, gioc = false
-  Bitwidth bw(false, 10, global_bwmap);     // hier = false, max_iters = 10
+  Bitwidth bw(false, 10, res.bwmap);        // hier = false, max_iters = 10, merged in wait_local
   for (const auto &lg : local_lgs) {
     fmt::print("------------------------ Local Copy-Propagation ---------------------- (C-1)\n");
     cp.do_trans(lg);
@@ -53,14 +143,11 @@ void Lcompiler::add_pyrope_thread(std::shared_ptr<Lnast> ln) {
     gviz ? gv.do_from_lgraph(lg, "local") : void(); 
   }
 
-  std::lock_guard<std::mutex> guard(lgs_mutex);
-
-  for(auto *lg:local_lgs)
-    lgs.emplace_back(lg);
+  res.lgs = std::move(local_lgs);
 }
 
 
-void Lcompiler::add_firrtl_thread(std::shared_ptr<Lnast> ln) {
+void Lcompiler::add_firrtl_thread(std::shared_ptr<Lnast> ln, Local_result &res) {
   Graphviz gv(true, false, odir); 
   gviz ? gv.do_from_lnast(ln, "raw") : void(); 
   
@@ -93,14 +180,14 @@ void Lcompiler::add_firrtl_thread(std::shared_ptr<Lnast> ln) {
     gviz ? gv.do_from_lgraph(lg, "local.no_bits") : void();
   }
 
-  std::lock_guard<std::mutex> guard(lgs_mutex);
-  for(auto *lg:local_lgs)
-    lgs.emplace_back(lg);
+  res.lgs = std::move(local_lgs);
 }
 
 
 
 void Lcompiler::global_io_connection() {
+  wait_local();
+
   Graphviz gv(true,  false, odir);
   Cprop    cp(false, true);               // hier = false, at_gioc = true 
   Bitwidth bw(true, 10, global_bwmap);    // hier = false, max_iters = 10
@@ -118,6 +205,8 @@ void Lcompiler::global_io_connection() {
 
 
 void Lcompiler::global_firrtl_bits_analysis_map() {
+  wait_local();
+
   Graphviz gv(true, false, odir);
   Firmap   fm;   
 
@@ -165,27 +254,40 @@ void Lcompiler::global_firrtl_bits_analysis_map() {
 
 
 void Lcompiler::local_bitwidth_inference() {
-  Graphviz gv(true, false, odir); 
-  Bitwidth bw(false, 10, global_bwmap);     // hier = false, max_iters = 10
-  for (auto &lg: lgs) {
-    fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-1)\n");
-    bw.do_trans(lg);
-    gviz ? gv.do_from_lgraph(lg, "local.debug0") : void(); 
+  wait_local();
 
+  local_start = std::chrono::steady_clock::now();
+  for (auto *lg : lgs) {
+    auto &res = local_results.emplace_back();
+    res.name  = lg->get_name();
 
-    fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-2)\n");
-    bw.do_trans(lg);
-    gviz ? gv.do_from_lgraph(lg, "local.debug1") : void(); 
+    submit_local(res, [this, lg](Local_result &r) {
+      Graphviz gv(true, false, odir); 
+      Bitwidth bw(false, 10, r.bwmap);  // hier = false, max_iters = 10, merged in join_local
 
+      fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-1)\n");
+      bw.do_trans(lg);
+      gviz ? gv.do_from_lgraph(lg, "local.debug0") : void(); 
 
-    fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-3)\n");
-    bw.do_trans(lg);
-    gviz ? gv.do_from_lgraph(lg, "local") : void(); 
+
+      fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-2)\n");
+      bw.do_trans(lg);
+      gviz ? gv.do_from_lgraph(lg, "local.debug1") : void(); 
+
+
+      fmt::print("------------------------ Local Bitwidth-Inference ------------------- (B-3)\n");
+      bw.do_trans(lg);
+      gviz ? gv.do_from_lgraph(lg, "local") : void(); 
+    });
   }
+
+  join_local("bitwidth");
 }
 
 
 void Lcompiler::global_bitwidth_inference() {
+  wait_local();
+
   Graphviz gv(true, false, odir);
   Bitwidth bw(true, 10, global_bwmap);   // hier = true, max_iters = 10
 
@@ -207,7 +309,7 @@ void Lcompiler::global_bitwidth_inference() {
 }
 
 std::vector<LGraph *> Lcompiler::wait_all() {
-  /* thread_pool.wait_all(); */
+  wait_local();
   return lgs;
 }
 
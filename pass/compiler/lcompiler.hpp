@@ -1,5 +1,10 @@
 // This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -9,8 +14,10 @@
 #include "lbench.hpp"
 #include "lnast.hpp"
 #include "likely.hpp"
+#include "thread_pool.hpp"
 
-using BWMap = absl::flat_hash_map<Node_pin::Compact, Bitwidth_range>;
+using BWKey = std::pair<Lg_type_id::type, Node_pin::Compact>;  // same as bitwidth.hpp
+using BWMap = absl::flat_hash_map<BWKey, Bitwidth_range>;
 
 class Lcompiler {
 private:
@@ -21,20 +28,38 @@ private:
   BWMap global_bwmap;
 
 protected:
-  std::mutex lgs_mutex;
+  // Result of the local passes of one LNAST. Slots are kept in the add order,
+  // so the lgs and the merged bwmap do not depend on the thread scheduling.
+  struct Local_result {
+    std::vector<LGraph *> lgs;
+    BWMap                 bwmap;
+    std::string           name;
+    double                secs = 0;
+    std::exception_ptr    error;
+  };
+
+  int                          n_threads;
+  std::unique_ptr<Thread_pool> thread_pool;  // nullptr when n_threads == 1
+  std::deque<Local_result>     local_results;
+  std::chrono::steady_clock::time_point local_start;
+
   std::vector<LGraph *> lgs;
 
   void compile_thread(std::shared_ptr<Lnast> ln);
   void compile_thread(std::string_view file); // future allow to call inou.pyrope or inou.verilog or comp error
-  void add_pyrope_thread(std::shared_ptr<Lnast> lnast);
-  void add_firrtl_thread(std::shared_ptr<Lnast> lnast);
+  void add_pyrope_thread(std::shared_ptr<Lnast> lnast, Local_result &res);
+  void add_firrtl_thread(std::shared_ptr<Lnast> lnast, Local_result &res);
+  void add_thread(std::shared_ptr<Lnast> lnast, bool firrtl);
+  void submit_local(Local_result &res, std::function<void(Local_result &res)> fn);
+  void join_local(std::string_view phase);
+  void print_scaling(std::string_view phase, double wall, const std::deque<Local_result> &results) const;
 
 public:
-  Lcompiler(std::string_view path, std::string_view odir, std::string_view top, bool gviz);
+  Lcompiler(std::string_view path, std::string_view odir, std::string_view top, bool gviz, int n_threads = 1);
 
-  //thread_pool.add(Lcompiler::add_thread, this, ln);
-  void add_pyrope(std::shared_ptr<Lnast> lnast) { add_pyrope_thread(lnast);}
-  void add_firrtl(std::shared_ptr<Lnast> lnast) { add_firrtl_thread(lnast);}
+  void add_pyrope(std::shared_ptr<Lnast> lnast) { add_thread(lnast, false); }
+  void add_firrtl(std::shared_ptr<Lnast> lnast) { add_thread(lnast, true); }
+  void wait_local(); // join the add_pyrope/add_firrtl jobs and merge the per-module bwmaps
   void local_bitwidth_inference();
   void global_io_connection();
   void global_bitwidth_inference();
@@ -1,6 +1,8 @@
 // This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #include "pass_compiler.hpp"
 
+#include "pass_hier_driver.hpp"
+
 static Pass_plugin sample("pass_compiler", Pass_compiler::setup);
 
 
@@ -12,6 +14,7 @@ void Pass_compiler::setup() {
   m1.add_label_optional("top",    "specify the top module");
   m1.add_label_optional("odir",   "output directory", ".");
   m1.add_label_optional("gviz",   "dump graphviz");
+  m1.add_label_optional("threads", "threads to compile the lnasts in parallel (0 for all the cores)", "0");
 
   register_pass(m1);
 }
@@ -59,8 +62,9 @@ void Pass_compiler::compile(Eprp_var &var) {
   auto top       = pc.check_option_top(var);
   bool gviz      = pc.check_option_gviz(var);
   bool is_firrtl = pc.check_option_firrtl(var);
+  int  n_threads = Pass_hier_driver::get_threads(var.get("threads"));
 
-  Lcompiler compiler(path, odir, top, gviz);
+  Lcompiler compiler(path, odir, top, gviz, n_threads);
   fmt::print("top module_name is: {}\n", top);
 
   if (var.lnasts.empty()) {
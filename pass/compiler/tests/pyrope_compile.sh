@@ -16,6 +16,8 @@ pts='hier_tuple2 hier_tuple_io tuple_copy2 if nested_if reg__q_pin tuple_copy
 # Note: in this bash script, you MUST specify top module name AT FIRST POSITION
 pts_hier1='top sum top'
 pts_hier2='top top sum'
+# threads:1 and threads:4 must generate the same verilog (the first is the top)
+pts_parallel='top sum counter capricious_bits adder_stage hier_tuple'
 
 
 LGSHELL=./bazel-bin/main/lgshell
@@ -189,6 +191,71 @@ Pyrope_compile_hier () {
 }
 
 
+Pyrope_compile_parallel () {
+  echo ""
+  echo ""
+  echo ""
+  echo "===================================================="
+  echo "Pyrope Compilation: Parallel vs Serial"
+  echo "===================================================="
+
+  declare pts_concat
+  declare top_module
+
+  for pt in $1
+  do
+    if [ ! -f ${PATTERN_PATH}/${pt}.prp ]; then
+        echo "ERROR: could not find ${pt}.prp in ${PATTERN_PATH}"
+        exit 1
+    fi
+    if [ -z "${top_module}" ]; then
+      top_module=${pt}
+    fi
+    if [ -z "${pts_concat}" ]; then
+      pts_concat="${PATTERN_PATH}/${pt}.prp"
+    else
+      pts_concat="${pts_concat},${PATTERN_PATH}/${pt}.prp"
+    fi
+  done
+
+  for threads in 1 4
+  do
+    rm -rf ./lgdb_threads${threads} ./threads${threads}
+    mkdir -p ./threads${threads}
+    ${LGSHELL} "inou.pyrope files:${pts_concat} |> pass.compiler path:lgdb_threads${threads} top:${top_module} threads:${threads}"
+    ret_val=$?
+    if [ $ret_val -ne 0 ]; then
+      echo "ERROR: could not compile with threads:${threads} patterns: ${pts_concat}"
+      exit $ret_val
+    fi
+
+    for pt in $1
+    do
+      ${LGSHELL} "lgraph.open path:lgdb_threads${threads} name:${pt} |> inou.yosys.fromlg path:lgdb_threads${threads} odir:threads${threads}"
+      if [ $? -ne 0 ] || [ ! -f threads${threads}/${pt}.v ]; then
+        echo "ERROR: Pyrope compiler failed: verilog generation threads:${threads}, testcase: ${pt}"
+        exit 1
+      fi
+    done
+  done
+
+  for pt in $1
+  do
+    diff -q threads1/${pt}.v threads4/${pt}.v
+    if [ $? -ne 0 ]; then
+      echo "FAIL: ${pt}.v threads:4 is not the same as threads:1"
+      exit 1
+    fi
+  done
+  echo "Successfully pass parallel vs serial check!"
+
+  rm -rf ./lgdb_threads1 ./lgdb_threads4 ./threads1 ./threads4
+  rm -f yosys_script.*
+}
+
+
+rm -rf ./lgdb
+Pyrope_compile_parallel "$pts_parallel"
 rm -rf ./lgdb
 Pyrope_compile_hier "$pts_hier1"
 rm -rf ./lgdb
@@ -1,7 +1,10 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <deque>
 #include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "cprop.hpp"
 #include "lbench.hpp"
 #include "lgcpp_plugin.hpp"
@@ -13,7 +16,7 @@
 //#define TRACE(x)
 #define TRACE(x) x
 
-Cprop::Cprop (bool _hier, bool _at_gioc) : hier(_hier), at_gioc(_at_gioc) {}
+Cprop::Cprop (bool _hier, bool _at_gioc, bool _sparse) : hier(_hier), at_gioc(_at_gioc), sparse(_sparse) {}
 
 void Cprop::collapse_forward_same_op(Node &node, XEdge_iterator &inp_edges_ordered) {
   auto op = node.get_type_op();
@@ -353,10 +356,13 @@ void Cprop::replace_all_inputs_const(Node &node, XEdge_iterator &inp_edges_order
   } else if (op == Ntype_op::EQ) {
     bool eq = true;
     I(inp_edges_ordered.size() > 1);
-    auto first = inp_edges_ordered[0].driver.get_node().get_type_const();
-    for (auto i = 1u; i < inp_edges_ordered.size(); ++i) {
-      auto c = inp_edges_ordered[i].driver.get_node().get_type_const();
-      eq     = eq && first.eq_op(c);
+    auto first_node = inp_edges_ordered[0].driver.get_node();
+    auto first_h    = first_node.get_type_const_handle();
+    for (auto i = 1u; eq && i < inp_edges_ordered.size(); ++i) {
+      auto c_node = inp_edges_ordered[i].driver.get_node();
+      if (c_node.get_type_const_handle() == first_h)
+        continue;  // interned, same handle is same value (no decode)
+      eq = first_node.get_type_const().eq_op(c_node.get_type_const());
     }
 
     Lconst result(eq ? 1 : 0);
@@ -762,51 +768,173 @@ void Cprop::process_tuple_add(Node &node) {
   }
 }
 
-void Cprop::do_trans(LGraph *lg) {
-  /* Lbench b("pass.cprop"); */
-  /* bool tup_get_left = false; */
+void Cprop::process_node(Node &node) {
+  ++n_visited;
+
+  auto op = node.get_type_op();
+
+  // Special cases to handle in cprop
+  if (op == Ntype_op::AttrGet) {
+    process_attr_get(node);
+    return;
+  } else if (op == Ntype_op::AttrSet) {
+    return;  // Nothing to do in cprop
+  } else if (op == Ntype_op::Sub) {
+    process_subgraph(node);
+    return;
+  } else if (op == Ntype_op::Sflop || op == Ntype_op::Aflop || op == Ntype_op::Latch || op == Ntype_op::Fflop || op == Ntype_op::Memory || op == Ntype_op::Sub) {
+    fmt::print("cprop skipping node:{}\n", node.debug_name());
+    // FIXME: if flop feeds itself (no update, delete, replace for zero)
+    // FIXME: if flop is disconnected *after AttrGet processed*, the flop was not used. Delete
+    return;
+  } else if (!node.has_outputs()) {
+    node.del_node();
+    return;
+  } else if (op == Ntype_op::TupAdd) {
+    process_tuple_add(node);
+    return;
+  } else if (op == Ntype_op::TupGet) {
+    auto ok = process_tuple_get(node);
+    if (!ok) {
+      fmt::print("cprop could not simplify node:{}\n",node.debug_name());
+    }
+    tuple_get_left |= !ok;
+    return;
+  }
+
+  // Normal copy prop and strength reduction
+  auto inp_edges_ordered = node.inp_edges_ordered();
+  try_constant_prop(node, inp_edges_ordered);
+
+  if (node.is_invalid())
+    return;  // It got deleted
+
+  try_collapse_forward(node, inp_edges_ordered);
+}
+
+// Sparse mode: only the nodes that a full sweep would change are visited. The
+// worklist is seeded with the fanout of the constants, the dead nodes, and the
+// nodes that collapse forward without constants. Tuples, attributes and
+// lgcpp subs need the forward order (node2tuple chains), so an lgraph with any
+// of them is not handled here (false, nothing changed) and gets the full sweep.
+bool Cprop::do_trans_sparse(LGraph *lg) {
+  std::deque<Node::Compact>          work;
+  absl::flat_hash_set<Node::Compact> in_work;
+
+  auto add_node = [&work, &in_work](const Node &node) {
+    if (node.is_graph_io())
+      return;
+    auto c = node.get_compact();
+    if (in_work.insert(c).second)
+      work.emplace_back(c);
+  };
 
-  for (auto node : lg->forward()) {
-    fmt::print("{}\n", node.debug_name());
+  for (auto node : lg->fast()) {
     auto op = node.get_type_op();
+    if (op == Ntype_op::TupAdd || op == Ntype_op::TupGet || op == Ntype_op::TupKey || op == Ntype_op::AttrGet
+        || op == Ntype_op::AttrSet || (op == Ntype_op::Sub && !node.is_type_sub_present()))
+      return false;
 
-    // Special cases to handle in cprop
-    if (op == Ntype_op::AttrGet) {
-      process_attr_get(node);
-      continue;
-    } else if (op == Ntype_op::AttrSet) {
-      continue;  // Nothing to do in cprop
-    } else if (op == Ntype_op::Sub) {
-      process_subgraph(node);
-      continue;
-    } else if (op == Ntype_op::Sflop || op == Ntype_op::Aflop || op == Ntype_op::Latch || op == Ntype_op::Fflop || op == Ntype_op::Memory || op == Ntype_op::Sub) {
-      fmt::print("cprop skipping node:{}\n", node.debug_name());
-      // FIXME: if flop feeds itself (no update, delete, replace for zero)
-      // FIXME: if flop is disconnected *after AttrGet processed*, the flop was not used. Delete
-      continue;
-    } else if (!node.has_outputs()) {
-      node.del_node();
-      continue;
-    } else if (op == Ntype_op::TupAdd) {
-      process_tuple_add(node);
-      continue;
-    } else if (op == Ntype_op::TupGet) {
-      auto ok = process_tuple_get(node);
-      if (!ok) {
-        fmt::print("cprop could not simplify node:{}\n",node.debug_name());
-      }
-      tuple_get_left |= !ok;
+    if (op == Ntype_op::Const) {  // this also covers muxes with a constant select
+      for (auto &e : node.out_edges()) add_node(e.sink.get_node());
+    } else if (is_sparse_seed(node)) {
+      add_node(node);
+    }
+  }
+
+  std::vector<Node> sinks;
+  std::vector<Node> drivers;
+  while (!work.empty()) {
+    auto c = work.front();
+    work.pop_front();
+    in_work.erase(c);
+
+    if (!lg->is_valid_node(c.get_nid()))
+      continue;  // deleted after it was added
+
+    Node node(lg, c);
+    if (node.get_type_op() == Ntype_op::Const) {
+      if (!node.has_outputs())
+        node.del_node();  // all the sinks folded it
       continue;
     }
 
-    // Normal copy prop and strength reduction
+    // The nodes around a change (new constant, collapsed driver, or dead node) are revisited
+    sinks.clear();
+    for (auto &e : node.out_edges()) sinks.emplace_back(e.sink.get_node());
+    drivers.clear();
+    for (auto &e : node.inp_edges()) drivers.emplace_back(e.driver.get_node());
+    const auto n_inputs = drivers.size();
+
+    process_node(node);
+
+    if (node.is_invalid() || !lg->is_valid_node(c.get_nid())) {
+      for (auto &sink : sinks) add_node(sink);
+      for (auto &driver : drivers) add_node(driver);  // may be dead now
+    } else if (node.inp_edges().size() != n_inputs) {
+      add_node(node);  // constants folded, retry
+    }
+  }
+
+  return true;
+}
+
+// Nodes that process_node changes even without constant inputs (see
+// try_collapse_forward and the dead node cases)
+bool Cprop::is_sparse_seed(Node &node) {
+  auto op = node.get_type_op();
+  if (op == Ntype_op::Sflop || op == Ntype_op::Aflop || op == Ntype_op::Latch || op == Ntype_op::Fflop
+      || op == Ntype_op::Memory || op == Ntype_op::Sub)
+    return false;
+
+  if (!node.has_outputs())
+    return true;
+
+  if (op == Ntype_op::Sum || op == Ntype_op::Mult || op == Ntype_op::Div || op == Ntype_op::And || op == Ntype_op::Or
+      || op == Ntype_op::Xor) {
+    if (node.inp_edges().size() == 1)
+      return true;
+    if (op == Ntype_op::Div)
+      return false;
+    for (auto &e : node.out_edges()) {
+      if (e.sink.get_node().get_type_op() == op)
+        return true;  // same op chain
+    }
+    return false;
+  }
+
+  if (op == Ntype_op::Tposs || op == Ntype_op::Ror) {
+    for (auto &e : node.inp_edges()) {
+      if (e.driver.get_node().get_type_op() == Ntype_op::Tposs)
+        return true;
+    }
+    return false;
+  }
+
+  if (op == Ntype_op::Mux) {
     auto inp_edges_ordered = node.inp_edges_ordered();
-    try_constant_prop(node, inp_edges_ordered);
+    if (inp_edges_ordered.size() < 2)
+      return false;
+    for (auto i = 2u; i < inp_edges_ordered.size(); ++i) {
+      if (inp_edges_ordered[1].driver != inp_edges_ordered[i].driver)
+        return false;
+    }
+    return true;
+  }
+
+  return false;
+}
 
-    if (node.is_invalid())
-      continue;  // It got deleted
+void Cprop::do_trans(LGraph *lg) {
+  /* Lbench b("pass.cprop"); */
+  /* bool tup_get_left = false; */
 
-    try_collapse_forward(node, inp_edges_ordered);
+  const bool swept = sparse && do_trans_sparse(lg);
+  if (!swept) {
+    for (auto node : lg->forward()) {
+      fmt::print("{}\n", node.debug_name());
+      process_node(node);
+    }
   }
 
   // FIXME: due to strange bug?? I move this function to the end of process_tuple_add
@@ -817,29 +945,31 @@ void Cprop::do_trans(LGraph *lg) {
   /* try_create_graph_output(lg, tup); */
 
 
-  for (auto node : lg->fast()) {
-    if (!tuple_get_left && node.is_type_tup()) {
-      if (hier) {
-        auto it = node2tuple.find(node.get_compact());
-        if (it != node2tuple.end()) {
-          node2tuple.erase(it);
+  if (!swept) {  // sparse: the worklist deleted the dead nodes, and there are no tuples
+    for (auto node : lg->fast()) {
+      if (!tuple_get_left && node.is_type_tup()) {
+        if (hier) {
+          auto it = node2tuple.find(node.get_compact());
+          if (it != node2tuple.end()) {
+            node2tuple.erase(it);
+          }
         }
+        node.del_node();
+        continue;
       }
-      node.del_node();
-      continue;
-    }
 
-    if (!node.has_outputs()) {
-      auto op = node.get_type_op();
-      if (op != Ntype_op::Sflop && op != Ntype_op::Aflop  && op != Ntype_op::Latch && 
-          op != Ntype_op::Fflop && op != Ntype_op::Memory && op != Ntype_op::Sub   && op != Ntype_op::AttrSet) {
-        // TODO: del_dead_end_nodes(); It can propagate back and keep deleting
-        // nodes until it reaches a SubGraph or a driver_pin that has some
-        // other outputs. Doing this dead_end_nodes delete iterator can retuce
-        // the number of times that cprop needs to be called for deep chains.
-        node.del_node();
+      if (!node.has_outputs()) {
+        auto op = node.get_type_op();
+        if (op != Ntype_op::Sflop && op != Ntype_op::Aflop  && op != Ntype_op::Latch && 
+            op != Ntype_op::Fflop && op != Ntype_op::Memory && op != Ntype_op::Sub   && op != Ntype_op::AttrSet) {
+          // TODO: del_dead_end_nodes(); It can propagate back and keep deleting
+          // nodes until it reaches a SubGraph or a driver_pin that has some
+          // other outputs. Doing this dead_end_nodes delete iterator can retuce
+          // the number of times that cprop needs to be called for deep chains.
+          node.del_node();
+        }
+        continue;
       }
-      continue;
     }
   }
 
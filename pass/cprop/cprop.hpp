@@ -11,6 +11,8 @@ private:
   bool hier;
   bool at_gioc;
   bool tuple_get_left = false;
+  bool sparse;
+  size_t n_visited = 0;
 protected:
 
   absl::flat_hash_map<Node::Compact, std::shared_ptr<Lgtuple>> node2tuple;  // node to the most up-to-dated tuple chain
@@ -30,6 +32,10 @@ protected:
   void replace_logic_node(Node &node, const Lconst &result, const Lconst &result_reduced);
 
   void process_subgraph(Node &node);
+  void process_node(Node &node);
+
+  bool do_trans_sparse(LGraph *lg);
+  bool is_sparse_seed(Node &node);
 
   // Attributes method
   bool process_attr_get(Node &node);
@@ -46,10 +52,11 @@ protected:
 
 
 public:
-  Cprop (bool _hier, bool _gioc);
+  Cprop (bool _hier, bool _gioc, bool _sparse = false);
   static std::tuple<std::string_view, std::string_view, int> get_tuple_name_key(Node &node);
   void dump_node2tuples() const;
   // Entry point
   void do_trans(LGraph *orig);
   bool get_tuple_get_left() const;
+  size_t get_n_visited() const { return n_visited; }
 };
@@ -1,6 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #include "pass_cprop.hpp"
 #include "cprop.hpp"
+#include "pass_hier_driver.hpp"
 
 static Pass_plugin sample("pass_cprop", Pass_cprop::setup);
 
@@ -8,6 +9,9 @@ void Pass_cprop::setup() {
   Eprp_method m1("pass.cprop", "in-place copy propagation", &Pass_cprop::optimize);
   m1.add_label_optional("hier", "hierarchical copy-propagation", "false");
   m1.add_label_optional("gioc", "global io connection", "false");
+  m1.add_label_optional("sparse", "worklist from the constants instead of a full sweep (lgraphs with tuples/attributes get the full sweep)", "false");
+  m1.add_label_optional("threads", "threads to process independent lgraphs (0 for all the cores)", "1");
+  m1.set_streamable();
 
   register_pass(m1);
 }
@@ -15,6 +19,9 @@ void Pass_cprop::setup() {
 Pass_cprop::Pass_cprop(const Eprp_var &var) : Pass("pass.cprop", var) {
   auto hier_txt = var.get("hier");
   auto gioc_txt = var.get("gioc");
+  auto sparse_txt = var.get("sparse");
+
+  n_threads = Pass_hier_driver::get_threads(var.get("threads"));
 
   if (hier_txt != "false" && hier_txt != "0")
     hier = true;
@@ -26,15 +33,40 @@ Pass_cprop::Pass_cprop(const Eprp_var &var) : Pass("pass.cprop", var) {
     gioc = true;
   else
     gioc = false;
+
+  if (sparse_txt != "false" && sparse_txt != "0")
+    sparse = true;
+  else
+    sparse = false;
 }
 
 void Pass_cprop::optimize(Eprp_var &var) {
   Pass_cprop pcp(var);
-  Cprop cp(pcp.hier, pcp.gioc);
 
-  for (auto &lg : var.lgs) {
-    cp.do_trans(lg);
+  if (pcp.n_threads == 1 || pcp.hier || pcp.gioc) {  // hier and gioc modify other lgraphs
+    Cprop cp(pcp.hier, pcp.gioc, pcp.sparse);
+
+    for (auto &lg : var.lgs) {
+      cp.do_trans(lg);
+    }
+    info("pass.cprop visited:{} nodes", cp.get_n_visited());
+    return;
+  }
+
+  Pass_hier_driver driver(pcp.n_threads);
+
+  std::vector<Cprop> cps;  // Cprop keeps per-run state, one per thread
+  for (int i = 0; i < driver.get_n_threads(); ++i) {
+    cps.emplace_back(pcp.hier, pcp.gioc, pcp.sparse);
+  }
+
+  driver.run(var.lgs, [&cps](LGraph *lg, int tid) { cps[tid].do_trans(lg); });
+
+  size_t n_visited = 0;
+  for (const auto &cp : cps) {
+    n_visited += cp.get_n_visited();
   }
+  info("pass.cprop visited:{} nodes", n_visited);
 }
 
 
@@ -7,6 +7,8 @@ class Pass_cprop : public Pass {
 private:
   bool hier;
   bool gioc;
+  bool sparse;
+  int  n_threads;
 protected:
   static void optimize(Eprp_var &var);
 
@@ -0,0 +1,148 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cprop.hpp"
+#include "eprp_utils.hpp"
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+
+// pass.cprop sparse:true must leave the same lgraph as the full sweep
+class Cprop_sparse_test : public ::testing::Test {
+protected:
+  void SetUp() override { Eprp_utils::clean_dir("lgdb_cprop_sparse"); }
+  void TearDown() override { Graph_library::shutdown(); }
+
+  static void connect(Node_pin dpin, Node &node, Port_ID pid) { dpin.connect_sink(node.setup_sink_pin_raw(pid)); }
+
+  static LGraph *create(std::string_view name, bool with_attr) {
+    auto *lg = LGraph::create("lgdb_cprop_sparse", name, "-");
+
+    auto a = lg->add_graph_input("a", 1, 8);
+    auto b = lg->add_graph_input("b", 2, 8);
+
+    // o1 = 3 + 4
+    auto sum1 = lg->create_node(Ntype_op::Sum);
+    connect(lg->create_node_const(3).get_driver_pin(), sum1, 0);
+    connect(lg->create_node_const(4).get_driver_pin(), sum1, 0);
+    sum1.setup_driver_pin().connect_sink(lg->add_graph_output("o1", 3, 8));
+
+    // o2 = mux(1, a, b)
+    auto mux = lg->create_node(Ntype_op::Mux);
+    connect(lg->create_node_const(1).get_driver_pin(), mux, 0);
+    connect(a, mux, 1);
+    connect(b, mux, 2);
+    mux.setup_driver_pin().connect_sink(lg->add_graph_output("o2", 4, 8));
+
+    // o3 = and(a), no constants
+    auto and1 = lg->create_node(Ntype_op::And);
+    connect(a, and1, 0);
+    and1.setup_driver_pin().connect_sink(lg->add_graph_output("o3", 5, 8));
+
+    // o4 = a + (2 + 5)
+    auto sum2 = lg->create_node(Ntype_op::Sum);
+    connect(lg->create_node_const(2).get_driver_pin(), sum2, 0);
+    connect(lg->create_node_const(5).get_driver_pin(), sum2, 0);
+    auto sum3 = lg->create_node(Ntype_op::Sum);
+    connect(a, sum3, 0);
+    connect(sum2.setup_driver_pin(), sum3, 0);
+    sum3.setup_driver_pin().connect_sink(lg->add_graph_output("o4", 6, 8));
+
+    // o5 = xor(xor(a, b), b), no constants
+    auto xor1 = lg->create_node(Ntype_op::Xor);
+    connect(a, xor1, 0);
+    connect(b, xor1, 0);
+    auto xor2 = lg->create_node(Ntype_op::Xor);
+    connect(xor1.setup_driver_pin(), xor2, 0);
+    connect(b, xor2, 0);
+    xor2.setup_driver_pin().connect_sink(lg->add_graph_output("o5", 7, 8));
+
+    // dead: (a + b) | 6 has no outputs
+    auto sum4 = lg->create_node(Ntype_op::Sum);
+    connect(a, sum4, 0);
+    connect(b, sum4, 0);
+    auto or1 = lg->create_node(Ntype_op::Or);
+    connect(sum4.setup_driver_pin(), or1, 0);
+    connect(lg->create_node_const(6).get_driver_pin(), or1, 0);
+
+    if (with_attr)
+      lg->create_node(Ntype_op::AttrSet);  // needs the forward sweep
+
+    return lg;
+  }
+
+  static std::string describe(const Node_pin &dpin, int depth) {
+    auto node = dpin.get_node();
+    if (node.is_graph_io())
+      return std::string(dpin.get_name());
+    if (node.is_type_const())
+      return node.get_type_const().to_pyrope();
+
+    std::vector<std::string> inps;
+    if (depth > 0) {
+      for (auto &e : node.inp_edges_ordered()) inps.emplace_back(describe(e.driver, depth - 1));
+    }
+    std::string txt(node.get_type_name());
+    txt += "(";
+    for (const auto &i : inps) txt += i + ",";
+    return txt + ")";
+  }
+
+  // Output drivers and the number of nodes of each type
+  static std::map<std::string, std::string> summary(LGraph *lg) {
+    std::map<std::string, std::string> res;
+    lg->each_graph_output([&res](const Node_pin &pin) {
+      std::string drivers;
+      for (auto &e : pin.get_sink_from_output().inp_edges()) drivers += describe(e.driver, 3) + " ";
+      res[std::string(pin.get_name())] = drivers;
+    });
+
+    std::map<std::string, int> n_nodes;
+    for (auto node : lg->fast()) n_nodes[std::string(node.get_type_name())]++;
+    for (const auto &[type, n] : n_nodes) res["#" + type] = std::to_string(n);
+
+    return res;
+  }
+};
+
+TEST_F(Cprop_sparse_test, same_as_full) {
+  auto *lg_full   = create("full", false);
+  auto *lg_sparse = create("sparse", false);
+
+  Cprop full(false, false, false);
+  full.do_trans(lg_full);
+
+  Cprop sparse(false, false, true);
+  sparse.do_trans(lg_sparse);
+
+  auto res_full   = summary(lg_full);
+  auto res_sparse = summary(lg_sparse);
+  EXPECT_EQ(res_full, res_sparse);
+  for (const auto &[key, txt] : res_full) {
+    EXPECT_EQ(txt, res_sparse[key]) << key;
+  }
+
+  EXPECT_EQ(res_full["o1"], "7 ");
+  EXPECT_EQ(res_full["o2"], "b ");
+  EXPECT_EQ(res_full["o3"], "a ");
+  EXPECT_EQ(res_full["o5"], "a ");
+
+  EXPECT_LT(sparse.get_n_visited(), full.get_n_visited());
+}
+
+TEST_F(Cprop_sparse_test, attr_gets_full_sweep) {
+  auto *lg_full   = create("full_attr", true);
+  auto *lg_sparse = create("sparse_attr", true);
+
+  Cprop full(false, false, false);
+  full.do_trans(lg_full);
+
+  Cprop sparse(false, false, true);
+  sparse.do_trans(lg_sparse);
+
+  EXPECT_EQ(summary(lg_full), summary(lg_sparse));
+  EXPECT_EQ(sparse.get_n_visited(), full.get_n_visited());
+}
@@ -1410,6 +1410,8 @@ void Lnast_tolg::process_ast_func_call_op(LGraph *lg, const Lnast_nid &lnidx_fc)
     fmt::print("function {} defined in separated prp file, query lgdb\n", func_name);
     Node subg_node;
     Sub_node* sub;
+    // lookup + pin setup must be atomic, the callee may be compiled in another thread
+    std::lock_guard<std::recursive_mutex> guard(Graph_library::get_mutex());
     if (library->has_name(func_name)) {
       auto lgid = library->get_lgid(func_name);
       subg_node = lg->create_node_sub(lgid);
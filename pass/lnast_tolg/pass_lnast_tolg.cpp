@@ -9,6 +9,7 @@ void Pass_lnast_tolg::setup() {
 
   Eprp_method m1("pass.lnast_tolg", " front-end language lnast -> lgraph", &Pass_lnast_tolg::tolg);
   m1.add_label_optional("path", "path to output the lgraph[s] to", "lgdb");
+  m1.set_streamable();
   register_pass(m1);
 
   Eprp_method m2("pass.lnast_tolg.dbg_lnast_ssa", " perform the LNAST SSA transformation, only for debug purpose", &Pass_lnast_tolg::dbg_lnast_ssa);
@@ -0,0 +1,213 @@
+
+// Simulated cycles/sec vs threads for N independent Sample_stage instances.
+// Each sub-stage (s1, s2, s3) is a scheduler stage:
+//
+//  serial:    Sample_stage::cycle (reference)
+//  lock-step: Simlib_scheduler::run (barrier per cycle)
+//  skew:      Simlib_scheduler::run_skew (Simlib_channel, bounded skew)
+//
+// All the modes must end with the same state.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "sample_stage.hpp"
+#include "simlib_scheduler.hpp"
+
+using namespace std::chrono;
+
+struct S1_out {
+  bool     to2_aValid;
+  uint32_t to2_a;
+  uint32_t to2_b;
+  bool     to3_cValid;
+  uint32_t to3_c;
+
+  explicit S1_out(const Sample1_stage &s)
+      : to2_aValid(s.to2_aValid), to2_a(s.to2_a), to2_b(s.to2_b), to3_cValid(s.to3_cValid), to3_c(s.to3_c) {}
+  S1_out() = default;
+};
+
+struct S2_out {
+  bool     to1_aValid;
+  uint32_t to1_a;
+  bool     to3_dValid;
+  uint32_t to3_d;
+
+  explicit S2_out(const Sample2_stage &s) : to1_aValid(s.to1_aValid), to1_a(s.to1_a), to3_dValid(s.to3_dValid), to3_d(s.to3_d) {}
+  S2_out() = default;
+};
+
+struct Lock_step_inst {
+  Sample_stage st;
+  S1_out       s1_out[2];  // cycle parity double buffer
+  S2_out       s2_out[2];
+  uint32_t     s3_out[2];
+};
+
+struct Skew_inst {
+  Sample_stage st;
+
+  Simlib_channel<S1_out>   s1_to2;
+  Simlib_channel<S1_out>   s1_to3;
+  Simlib_channel<S2_out>   s2_to1;
+  Simlib_channel<S2_out>   s2_to3;
+  Simlib_channel<uint32_t> s3_to1;
+
+  explicit Skew_inst(const Sample_stage &reset)
+      : st(reset)
+      , s1_to2(S1_out(reset.s1))
+      , s1_to3(S1_out(reset.s1))
+      , s2_to1(S2_out(reset.s2))
+      , s2_to3(S2_out(reset.s2))
+      , s3_to1(reset.s3.to1_b) {}
+};
+
+static uint64_t checksum(const Sample_stage &st) {
+  uint64_t h = st.s1.tmp ^ (uint64_t(st.s2.tmp) << 20) ^ (uint64_t(st.s3.tmp) << 40);
+  for (auto v : st.s3.memory) h = h * 31 + v;
+  return h ^ st.s1.to3_c ^ st.s2.to2_e ^ st.s3.to1_b;
+}
+
+static Sample_stage make_inst(const Sample_stage &reset, int i) {
+  Sample_stage st = reset;
+  st.s1.tmp += 5 * i;  // different instances
+  st.s2.tmp += 2 * i;
+  return st;
+}
+
+static double report(const char *mode, int n_threads, uint64_t n_cycles, double secs, uint64_t chk) {
+  double khz = n_cycles / secs / 1e3;
+  printf("%-9s threads:%-2d %8.1f KHz (chk:%llx)\n", mode, n_threads, khz, (unsigned long long)chk);
+  return khz;
+}
+
+int main(int argc, char **argv) {
+  const int      n_inst      = argc > 1 ? atoi(argv[1]) : 64;
+  const uint64_t n_cycles    = argc > 2 ? atoll(argv[2]) : 100000;
+  const int      max_threads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+
+  // Reset state (shared by all the modes)
+  auto reset = std::make_unique<Sample_stage>();
+  *reset     = Sample_stage{};
+  for (int i = 0; i < 1000; ++i) reset->reset_cycle();
+
+  // serial reference
+  uint64_t ref_chk = 0;
+  {
+    std::vector<Sample_stage> insts;
+    for (int i = 0; i < n_inst; ++i) insts.emplace_back(make_inst(*reset, i));
+    auto start = high_resolution_clock::now();
+    for (uint64_t c = 0; c < n_cycles; ++c) {
+      for (auto &inst : insts) inst.cycle();
+    }
+    double secs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+    for (const auto &inst : insts) ref_chk = ref_chk * 131 + checksum(inst);
+    report("serial", 1, n_cycles, secs, ref_chk);
+  }
+
+  int errors = 0;
+  for (int n_threads = 1; n_threads <= std::max(max_threads, 1); n_threads *= 2) {
+    {
+      std::vector<Lock_step_inst> insts(n_inst);
+      Simlib_scheduler            sched(n_threads);
+      for (int i = 0; i < n_inst; ++i) {
+        auto *p      = &insts[i];
+        p->st        = make_inst(*reset, i);
+        p->s1_out[1] = S1_out(p->st.s1);  // cycle -1 outputs
+        p->s2_out[1] = S2_out(p->st.s2);
+        p->s3_out[1] = p->st.s3.to1_b;
+
+        sched.add([p](uint64_t c) {
+          const auto &s2 = p->s2_out[(c - 1) & 1];
+          p->st.s1.cycle(p->s3_out[(c - 1) & 1], s2.to1_aValid, s2.to1_a);
+          p->s1_out[c & 1] = S1_out(p->st.s1);
+        });
+        sched.add([p](uint64_t c) {
+          const auto &s1 = p->s1_out[(c - 1) & 1];
+          p->st.s2.cycle(s1.to2_aValid, s1.to2_a, s1.to2_b);
+          p->s2_out[c & 1] = S2_out(p->st.s2);
+        });
+        sched.add([p](uint64_t c) {
+          const auto &s1 = p->s1_out[(c - 1) & 1];
+          const auto &s2 = p->s2_out[(c - 1) & 1];
+          p->st.s3.cycle(s1.to3_cValid, s1.to3_c, s2.to3_dValid, s2.to3_d);
+          p->s3_out[c & 1] = p->st.s3.to1_b;
+        });
+      }
+
+      auto start = high_resolution_clock::now();
+      sched.run(n_cycles);
+      double secs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+
+      uint64_t chk = 0;
+      for (const auto &inst : insts) chk = chk * 131 + checksum(inst.st);
+      report("lock-step", n_threads, n_cycles, secs, chk);
+      errors += chk != ref_chk;
+    }
+
+    {
+      std::vector<std::unique_ptr<Skew_inst>> insts;
+      Simlib_scheduler                        sched(n_threads);
+      for (int i = 0; i < n_inst; ++i) {
+        insts.emplace_back(std::make_unique<Skew_inst>(make_inst(*reset, i)));
+        auto *p = insts.back().get();
+
+        sched.add_skew([p] {
+          if (p->s3_to1.empty() || p->s2_to1.empty() || p->s1_to2.full() || p->s1_to3.full())
+            return false;
+          const auto &s2 = p->s2_to1.front();
+          p->st.s1.cycle(p->s3_to1.front(), s2.to1_aValid, s2.to1_a);
+          p->s3_to1.pop();
+          p->s2_to1.pop();
+          S1_out out(p->st.s1);
+          p->s1_to2.push(out);
+          p->s1_to3.push(out);
+          return true;
+        });
+        sched.add_skew([p] {
+          if (p->s1_to2.empty() || p->s2_to1.full() || p->s2_to3.full())
+            return false;
+          const auto &s1 = p->s1_to2.front();
+          p->st.s2.cycle(s1.to2_aValid, s1.to2_a, s1.to2_b);
+          p->s1_to2.pop();
+          S2_out out(p->st.s2);
+          p->s2_to1.push(out);
+          p->s2_to3.push(out);
+          return true;
+        });
+        sched.add_skew([p] {
+          if (p->s1_to3.empty() || p->s2_to3.empty() || p->s3_to1.full())
+            return false;
+          const auto &s1 = p->s1_to3.front();
+          const auto &s2 = p->s2_to3.front();
+          p->st.s3.cycle(s1.to3_cValid, s1.to3_c, s2.to3_dValid, s2.to3_d);
+          p->s1_to3.pop();
+          p->s2_to3.pop();
+          p->s3_to1.push(p->st.s3.to1_b);
+          return true;
+        });
+      }
+
+      auto start = high_resolution_clock::now();
+      sched.run_skew(n_cycles);
+      double secs = duration_cast<microseconds>(high_resolution_clock::now() - start).count() / 1e6;
+
+      uint64_t chk = 0;
+      for (const auto &inst : insts) chk = chk * 131 + checksum(inst->st);
+      report("skew", n_threads, n_cycles, secs, chk);
+      errors += chk != ref_chk;
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "bench_threads: ERROR %d runs do not match the serial simulation\n", errors);
+    return 3;
+  }
+
+  return 0;
+}
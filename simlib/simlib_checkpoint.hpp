@@ -1,14 +1,17 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include <dirent.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iterator>
+#include <string>
 #include <vector>
 
 #include "lbench.hpp"
@@ -16,8 +19,26 @@
 #include "simlib_signature.hpp"
 #include "vcd_writer.hpp"
 //unsigned t = 0;
+
+// Checkpoints are incremental: a checkpoint only stores the pages of top that
+// changed since the previous checkpoint (delta), and points to it. Every
+// max_chain deltas (or when most pages changed) a full checkpoint is saved, so
+// loading applies at most max_chain deltas. The dirty pages are found against
+// a shadow copy of the last saved/loaded state.
+//
+// The path/name.index file lists the checkpoints (no directory scans).
 template <typename Top_struct>
 class Simlib_checkpoint {
+  static constexpr size_t page_bytes = 4096;
+  static constexpr int    max_chain  = 16;
+
+  struct Ckpt_entry {  // checkpoint file header and index file record
+    uint64_t cycles;
+    uint64_t base_cycles;  // checkpoint the delta applies to (cycles if full)
+    uint32_t chain;        // deltas since the last full checkpoint (0 is full)
+    uint32_t n_pages;      // pages stored (each with its uint32_t page number if delta)
+  };
+
   uint64_t          ncycles;
   int               checkpoint_ncycles;
   int               next_checkpoint_ncycles;
@@ -28,6 +49,10 @@ class Simlib_checkpoint {
   Top_struct       top;
   Simlib_signature signature;
 
+  std::vector<uint8_t>    shadow;      // top at last_entry (empty if none)
+  Ckpt_entry              last_entry;  // last checkpoint saved/loaded
+  std::vector<Ckpt_entry> ckpt_index;  // sorted by cycles
+
   Lbench perf;
 #ifdef SIMLIB_VCD
   void advance_reset(uint64_t n = 1) {
@@ -100,6 +125,9 @@ public:
     next_checkpoint_ncycles = ncycles + checkpoint_ncycles;  // 19216//2ndRun:31264
   }
 
+  const Top_struct& get_top() const { return top; }
+  uint64_t          get_ncycles() const { return ncycles; }
+
   size_t calc_bytes() const { return sizeof(top) + signature.get_map_bytes(); }
 
   void enable_trace(std::string_view _path) {
@@ -111,8 +139,58 @@ public:
     const int pages = (calc_bytes() >> 12) + 1;
 
     set_checkpoint_cycles(10000 / pages);
+
+    load_index();
+  }
+
+  std::string get_index_filename() const { return path + "/" + name + ".index"; }
+
+  void add_index_entry(const Ckpt_entry& entry) {
+    auto it = std::lower_bound(ckpt_index.begin(), ckpt_index.end(), entry.cycles,
+                               [](const Ckpt_entry& e, uint64_t c) { return e.cycles < c; });
+    if (it != ckpt_index.end() && it->cycles == entry.cycles)
+      *it = entry;  // saved again
+    else
+      ckpt_index.insert(it, entry);
+  }
+
+  void load_index() {
+    ckpt_index.clear();
+
+    int fd = ::open(get_index_filename().c_str(), O_RDONLY);
+    if (fd < 0)
+      return;  // no checkpoints yet
+
+    Ckpt_entry entry;
+    while (read(fd, &entry, sizeof(entry)) == sizeof(entry)) {
+      add_index_entry(entry);
+    }
+    close(fd);
+  }
+
+  void append_index(const Ckpt_entry& entry) {
+    int fd = ::open(get_index_filename().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0 || write(fd, &entry, sizeof(entry)) != sizeof(entry)) {
+      fprintf(stderr, "simlib: ERROR unable to update checkpoint index:%s\n", get_index_filename().c_str());
+      exit(3);
+    }
+    close(fd);
+
+    add_index_entry(entry);
   }
 
+  // Nearest checkpoint at or before cycles (0 if none)
+  uint64_t find_checkpoint(uint64_t cycles) const {
+    auto it = std::upper_bound(ckpt_index.begin(), ckpt_index.end(), cycles,
+                               [](uint64_t c, const Ckpt_entry& e) { return c < e.cycles; });
+    if (it == ckpt_index.begin())
+      return 0;
+    --it;
+    return it->cycles;
+  }
+
+  size_t get_n_pages() const { return (sizeof(top) + page_bytes - 1) / page_bytes; }
+
   static bool str_ends_with(const std::string& str, const std::string& suffix) {
     return str.size() >= suffix.size() && 0 == str.compare(str.size() - suffix.size(), suffix.size(), suffix);
   }
@@ -121,29 +199,23 @@ public:
     return str.size() >= prefix.size() && 0 == str.compare(0, prefix.size(), prefix);
   }
 
-  //   uint64_t find_previous_checkpoint(uint64_t cycles) {
-  //     DIR *dr = opendir(path.c_str());
-  //     assert(dr != nullptr);
-  //     struct dirent *de;  // Pointer for directory entry
-  //     uint64_t best_found = 0; // reset everything
-  //     while ((de = readdir(dr)) != NULL) {
-  //      const std::string d_name{de->d_name};
-  //       if (!str_starts_with(d_name, name))
-  //        continue;
-  //       if (!str_ends_with(d_name, ".ckpt"))
-  //        continue;
-  //       const std::string str_cycles = d_name.substr(name.size()+1, d_name.size()-5); // 5 for .ckpt
-  //       auto val = std::atoi(str_cycles.c_str());
-  //       if (val > best_found && val <= cycles)
-  //         best_found = val;
-  //     }
-  //     closedir(dr);
-  //     return best_found;
-  //   }
-
   bool load_checkpoint(uint64_t cycles) {
     printf("load checkpoint @%lld\n", cycles);
-    // std::string filename = path + "/" + name + "_" + std::to_string(cycles) + ".ckpt";
+
+    Ckpt_entry entry;
+    if (!load_checkpoint_int(cycles, entry))
+      return false;
+
+    ncycles = cycles;  // next checkpoints are saved from the loaded cycle
+
+    const auto* cur = reinterpret_cast<const uint8_t*>(&top);
+    shadow.assign(cur, cur + sizeof(top));  // next checkpoints are deltas from this one
+    last_entry = entry;
+
+    return true;
+  }
+
+  bool load_checkpoint_int(uint64_t cycles, Ckpt_entry& entry) {
     std::string filename = path + "/" + name + "_" + std::to_string(cycles);
     int         fd       = ::open(filename.c_str(), O_RDONLY, 0644);
     // 0644 file system permission flags : it stands for -rw-r--r-- file permission.
@@ -152,59 +224,75 @@ public:
       return false;
     }
 
-    Simlib_signature s2(signature);
-    auto             sz = read(fd, s2.get_map_address(), s2.get_map_bytes());
-    if (sz != signature.get_map_bytes()) {
-      fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s signature loading\n", filename.c_str());
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(entry) + signature.get_map_bytes()) {
+      fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s header loading\n", filename.c_str());
       exit(3);
     }
+    const size_t bytes = st.st_size;
+    auto*        base  = (const uint8_t*)::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      fprintf(stderr, "simlib: ERROR unable to mmap checkpoint:%s\n", filename.c_str());
+      exit(3);
+    }
+
+    ::memcpy(&entry, base, sizeof(entry));
+    const uint8_t* ptr = base + sizeof(entry);
+
+    Simlib_signature s2(signature);
+    ::memcpy(s2.get_map_address(), ptr, s2.get_map_bytes());
+    ptr += s2.get_map_bytes();
     if (s2 != signature) {
       printf("missmatch signature load checkpoint @%lld\n", cycles);
+      ::munmap((void*)base, bytes);
       return false;
     }
 
-    auto sz2 = read(fd, &top, sizeof(top));
-    if (sz2 != sizeof(top)) {
+    const size_t data_bytes = entry.chain == 0 ? sizeof(top) : entry.n_pages * (sizeof(uint32_t) + page_bytes);
+    if (entry.cycles != cycles || static_cast<size_t>(base + bytes - ptr) < data_bytes) {
       fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s data loading\n", filename.c_str());
       exit(3);
     }
 
-    close(fd);
+    if (entry.chain == 0) {
+      ::memcpy(&top, ptr, sizeof(top));
+    } else {
+      Ckpt_entry base_entry;
+      if (entry.base_cycles >= cycles || !load_checkpoint_int(entry.base_cycles, base_entry)) {
+        ::munmap((void*)base, bytes);
+        return false;
+      }
+
+      auto* cur = reinterpret_cast<uint8_t*>(&top);
+      for (uint32_t i = 0; i < entry.n_pages; ++i) {
+        uint32_t page;
+        ::memcpy(&page, ptr, sizeof(page));
+        ptr += sizeof(page);
+        const size_t offset = static_cast<size_t>(page) * page_bytes;
+        if (offset >= sizeof(top)) {
+          fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s page loading\n", filename.c_str());
+          exit(3);
+        }
+        ::memcpy(&cur[offset], ptr, std::min(page_bytes, sizeof(top) - offset));
+        ptr += page_bytes;
+      }
+    }
+
+    ::munmap((void*)base, bytes);
 
     return true;
   }
 
   bool load_intermediate_checkpoint(uint64_t cycles) {
     printf("load intermediate checkpoint @%lld\n", cycles);
-    std::vector<int> myvector;
-    DIR*             dr = opendir(path.c_str());
-    if (dr == NULL) {
-      fprintf(stderr, "simlib: ERROR unable to access path:%s\n", path.c_str());
-      exit(-1);
-    }
-    struct dirent* de;
-    while ((de = readdir(dr)) != NULL) {
-      std::string chop_name(de->d_name);
-      if (chop_name.substr(0, name.size() + 1) == (name + "_")) {  // name is provided in main.cpp
-        int mydata = atoi(chop_name.substr(name.size() + 1, chop_name.size() - name.size() + 1)
-                              .c_str());  // name.size() is due to ckpt and +1 is for "_"
-        myvector.push_back(mydata);
-      }
-    }
-    closedir(dr);
-    for (const auto e : myvector) {
-      if (e == cycles) {
-        load_checkpoint(cycles);  // checkpoint already available, so load it and return
-        return true;
-      }
+
+    uint64_t lower_cycles = find_checkpoint(cycles);  // nearest checkpoint at or before cycles (index file)
+    if (lower_cycles == cycles) {
+      load_checkpoint(cycles);  // checkpoint already available, so load it and return
+      return true;
     }
     // if checkpoint is not already saved:
-    int lower_cycles = 0;
-    if (!myvector.empty()) {
-      std::sort(myvector.begin(), myvector.end());
-      std::vector<int>::iterator low = std::lower_bound(myvector.begin(), myvector.end(), cycles);
-      lower_cycles                   = myvector[low - myvector.begin() - 1];  // find the nearest checkpoint of lesser vailue
-    }
     ncycles = lower_cycles;
     if (lower_cycles == 0) {  // if the nearest smaller checkpoint is 0
       advance_reset(reset_ncycles);
@@ -267,34 +355,72 @@ public:
     printf("Save checkpoint @%lld\n", ncycles);
     std::string filename = path + "/" + name + "_" + std::to_string(ncycles);
 
-    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    const auto*  cur     = reinterpret_cast<const uint8_t*>(&top);
+    const size_t n_pages = get_n_pages();
+
+    // Dirty pages since the last checkpoint
+    std::vector<uint32_t> dirty;
+    bool full = shadow.empty() || last_entry.chain + 1 >= max_chain || last_entry.cycles >= ncycles;
+    if (!full) {
+      for (uint32_t page = 0; page < n_pages; ++page) {
+        const size_t offset = static_cast<size_t>(page) * page_bytes;
+        if (::memcmp(&cur[offset], &shadow[offset], std::min(page_bytes, sizeof(top) - offset)) != 0)
+          dirty.emplace_back(page);
+      }
+      full = dirty.size() * 2 > n_pages;  // a full checkpoint is cheaper to load
+    }
+
+    Ckpt_entry entry;
+    entry.cycles      = ncycles;
+    entry.base_cycles = full ? ncycles : last_entry.cycles;
+    entry.chain       = full ? 0 : last_entry.chain + 1;
+    entry.n_pages     = full ? n_pages : dirty.size();
+
+    const size_t data_bytes = full ? sizeof(top) : dirty.size() * (sizeof(uint32_t) + page_bytes);
+    const size_t bytes      = sizeof(entry) + signature.get_map_bytes() + data_bytes;
+
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
     if (fd < 0) {
       fprintf(stderr, "simlib: ERROR unable to create checkpoint:%s\n", filename.c_str());
       exit(3);
     }
-    int ret = ::ftruncate(
-        fd, calc_bytes());  // fd is made of size of top size + signature size//Upon successful completion, ftruncate() and
-                            // truncate() return 0. Otherwise a -1 is returned, and errno is set to indicate the error.
+    int ret = ::ftruncate(fd, bytes);  // zero filled (the last page may be partial)
     if (ret < 0) {
       fprintf(stderr, "simlib: ERROR unable to grown checkpoint:%s\n", filename.c_str());
       exit(3);
     }
-    uint8_t* base = (uint8_t*)::mmap(nullptr, calc_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
-                                     0);  // fd and base are mapped as shared mem locations ; mem mapped size is otained by
-                                          // calc_bytes which is top size+signature size
-
+    uint8_t* base = (uint8_t*)::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     if (base == MAP_FAILED) {
       fprintf(stderr, "simlib: ERROR unable to mmap checkpoint:%s\n", filename.c_str());
       exit(3);
     }
 
-    ::memcpy(base, signature.get_map_address(),
-             signature.get_map_bytes());  // mem form signature is copied to base for the size of signature
-    ::memcpy(
-        &base[signature.get_map_bytes()], &top,
-        sizeof(top));  // data from top is copied to base with starting adress as that after signature area copied in last command
-    ::munmap(base, calc_bytes());  // memm unmap of base for the calc_bytes i.e size of top + size of signature
+    uint8_t* ptr = base;
+    ::memcpy(ptr, &entry, sizeof(entry));
+    ptr += sizeof(entry);
+    ::memcpy(ptr, signature.get_map_address(), signature.get_map_bytes());
+    ptr += signature.get_map_bytes();
+
+    if (full) {
+      ::memcpy(ptr, cur, sizeof(top));
+      shadow.assign(cur, cur + sizeof(top));
+    } else {
+      for (auto page : dirty) {
+        const size_t offset = static_cast<size_t>(page) * page_bytes;
+        const size_t sz     = std::min(page_bytes, sizeof(top) - offset);
+        ::memcpy(ptr, &page, sizeof(page));
+        ptr += sizeof(page);
+        ::memcpy(ptr, &cur[offset], sz);
+        ptr += page_bytes;
+        ::memcpy(&shadow[offset], &cur[offset], sz);
+      }
+    }
+
+    ::munmap(base, bytes);
     close(fd);
+
+    last_entry = entry;
+    append_index(entry);
   }
 
   void handle_checkpoint() {
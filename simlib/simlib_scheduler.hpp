@@ -0,0 +1,235 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Multi-threaded runtime for independent stages. Stages that only communicate
+// through flops (they read the previous cycle outputs of the other stages, like
+// s1/s2/s3 in the Sample_stage::cycle example) can run in parallel.
+//
+// Lock-step (run): each cycle, every thread calls the cycle function of its
+// stages and waits in a barrier. A stage must read the outputs that the other
+// stages produced in the previous cycle: double buffer them with the cycle
+// parity (write out[cycle & 1], read out[(cycle - 1) & 1]).
+//
+// Bounded skew (run_skew): stages are connected with Simlib_channel (one token
+// per cycle, initialized with the reset value). A stage cycles when all its
+// inputs have a token and all its outputs have space, so a producer can run up
+// to Depth cycles ahead of its consumer. No per cycle barrier.
+//
+// With 1 thread the stages are called in the calling thread. The stages are
+// assigned to threads by weight (e.g: estimated cost) at the first run.
+
+inline void simlib_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+// Sense reversing spin barrier (yields if the wait is long)
+class Simlib_barrier {
+  const int             n_threads;
+  std::atomic<int>      count{0};
+  std::atomic<uint32_t> generation{0};
+
+public:
+  explicit Simlib_barrier(int n) : n_threads(n) {}
+
+  void wait() {
+    auto gen = generation.load(std::memory_order_acquire);
+    if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == n_threads) {
+      count.store(0, std::memory_order_relaxed);
+      generation.fetch_add(1, std::memory_order_release);
+      return;
+    }
+
+    int spins = 0;
+    while (generation.load(std::memory_order_acquire) == gen) {
+      if (++spins < 1024)
+        simlib_cpu_relax();
+      else
+        std::this_thread::yield();
+    }
+  }
+};
+
+// Single producer, single consumer token queue between two stages
+template <typename T, int Depth = 4>
+class Simlib_channel {
+  static_assert(Depth >= 2, "Depth 1 deadlocks stages in a loop (both sides start with a token)");
+
+  alignas(64) std::atomic<uint32_t> head{0};  // producer
+  alignas(64) std::atomic<uint32_t> tail{0};  // consumer
+  alignas(64) T buffer[Depth];
+
+public:
+  explicit Simlib_channel(const T &reset_value) { push(reset_value); }  // the flop value before the first cycle
+
+  bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+  bool full() const { return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire) == Depth; }
+
+  const T &front() const { return buffer[tail.load(std::memory_order_relaxed) % Depth]; }
+  void     pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  void push(const T &val) {
+    auto h              = head.load(std::memory_order_relaxed);
+    buffer[h % Depth] = val;
+    head.store(h + 1, std::memory_order_release);
+  }
+};
+
+class Simlib_scheduler {
+public:
+  using Cycle_fn     = std::function<void(uint64_t cycle)>;
+  using Try_cycle_fn = std::function<bool()>;  // false if the inputs/outputs are not ready
+
+  explicit Simlib_scheduler(int _n_threads) : n_threads(std::max(_n_threads, 1)), barrier(n_threads) {}
+
+  ~Simlib_scheduler() {
+    if (workers.empty())
+      return;
+
+    job = Job::Quit;
+    barrier.wait();
+    for (auto &t : workers) t.join();
+  }
+
+  void add(Cycle_fn fn, uint64_t weight = 1) {
+    assert(skew_stages.empty());  // do not mix lock-step and skew stages
+    stages.emplace_back(std::move(fn));
+    weights.emplace_back(weight);
+    partitioned = false;
+  }
+
+  void add_skew(Try_cycle_fn fn, uint64_t weight = 1) {
+    assert(stages.empty());
+    skew_stages.emplace_back(std::move(fn));
+    weights.emplace_back(weight);
+    partitioned = false;
+  }
+
+  void run(uint64_t n) {
+    assert(skew_stages.empty());
+    start(Job::Lock_step, n);
+    ncycles += n;
+  }
+
+  void run_skew(uint64_t n) {
+    assert(stages.empty());
+    start(Job::Skew, n);
+    ncycles += n;
+  }
+
+  int      get_n_threads() const { return n_threads; }
+  uint64_t get_ncycles() const { return ncycles; }
+
+protected:
+  enum class Job { Lock_step, Skew, Quit };
+
+  const int      n_threads;
+  Simlib_barrier barrier;
+
+  std::vector<Cycle_fn>     stages;
+  std::vector<Try_cycle_fn> skew_stages;
+  std::vector<uint64_t>     weights;
+
+  std::vector<std::vector<size_t>> thread_stages;  // stage ids per thread
+  bool                             partitioned = false;
+
+  std::vector<std::thread> workers;  // thread 0 is the caller
+  Job                      job      = Job::Lock_step;
+  uint64_t                 job_n    = 0;
+  uint64_t                 ncycles  = 0;
+
+  void partition() {
+    thread_stages.assign(n_threads, {});
+
+    // Largest weight first to the least loaded thread
+    std::vector<size_t> order(weights.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return weights[a] > weights[b]; });
+
+    std::vector<uint64_t> load(n_threads, 0);
+    for (auto id : order) {
+      auto tid = std::min_element(load.begin(), load.end()) - load.begin();
+      thread_stages[tid].emplace_back(id);
+      load[tid] += weights[id];
+    }
+    for (auto &ts : thread_stages) std::sort(ts.begin(), ts.end());  // keep the add order
+
+    partitioned = true;
+  }
+
+  void start(Job _job, uint64_t n) {
+    if (n == 0)
+      return;  // nothing to run (a skew stage only finishes after running a cycle)
+
+    if (!partitioned)
+      partition();
+
+    job   = _job;
+    job_n = n;
+
+    if (n_threads == 1) {
+      execute(0);
+      return;
+    }
+
+    if (workers.empty()) {
+      for (int tid = 1; tid < n_threads; ++tid) workers.emplace_back([this, tid] { worker_main(tid); });
+    }
+
+    barrier.wait();  // start
+    execute(0);
+    barrier.wait();  // done
+  }
+
+  void worker_main(int tid) {
+    while (true) {
+      barrier.wait();  // start
+      if (job == Job::Quit)
+        return;
+      execute(tid);
+      barrier.wait();  // done
+    }
+  }
+
+  void execute(int tid) {
+    const auto &mine = thread_stages[tid];
+
+    if (job == Job::Lock_step) {
+      for (uint64_t cycle = ncycles; cycle < ncycles + job_n; ++cycle) {
+        for (auto id : mine) stages[id](cycle);
+        if (n_threads > 1)
+          barrier.wait();  // next cycle reads the outputs of this one
+      }
+      return;
+    }
+
+    assert(job == Job::Skew);
+    std::vector<uint64_t> done(mine.size(), 0);
+    size_t                n_finished = 0;
+    while (n_finished < mine.size()) {
+      bool progress = false;
+      for (size_t i = 0; i < mine.size(); ++i) {
+        if (done[i] == job_n)
+          continue;
+        // Run as many cycles as possible (bounded by the channel depth)
+        while (done[i] < job_n && skew_stages[mine[i]]()) {
+          ++done[i];
+          progress = true;
+        }
+        if (done[i] == job_n)
+          ++n_finished;
+      }
+      if (!progress)
+        std::this_thread::yield();  // waiting for stages in other threads
+    }
+  }
+};
@@ -0,0 +1,113 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <stdlib.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "simlib_checkpoint.hpp"
+
+// Several pages of state, but each cycle only touches a few of them (deltas)
+struct Ckpt_top {
+  uint64_t                     cnt = 0;
+  std::array<uint32_t, 1 << 16> mem{};
+
+  Ckpt_top(uint64_t hidx) { (void)hidx; }
+
+  void reset_cycle() {
+    cnt = 0;
+    mem.fill(0);
+  }
+  void cycle(int a, int b) {
+    ++cnt;
+    mem[(cnt * 4099) & (mem.size() - 1)] += cnt + a + b;
+  }
+};
+
+class Simlib_checkpoint_test : public ::testing::Test {
+protected:
+  static constexpr uint64_t reset_ncycles = 10;
+
+  std::string path;
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/simlib_checkpoint_test.XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    path = tmpl;
+  }
+
+  void TearDown() override {
+    std::string cmd = "rm -rf " + path;
+    (void)system(cmd.c_str());
+  }
+
+  std::unique_ptr<Simlib_checkpoint<Ckpt_top>> open_sim() {
+    auto sim = std::make_unique<Simlib_checkpoint<Ckpt_top>>("ckpt", reset_ncycles);
+    sim->enable_trace(path);
+    return sim;
+  }
+
+  // Same cycles as Simlib_checkpoint, but from reset and without checkpoints
+  static std::unique_ptr<Ckpt_top> simulate(uint64_t cycles) {
+    auto top = std::make_unique<Ckpt_top>(0);
+    for (uint64_t i = 0; i < reset_ncycles; ++i) top->reset_cycle();
+    for (uint64_t i = reset_ncycles; i < cycles; ++i) top->cycle(1, 0);
+    return top;
+  }
+
+  void check_load(uint64_t cycles) {
+    auto sim = open_sim();
+    ASSERT_TRUE(sim->load_checkpoint(cycles)) << "cycle " << cycles;
+
+    auto ref = simulate(cycles);
+    EXPECT_EQ(sim->get_top().cnt, ref->cnt) << "cycle " << cycles;
+    EXPECT_TRUE(sim->get_top().mem == ref->mem) << "cycle " << cycles;
+  }
+};
+
+TEST_F(Simlib_checkpoint_test, delta_chain) {
+  {
+    auto sim = open_sim();
+    sim->save_checkpoint();  // full checkpoint after reset
+    for (int i = 0; i < 40; ++i) {  // longer than max_chain
+      sim->advance_clock(3);
+      sim->save_checkpoint();
+    }
+    EXPECT_EQ(sim->get_ncycles(), reset_ncycles + 40 * 3);
+  }
+
+  for (int i = 0; i <= 40; ++i) {
+    check_load(reset_ncycles + i * 3);
+  }
+
+  auto sim = open_sim();
+  EXPECT_FALSE(sim->load_checkpoint(reset_ncycles + 1));
+}
+
+TEST_F(Simlib_checkpoint_test, resaved_cycle) {
+  {
+    auto sim = open_sim();
+    sim->save_checkpoint();
+    for (int i = 0; i < 20; ++i) {
+      sim->advance_clock(5);
+      sim->save_checkpoint();
+    }
+  }
+
+  {
+    // Go back and save again the cycles that later deltas were built on
+    auto sim = open_sim();
+    ASSERT_TRUE(sim->load_checkpoint(reset_ncycles + 30));
+    sim->save_checkpoint();  // same cycle as the loaded one
+    sim->advance_clock(5);
+    sim->save_checkpoint();  // already saved (now a delta from +30)
+    sim->advance_clock(2);
+    sim->save_checkpoint();  // new cycle in between
+  }
+
+  for (uint64_t delta : {30, 35, 37, 40, 45, 70, 100}) {
+    check_load(reset_ncycles + delta);
+  }
+}
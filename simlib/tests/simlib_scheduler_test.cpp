@@ -0,0 +1,77 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "simlib_scheduler.hpp"
+
+// Two counters connected with channels (each stage adds the value of the other)
+struct Sched_counters {
+  Simlib_channel<uint64_t> a2b{0};
+  Simlib_channel<uint64_t> b2a{1};
+  uint64_t                 a = 0;
+  uint64_t                 b = 1;
+
+  void add_skew(Simlib_scheduler &sched) {
+    sched.add_skew([this]() {
+      if (b2a.empty() || a2b.full())
+        return false;
+      a += b2a.front();
+      b2a.pop();
+      a2b.push(a);
+      return true;
+    });
+    sched.add_skew([this]() {
+      if (a2b.empty() || b2a.full())
+        return false;
+      b += a2b.front();
+      a2b.pop();
+      b2a.push(b);
+      return true;
+    });
+  }
+};
+
+class Simlib_scheduler_test : public ::testing::Test {};
+
+TEST_F(Simlib_scheduler_test, zero_cycles) {
+  for (int n_threads : {1, 2}) {
+    Sched_counters   cnt;
+    Simlib_scheduler sched(n_threads);
+    cnt.add_skew(sched);
+
+    sched.run_skew(0);  // returns (no stage waits for a cycle)
+    EXPECT_EQ(sched.get_ncycles(), 0);
+
+    sched.run_skew(3);
+    sched.run_skew(0);
+    EXPECT_EQ(sched.get_ncycles(), 3);
+  }
+
+  std::atomic<int> calls{0};
+  Simlib_scheduler sched(2);
+  sched.add([&calls](uint64_t) { ++calls; });
+  sched.add([&calls](uint64_t) { ++calls; });
+  sched.run(0);
+  sched.run(2);
+  EXPECT_EQ(calls, 4);
+}
+
+TEST_F(Simlib_scheduler_test, skew_same_as_serial) {
+  Sched_counters ref;
+  {
+    Simlib_scheduler sched(1);
+    ref.add_skew(sched);
+    sched.run_skew(20);
+  }
+
+  Sched_counters   par;
+  Simlib_scheduler sched(2);
+  par.add_skew(sched);
+  sched.run_skew(7);
+  sched.run_skew(13);
+  EXPECT_EQ(par.a, ref.a);
+  EXPECT_EQ(par.b, ref.b);
+}
@@ -0,0 +1,97 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <unistd.h>
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "wave_writer.hpp"
+
+class Wave_writer_test : public ::testing::Test {
+protected:
+  struct Change {
+    uint64_t              time;
+    Wave_var              var;
+    std::vector<uint64_t> words;
+
+    bool operator==(const Change &o) const { return std::tie(time, var, words) == std::tie(o.time, o.var, o.words); }
+  };
+
+  static std::vector<uint64_t> mask(const std::vector<uint64_t> &words, uint32_t bits) {
+    auto res = words;
+    if (bits % 64)
+      res.back() &= (1ULL << (bits % 64)) - 1;
+    return res;
+  }
+};
+
+TEST_F(Wave_writer_test, random_round_trip) {
+  const std::string file = "wave_writer_test.lwave";
+
+  std::mt19937_64 rng(42);
+
+  const std::vector<uint32_t> bits = {1, 13, 64, 70, 130, 200};
+
+  std::vector<Change> expected;
+  {
+    Wave_writer writer(file, "10ps");
+
+    std::vector<Wave_var> vars;
+    for (auto i = 0u; i < bits.size(); ++i) vars.emplace_back(writer.register_var("top.sub" + std::to_string(i % 2), "v" + std::to_string(i), bits[i]));
+
+    std::vector<std::vector<uint64_t>> last(bits.size());
+    for (auto i = 0u; i < bits.size(); ++i) last[i].resize((bits[i] + 63) / 64, 0);
+
+    uint64_t time = 0;
+    for (int step = 0; step < 200000; ++step) {
+      if (step)  // the first changes are initial values
+        time += 1 + rng() % 4;
+      writer.set_time(time);
+
+      auto i = rng() % bits.size();
+
+      std::vector<uint64_t> words(last[i]);
+      for (auto &w : words) {
+        switch (rng() % 3) {  // mix random values, small deltas, and no change
+          case 0: w = rng(); break;
+          case 1: w ^= 1ULL << (rng() % 64); break;
+          default: break;
+        }
+      }
+
+      auto val     = mask(words, bits[i]);
+      bool changed = writer.change(vars[i], words.data(), words.size());
+      EXPECT_EQ(changed, val != last[i]);
+      if (!changed)
+        continue;
+
+      last[i] = val;
+      expected.push_back({time, vars[i], val});
+    }
+  }
+
+  Wave_reader reader(file);
+  ASSERT_TRUE(reader.is_valid()) << reader.get_error();
+  EXPECT_EQ(reader.get_timescale(), "10ps");
+  ASSERT_EQ(reader.get_vars().size(), bits.size());
+  for (auto i = 0u; i < bits.size(); ++i) {
+    EXPECT_EQ(reader.get_vars()[i].bits, bits[i]);
+    EXPECT_EQ(reader.get_vars()[i].name, "v" + std::to_string(i));
+    EXPECT_EQ(reader.get_vars()[i].scope, "top.sub" + std::to_string(i % 2));
+  }
+
+  std::vector<Change> decoded;
+  bool                ok = reader.each_change([&](uint64_t time, Wave_var var, const uint64_t *words) {
+    decoded.push_back({time, var, std::vector<uint64_t>(words, words + (bits[var] + 63) / 64)});
+  });
+  EXPECT_TRUE(ok) << reader.get_error();
+
+  ASSERT_EQ(decoded.size(), expected.size());
+  for (auto i = 0u; i < expected.size(); ++i) {
+    ASSERT_TRUE(decoded[i] == expected[i]) << "change " << i << " time " << expected[i].time << " var " << expected[i].var;
+  }
+
+  unlink(file.c_str());
+}
@@ -525,6 +525,10 @@ public:
     return words_[0];
   }
 
+  // Raw words (LSB first) for binary tracing (Wave_writer)
+  uint64_t             get_word(int i) const { return words_[i]; }
+  constexpr static int get_n_words() { return n_; }
+
   std::string to_string_binary() const {
    constexpr std::string_view nibble_to_str[] = { "0000", "0001", "0010", "0011",
                                                    "0100", "0101", "0110", "0111",
@@ -0,0 +1,133 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Converts a lwave file (Wave_writer) to VCD:
+//   wave2vcd SIMLIB_WAVE.lwave SIMLIB_VCD.vcd
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "wave_writer.hpp"
+
+static std::string vcd_ident(uint32_t id) {  // printable ASCII '!' to '~'
+  std::string ident;
+  do {
+    ident.push_back(static_cast<char>('!' + id % 94));
+    id /= 94;
+  } while (id);
+  return ident;
+}
+
+static std::vector<std::string> split_scope(const std::string &scope) {
+  std::vector<std::string> comps;
+  size_t                   start = 0;
+  while (true) {
+    auto n = scope.find('.', start);
+    comps.emplace_back(scope.substr(start, n - start));
+    if (n == std::string::npos)
+      break;
+    start = n + 1;
+  }
+  return comps;
+}
+
+static void write_vcd_header(FILE *out, const Wave_reader &reader, const std::vector<std::string> &idents) {
+  const auto &vars = reader.get_vars();
+  fprintf(out, "$timescale %s $end\n", reader.get_timescale().c_str());
+
+  std::vector<uint32_t> order(vars.size());
+  for (auto i = 0u; i < vars.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&vars](uint32_t a, uint32_t b) { return vars[a].scope < vars[b].scope; });
+
+  std::vector<std::string> open_scopes;
+  for (auto i : order) {
+    const auto &v     = vars[i];
+    auto        comps = split_scope(v.scope);
+
+    size_t common = 0;
+    while (common < open_scopes.size() && common < comps.size() && open_scopes[common] == comps[common]) ++common;
+
+    while (open_scopes.size() > common) {
+      fprintf(out, "$upscope $end\n");
+      open_scopes.pop_back();
+    }
+    for (auto j = common; j < comps.size(); ++j) {
+      fprintf(out, "$scope module %s $end\n", comps[j].c_str());
+      open_scopes.emplace_back(comps[j]);
+    }
+
+    fprintf(out, "$var wire %u %s %s $end\n", v.bits, idents[i].c_str(), v.name.c_str());
+  }
+  while (!open_scopes.empty()) {
+    fprintf(out, "$upscope $end\n");
+    open_scopes.pop_back();
+  }
+
+  fprintf(out, "$enddefinitions $end\n");
+}
+
+static void write_vcd_value(FILE *out, const Wave_reader::Var &v, const std::string &ident, const uint64_t *words) {
+  if (v.bits == 1) {
+    fprintf(out, "%c%s\n", (words[0] & 1) ? '1' : '0', ident.c_str());
+    return;
+  }
+
+  std::string val("b");
+  bool        leading = true;
+  for (int bit = v.bits - 1; bit >= 0; --bit) {
+    bool one = (words[bit / 64] >> (bit % 64)) & 1;
+    if (leading && !one && bit)
+      continue;
+    leading = false;
+    val.push_back(one ? '1' : '0');
+  }
+  fprintf(out, "%s %s\n", val.c_str(), ident.c_str());
+}
+
+static int error(const char *msg, const char *file) {
+  fprintf(stderr, "wave2vcd: ERROR %s:%s\n", msg, file);
+  return 3;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <in.lwave> <out.vcd>\n", argv[0]);
+    return 1;
+  }
+
+  Wave_reader reader(argv[1]);
+  if (!reader.is_valid())
+    return error(reader.get_error().c_str(), argv[1]);
+
+  const auto              &vars = reader.get_vars();
+  std::vector<std::string> idents;
+  for (auto i = 0u; i < vars.size(); ++i) idents.emplace_back(vcd_ident(i));
+
+  FILE *out = fopen(argv[2], "w");
+  if (out == nullptr)
+    return error("unable to create", argv[2]);
+
+  write_vcd_header(out, reader, idents);
+
+  std::vector<uint64_t> zero(reader.get_n_words(), 0);
+  fprintf(out, "#0\n$dumpvars\n");
+  for (auto i = 0u; i < vars.size(); ++i) write_vcd_value(out, vars[i], idents[i], &zero[vars[i].word_pos]);
+  fprintf(out, "$end\n");
+
+  uint64_t last_time = 0;
+  bool     ok        = reader.each_change([&](uint64_t time, Wave_var var, const uint64_t *words) {
+    if (time != last_time) {
+      fprintf(out, "#%llu\n", static_cast<unsigned long long>(time));
+      last_time = time;
+    }
+    write_vcd_value(out, vars[var], idents[var], words);
+  });
+
+  fclose(out);
+
+  if (!ok)
+    return error(reader.get_error().c_str(), argv[1]);
+
+  return 0;
+}
@@ -0,0 +1,456 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "wave_writer.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+Wave_writer::Wave_writer(const std::string &filename, std::string_view _timescale)
+    : timescale(_timescale), full_queue(16), free_queue(16) {
+  ofile = fopen(filename.c_str(), "w");
+  if (ofile == nullptr) {
+    fprintf(stderr, "simlib: ERROR unable to create waveform:%s\n", filename.c_str());
+    exit(3);
+  }
+
+  current = new Block;
+  current->raw.reserve(block_size + 64);
+}
+
+Wave_writer::~Wave_writer() { close(); }
+
+Wave_var Wave_writer::register_var(std::string_view scope, std::string_view name, uint32_t bits) {
+  assert(registering);  // all the vars must be registered before the first change
+  assert(bits > 0);
+
+  Wave_var var = vars.size();
+  vars.emplace_back(Var{std::string(scope), std::string(name), bits, static_cast<uint32_t>(prev_words.size())});
+  prev_words.resize(prev_words.size() + (bits + 63) / 64, 0);
+
+  return var;
+}
+
+bool Wave_writer::change(Wave_var var, const uint64_t *words, int n_words) {
+  assert(!closed);
+  assert(var < vars.size());
+
+  const auto &v = vars[var];
+  const int   n = (v.bits + 63) / 64;
+  assert(n_words >= n);
+  (void)n_words;
+
+  const uint64_t top_mask = (v.bits % 64) ? (1ULL << (v.bits % 64)) - 1 : ~0ULL;
+  auto *         prev     = &prev_words[v.word_pos];
+
+  bool changed = false;
+  for (int i = 0; i < n; ++i) {
+    auto w = i == n - 1 ? (words[i] & top_mask) : words[i];
+    if (w != prev[i]) {
+      changed = true;
+      break;
+    }
+  }
+  if (!changed)
+    return false;
+
+  if (unlikely(registering)) {  // initial value, recorded by finalize_registration
+    for (int i = 0; i < n; ++i) {
+      prev[i] = i == n - 1 ? (words[i] & top_mask) : words[i];
+    }
+    return true;
+  }
+
+  auto &raw = current->raw;
+  if (raw.empty())
+    current->start_time = last_time;
+
+  if (pending_dt) {
+    put_varint(raw, (pending_dt << 1) | 1);
+    pending_dt = 0;
+  }
+
+  // vars tend to change in registration order: small id deltas
+  int64_t  delta  = static_cast<int64_t>(var) - static_cast<int64_t>(last_var);
+  uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+  put_varint(raw, zigzag << 1);
+  last_var = var;
+
+  for (int i = 0; i < n; ++i) {
+    auto w = i == n - 1 ? (words[i] & top_mask) : words[i];
+    put_varint(raw, w ^ prev[i]);  // counters/flags flip few bits: small XOR
+    prev[i] = w;
+  }
+
+  current->end_time = last_time;
+  if (unlikely(raw.size() >= block_size))
+    next_block();
+
+  return true;
+}
+
+void Wave_writer::write_header() {
+  std::vector<uint8_t> hdr;
+
+  put_varint(hdr, timescale.size());
+  hdr.insert(hdr.end(), timescale.begin(), timescale.end());
+
+  put_varint(hdr, vars.size());
+  for (const auto &v : vars) {
+    put_varint(hdr, v.scope.size());
+    hdr.insert(hdr.end(), v.scope.begin(), v.scope.end());
+    put_varint(hdr, v.name.size());
+    hdr.insert(hdr.end(), v.name.begin(), v.name.end());
+    put_varint(hdr, v.bits);
+  }
+
+  uint32_t hdr_size = hdr.size();
+  fwrite(magic.data(), 1, magic.size(), ofile);
+  fwrite(&hdr_size, sizeof(hdr_size), 1, ofile);
+  fwrite(hdr.data(), 1, hdr.size(), ofile);
+}
+
+void Wave_writer::finalize_registration() {
+  assert(registering);
+  registering = false;
+
+  write_header();  // before the writer thread owns ofile
+  writer_thread = std::thread(&Wave_writer::writer_main, this);
+
+  // Initial values (the reader starts with all zeroes)
+  current->start_time = last_time;
+  for (Wave_var var = 0; var < vars.size(); ++var) {
+    const auto &v    = vars[var];
+    const int   n    = (v.bits + 63) / 64;
+    const auto *prev = &prev_words[v.word_pos];
+
+    bool non_zero = false;
+    for (int i = 0; i < n; ++i) {
+      non_zero |= prev[i] != 0;
+    }
+    if (!non_zero)
+      continue;
+
+    int64_t  delta  = static_cast<int64_t>(var) - static_cast<int64_t>(last_var);
+    uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+    put_varint(current->raw, zigzag << 1);
+    last_var = var;
+    for (int i = 0; i < n; ++i) {
+      put_varint(current->raw, prev[i]);
+    }
+  }
+  current->end_time = last_time;
+}
+
+void Wave_writer::next_block() {
+  n_in_flight.fetch_add(1, std::memory_order_relaxed);
+  while (!full_queue.enqueue(current)) {  // writer thread behind: back pressure
+    std::this_thread::yield();
+  }
+
+  Block *block;
+  if (!free_queue.dequeue(block)) {
+    block = new Block;
+    block->raw.reserve(block_size + 64);
+  }
+  block->raw.clear();
+  current = block;
+}
+
+void Wave_writer::write_block(Block *block, std::vector<uint8_t> &comp) {
+  compress(block->raw, comp);
+
+  const uint8_t *payload = comp.data();
+  uint32_t       hdr[2]  = {static_cast<uint32_t>(block->raw.size()), static_cast<uint32_t>(comp.size())};
+  if (comp.size() >= block->raw.size()) {  // not worth it
+    payload = block->raw.data();
+    hdr[1]  = hdr[0];
+  }
+
+  fwrite(hdr, sizeof(uint32_t), 2, ofile);
+  fwrite(&block->start_time, sizeof(uint64_t), 1, ofile);
+  fwrite(&block->end_time, sizeof(uint64_t), 1, ofile);
+  fwrite(payload, 1, hdr[1], ofile);
+}
+
+void Wave_writer::writer_main() {
+  std::vector<uint8_t> comp;
+  comp.reserve(block_size + block_size / 2);
+
+  while (true) {
+    Block *block;
+    if (!full_queue.dequeue(block)) {
+      if (!done.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        continue;
+      }
+      if (!full_queue.dequeue(block))  // last blocks enqueued before done
+        break;
+    }
+
+    write_block(block, comp);
+    if (!free_queue.enqueue(block))
+      delete block;
+    n_in_flight.fetch_sub(1, std::memory_order_release);
+  }
+
+  fflush(ofile);
+}
+
+void Wave_writer::flush() {
+  assert(!closed);
+  if (registering)
+    finalize_registration();
+
+  if (!current->raw.empty())
+    next_block();
+
+  while (n_in_flight.load(std::memory_order_acquire) > 0) {
+    std::this_thread::yield();
+  }
+  fflush(ofile);  // no block in flight, the writer thread is idle
+}
+
+void Wave_writer::close() {
+  if (closed)
+    return;
+
+  if (registering)
+    finalize_registration();
+
+  if (!current->raw.empty())
+    next_block();
+
+  done.store(true, std::memory_order_release);
+  writer_thread.join();
+
+  fclose(ofile);
+  ofile  = nullptr;
+  closed = true;
+
+  delete current;
+  current = nullptr;
+  Block *block;
+  while (free_queue.dequeue(block)) {
+    delete block;
+  }
+}
+
+// LZ77 byte compressor: varint tokens
+//   (len << 1)           followed by len literal bytes
+//   ((len - 4) << 1) | 1 followed by varint offset (copy len bytes from offset back)
+void Wave_writer::compress(const std::vector<uint8_t> &in, std::vector<uint8_t> &out) {
+  constexpr int hash_bits = 13;
+
+  out.clear();
+
+  uint32_t table[1 << hash_bits];
+  memset(table, 0xFF, sizeof(table));
+
+  const size_t n         = in.size();
+  size_t       lit_start = 0;
+  size_t       pos       = 0;
+
+  auto emit_literals = [&](size_t end) {
+    if (end <= lit_start)
+      return;
+    put_varint(out, (end - lit_start) << 1);
+    out.insert(out.end(), in.begin() + lit_start, in.begin() + end);
+  };
+
+  while (pos + 4 <= n) {
+    uint32_t seq;
+    memcpy(&seq, &in[pos], 4);
+    auto h    = (seq * 2654435761u) >> (32 - hash_bits);
+    auto cand = table[h];
+    table[h]  = pos;
+
+    if (cand != UINT32_MAX && memcmp(&in[cand], &in[pos], 4) == 0) {
+      size_t len = 4;
+      while (pos + len < n && in[cand + len] == in[pos + len]) {
+        ++len;
+      }
+      emit_literals(pos);
+      put_varint(out, ((len - 4) << 1) | 1);
+      put_varint(out, pos - cand);
+      pos += len;
+      lit_start = pos;
+      continue;
+    }
+    ++pos;
+  }
+  emit_literals(n);
+}
+
+bool Wave_writer::decompress(const uint8_t *in, size_t in_size, std::vector<uint8_t> &out, size_t raw_size) {
+  out.clear();
+  out.reserve(raw_size);
+
+  const uint8_t *ptr = in;
+  const uint8_t *end = in + in_size;
+  while (ptr < end) {
+    uint64_t token;
+    if (!get_varint(ptr, end, token))
+      return false;
+
+    if ((token & 1) == 0) {
+      auto len = token >> 1;
+      if (len > static_cast<uint64_t>(end - ptr))
+        return false;
+      out.insert(out.end(), ptr, ptr + len);
+      ptr += len;
+      continue;
+    }
+
+    auto     len = (token >> 1) + 4;
+    uint64_t offset;
+    if (!get_varint(ptr, end, offset) || offset == 0 || offset > out.size())
+      return false;
+    auto from = out.size() - offset;
+    for (uint64_t i = 0; i < len; ++i) {  // may overlap
+      uint8_t b = out[from + i];
+      out.emplace_back(b);
+    }
+  }
+
+  return out.size() == raw_size;
+}
+
+Wave_writer *initialize_wave_writer() {
+  const char *var = getenv("SIMLIB_DUMPDIR");
+  std::string dump_file{"SIMLIB_WAVE.lwave"};
+  if (var) {
+    std::string dir{var};
+    dump_file = dir + "/" + "SIMLIB_WAVE.lwave";
+  }
+  static Wave_writer writer{dump_file};
+  return &writer;
+}
+
+Wave_reader::Wave_reader(const std::string &filename) {
+  FILE *in = fopen(filename.c_str(), "r");
+  if (in == nullptr) {
+    set_error("unable to open");
+    return;
+  }
+
+  uint8_t buf[64 * 1024];
+  size_t  sz;
+  while ((sz = fread(buf, 1, sizeof(buf), in)) > 0) file.insert(file.end(), buf, buf + sz);
+  fclose(in);
+
+  read_header();
+}
+
+bool Wave_reader::read_header() {
+  const uint8_t *ptr = file.data();
+  const uint8_t *end = file.data() + file.size();
+
+  const auto &magic = Wave_writer::magic;
+  if (file.size() < magic.size() + sizeof(uint32_t) || memcmp(ptr, magic.data(), magic.size()) != 0)
+    return set_error("not a lwave file");
+  ptr += magic.size();
+
+  uint32_t hdr_size;
+  memcpy(&hdr_size, ptr, sizeof(hdr_size));
+  ptr += sizeof(hdr_size);
+  if (hdr_size > static_cast<size_t>(end - ptr))
+    return set_error("corrupted header");
+
+  const uint8_t *hdr_end = ptr + hdr_size;
+  auto           get_str = [&ptr, hdr_end](std::string &str) {
+    uint64_t len;
+    if (!Wave_writer::get_varint(ptr, hdr_end, len) || len > static_cast<uint64_t>(hdr_end - ptr))
+      return false;
+    str.assign(reinterpret_cast<const char *>(ptr), len);
+    ptr += len;
+    return true;
+  };
+
+  uint64_t n_vars;
+  if (!get_str(timescale) || !Wave_writer::get_varint(ptr, hdr_end, n_vars))
+    return set_error("corrupted header");
+
+  for (uint64_t i = 0; i < n_vars; ++i) {
+    Var      v;
+    uint64_t bits;
+    if (!get_str(v.scope) || !get_str(v.name) || !Wave_writer::get_varint(ptr, hdr_end, bits) || bits == 0)
+      return set_error("corrupted header");
+    v.bits     = bits;
+    v.word_pos = n_words;
+    n_words += (bits + 63) / 64;
+    vars.emplace_back(std::move(v));
+  }
+
+  blocks_pos = hdr_end - file.data();
+  return true;
+}
+
+bool Wave_reader::each_change(const Change_fn &fn) {
+  if (!is_valid())
+    return false;
+
+  std::vector<uint64_t> values(n_words, 0);
+
+  const uint8_t *ptr = file.data() + blocks_pos;
+  const uint8_t *end = file.data() + file.size();
+
+  uint64_t             time     = 0;
+  Wave_var             last_var = 0;
+  std::vector<uint8_t> raw;
+  while (ptr < end) {
+    uint32_t blk[2];
+    uint64_t times[2];
+    if (static_cast<size_t>(end - ptr) < sizeof(blk) + sizeof(times))
+      return set_error("truncated block");
+    memcpy(blk, ptr, sizeof(blk));
+    ptr += sizeof(blk);
+    memcpy(times, ptr, sizeof(times));
+    ptr += sizeof(times);
+    if (blk[1] > static_cast<size_t>(end - ptr))
+      return set_error("truncated block");
+
+    const uint8_t *rptr;
+    const uint8_t *rend;
+    if (blk[0] == blk[1]) {
+      rptr = ptr;
+      rend = ptr + blk[1];
+    } else {
+      if (!Wave_writer::decompress(ptr, blk[1], raw, blk[0]))
+        return set_error("corrupted block");
+      rptr = raw.data();
+      rend = raw.data() + raw.size();
+    }
+    ptr += blk[1];
+
+    while (rptr < rend) {
+      uint64_t token;
+      if (!Wave_writer::get_varint(rptr, rend, token))
+        return set_error("corrupted block");
+
+      if (token & 1) {
+        time += token >> 1;
+        continue;
+      }
+
+      uint64_t zigzag = token >> 1;
+      int64_t  delta  = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+      last_var += delta;
+      if (last_var >= vars.size())
+        return set_error("corrupted block");
+
+      const auto &v = vars[last_var];
+      auto       *w = &values[v.word_pos];
+      for (auto i = 0u; i < (v.bits + 63) / 64; ++i) {
+        uint64_t x;
+        if (!Wave_writer::get_varint(rptr, rend, x))
+          return set_error("corrupted block");
+        w[i] ^= x;
+      }
+
+      fn(time, last_var, w);
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,191 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "likely.hpp"
+#include "spsc.hpp"
+#include "uint.hpp"
+
+// Binary waveform (lwave) writer. An alternative to vcd::VCDWriter for traced
+// livesim runs:
+//
+// -Values are uint64_t words (not strings). Variables are an index (Wave_var)
+//  returned by register_var, so change() does not hash names.
+//
+// -The cycle loop only encodes the changes into the current block (varint
+//  time deltas, variable id deltas, and XOR against the previous value). Full
+//  blocks are handed to a background thread (lock-free spsc queue) that
+//  compresses (LZ) and writes them.
+//
+// wave2vcd converts a lwave file to VCD for the waveform viewers (Wave_reader
+// decodes the file).
+//
+// File: "LWAVE1\n" header (timescale, vars) followed by blocks:
+//   raw_size:u32 comp_size:u32 start_time:u64 end_time:u64 payload[comp_size]
+// comp_size == raw_size means not compressed. Blocks must be decoded in order
+// (the XOR deltas continue across blocks).
+
+using Wave_var = uint32_t;
+
+class Wave_writer {
+public:
+  static constexpr std::string_view magic      = "LWAVE1\n";
+  static constexpr size_t           block_size = 64 * 1024;  // raw bytes per block (before compression)
+
+  Wave_writer(const std::string &filename, std::string_view timescale = "1ns");
+  ~Wave_writer();
+
+  // All the variables must be registered before the first change (like VCD)
+  Wave_var register_var(std::string_view scope, std::string_view name, uint32_t bits);
+
+  // Time must not go backwards
+  void set_time(uint64_t time) {
+    if (likely(time == last_time))
+      return;
+    assert(time > last_time);
+    if (unlikely(registering))
+      finalize_registration();
+    pending_dt += time - last_time;
+    last_time = time;
+  }
+  void advance_time(uint64_t delta) { set_time(last_time + delta); }
+
+  // Return true if the value changed (and it was recorded)
+  bool change(Wave_var var, uint64_t value) { return change(var, &value, 1); }
+  bool change(Wave_var var, const uint64_t *words, int n_words);
+
+  template <int w_>
+  bool change(Wave_var var, const UInt<w_> &val) {
+    if constexpr (UInt<w_>::get_n_words() == 1) {
+      return change(var, static_cast<uint64_t>(val.get_word(0)));
+    } else {
+      uint64_t words[UInt<w_>::get_n_words()];
+      for (int i = 0; i < UInt<w_>::get_n_words(); ++i)
+        words[i] = val.get_word(i);
+      return change(var, words, UInt<w_>::get_n_words());
+    }
+  }
+
+  void flush();  // Hands the current block to the writer thread and waits for the file writes
+  void close();
+
+  size_t get_n_vars() const { return vars.size(); }
+
+  // LZ block compression (also used by wave2vcd to decompress)
+  static void compress(const std::vector<uint8_t> &in, std::vector<uint8_t> &out);
+  static bool decompress(const uint8_t *in, size_t in_size, std::vector<uint8_t> &out, size_t raw_size);
+
+  static void put_varint(std::vector<uint8_t> &buf, uint64_t v) {
+    while (v >= 0x80) {
+      buf.emplace_back(static_cast<uint8_t>(v | 0x80));
+      v >>= 7;
+    }
+    buf.emplace_back(static_cast<uint8_t>(v));
+  }
+  static bool get_varint(const uint8_t *&ptr, const uint8_t *end, uint64_t &v) {
+    v         = 0;
+    int shift = 0;
+    while (ptr < end && shift < 64) {
+      auto b = *ptr++;
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0)
+        return true;
+      shift += 7;
+    }
+    return false;
+  }
+
+protected:
+  struct Var {
+    std::string scope;
+    std::string name;
+    uint32_t    bits;
+    uint32_t    word_pos;  // position in prev_words
+  };
+
+  struct Block {
+    std::vector<uint8_t> raw;
+    uint64_t             start_time;
+    uint64_t             end_time;
+  };
+
+  FILE *      ofile;
+  std::string timescale;
+
+  std::vector<Var>      vars;
+  std::vector<uint64_t> prev_words;  // last value of each var
+
+  bool     registering = true;
+  bool     closed      = false;
+  uint64_t last_time   = 0;
+  uint64_t pending_dt  = 0;  // time advanced since the last recorded change
+  Wave_var last_var    = 0;
+
+  // Producer (simulation thread) side
+  Block *current = nullptr;
+
+  // Handoff: full blocks to the writer thread, empty blocks back (no allocations in steady state)
+  spsc<Block *>     full_queue;
+  spsc<Block *>     free_queue;
+  std::atomic<bool> done{false};
+  std::atomic<int>  n_in_flight{0};
+  std::thread       writer_thread;
+
+  void finalize_registration();
+  void write_header();
+  void next_block();
+  void writer_main();
+  void write_block(Block *block, std::vector<uint8_t> &comp);
+};
+
+Wave_writer *initialize_wave_writer();
+
+// Decodes a lwave file (the whole file is read at open)
+class Wave_reader {
+public:
+  struct Var {
+    std::string scope;
+    std::string name;
+    uint32_t    bits;
+    uint32_t    word_pos;  // position in the values passed to each_change
+  };
+
+  // words: the new value of var ((bits+63)/64 words)
+  using Change_fn = std::function<void(uint64_t time, Wave_var var, const uint64_t *words)>;
+
+  explicit Wave_reader(const std::string &filename);
+
+  bool               is_valid() const { return error.empty(); }
+  const std::string &get_error() const { return error; }  // empty if no error
+
+  const std::string      &get_timescale() const { return timescale; }
+  const std::vector<Var> &get_vars() const { return vars; }
+  uint32_t                get_n_words() const { return n_words; }
+
+  // Calls fn for each recorded change in time order (initial values first).
+  // False (and get_error) if the file is corrupted.
+  bool each_change(const Change_fn &fn);
+
+protected:
+  std::string          error;
+  std::string          timescale;
+  std::vector<Var>     vars;
+  uint32_t             n_words = 0;
+  std::vector<uint8_t> file;
+  size_t               blocks_pos = 0;  // first block in file
+
+  bool set_error(const char *msg) {
+    error = msg;
+    return false;
+  }
+  bool read_header();
+};
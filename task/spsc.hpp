@@ -46,8 +46,8 @@ public:
   spsc(size_t size)
       : _size(size)
       , _mask(size - 1)
-      , _buffer(reinterpret_cast<T *>(aligned_alloc(128, sizeof(T) * (size + 1))))
-      , // need one extra element for a guard
+      , _buffer(reinterpret_cast<T *>(aligned_alloc(128, (sizeof(T) * (size + 1) + 127) & ~size_t(127))))
+      , // need one extra element for a guard (size rounded up to the alignment, as aligned_alloc requires)
       _head(0)
       , _tail(0) {
 
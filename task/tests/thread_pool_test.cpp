@@ -1,5 +1,7 @@
 
 
+#include <chrono>
+#include <ctime>
 #include <iostream>
 
 #include "gtest/gtest.h"
@@ -8,6 +10,7 @@
 #include "spmc.hpp"
 #include "mpmc.hpp"
 #include "thread_pool.hpp"
+#include "spmc_thread_pool.hpp"
 #include "concurrentqueue.hpp"
 
 int control = 1023;
@@ -96,3 +99,135 @@ TEST_F(GTest1, bench) {
   }
 }
 
+
+static int fib_serial(int n) { return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2); }
+
+static void fib_spawn(Thread_pool *pool, int n, int *res) {
+  if (n < 16) {
+    *res = fib_serial(n);
+    return;
+  }
+
+  int               a, b;
+  Thread_pool::Sync sync{0};
+  pool->spawn(sync, fib_spawn, pool, n - 1, &a);
+  fib_spawn(pool, n - 2, &b);
+  pool->sync(sync);
+
+  *res = a + b;
+}
+
+static void add_ptr(int *ptr) { total.fetch_add(*ptr, std::memory_order_relaxed); }
+
+// The pointer is copied, the local variable holding it can be gone when the job runs
+TEST_F(GTest1, pointer_arg) {
+  total = 0;
+  int val = 7;
+
+  Thread_pool pool(1);
+  for (int i = 0; i < 100; ++i) {
+    int *ptr = &val;
+    pool.add(add_ptr, ptr);
+    ptr = nullptr;
+  }
+  pool.wait_all();
+
+  EXPECT_EQ(total, 700);
+}
+
+TEST_F(GTest1, spawn_sync) {
+  for (int n = 1; n < 5; n = n + 2) {
+    Lbench bb("task.THREAD_POOL_fib" + std::to_string(n));
+
+    Thread_pool pool(n);
+
+    int res = 0;
+    fib_spawn(&pool, 30, &res);
+    EXPECT_EQ(res, fib_serial(30));
+
+    // spawn from inside a job (recursive fork/join from a worker)
+    Thread_pool::Sync sync{0};
+    int               res2 = 0;
+    pool.spawn(sync, fib_spawn, &pool, 27, &res2);
+    pool.sync(sync);
+    EXPECT_EQ(res2, fib_serial(27));
+  }
+}
+
+// A sync/wait_all with nothing left to steal blocks (no CPU) until the jobs finish
+TEST_F(GTest1, wait_blocks) {
+  Thread_pool pool(1);
+
+  for (int mode = 0; mode < 2; ++mode) {
+    std::atomic<bool> started{false};
+    Thread_pool::Sync sync{0};
+    auto              job = [&started] {
+      started = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    };
+    if (mode == 0)
+      pool.add(job);
+    else
+      pool.spawn(sync, job);
+
+    while (!started) {  // running in the worker, not in the waiting thread
+      std::this_thread::yield();
+    }
+
+    auto cpu_start = std::clock();
+    if (mode == 0)
+      pool.wait_all();
+    else
+      pool.sync(sync);
+    auto cpu_ms = (std::clock() - cpu_start) * 1000.0 / CLOCKS_PER_SEC;
+
+    EXPECT_LT(cpu_ms, 50);
+  }
+}
+
+// Throughput (jobs/s) and latency (add to start of execution) for the
+// work-stealing Thread_pool and the previous spmc256 pool
+template <class Pool> static void bench_pool(const std::string &name, int n) {
+  constexpr int JOB_COUNT = 2000000;
+  constexpr int LAT_COUNT = 20000;
+
+  Pool pool(n);
+
+  total = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  {
+    Lbench bb("task.THREAD_POOL_" + name + "_throughput" + std::to_string(n));
+    for (int i = 0; i < JOB_COUNT; ++i) {
+      pool.add(mywork, 1);
+    }
+    pool.wait_all();
+  }
+  auto   stop = std::chrono::high_resolution_clock::now();
+  double secs = std::chrono::duration<double>(stop - start).count();
+  EXPECT_EQ(total, JOB_COUNT);
+
+  double lat_total = 0;
+  {
+    Lbench bb("task.THREAD_POOL_" + name + "_latency" + std::to_string(n));
+    for (int i = 0; i < LAT_COUNT; ++i) {
+      std::atomic<int64_t> exec_ns{0};
+      auto                 add_time = std::chrono::high_resolution_clock::now();
+      pool.add([&exec_ns]() {
+        exec_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+      });
+      pool.wait_all();
+      lat_total += exec_ns - std::chrono::duration_cast<std::chrono::nanoseconds>(add_time.time_since_epoch()).count();
+    }
+  }
+
+  std::cout << name << " threads:" << pool.size() << " throughput:" << JOB_COUNT / secs / 1e6 << " Mjobs/s"
+            << " latency:" << lat_total / LAT_COUNT << " ns" << std::endl;
+}
+
+TEST_F(GTest1, pool_bench) {
+  for (int n = 1; n < 5; n = n + 2) {
+    bench_pool<Thread_pool>("ws", n);
+    if (std::thread::hardware_concurrency() > 1)  // Spmc_thread_pool needs at least one extra core
+      bench_pool<Spmc_thread_pool>("spmc", n);
+  }
+}
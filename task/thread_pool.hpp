@@ -2,24 +2,20 @@
 #pragma once
 
 #include <cassert>
-#include <unistd.h>
+#include <cstring>
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
-#include <iostream>
-
-//#define MPMC
-#ifdef MPMC
-#include "mpmc.hpp"
-#else
-#include "spmc.hpp"
-#endif
+#include "work_deque.hpp"
 
 template <class Func, class... Args> inline auto forward_as_lambda(Func &&func, Args &&... args) {
   return [f   = std::forward<decltype(func)>(func),
@@ -35,133 +31,323 @@ template <class Func, class T, class... Args> inline auto forward_as_lambda2(Fun
   };
 }
 
+// Job with small buffer storage (one cache line). Trivially copyable
+// callables that fit are stored inline, others are heap allocated.
+class Task_job {
+public:
+  static constexpr size_t Buffer_size = 48;
+
+  void (*run)(Task_job &job);
+  std::atomic<int> *sync;  // decremented once done (nullptr for add)
+  alignas(8) unsigned char buffer[Buffer_size];
+
+  template <class Func> void setup(Func &&func, std::atomic<int> *_sync) {
+    using Fn = std::decay_t<Func>;
+
+    sync = _sync;
+    if constexpr (sizeof(Fn) <= Buffer_size && alignof(Fn) <= 8 && std::is_trivially_copyable_v<Fn>) {
+      new (buffer) Fn(std::forward<Func>(func));
+      run = [](Task_job &job) { (*std::launder(reinterpret_cast<Fn *>(job.buffer)))(); };
+    } else {
+      Fn *ptr = new Fn(std::forward<Func>(func));
+      memcpy(buffer, &ptr, sizeof(ptr));
+      run = [](Task_job &job) {
+        Fn *fn;
+        memcpy(&fn, job.buffer, sizeof(fn));
+        (*fn)();
+        delete fn;
+      };
+    }
+  }
+};
+
+static_assert(sizeof(Task_job) == 64);
+static_assert(std::is_trivially_copyable_v<Task_job>);
+
+// Work-stealing thread pool.
+//
+// Each worker has a Work_deque. Jobs added from a worker (or from the thread
+// that created the pool) go to its own deque without locks. Other threads use
+// a shared injection queue. Idle workers steal, and park in a condition
+// variable after a short spin (no busy wait).
+//
+// Fork/join: spawn(sync,...) + sync(sync). The thread waiting in sync (or
+// wait_all) executes pending jobs, so recursive spawns do not deadlock. When
+// there is nothing left to steal, it blocks in the same condition variable
+// until the jobs finish or new work shows up.
 class Thread_pool {
+public:
+  using Sync = std::atomic<int>;
+
+protected:
+  using Deque = Work_deque<Task_job>;
+
+  static constexpr int Spin_rounds = 64;
 
-  std::vector<std::thread> threads;
-#ifdef MPMC
-  mpmc<std::function<void(void)>> queue;
-#else
-  spmc256<std::function<void(void)>> queue;
-#endif
+  std::vector<std::thread>            threads;
+  std::vector<std::unique_ptr<Deque>> deques;  // one per worker, plus one for the creator thread
+
+  std::mutex           inject_mutex;
+  std::deque<Task_job> inject_queue;
+  std::atomic<int>     inject_size;
 
   std::atomic<int>  jobs_left;
   std::atomic<bool> finishing;
 
+  std::mutex              park_mutex;
+  std::condition_variable park_cv;
+  std::atomic<int>        n_parked;
+  std::atomic<int>        n_waiting;   // blocked in help_until
+  uint64_t                park_epoch;  // protected by park_mutex
+
   size_t thread_count;
 
-  std::condition_variable job_available_var;
-  std::mutex              queue_mutex;
+  static inline thread_local Thread_pool *tls_pool = nullptr;
+  static inline thread_local int          tls_slot = -1;
 
-  void task() {
-    static std::atomic_flag lock = ATOMIC_FLAG_INIT;
+  int get_slot() const { return tls_pool == this ? tls_slot : -1; }
 
-    if (!lock.test_and_set(std::memory_order_acquire)) {
-      for(unsigned i = 1; i < thread_count; ++i)
-        threads.push_back(std::thread([this] { this->task(); }));
-    }
+  static uint32_t next_victim() {
+    static thread_local uint32_t seed = 0x9E3779B9u ^ (uint32_t)(uintptr_t)&seed;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  void execute(Task_job &job) {
+    auto *sync = job.sync;
+    job.run(job);
 
-    while(!finishing) {
-      while(!queue.empty()) {
-        next_job()();
-        jobs_left.fetch_sub(1, std::memory_order_relaxed);
+    bool last = false;
+    if (sync)
+      last = sync->fetch_sub(1, std::memory_order_acq_rel) == 1;
+    last |= jobs_left.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    if (last)
+      wake_waiting();
+  }
+
+  bool try_get_job(int slot, Task_job &job) {
+    if (slot >= 0 && deques[slot]->pop(job))
+      return true;
+
+    if (inject_size.load(std::memory_order_acquire) > 0) {
+      std::lock_guard<std::mutex> guard(inject_mutex);
+      if (!inject_queue.empty()) {
+        job = inject_queue.front();
+        inject_queue.pop_front();
+        inject_size.fetch_sub(1, std::memory_order_release);
+        return true;
       }
     }
-  }
 
-  std::function<void(void)> next_job() {
-    std::function<void(void)>    res;
-    std::unique_lock<std::mutex> job_lock(queue_mutex);
+    const auto n = deques.size();
+    auto       v = next_victim();
+    for (auto i = 0u; i < n; ++i) {
+      auto victim = (v + i) % n;
+      if (static_cast<int>(victim) == slot)
+        continue;
+      if (deques[victim]->steal(job))
+        return true;
+    }
 
-    // Wait for a job if we don't have any.
-    job_available_var.wait(job_lock, [this]() -> bool { return !queue.empty() || finishing; });
+    return false;
+  }
 
-    bool has_work = queue.dequeue(res);
-    if (has_work) {
-      return res;
+  bool has_work() const {
+    if (inject_size.load(std::memory_order_acquire) > 0)
+      return true;
+    for (const auto &d : deques) {
+      if (!d->empty())
+        return true;
     }
+    return false;
+  }
 
-    jobs_left.fetch_add(1, std::memory_order_relaxed);
+  void wake_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the n_parked/n_waiting increment
+    if (n_parked.load(std::memory_order_relaxed) == 0 && n_waiting.load(std::memory_order_relaxed) == 0)
+      return;
 
-    return [] {}; // Nothing to do
+    {
+      std::lock_guard<std::mutex> guard(park_mutex);
+      ++park_epoch;
+    }
+    park_cv.notify_one();
   }
 
-  void add_(std::function<void(void)> job) {
-    //static int n_inline=0;
-    //static int n_thread=0;
-    //if (((n_thread+n_inline)&0xFFFF)==0) {
-      //std::cout << "n_thread:" << n_thread << " n_inline:" << n_inline << "\n";
-    //}
-    if(jobs_left > 48) {
-      //++n_inline;
-      job();
+  void wake_waiting() {  // a sync counter reached zero
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the n_waiting increment in help_until
+    if (n_waiting.load(std::memory_order_relaxed) == 0)
       return;
+
+    {
+      std::lock_guard<std::mutex> guard(park_mutex);
+      ++park_epoch;
     }
-    //++n_thread;
+    park_cv.notify_all();
+  }
+
+  void park() {
+    std::unique_lock<std::mutex> lock(park_mutex);
+    const auto                   epoch = park_epoch;
+
+    n_parked.fetch_add(1, std::memory_order_seq_cst);
+    if (!has_work() && !finishing) {
+      park_cv.wait(lock, [this, epoch]() { return park_epoch != epoch || finishing; });
+    }
+    n_parked.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void task(int slot) {
+    tls_pool = this;
+    tls_slot = slot;
+
+    Task_job job;
+    while (!finishing) {
+      bool done = false;
+      for (int i = 0; i < Spin_rounds && !done; ++i) {
+        if (try_get_job(slot, job)) {
+          execute(job);
+          done = true;
+        } else if (i > Spin_rounds / 2) {
+          std::this_thread::yield();
+        }
+      }
+      if (!done)
+        park();
+    }
+  }
+
+  // Trivially copyable function and arguments passed by value produce a
+  // trivially copyable callable (stored inline in the Task_job). Lvalue
+  // arguments are passed by reference like forward_as_lambda does.
+  template <class Func, class... Args> static auto make_callable(Func &&func, Args &&... args) {
+    if constexpr ((... && !std::is_lvalue_reference_v<Args>) && std::is_trivially_copyable_v<std::decay_t<Func>>
+                  && (... && std::is_trivially_copyable_v<std::decay_t<Args>>)) {
+      return [f = func, args...]() mutable { std::invoke(f, args...); };
+    } else {
+      return forward_as_lambda(std::forward<Func>(func), std::forward<Args>(args)...);
+    }
+  }
+
+  template <class Func> void submit(Func &&func, Sync *sync) {
+    Task_job job;
+    job.setup(std::forward<Func>(func), sync);
+
     jobs_left.fetch_add(1, std::memory_order_relaxed);
-    queue.enqueue(job);
-    job_available_var.notify_one();
+
+    auto slot = get_slot();
+    if (slot >= 0) {
+      if (!deques[slot]->push(job)) {
+        execute(job);  // Deque full, run inline
+        return;
+      }
+    } else {
+      std::lock_guard<std::mutex> guard(inject_mutex);
+      inject_queue.emplace_back(job);
+      inject_size.fetch_add(1, std::memory_order_release);
+    }
+
+    wake_one();
+  }
+
+  void help_until(const std::atomic<int> &counter) {
+    auto     slot = get_slot();
+    Task_job job;
+    int      misses = 0;
+    while (counter.load(std::memory_order_acquire) > 0) {
+      if (try_get_job(slot, job)) {
+        execute(job);
+        misses = 0;
+        continue;
+      }
+      if (++misses < Spin_rounds) {
+        if (misses > Spin_rounds / 2)
+          std::this_thread::yield();
+        continue;
+      }
+
+      // Nothing to steal: the pending jobs run in other threads
+      std::unique_lock<std::mutex> lock(park_mutex);
+      const auto                   epoch = park_epoch;
+
+      n_waiting.fetch_add(1, std::memory_order_seq_cst);
+      if (counter.load(std::memory_order_seq_cst) > 0 && !has_work()) {
+        park_cv.wait(lock, [this, epoch, &counter]() {
+          return park_epoch != epoch || counter.load(std::memory_order_acquire) == 0;
+        });
+      }
+      n_waiting.fetch_sub(1, std::memory_order_relaxed);
+      misses = 0;
+    }
   }
 
 public:
-  Thread_pool(int _thread_count = 0)
-      :
-#ifdef MPMC
-      queue(256)
-      ,
-#endif
-      jobs_left(0)
-      , finishing(false) {
+  Thread_pool(int _thread_count = 0) : inject_size(0), jobs_left(0), finishing(false), n_parked(0), n_waiting(0), park_epoch(0) {
+    size_t lim = std::thread::hardware_concurrency();
+    if (lim > 1)
+      lim--;  // -1 for calling thread
 
     thread_count = _thread_count;
-    size_t lim   = (std::thread::hardware_concurrency() - 1); // -1 for calling thread
-
-    if(thread_count > lim || thread_count == 0)
+    if (thread_count > lim || thread_count == 0)
       thread_count = lim;
-    else if(thread_count < 1)
-      thread_count = 1;
 
     assert(thread_count);
 
-    threads.push_back(std::thread([this] { this->task(); })); // Just one thread in critical path
+    for (auto i = 0u; i <= thread_count; ++i) {
+      deques.emplace_back(std::make_unique<Deque>());
+    }
+
+    if (tls_pool == nullptr) {  // The creator thread gets the last deque
+      tls_pool = this;
+      tls_slot = thread_count;
+    }
+
+    for (auto i = 0u; i < thread_count; ++i) {
+      threads.emplace_back([this, i] { this->task(i); });
+    }
   }
 
   ~Thread_pool() {
     wait_all();
 
     {
-      std::lock_guard<std::mutex> lock(queue_mutex);
+      std::lock_guard<std::mutex> guard(park_mutex);
       finishing = true;
+      ++park_epoch;
     }
-    job_available_var.notify_all();
+    park_cv.notify_all();
 
-    for(auto &x : threads)
-      if(x.joinable())
+    for (auto &x : threads)
+      if (x.joinable())
         x.join();
-  }
 
-  inline unsigned size() const {
-    return thread_count;
+    if (tls_pool == this) {
+      tls_pool = nullptr;
+      tls_slot = -1;
+    }
   }
 
+  inline unsigned size() const { return thread_count; }
+
   template <class Func, class... Args> void add(Func &&func, Args &&... args) {
-    return add_(forward_as_lambda(std::forward<decltype(func)>(func), std::forward<decltype(args)>(args)...));
+    submit(make_callable(std::forward<Func>(func), std::forward<Args>(args)...), nullptr);
   }
-#if 1
+
+  // A pointer first argument is copied, even if it is an lvalue (the job may
+  // run after the caller's pointer variable is gone)
   template <class Func, class T, class... Args> void add(Func &&func, T *first, Args &&... args) {
-    return add_(forward_as_lambda2(std::forward<decltype(func)>(func), std::forward<decltype(first)>(first),
-                                   std::forward<decltype(args)>(args)...));
-  }
-#endif
-
-  void wait_all() {
-    while(jobs_left > 0) {
-      std::function<void(void)> res;
-      bool                      has_work = queue.dequeue(res);
-      if(has_work) {
-        res();
-        jobs_left.fetch_sub(1, std::memory_order_relaxed);
-      }
-    }
+    submit(make_callable(std::forward<Func>(func), std::move(first), std::forward<Args>(args)...), nullptr);
   }
-};
 
+  // Fork/join: spawn jobs tracked by sync, and wait (helping) with sync(sync)
+  template <class Func, class... Args> void spawn(Sync &sync, Func &&func, Args &&... args) {
+    sync.fetch_add(1, std::memory_order_relaxed);
+    submit(make_callable(std::forward<Func>(func), std::forward<Args>(args)...), &sync);
+  }
+
+  void sync(const Sync &sync) { help_until(sync); }
+
+  void wait_all() { help_until(jobs_left); }
+};
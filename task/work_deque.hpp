@@ -0,0 +1,84 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <type_traits>
+
+// Bounded Chase-Lev work-stealing deque. The owner thread push/pop at the
+// bottom (LIFO), any other thread can steal from the top (FIFO).
+//
+// Slots are copied by value (memcpy) so Type must be trivially copyable. A
+// thief may copy a slot that is being recycled, but the copy is discarded
+// when the top CAS fails.
+template <class Type, int Log2_size = 10> class Work_deque {
+private:
+  static_assert(std::is_trivially_copyable_v<Type>, "Work_deque slots are copied by value");
+
+  static constexpr int64_t Size = 1 << Log2_size;
+  static constexpr int64_t Mask = Size - 1;
+
+  typedef char cache_line_pad_t[128];  // Some CPUs could have 128 cache line in LLC
+
+  std::atomic<int64_t> top;
+  cache_line_pad_t     _pad1;
+  std::atomic<int64_t> bottom;
+  cache_line_pad_t     _pad2;
+  Type                 array[Size];
+
+public:
+  Work_deque() : top(0), bottom(0) {}
+
+  // Owner only. Returns false when full (caller should run the job inline)
+  bool push(const Type &data) {
+    auto b = bottom.load(std::memory_order_relaxed);
+    auto t = top.load(std::memory_order_acquire);
+    if (b - t >= Size)
+      return false;
+
+    memcpy(&array[b & Mask], &data, sizeof(Type));
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  // Owner only
+  bool pop(Type &data) {
+    auto b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {  // empty
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    memcpy(&data, &array[b & Mask], sizeof(Type));
+    if (t != b)
+      return true;
+
+    // Last entry, race against thieves
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+
+  // Any thread
+  bool steal(Type &data) {
+    auto t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+      return false;
+
+    memcpy(&data, &array[t & Mask], sizeof(Type));
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  bool empty() const { return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed); }
+};